@@ -19,6 +19,7 @@
  */
 
 void PrepareForMapShadow(vec3 vertexCoord, vec3 normal);
+void PrepareForMapFaceShadow(vec3 faceCoord, vec3 normal);
 void PrepareForModelShadow(vec3 vertexCoord, vec3 normal);
 void PrepareForMapRadiosity(vec3 vertexCoord, vec3 normal);
 void PrepareForMapRadiosityForMap(vec3 vertexCoord, vec3 centerCoord, vec3 normal);
@@ -31,7 +32,7 @@ void PrepareShadow(vec3 vertexCoord, vec3 normal) {
 
 // map uses specialized shadow coordinate calculation to avoid glitch
 void PrepareShadowForMap(vec3 vertexCoord, vec3 centerCoord, vec3 normal) {
-	PrepareForMapShadow(centerCoord + normal * 0.1, normal);
+	PrepareForMapFaceShadow(centerCoord, normal);
 	PrepareForModelShadow(vertexCoord, normal);
 	PrepareForMapRadiosityForMap(vertexCoord, centerCoord, normal);
 }
\ No newline at end of file
@@ -18,16 +18,20 @@
 
  */
 
-varying vec3 mapShadowCoord;
+// the position the map shadow is evaluated at, and the normal of the map
+// face it was computed for (zero elsewhere)
+varying vec3 mapShadowPosition;
+varying vec3 mapShadowFaceNormal;
 
 void PrepareForMapShadow(vec3 vertexCoord, vec3 normal) {
-	mapShadowCoord = vertexCoord;
-	mapShadowCoord.y -= mapShadowCoord.z;
-
-	// texture value is normalized unsigned integer
-	mapShadowCoord.z /= 255.0;
-
-	// texture coord is normalized
-	// FIXME: variable texture size
-	mapShadowCoord.xy /= 512.0;
-}
\ No newline at end of file
+	mapShadowPosition = vertexCoord;
+	mapShadowFaceNormal = vec3(0.0);
+}
+
+// `faceCoord` is the center of a voxel face, or anywhere on a face merged
+// from several voxel faces; either way the shadow is evaluated at the
+// center of the voxel face under the fragment
+void PrepareForMapFaceShadow(vec3 faceCoord, vec3 normal) {
+	mapShadowPosition = faceCoord;
+	mapShadowFaceNormal = normal;
+}
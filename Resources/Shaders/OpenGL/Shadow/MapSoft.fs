@@ -25,7 +25,28 @@
 
 uniform sampler2D mapShadowTexture;
 
-varying vec3 mapShadowCoord;
+varying vec3 mapShadowPosition;
+varying vec3 mapShadowFaceNormal;
+
+vec3 ComputeMapShadowCoord() {
+	vec3 coord = mapShadowPosition;
+	vec3 normal = mapShadowFaceNormal;
+
+	// map faces are evaluated at the center of the voxel face under the
+	// fragment, nudged off the face, so that the shadow edges follow the
+	// voxels even on faces merged by the mesher
+	if (dot(normal, normal) > 0.5)
+		coord = floor(coord - normal * 0.5) + 0.5 + normal * 0.6;
+
+	coord.y -= coord.z;
+
+	// texture value is normalized unsigned integer
+	coord.z /= 255.0;
+
+	// don't normalize texture coord here
+
+	return coord;
+}
 
 vec3 MapSoft_BlockSample(vec2 sample, float depth, float shiftedDepth) {
 	const float factor = 1.0 / 512.0;
@@ -37,6 +58,7 @@ vec3 MapSoft_BlockSample(vec2 sample, float depth, float shiftedDepth) {
 }
 
 float EvaluateMapShadow() {
+	vec3 mapShadowCoord = ComputeMapShadowCoord();
 	float depth = mapShadowCoord.z;
 	vec2 iPos = (floor(mapShadowCoord.xy));
 	vec2 fracPos = mapShadowCoord.xy - iPos.xy; // [0, 1]
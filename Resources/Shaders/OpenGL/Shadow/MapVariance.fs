@@ -19,9 +19,33 @@
  */
 
 uniform sampler2D mapShadowTexture;
-varying vec3 mapShadowCoord;
+varying vec3 mapShadowPosition;
+varying vec3 mapShadowFaceNormal;
+
+vec3 ComputeMapShadowCoord() {
+	vec3 coord = mapShadowPosition;
+	vec3 normal = mapShadowFaceNormal;
+
+	// map faces are evaluated at the center of the voxel face under the
+	// fragment, nudged off the face, so that the shadow edges follow the
+	// voxels even on faces merged by the mesher
+	if (dot(normal, normal) > 0.5)
+		coord = floor(coord - normal * 0.5) + 0.5 + normal * 0.6;
+
+	coord.y -= coord.z;
+
+	// texture value is normalized unsigned integer
+	coord.z /= 255.0;
+
+	// texture coord is normalized
+	// FIXME: variable texture size
+	coord.xy /= 512.0;
+
+	return coord;
+}
 
 float EvaluateMapShadow() {
+	vec3 mapShadowCoord = ComputeMapShadowCoord();
 	const vec2 mapSize = vec2(512.0); // TODO: variable?
 	vec2 mapSizeInv = 1.0 / mapSize;
 
@@ -26,10 +26,14 @@ uniform vec3 frontVector;
 uniform vec3 viewOriginVector;
 uniform vec2 zNearFar;
 
+// per instance
 attribute vec4 positionAttribute;
-attribute vec3 spritePosAttribute;
+attribute float angleAttribute;
 attribute vec4 colorAttribute;
 
+// per vertex
+attribute vec2 cornerAttribute;
+
 varying vec4 color;
 varying vec4 texCoord;
 varying vec4 fogDensity;
@@ -46,11 +50,11 @@ void main() {
 	vec3 right = rightVector * radius;
 	vec3 up = upVector * radius;
 
-	float angle = spritePosAttribute.z;
+	float angle = angleAttribute;
 	float c = cos(angle), s = sin(angle);
 	vec2 sprP;
-	sprP.x = dot(spritePosAttribute.xy, vec2(c, -s));
-	sprP.y = dot(spritePosAttribute.xy, vec2(s, c));
+	sprP.x = dot(cornerAttribute, vec2(c, -s));
+	sprP.y = dot(cornerAttribute, vec2(s, c));
 	sprP *= radius;
 	pos += right * sprP.x;
 	pos += up * sprP.y;
@@ -72,7 +76,7 @@ void main() {
 	color = colorAttribute;
 
 	// sprite texture coord
-	texCoord.xy = spritePosAttribute.xy * 0.5 + 0.5;
+	texCoord.xy = cornerAttribute * 0.5 + 0.5;
 
 	// depth texture coord
 	texCoord.zw = vec2(0.5) + (gl_Position.xy / gl_Position.w) * 0.5;
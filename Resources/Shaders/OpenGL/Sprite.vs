@@ -24,10 +24,14 @@ uniform vec3 rightVector;
 uniform vec3 upVector;
 uniform vec3 viewOriginVector;
 
+// per instance
 attribute vec4 positionAttribute;
-attribute vec3 spritePosAttribute;
+attribute float angleAttribute;
 attribute vec4 colorAttribute;
 
+// per vertex
+attribute vec2 cornerAttribute;
+
 varying vec4 color;
 varying vec2 texCoord;
 varying vec4 fogDensity;
@@ -41,11 +45,11 @@ void main() {
 	vec3 right = rightVector * radius;
 	vec3 up = upVector * radius;
 
-	float angle = spritePosAttribute.z;
+	float angle = angleAttribute;
 	float c = cos(angle), s = sin(angle);
 	vec2 sprP;
-	sprP.x = dot(spritePosAttribute.xy, vec2(c, -s));
-	sprP.y = dot(spritePosAttribute.xy, vec2(s, c));
+	sprP.x = dot(cornerAttribute, vec2(c, -s));
+	sprP.y = dot(cornerAttribute, vec2(s, c));
 	sprP *= radius;
 	pos += right * sprP.x;
 	pos += up * sprP.y;
@@ -55,7 +59,7 @@ void main() {
 	color = colorAttribute;
 	
 	// sprite texture coord
-	texCoord = spritePosAttribute.xy * 0.5 + 0.5;
+	texCoord = cornerAttribute * 0.5 + 0.5;
 
 	// fog.
 	// cannot gamma correct because sprite may be
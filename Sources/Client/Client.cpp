@@ -49,7 +49,11 @@
 
 #include "BloodMarks.h"
 #include "Corpse.h"
-#include "SmokeSpriteEntity.h"
+#include "FallingBlock.h"
+#include "GunCasing.h"
+#include "OcclusionBuffer.h"
+#include "ParticleSystem.h"
+#include "Tracer.h"
 
 #include "GameMap.h"
 #include "Weapon.h"
@@ -86,7 +90,6 @@ namespace spades {
 			  time(0.0F),
 			  readyToClose(false),
 
-			  worldSubFrame(0.0F),
 			  worldSubFrameFast(0.0F),
 			  frameToRendererInit(5),
 			  timeSinceInit(0.0F),
@@ -139,6 +142,14 @@ namespace spades {
 			renderer->SetFogColor(MakeVector3(0, 0, 0));
 			renderer->SetFogDistance(128.0F);
 
+			particleSystem = stmp::make_unique<ParticleSystem>(*this);
+			tracerPool = stmp::make_unique<LocalEntityPool<Tracer>>("Tracers");
+			mapViewTracerPool = stmp::make_unique<LocalEntityPool<MapViewTracer>>("Map Tracers");
+			gunCasingPool = stmp::make_unique<LocalEntityPool<GunCasing>>("Casings");
+			localEntityPools = {particleSystem.get(), tracerPool.get(), mapViewTracerPool.get(),
+			                    gunCasingPool.get()};
+			occlusionBuffer = stmp::make_unique<OcclusionBuffer>();
+
 			auto* chatFont = cg_smallFont ? &fontManager->GetSmallFont() : &fontManager->GetGuiFont();
 			auto* centerFont = cg_centerMessageSmallFont ? &fontManager->GetMediumFont() : &fontManager->GetLargeFont();
 
@@ -231,7 +242,6 @@ namespace spades {
 			limbo->SetSelectedWeapon(RIFLE_WEAPON);
 			inGameLimbo = false;
 
-			worldSubFrame = 0.0F;
 			worldSubFrameFast = 0.0F;
 			worldSetTime = time;
 		}
@@ -325,7 +335,7 @@ namespace spades {
 			bloodMarks = stmp::make_unique<BloodMarks>(*this);
 
 			// load images
-			SmokeSpriteEntity::Preload(renderer.GetPointerOrNull());
+			particleSystem->Preload();
 
 			renderer->RegisterImage("Gfx/Bullet/7.62mm.png");
 			renderer->RegisterImage("Gfx/Bullet/9mm.png");
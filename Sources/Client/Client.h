@@ -35,9 +35,11 @@
 #include "ILocalEntity.h"
 #include "IRenderer.h"
 #include "IWorldListener.h"
+#include "LocalEntityPool.h"
 #include "MumbleLink.h"
 #include "NoiseSampler.h"
 #include "Player.h"
+#include "ProjectilePhysics.h"
 #include <Core/Math.h>
 #include <Core/ServerAddress.h>
 #include <Core/Stopwatch.h>
@@ -65,6 +67,7 @@ namespace spades {
 		class ChatWindow;
 		class CenterMessageView;
 		class Corpse;
+		class FallingBlock;
 		class HurtRingView;
 		class MapView;
 		class ScoreboardView;
@@ -76,6 +79,11 @@ namespace spades {
 		class BloodMarks;
 		class ClientUI;
 		class PieMenuView;
+		class ParticleSystem;
+		class Tracer;
+		class MapViewTracer;
+		class GunCasing;
+		class OcclusionBuffer;
 
 		class Client : public IWorldListener, public gui::View {
 			friend class ScoreboardView;
@@ -144,7 +152,6 @@ namespace spades {
 			Handle<IAudioDevice> audioDevice;
 			float time;
 			bool readyToClose;
-			float worldSubFrame;
 			float worldSubFrameFast;
 
 			int frameToRendererInit;
@@ -450,8 +457,26 @@ namespace spades {
 			float mapReceivingProgressSmoothed = 0.0F;
 
 			std::list<std::unique_ptr<ILocalEntity>> localEntities;
+
+			// frequently spawned local entities live in pools instead of `localEntities`
+			std::unique_ptr<ParticleSystem> particleSystem;
+			std::unique_ptr<LocalEntityPool<Tracer>> tracerPool;
+			std::unique_ptr<LocalEntityPool<MapViewTracer>> mapViewTracerPool;
+			std::unique_ptr<LocalEntityPool<GunCasing>> gunCasingPool;
+			std::array<ILocalEntityPool*, 4> localEntityPools;
+			double localEntityStatTime = 0.0;
+			int localEntityStatFrames = 0;
+			void UpdateLocalEntities(float dt);
 			std::list<std::unique_ptr<Corpse>> corpses;
 			Corpse* lastLocalCorpse;
+
+			std::vector<std::unique_ptr<FallingBlock>> fallingBlocks;
+			ProjectileBatch fallingBlockBatch;
+			float fallingBlockSubFrame = 0.0F;
+			double fallingBlockStatTime = 0.0;
+			int fallingBlockStatSteps = 0;
+			void UpdateFallingBlocks(float dt);
+
 			void RemoveCorpses();
 			void RemoveInvisibleCorpses();
 			void RemoveCorpseForPlayer(int playerId);
@@ -459,6 +484,15 @@ namespace spades {
 
 			std::unique_ptr<BloodMarks> bloodMarks;
 
+			/** Map depth of the current frame, used to skip hidden models. */
+			std::unique_ptr<OcclusionBuffer> occlusionBuffer;
+			/** Time spent adding the players and corpses to the scene and how
+			 * many were added, to estimate what the occlusion culling saves. */
+			double occlusionModelTime = 0.0;
+			std::size_t occlusionNumModels = 0;
+			int occlusionNumFrames = 0;
+			void UpdateOcclusionBuffer();
+
 			int nextScreenShotIndex;
 			int nextMapShotIndex;
 
@@ -615,11 +649,21 @@ namespace spades {
 			void AddLocalEntity(std::unique_ptr<ILocalEntity>&& ent) {
 				localEntities.emplace_back(std::move(ent));
 			}
+			ParticleSystem& GetParticleSystem() { return *particleSystem; }
+			LocalEntityPool<Tracer>& GetTracerPool() { return *tracerPool; }
+			LocalEntityPool<MapViewTracer>& GetMapViewTracerPool() { return *mapViewTracerPool; }
+			LocalEntityPool<GunCasing>& GetGunCasingPool() { return *gunCasingPool; }
 
 			void MarkWorldUpdate();
 
 			IRenderer& GetRenderer() { return *renderer; }
 			SceneDefinition GetLastSceneDef() { return lastSceneDef; }
+			/**
+			 * @return `true` if a model within `box` is certainly hidden behind
+			 *         the map in the current frame, along with its shadow and
+			 *         its water reflection.
+			 */
+			bool IsOccludedByMap(const AABB3& box);
 			IAudioDevice& GetAudioDevice() { return *audioDevice; }
 
 			float GetTime() { return time; }
@@ -78,6 +78,7 @@ namespace spades {
 			Handle<IRenderer> base;
 			AABB3 clipBox;
 			bool allowDepthHack;
+			bool allowModels;
 
 			void OnProhibitedAction() {}
 
@@ -99,10 +100,11 @@ namespace spades {
 			~SandboxedRenderer() {}
 
 		public:
-			SandboxedRenderer(Handle<IRenderer> base) : base(std::move(base)) {}
+			SandboxedRenderer(Handle<IRenderer> base) : base(std::move(base)), allowModels(true) {}
 
 			void SetClipBox(const AABB3& b) { clipBox = b; }
 			void SetAllowDepthHack(bool h) { allowDepthHack = h; }
+			void SetAllowModels(bool m) { allowModels = m; }
 
 			void Init() { OnProhibitedAction(); }
 			void Shutdown() { OnProhibitedAction(); }
@@ -134,6 +136,9 @@ namespace spades {
 			}
 
 			void RenderModel(IModel& model, const ModelRenderParam& _p) {
+				if (!allowModels)
+					return;
+
 				ModelRenderParam p = _p;
 
 				if (p.depthHack && !allowDepthHack) {
@@ -163,6 +168,14 @@ namespace spades {
 				if (CheckVisibility(AABB3(center - rad, center + rad)))
 					base->AddSprite(image, center, radius, rotation);
 			}
+			void AddSprites(IImage& image, const SpriteParam* sprites, std::size_t count) {
+				for (std::size_t i = 0; i < count; i++) {
+					const SpriteParam& s = sprites[i];
+					Vector3 rad(s.radius * 1.5F, s.radius * 1.5F, s.radius * 1.5F);
+					if (CheckVisibility(AABB3(s.center - rad, s.center + rad)))
+						base->AddSprites(image, &s, 1);
+				}
+			}
 			void AddLongSprite(IImage& image, Vector3 p1, Vector3 p2, float radius) {
 				Vector3 rad(radius * 1.5F, radius * 1.5F, radius * 1.5F);
 				AABB3 bounds1(p1 - rad, p1 + rad);
@@ -512,7 +525,7 @@ namespace spades {
 		}
 
 		Matrix4 ClientPlayer::GetEyeMatrix() {
-			Vector3 eye = player.GetEye();
+			Vector3 eye = player.GetEye(true);
 
 			if ((int)cg_shake >= 2 && !player.GetWade()) {
 				float sp = SmoothStep(sprintState);
@@ -635,6 +648,7 @@ namespace spades {
 			);
 			sandboxedRenderer->SetClipBox(clip);
 			sandboxedRenderer->SetAllowDepthHack(true); // allow depthhack
+			sandboxedRenderer->SetAllowModels(true);
 
 			// no flashlight if spectating other players while dead
 			if (client.flashlightOn && p.IsLocalPlayer()) {
@@ -880,7 +894,7 @@ namespace spades {
 			float yaw = atan2f(o.y, o.x) + M_PI_F * 0.5F;
 
 			// lower axis
-			Matrix4 const lower = Matrix4::Translate(p.GetOrigin())
+			Matrix4 const lower = Matrix4::Translate(p.GetOrigin(true))
 				* Matrix4::Rotate(MakeVector3(0, 0, 1), yaw);
 
 			Matrix4 const scaler = Matrix4::Scale(0.1F)
@@ -1015,12 +1029,19 @@ namespace spades {
 			// --- local view ends
 		}
 
-		void ClientPlayer::AddToSceneThirdPersonView() {
+		void ClientPlayer::AddToSceneThirdPersonView(bool occluded) {
 			Player& p = player;
 			Weapon& w = p.GetWeapon();
 			IRenderer& renderer = client.GetRenderer();
 			World* world = client.GetWorld();
 
+			// an occluded player still poses its skins, which place its
+			// tracers and muzzle flashes, but none of its models is drawn
+			auto renderModel = [&](IModel& m, const ModelRenderParam& prm) {
+				if (!occluded)
+					renderer.RenderModel(m, prm);
+			};
+
 			std::string modelPath = "Models/Player/";
 			if (!cg_classicPlayerModels)
 				modelPath += w.GetName() + "/";
@@ -1037,16 +1058,16 @@ namespace spades {
 			if (!p.IsAlive()) {
 				if (!cg_ragdoll) {
 					model = renderer.RegisterModel((modelPath + "Dead.kv6").c_str());
-					param.matrix = Matrix4::FromAxis(-right, front2D, -up, p.GetEye());
+					param.matrix = Matrix4::FromAxis(-right, front2D, -up, p.GetEye(true));
 					param.matrix = param.matrix * Matrix4::Translate(0.0F, 0.0F, -0.1F);
 					param.matrix = param.matrix * Matrix4::Scale(0.1F);
-					renderer.RenderModel(*model, param);
+					renderModel(*model, param);
 				}
 
 				return;
 			}
 
-			const Vector3 origin = p.GetOrigin();
+			const Vector3 origin = p.GetOrigin(true);
 
 			// set clipping box to prevent drawing models that are too large
 			AABB3 clip = AABB3(
@@ -1055,6 +1076,7 @@ namespace spades {
 			);
 			sandboxedRenderer->SetClipBox(clip);
 			sandboxedRenderer->SetAllowDepthHack(false); // disable depthhack
+			sandboxedRenderer->SetAllowModels(!occluded);
 
 			// ready for tool rendering
 			asIScriptObject* curSkin = GetCurrentSkin(false);
@@ -1157,10 +1179,10 @@ namespace spades {
 					: renderer.RegisterModel((modelPath + "Leg.kv6").c_str());
 
 				param.matrix = leg1 * scaler;
-				renderer.RenderModel(*model, param);
+				renderModel(*model, param);
 
 				param.matrix = leg2 * scaler * Matrix4::Scale(-1, 1, 1); // mirror
-				renderer.RenderModel(*model, param);
+				renderModel(*model, param);
 			}
 
 			// Torso
@@ -1170,7 +1192,7 @@ namespace spades {
 					: renderer.RegisterModel((modelPath + "Torso.kv6").c_str());
 
 				param.matrix = torso * scaler;
-				renderer.RenderModel(*model, param);
+				renderModel(*model, param);
 			}
 
 			// Arms
@@ -1178,7 +1200,7 @@ namespace spades {
 				model = renderer.RegisterModel((modelPath + "Arms.kv6").c_str());
 
 				param.matrix = arms * scaler;
-				renderer.RenderModel(*model, param);
+				renderModel(*model, param);
 			}
 
 			// Head
@@ -1188,7 +1210,7 @@ namespace spades {
 					: renderer.RegisterModel((modelPath + "Head.kv6").c_str());
 
 				param.matrix = head * scaler;
-				renderer.RenderModel(*model, param);
+				renderModel(*model, param);
 			}
 
 			// Tool
@@ -1217,7 +1239,7 @@ namespace spades {
 							* Matrix4::Rotate(MakeVector3(1, 0, 0), -0.5F)
 						: Matrix4::Translate(0, 0.35F, 0.7F));
 					param.matrix = briefcase * scaler;
-					renderer.RenderModel(*model, param);
+					renderModel(*model, param);
 				}
 			}
 
@@ -1240,15 +1262,22 @@ namespace spades {
 
 			// distance cull
 			const auto& viewOrigin = client.GetLastSceneDef().viewOrigin;
-			float distSqr = (p.GetOrigin() - viewOrigin).GetSquaredLength2D();
+			float distSqr = (p.GetOrigin(true) - viewOrigin).GetSquaredLength2D();
 			if (distSqr > FOG_DISTANCE_SQ)
 				return;
 
 			bool isThirdPerson = ShouldRenderInThirdPersonView();
-			if (!isThirdPerson)
+			if (!isThirdPerson) {
 				AddToSceneFirstPersonView();
-			else
-				AddToSceneThirdPersonView();
+			} else {
+				// occlusion cull with the clipping box of the models
+				const Vector3 origin = p.GetOrigin(true);
+				AABB3 clip = AABB3(
+					origin - Vector3(2.0F, 2.0F, 4.0F),
+					origin + Vector3(2.0F, 2.0F, 2.0F)
+				);
+				AddToSceneThirdPersonView(client.IsOccludedByMap(clip));
+			}
 
 			if (cg_debugToolSkinAnchors
 				&& p.IsLocalPlayer() && p.IsAlive()
@@ -1295,7 +1324,7 @@ namespace spades {
 				const Vector3 muzzle = interface.GetMuzzlePosition();
 
 				// The skin should return a legit position. Return the default position if it didn't.
-				const Vector3 origin = player.GetOrigin();
+				const Vector3 origin = player.GetOrigin(true);
 				AABB3 clip = AABB3(
 					origin - Vector3(2.0F, 2.0F, 4.0F),
 					origin + Vector3(2.0F, 2.0F, 2.0F)
@@ -1337,7 +1366,7 @@ namespace spades {
 				const Vector3 caseEject = interface.GetCaseEjectPosition();
 
 				// The skin should return a legit position. Return the default position if it didn't.
-				const Vector3 origin = player.GetOrigin();
+				const Vector3 origin = player.GetOrigin(true);
 				AABB3 clip = AABB3(
 					origin - Vector3(2.0F, 2.0F, 4.0F),
 					origin + Vector3(2.0F, 2.0F, 2.0F)
@@ -1565,11 +1594,9 @@ namespace spades {
 				if (weaponType == SHOTGUN_WEAPON)
 					vel *= 0.5F;
 
-				auto ent = stmp::make_unique<GunCasing>(&client,
+				client.GetGunCasingPool().Emplace(&client,
 					model.GetPointerOrNull(), snd.GetPointerOrNull(),
 					snd2.GetPointerOrNull(), origin, o, vel);
-
-				client.AddLocalEntity(std::move(ent));
 			}
 		}
 
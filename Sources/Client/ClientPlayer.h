@@ -75,7 +75,7 @@ namespace spades {
 			Handle<SandboxedRenderer> sandboxedRenderer;
 
 			std::array<Vector3, 3> GetFlashlightAxes();
-			void AddToSceneThirdPersonView();
+			void AddToSceneThirdPersonView(bool occluded);
 			void AddToSceneFirstPersonView();
 
 			void SetSkinParameterForTool(Player::ToolType, asIScriptObject*);
@@ -634,7 +634,7 @@ namespace spades {
 			Vector4 playerColor = MakeVector4(1, 1, 1, 1);
 
 			Vector3 eye = lastSceneDef.viewOrigin;
-			Vector3 dir = player.GetEye() - eye;
+			Vector3 dir = player.GetEye(true) - eye;
 
 			float dist = dir.GetSquaredLength2D();
 
@@ -667,7 +667,7 @@ namespace spades {
 		void Client::DrawPlayerName(Player& player, const Vector4& color) {
 			SPADES_MARK_FUNCTION();
 
-			Vector3 origin = player.GetEye();
+			Vector3 origin = player.GetEye(true);
 			origin.z -= 0.45F; // above player head
 
 			Vector2 scrPos;
@@ -835,7 +835,7 @@ namespace spades {
 				if (p.GetFront().GetSquaredLength() < 0.01F)
 					continue;
 
-				Vector3 origin = p.GetEye();
+				Vector3 origin = p.GetEye(true);
 				origin.z -= 0.9F; // above player
 
 				float dist = (origin - eye).GetLength();
@@ -1756,6 +1756,8 @@ namespace spades {
 				renderer->DrawImage(nullptr, AABB2(0, 0, sw, sh));
 			}
 
+			for (ILocalEntityPool* pool : localEntityPools)
+				pool->Render2D();
 			for (const auto& ent : localEntities)
 				ent->Render2D();
 
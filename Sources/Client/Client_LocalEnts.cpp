@@ -34,9 +34,9 @@
 
 #include "BloodMarks.h"
 #include "Corpse.h"
+#include "FallingBlock.h"
 #include "ILocalEntity.h"
-#include "ParticleSpriteEntity.h"
-#include "SmokeSpriteEntity.h"
+#include "ParticleSystem.h"
 
 #include "GameMap.h"
 #include "Weapon.h"
@@ -52,8 +52,10 @@ DEFINE_SPADES_SETTING(cg_waterImpact, "1");
 
 DEFINE_SPADES_SETTING(cg_corpseSoftLimit, "6");
 DEFINE_SPADES_SETTING(cg_corpseHardLimit, "16");
+DEFINE_SPADES_SETTING(cg_localEntityStatistics, "0");
 
 SPADES_SETTING(cg_manualFocus);
+SPADES_SETTING(cg_physicsStatistics);
 DEFINE_SPADES_SETTING(cg_autoFocusSpeed, "0.4");
 
 namespace spades {
@@ -115,6 +117,99 @@ namespace spades {
 			}
 		}
 
+		void Client::UpdateFallingBlocks(float dt) {
+			SPADES_MARK_FUNCTION();
+
+			if (fallingBlocks.empty()) {
+				fallingBlockSubFrame = 0.0F;
+				return;
+			}
+
+			const Handle<GameMap>& map = world->GetMap();
+			SPAssert(map);
+
+			// Step all falling blocks together in the world's fixed steps so the
+			// bounces don't depend on the frame rate and the collision tests of
+			// a big collapse run as one batch.
+			fallingBlockSubFrame += dt;
+			while (fallingBlockSubFrame >= WorldTimeStep && !fallingBlocks.empty()) {
+				fallingBlockSubFrame -= WorldTimeStep;
+
+				Stopwatch stopwatch;
+
+				std::size_t numAlive = 0;
+				for (std::size_t i = 0; i < fallingBlocks.size(); i++) {
+					if (fallingBlocks[i]->Advance(WorldTimeStep))
+						fallingBlocks[numAlive++] = std::move(fallingBlocks[i]);
+				}
+				fallingBlocks.resize(numAlive);
+
+				fallingBlockBatch.Clear();
+				fallingBlockBatch.Reserve(fallingBlocks.size());
+				for (const auto& block : fallingBlocks)
+					fallingBlockBatch.Add(block->GetLastOrigin(), block->GetOrigin(),
+					                      block->GetVelocity());
+
+				fallingBlockBatch.CollideFallingBlocks(*map);
+
+				numAlive = 0;
+				for (std::size_t i = 0; i < fallingBlocks.size(); i++) {
+					if (fallingBlocks[i]->ResolveCollision(fallingBlockBatch.GetHitFlags(i),
+					                                       fallingBlockBatch.GetVelocity(i)))
+						fallingBlocks[numAlive++] = std::move(fallingBlocks[i]);
+				}
+				fallingBlocks.resize(numAlive);
+
+				if (cg_physicsStatistics) {
+					fallingBlockStatTime += stopwatch.GetTime();
+					if (++fallingBlockStatSteps >= 60) {
+						SPLog("==== Falling Block Statistics ====");
+						SPLog("Falling Blocks: %d", (int)fallingBlocks.size());
+						SPLog("Average Time per Step: %.3fus",
+						      fallingBlockStatTime / fallingBlockStatSteps * 1000000.0);
+						fallingBlockStatTime = 0.0;
+						fallingBlockStatSteps = 0;
+					}
+				}
+			}
+		}
+
+		void Client::UpdateLocalEntities(float dt) {
+			SPADES_MARK_FUNCTION();
+
+			Stopwatch stopwatch;
+
+			for (ILocalEntityPool* pool : localEntityPools)
+				pool->Update(dt);
+
+			decltype(localEntities)::iterator it;
+			std::vector<decltype(it)> its;
+			for (it = localEntities.begin(); it != localEntities.end(); it++) {
+				if (!(*it)->Update(dt))
+					its.push_back(it);
+			}
+			for (const auto& it : its)
+				localEntities.erase(it);
+
+			if (cg_localEntityStatistics) {
+				localEntityStatTime += stopwatch.GetTime();
+				if (++localEntityStatFrames >= 60) {
+					SPLog("==== Local Entity Statistics ====");
+					for (ILocalEntityPool* pool : localEntityPools) {
+						SPLog("%s: %d alive, %d capacity, %d spawned, %d allocations",
+						      pool->GetName(), (int)pool->GetCount(), (int)pool->GetCapacity(),
+						      (int)pool->GetNumConstructed(), (int)pool->GetNumAllocations());
+						pool->ResetStatistics();
+					}
+					SPLog("Unpooled: %d alive", (int)localEntities.size());
+					SPLog("Average Update Time: %.3fus",
+					      localEntityStatTime / localEntityStatFrames * 1000000.0);
+					localEntityStatTime = 0.0;
+					localEntityStatFrames = 0;
+				}
+			}
+		}
+
 		void Client::RemoveAllLocalEntities() {
 			SPADES_MARK_FUNCTION();
 
@@ -124,6 +219,9 @@ namespace spades {
 
 			damageIndicators.clear();
 			localEntities.clear();
+			for (ILocalEntityPool* pool : localEntityPools)
+				pool->Clear();
+			fallingBlocks.clear();
 			grenadeTracers.clear();
 			
 			if (bloodMarks)
@@ -187,13 +285,12 @@ namespace spades {
 
 			int particlesNum = cg_particlesBloodNum;
 			for (int i = 0; i < particlesNum; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 8.0F);
-				ent->SetRadius(0.4F);
-				ent->SetLifeTime(3.0F, 0.0F, 1.0F);
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 8.0F);
+				ent.SetRadius(0.4F);
+				ent.SetLifeTime(3.0F, 0.0F, 1.0F);
 				if (distSqr < PARTICLE_BOUNCE_DIST_SQ || bounce)
-					ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-				localEntities.emplace_back(std::move(ent));
+					ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 			}
 
 			if (particleLevel < 2)
@@ -201,25 +298,23 @@ namespace spades {
 
 			color = MakeVector4(0.7F, 0.35F, 0.37F, 0.6F);
 			for (int i = 0; i < 2; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 100.0F,
-					SmokeSpriteEntity::Type::Explosion);
-				ent->SetTrajectory(pos, RandomVector() * 0.7F, 0.8F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.5F + SampleRandomFloat() * SampleRandomFloat() * 0.2F, 2.0F);
-				ent->SetLifeTime(0.2F + SampleRandomFloat() * 0.2F, 0.06F, 0.2F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->EmitSmoke(color, 100.0F,
+					SmokeType::Explosion);
+				ent.SetTrajectory(pos, RandomVector() * 0.7F, 0.8F, 0.0F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.5F + SampleRandomFloat() * SampleRandomFloat() * 0.2F, 2.0F);
+				ent.SetLifeTime(0.2F + SampleRandomFloat() * 0.2F, 0.06F, 0.2F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 
 			color.w *= 0.1F;
 			{
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 40.0F);
-				ent->SetTrajectory(pos, RandomVector() * 0.7F, 0.8F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.7F + SampleRandomFloat() * SampleRandomFloat() * 0.2F, 2.0F, 0.1F);
-				ent->SetLifeTime(0.8F + SampleRandomFloat() * 0.4F, 0.06F, 1.0F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->EmitSmoke(color, 40.0F);
+				ent.SetTrajectory(pos, RandomVector() * 0.7F, 0.8F, 0.0F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.7F + SampleRandomFloat() * SampleRandomFloat() * 0.2F, 2.0F, 0.1F);
+				ent.SetLifeTime(0.8F + SampleRandomFloat() * 0.4F, 0.06F, 1.0F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 		}
 
@@ -258,14 +353,13 @@ namespace spades {
 			Vector4 color = ConvertColorRGBA(col);
 
 			for (int i = 0; i < 4; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
+				auto ent = particleSystem->Emit(img, color);
 				Vector3 dir = RandomVector() + velBias * 0.5F;
-				ent->SetTrajectory(pos + dir * 0.2F, dir * 8.0F);
-				ent->SetRadius(0.4F);
-				ent->SetLifeTime(3.0F, 0.0F, 1.0F);
+				ent.SetTrajectory(pos + dir * 0.2F, dir * 8.0F);
+				ent.SetRadius(0.4F);
+				ent.SetLifeTime(3.0F, 0.0F, 1.0F);
 				if (distSqr < PARTICLE_BOUNCE_DIST_SQ)
-					ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-				localEntities.emplace_back(std::move(ent));
+					ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 			}
 
 			if (particleLevel < 2)
@@ -273,26 +367,24 @@ namespace spades {
 
 			if (distSqr < 32.0F * 32.0F) {
 				for (int i = 0; i < 8; i++) {
-					auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-					ent->SetTrajectory(pos, RandomVector() * 12.0F, 1.0F, 0.9F);
-					ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-					ent->SetRadius(0.2F + SampleRandomFloat() * SampleRandomFloat() * 0.25F);
-					ent->SetLifeTime(3.0F, 0.0F, 1.0F);
-					ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-					localEntities.emplace_back(std::move(ent));
+					auto ent = particleSystem->Emit(img, color);
+					ent.SetTrajectory(pos, RandomVector() * 12.0F, 1.0F, 0.9F);
+					ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+					ent.SetRadius(0.2F + SampleRandomFloat() * SampleRandomFloat() * 0.25F);
+					ent.SetLifeTime(3.0F, 0.0F, 1.0F);
+					ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 				}
 			}
 
 			color += (MakeVector4(1, 1, 1, 1) - color) * 0.2F;
 			color.w *= 0.2F;
 			for (int i = 0; i < 2; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 100.0F);
-				ent->SetTrajectory(pos, RandomVector() * 0.7F, 1.0F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.2F, 0.8F);
-				ent->SetLifeTime(0.3F + SampleRandomFloat() * 0.3F, 0.06F, 0.4F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->EmitSmoke(color, 100.0F);
+				ent.SetTrajectory(pos, RandomVector() * 0.7F, 1.0F, 0.0F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.2F, 0.8F);
+				ent.SetLifeTime(0.3F + SampleRandomFloat() * 0.3F, 0.06F, 0.4F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 		}
 
@@ -317,13 +409,12 @@ namespace spades {
 			Vector4 color = ConvertColorRGBA(IntVectorFromColor(col));
 
 			for (int i = 0; i < 4; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(origin, RandomVector() * 8.0F);
-				ent->SetRadius(0.4F);
-				ent->SetLifeTime(3.0F, 0.0F, 1.0F);
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(origin, RandomVector() * 8.0F);
+				ent.SetRadius(0.4F);
+				ent.SetLifeTime(3.0F, 0.0F, 1.0F);
 				if (distSqr < PARTICLE_BOUNCE_DIST_SQ)
-					ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-				localEntities.emplace_back(std::move(ent));
+					ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 			}
 		}
 
@@ -348,27 +439,25 @@ namespace spades {
 
 			// rapid smoke
 			for (int i = 0; i < 2; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 120.0F,
-					SmokeSpriteEntity::Type::Explosion);
-				ent->SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 0.3F, 1.0F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.4F, 3.0F, 0.0000005F);
-				ent->SetLifeTime(0.2F + SampleRandomFloat() * 0.1F, 0.0F, 0.3F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->EmitSmoke(color, 120.0F,
+					SmokeType::Explosion);
+				ent.SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 0.3F, 1.0F, 0.0F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.4F, 3.0F, 0.0000005F);
+				ent.SetLifeTime(0.2F + SampleRandomFloat() * 0.1F, 0.0F, 0.3F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 
 			// fire smoke
 			color = MakeVector4(1.0F, 0.6F, 0.4F, 0.2F) * 5.0F;
 			for (int i = 0; i < 4; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 120.0F,
-					SmokeSpriteEntity::Type::Explosion);
-				ent->SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 0.3F, 1.0F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.2F + SampleRandomFloat() * SampleRandomFloat() * 0.3F, 3.0F, 0.0000005F);
-				ent->SetLifeTime(0.01F + SampleRandomFloat() * 0.02F, 0.0F, 0.01F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->EmitSmoke(color, 120.0F,
+					SmokeType::Explosion);
+				ent.SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 0.3F, 1.0F, 0.0F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.2F + SampleRandomFloat() * SampleRandomFloat() * 0.3F, 3.0F, 0.0000005F);
+				ent.SetLifeTime(0.01F + SampleRandomFloat() * 0.02F, 0.0F, 0.01F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 		}
 
@@ -424,15 +513,14 @@ namespace spades {
 
 			int particlesNum = cg_particlesGrenadeNum;
 			for (int i = 0; i < particlesNum; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
+				auto ent = particleSystem->Emit(img, color);
 				Vector3 dir = RandomUnitVector() + velBias * 0.5F;
 				float radius = 0.3F + SampleRandomFloat() * SampleRandomFloat() * 0.3F;
-				ent->SetTrajectory(pos + dir * 0.2F, dir * 16.0F, 0.1F + radius * 3.0F);
-				ent->SetRadius(radius);
-				ent->SetLifeTime(3.5F + SampleRandomFloat() * 2.0F, 0.0F, 1.0F);
+				ent.SetTrajectory(pos + dir * 0.2F, dir * 16.0F, 0.1F + radius * 3.0F);
+				ent.SetRadius(radius);
+				ent.SetLifeTime(3.5F + SampleRandomFloat() * 2.0F, 0.0F, 1.0F);
 				if (dist < PARTICLE_BOUNCE_DIST)
-					ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-				localEntities.emplace_back(std::move(ent));
+					ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 			}
 
 			if (particleLevel < 2)
@@ -440,46 +528,43 @@ namespace spades {
 
 			// rapid smoke
 			for (int i = 0; i < 4; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 60.0F,
-					SmokeSpriteEntity::Type::Explosion);
-				ent->SetTrajectory(pos, (RandomUnitVector() + velBias * 0.5F) * 2.0F, 1.0F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 2.0F, 0.2F);
-				ent->SetLifeTime(1.8F + SampleRandomFloat() * 0.1F, 0.0F, 0.2F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->EmitSmoke(color, 60.0F,
+					SmokeType::Explosion);
+				ent.SetTrajectory(pos, (RandomUnitVector() + velBias * 0.5F) * 2.0F, 1.0F, 0.0F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 2.0F, 0.2F);
+				ent.SetLifeTime(1.8F + SampleRandomFloat() * 0.1F, 0.0F, 0.2F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 
 			// slow smoke
 			color.w = 0.25F;
 			for (int i = 0; i < 8; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 30.0F);
-				ent->SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
+				auto ent = particleSystem->EmitSmoke(color, 30.0F);
+				ent.SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
 							   SampleRandomFloat() - SampleRandomFloat(),
 							   (SampleRandomFloat() - SampleRandomFloat()) * 0.2F)) * 2.0F, 1.0F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(1.5F + SampleRandomFloat() * SampleRandomFloat() * 0.8F, 0.2F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(1.5F + SampleRandomFloat() * SampleRandomFloat() * 0.8F, 0.2F);
 				switch (particleLevel) {
-					case 1: ent->SetLifeTime(0.8F + SampleRandomFloat() * 1.0F, 0.1F, 8.0F); break;
-					case 2: ent->SetLifeTime(1.5F + SampleRandomFloat() * 2.0F, 0.1F, 8.0F); break;
+					case 1: ent.SetLifeTime(0.8F + SampleRandomFloat() * 1.0F, 0.1F, 8.0F); break;
+					case 2: ent.SetLifeTime(1.5F + SampleRandomFloat() * 2.0F, 0.1F, 8.0F); break;
 					case 3:
-					default: ent->SetLifeTime(2.0F + SampleRandomFloat() * 5.0F, 0.1F, 8.0F); break;
+					default: ent.SetLifeTime(2.0F + SampleRandomFloat() * 5.0F, 0.1F, 8.0F); break;
 				}
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 
 			// fire smoke
 			color = MakeVector4(1, 0.7F, 0.4F, 0.2F) * 5.0F;
 			for (int i = 0; i < 4; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 120.0F,
-					SmokeSpriteEntity::Type::Explosion);
-				ent->SetTrajectory(pos, (RandomUnitVector() + velBias) * 6.0F, 1.0F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.3F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 3.0F, 0.1F);
-				ent->SetLifeTime(0.18F + SampleRandomFloat() * 0.03F, 0.0F, 0.1F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->EmitSmoke(color, 120.0F,
+					SmokeType::Explosion);
+				ent.SetTrajectory(pos, (RandomUnitVector() + velBias) * 6.0F, 1.0F, 0.0F);
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.3F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 3.0F, 0.1F);
+				ent.SetLifeTime(0.18F + SampleRandomFloat() * 0.03F, 0.0F, 0.1F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 		}
 
@@ -505,15 +590,14 @@ namespace spades {
 
 			int particlesNum = cg_particlesGrenadeNum;
 			for (int i = 0; i < particlesNum; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
+				auto ent = particleSystem->Emit(img, color);
 				Vector3 dir = RandomUnitVector() + velBias * 0.5F;
 				float radius = 0.3F + SampleRandomFloat() * SampleRandomFloat() * 0.3F;
-				ent->SetTrajectory(pos + dir * 0.2F, dir * 16.0F, 0.1F + radius * 3.0F);
-				ent->SetRadius(radius);
-				ent->SetLifeTime(3.5F + SampleRandomFloat() * 2.0F, 0.0F, 1.0F);
+				ent.SetTrajectory(pos + dir * 0.2F, dir * 16.0F, 0.1F + radius * 3.0F);
+				ent.SetRadius(radius);
+				ent.SetLifeTime(3.5F + SampleRandomFloat() * 2.0F, 0.0F, 1.0F);
 				if (dist < PARTICLE_BOUNCE_DIST)
-					ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-				localEntities.emplace_back(std::move(ent));
+					ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 			}
 
 			if (particleLevel < 2)
@@ -523,41 +607,38 @@ namespace spades {
 			img = renderer->RegisterImage("Textures/WaterExpl.png");
 			color = MakeVector4(0.95F, 0.95F, 0.95F, 0.6F);
 			for (int i = 0; i < 7; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(pos, (MakeVector3(0.0F, 0.0F, -SampleRandomFloat() * 7.0F)) * 2.5F, 0.3F);
-				ent->SetRadius(1.2F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 0.6F);
-				ent->SetLifeTime(2.0F + SampleRandomFloat() * 0.3F, 0.1F, 0.2F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(pos, (MakeVector3(0.0F, 0.0F, -SampleRandomFloat() * 7.0F)) * 2.5F, 0.3F);
+				ent.SetRadius(1.2F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 0.6F);
+				ent.SetLifeTime(2.0F + SampleRandomFloat() * 0.3F, 0.1F, 0.2F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 
 			// water2
 			img = renderer->RegisterImage("Textures/Fluid.png");
 			color.w = 0.9F;
 			for (int i = 0; i < 16; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
 													 SampleRandomFloat() - SampleRandomFloat(),
 													 -SampleRandomFloat() * 7.0F)) * 3.5F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.3F, 0.5F);
-				ent->SetLifeTime(2.0F + SampleRandomFloat() * 0.3F, 0.1F, 0.2F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.3F, 0.5F);
+				ent.SetLifeTime(2.0F + SampleRandomFloat() * 0.3F, 0.1F, 0.2F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 
 			// slow smoke
 			color.w = 0.3F;
 			for (int i = 0; i < 4; i++) {
-				auto ent = stmp::make_unique<SmokeSpriteEntity>(*this, color, 10.0F);
-				ent->SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
+				auto ent = particleSystem->EmitSmoke(color, 10.0F);
+				ent.SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
 							   SampleRandomFloat() - SampleRandomFloat(),
 							   (SampleRandomFloat() - SampleRandomFloat()) * 0.2F)) * 2.0F, 1.0F, 0.0F);
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(1.5F + SampleRandomFloat() * SampleRandomFloat() * 0.6F, 0.2F);
-				ent->SetLifeTime(2.0F + SampleRandomFloat() * 0.3F, 0.2F, 1.5F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				localEntities.emplace_back(std::move(ent));
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(1.5F + SampleRandomFloat() * SampleRandomFloat() * 0.6F, 0.2F);
+				ent.SetLifeTime(2.0F + SampleRandomFloat() * 0.3F, 0.2F, 1.5F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
 			}
 
 			// TODO: wave?
@@ -581,13 +662,12 @@ namespace spades {
 			Vector4 color = MakeVector4(1, 1, 1, 0.6F);
 
 			for (int i = 0; i < 4; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 8.0F);
-				ent->SetRadius(0.3F);
-				ent->SetLifeTime(3.0F, 0.0F, 1.0F);
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(pos, (RandomVector() + velBias * 0.5F) * 8.0F);
+				ent.SetRadius(0.3F);
+				ent.SetLifeTime(3.0F, 0.0F, 1.0F);
 				if (distSqr < PARTICLE_BOUNCE_DIST_SQ)
-					ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-				localEntities.emplace_back(std::move(ent));
+					ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 			}
 
 			if (particleLevel < 2 || !cg_waterImpact)
@@ -597,29 +677,27 @@ namespace spades {
 			img = renderer->RegisterImage("Textures/WaterExpl.png");
 			color = MakeVector4(0.95F, 0.95F, 0.95F, 0.3F);
 			for (int i = 0; i < 2; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
 												SampleRandomFloat() - SampleRandomFloat(),
 												-SampleRandomFloat() * 7.0F)), 0.3F, 0.6F);
-				ent->SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 0.7F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				ent->SetLifeTime(3.0F + SampleRandomFloat() * 0.3F, 0.1F, 0.6F);
-				localEntities.emplace_back(std::move(ent));
+				ent.SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.4F, 0.7F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
+				ent.SetLifeTime(3.0F + SampleRandomFloat() * 0.3F, 0.1F, 0.6F);
 			}
 
 			// water2
 			img = renderer->RegisterImage("Textures/Fluid.png");
 			color.w = 0.9F;
 			for (int i = 0; i < 6; i++) {
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(pos, (MakeVector3(SampleRandomFloat() - SampleRandomFloat(),
 												SampleRandomFloat() - SampleRandomFloat(),
 												-SampleRandomFloat() * 16.0F)));
-				ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-				ent->SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.6F, 0.6F);
-				ent->SetBlockHitAction(BlockHitAction::Ignore);
-				ent->SetLifeTime(3.0F + SampleRandomFloat() * 0.3F, SampleRandomFloat() * 0.3F, 0.6F);
-				localEntities.emplace_back(std::move(ent));
+				ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+				ent.SetRadius(0.6F + SampleRandomFloat() * SampleRandomFloat() * 0.6F, 0.6F);
+				ent.SetBlockHitAction(BlockHitAction::Ignore);
+				ent.SetLifeTime(3.0F + SampleRandomFloat() * 0.3F, SampleRandomFloat() * 0.3F, 0.6F);
 			}
 
 			// TODO: wave?
@@ -649,12 +727,11 @@ namespace spades {
 				Vector3 vel = RandomVector() * 8.0F;
 				vel.z = Mix(0.5F, 1.0F, SampleRandomFloat());
 
-				auto ent = stmp::make_unique<ParticleSpriteEntity>(*this, img, color);
-				ent->SetTrajectory(spawnPos, vel, 0.8F, 0.1F);
-				ent->SetRadius(0.3F + SampleRandomFloat() * SampleRandomFloat() * 0.2F);
-				ent->SetLifeTime(10.0F, 0.5F, 1.0F);
-				ent->SetBlockHitAction(BlockHitAction::Stick);
-				localEntities.emplace_back(std::move(ent));
+				auto ent = particleSystem->Emit(img, color);
+				ent.SetTrajectory(spawnPos, vel, 0.8F, 0.1F);
+				ent.SetRadius(0.3F + SampleRandomFloat() * SampleRandomFloat() * 0.2F);
+				ent.SetLifeTime(10.0F, 0.5F, 1.0F);
+				ent.SetBlockHitAction(BlockHitAction::Stick);
 			}
 
 			lastSnowDropTime = time;
@@ -27,9 +27,11 @@
 
 #include "BloodMarks.h"
 #include "Corpse.h"
+#include "FallingBlock.h"
 #include "CTFGameMode.h"
 #include "GameProperties.h"
 #include "IGameMode.h"
+#include "OcclusionBuffer.h"
 #include "Player.h"
 #include "TCGameMode.h"
 
@@ -53,10 +55,15 @@ DEFINE_SPADES_SETTING(cg_depthOfFieldAmount, "1");
 DEFINE_SPADES_SETTING(cg_shake, "1");
 DEFINE_SPADES_SETTING(cg_debugBlockCursor, "0");
 DEFINE_SPADES_SETTING(cg_debugPlayerHitboxes, "0");
+DEFINE_SPADES_SETTING(cg_occlusionCulling, "1");
+DEFINE_SPADES_SETTING(cg_occlusionBenchmark, "0");
 
 SPADES_SETTING(cg_ragdoll);
 SPADES_SETTING(cg_hurtScreenEffects);
 SPADES_SETTING(cg_orientationSmoothing);
+SPADES_SETTING(cg_interpolateWorld);
+SPADES_SETTING(r_modelShadows);
+SPADES_SETTING(r_water);
 
 namespace spades {
 	namespace client {
@@ -342,7 +349,7 @@ namespace spades {
 					case ClientCameraMode::ThirdPersonFollow: {
 						Player& player = GetCameraTargetPlayer();
 
-						Vector3 center = player.GetEye();
+						Vector3 center = player.GetEye(true);
 						if (!player.IsAlive()) {
 							if (player.IsLocalPlayer() && lastLocalCorpse && cg_ragdoll)
 								center = lastLocalCorpse->GetCenter();
@@ -540,13 +547,13 @@ namespace spades {
 		void Client::AddGrenadeToScene(Grenade& g) {
 			SPADES_MARK_FUNCTION();
 
-			if (g.GetPosition().z > 63.0F)
+			if (g.GetPosition(true).z > 63.0F)
 				return; // work-around for water refraction problem
 
 			Handle<IModel> model = renderer->RegisterModel("Models/Weapons/Grenade/Grenade.kv6");
 
 			// Move the grenade slightly so that it doesn't look like sinking in the ground
-			Vector3 position = g.GetPosition();
+			Vector3 position = g.GetPosition(true);
 			position.z -= 0.03F * 3.0F;
 
 			ModelRenderParam param;
@@ -653,6 +660,59 @@ namespace spades {
 			}
 		}
 
+		void Client::UpdateOcclusionBuffer() {
+			SPADES_MARK_FUNCTION();
+
+			if (cg_occlusionBenchmark && map) {
+				cg_occlusionBenchmark = 0;
+
+				// what the culling did in game so far
+				const auto& stats = occlusionBuffer->GetStatistics();
+				std::size_t numAdded = occlusionNumModels;
+				double modelTime = occlusionModelTime / std::max<std::size_t>(numAdded, 1);
+				SPLog("Occlusion culling: %d frames, %.3f ms/frame to build", occlusionNumFrames,
+				      stats.buildTime * 1000.0 / std::max(occlusionNumFrames, 1));
+				SPLog("  %zu of %zu models occluded, %zu players/corpses added in %.3f us each",
+				      stats.numOccluded, stats.numQueries, numAdded, modelTime * 1.0e6);
+				SPLog("  estimated saving: %.3f ms/frame", stats.numOccluded * modelTime * 1000.0 /
+				                                                std::max(occlusionNumFrames, 1));
+
+				OcclusionBuffer::Benchmark(*map);
+
+				occlusionBuffer->ResetStatistics();
+				occlusionModelTime = 0.0;
+				occlusionNumModels = 0;
+				occlusionNumFrames = 0;
+			}
+
+			if (!cg_occlusionCulling || !map || lastSceneDef.skipWorld) {
+				occlusionBuffer->Invalidate();
+				return;
+			}
+
+			occlusionBuffer->Build(*map, lastSceneDef);
+			occlusionNumFrames++;
+		}
+
+		bool Client::IsOccludedByMap(const AABB3& box) {
+			if (!occlusionBuffer->IsValid())
+				return false;
+
+			AABB3 bounds = box;
+			if (r_modelShadows) {
+				// keep the models whose shadow might be visible. the sun light
+				// travels along (0, 1, 1) (see `GLBasicShadowMapRenderer`), so
+				// the shadow lies in the box swept along it down to the water.
+				bounds.max.y += std::max(63.0F - box.min.z, 0.0F);
+				bounds.max.z = std::max(bounds.max.z, 63.0F);
+			}
+
+			// r_water >= 2 also draws the models mirrored in the water
+			if ((int)r_water >= 2)
+				return occlusionBuffer->IsOccludedWithReflection(bounds);
+			return occlusionBuffer->IsOccluded(bounds);
+		}
+
 		void Client::DrawScene() {
 			SPADES_MARK_FUNCTION();
 
@@ -661,10 +721,17 @@ namespace spades {
 			if (world) {
 				stmp::optional<Player&> maybePlayer = world->GetLocalPlayer();
 
+				UpdateOcclusionBuffer();
+
+				Stopwatch modelStopwatch;
+				std::size_t numOccluded = occlusionBuffer->GetStatistics().numOccluded;
+				std::size_t numModels = 0;
+
 				for (size_t i = 0; i < world->GetNumPlayerSlots(); i++) {
 					if (world->GetPlayer(static_cast<unsigned int>(i))) {
 						SPAssert(clientPlayers[i]);
 						clientPlayers[i]->AddToScene();
+						numModels++;
 					}
 				}
 
@@ -674,15 +741,29 @@ namespace spades {
 				for (const auto& c : corpses) {
 					if ((c->GetCenter() - lastSceneDef.viewOrigin).GetSquaredLength2D() > FOG_DISTANCE_SQ)
 						continue;
+					numModels++;
+					if (IsOccludedByMap(c->GetBounds()))
+						continue;
 					c->AddToScene();
 				}
 
+				occlusionModelTime += modelStopwatch.GetTime();
+				occlusionNumModels +=
+				  numModels - (occlusionBuffer->GetStatistics().numOccluded - numOccluded);
+
 				// draw map objects
 				AddMapObjectsToScene();
 
+				for (ILocalEntityPool* pool : localEntityPools)
+					pool->Render3D();
 				for (const auto& ent : localEntities)
 					ent->Render3D();
 
+				float fallingBlockInterpolation =
+				  cg_interpolateWorld ? fallingBlockSubFrame / WorldTimeStep : 1.0F;
+				for (const auto& block : fallingBlocks)
+					block->Render3D(fallingBlockInterpolation);
+
 				bloodMarks->Draw();
 
 				if (maybePlayer) { // localplayer exists
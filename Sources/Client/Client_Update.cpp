@@ -314,19 +314,14 @@ namespace spades {
 				// physics diverges from server
 				world->Advance(dt);
 #else
-				// accurately resembles server's physics
-				// but not smooth
+				// accurately resembles server's physics.
+				// rendering interpolates between the last two steps
 				if (gameplayDt > 0.0F) {
-					worldSubFrame += gameplayDt;
+					world->AdvanceFixed(gameplayDt); // runs at exactly ~60fps
 					worldSubFrameFast += gameplayDt;
 				}
 
-				// these run at exactly ~60fps
-				float frameStep = 1.0F / 60.0F;
-				while (worldSubFrame >= frameStep) {
-					world->Advance(frameStep); // physics update
-					worldSubFrame -= frameStep;
-				}
+				float frameStep = WorldTimeStep;
 
 				// these run at min. ~60fps but as fast as possible
 				float step = std::min(gameplayDt, frameStep);
@@ -362,16 +357,9 @@ namespace spades {
 				corpseDispatch.Start();
 
 				// local entities should be done in the client thread
-				{
-					decltype(localEntities)::iterator it;
-					std::vector<decltype(it)> its;
-					for (it = localEntities.begin(); it != localEntities.end(); it++) {
-						if (!(*it)->Update(gameplayDt))
-							its.push_back(it);
-					}
-					for (const auto& it : its)
-						localEntities.erase(it);
-				}
+				UpdateLocalEntities(gameplayDt);
+
+				UpdateFallingBlocks(gameplayDt);
 
 				// update blood marks
 				bloodMarks->Update(gameplayDt);
@@ -1595,8 +1583,8 @@ namespace spades {
 			if (isFirstPerson)
 				vel *= 2.0F;
 
-			AddLocalEntity(stmp::make_unique<Tracer>(*this, muzzlePos, hitPos, vel, shotgun));
-			AddLocalEntity(stmp::make_unique<MapViewTracer>(muzzlePos, hitPos));
+			tracerPool->Emplace(*this, muzzlePos, hitPos, vel, shotgun);
+			mapViewTracerPool->Emplace(muzzlePos, hitPos);
 		}
 
 		void Client::BlocksFell(std::vector<IntVector3> blocks) {
@@ -1608,7 +1596,7 @@ namespace spades {
 			const auto& origin = MakeVector3(blocks[0]) + 0.5F;
 
 			Handle<IAudioChunk> c = audioDevice->RegisterSound("Sounds/Misc/BlockBounce.opus");
-			AddLocalEntity(stmp::make_unique<FallingBlock>(this, c.GetPointerOrNull(), blocks));
+			fallingBlocks.emplace_back(stmp::make_unique<FallingBlock>(this, c.GetPointerOrNull(), blocks));
 
 			if (!IsMuted()) {
 				c = audioDevice->RegisterSound("Sounds/Misc/BlockFall.opus");
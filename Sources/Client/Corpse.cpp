@@ -621,6 +621,15 @@ namespace spades {
 			return v;
 		}
 
+		AABB3 Corpse::GetBounds() {
+			AABB3 bounds(nodes[0].pos, nodes[0].pos);
+			for (int i = 1; i < NodeCount; i++)
+				bounds += nodes[i].pos;
+
+			// the limbs and the head extend a bit past their nodes
+			return bounds.Inflate(1.0F);
+		}
+
 		bool Corpse::IsVisibleFrom(spades::Vector3 eye) {
 			// distance culled?
 			if ((GetCenter() - eye).GetSquaredLength2D() > FOG_DISTANCE_SQ)
@@ -103,6 +103,8 @@ namespace spades {
 			void AddToScene();
 
 			Vector3 GetCenter();
+			/** @return a box containing all the models of the corpse. */
+			AABB3 GetBounds();
 			bool IsVisibleFrom(Vector3 eye);
 
 			void AddHeadImpulse(Vector3);
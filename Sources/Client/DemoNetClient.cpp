@@ -42,6 +42,7 @@
 #include "IWorldListener.h"
 
 SPADES_SETTING(cg_keyDemoPlayPause);
+DEFINE_SPADES_SETTING(cg_demoVerifyReplay, "0");
 
 namespace spades {
 	namespace client {
@@ -938,19 +939,17 @@ namespace spades {
 			try {
 				demoPlayer->ReplayUpTo(targetTime,
 					[this](const std::vector<char>& data, float dt) {
+						// Age world physics up to the packet's timestamp first, just
+						// like live playback does, so grenade fuses, falling blocks,
+						// etc. resolve at their correct demo timestamps under the
+						// silent listener. (`dt` is the time since the previous
+						// packet, so advancing afterwards would process every packet
+						// at the previous packet's timestamp.) The fixed step keeps
+						// the result identical to live playback and independent of
+						// the packet spacing.
+						if (auto w = GetWorld())
+							w->AdvanceFixed(dt);
 						ProcessPacket(data);
-						// Age world physics in fixed steps so grenade fuses, falling
-						// blocks, etc. resolve at their correct demo timestamps under
-						// the silent listener instead of firing after replay finishes.
-						if (auto w = GetWorld()) {
-							const float step = 1.0F / 60.0F;
-							while (dt >= step) {
-								w->Advance(step);
-								dt -= step;
-							}
-							if (dt > 0.0F)
-								w->Advance(dt);
-						}
 					});
 			} catch (...) {
 				if (GetWorld())
@@ -964,6 +963,29 @@ namespace spades {
 			seekingMode = false;
 		}
 
+		void DemoNetClient::VerifyReplayDeterminism(float targetTime) {
+			if (!GetWorld())
+				return;
+
+			uint64_t firstHash = GetWorld()->GetStateHash();
+
+			ResetWorldForReplay();
+			FastReplay(targetTime);
+
+			if (!GetWorld())
+				return;
+
+			uint64_t secondHash = GetWorld()->GetStateHash();
+			if (firstHash == secondHash) {
+				SPLog("Demo replay up to %.3fs is deterministic (world hash %016llx)", targetTime,
+				      (unsigned long long)firstHash);
+			} else {
+				SPLog("Demo replay up to %.3fs diverged: world hash %016llx != %016llx",
+				      targetTime, (unsigned long long)firstHash,
+				      (unsigned long long)secondHash);
+			}
+		}
+
 		void DemoNetClient::Seek(float time) {
 			if (!demoPlayer) return;
 
@@ -978,6 +1000,8 @@ namespace spades {
 				auto view = client->SaveViewState();
 				ResetWorldForReplay();
 				FastReplay(replayTime);
+				if (cg_demoVerifyReplay)
+					VerifyReplayDeterminism(replayTime);
 				client->RestoreViewState(view);
 			}
 
@@ -86,6 +86,8 @@ namespace spades {
 			void ResetWorldForReplay();
 			// Replay all demo packets from index 0 up to targetTime with seekingMode=true
 			void FastReplay(float targetTime);
+			// Replays up to targetTime once more and checks the world ends up in the same state
+			void VerifyReplayDeterminism(float targetTime);
 
 		public:
 			DemoNetClient(Client* client);
@@ -27,8 +27,8 @@
 #include "IAudioChunk.h"
 #include "IAudioDevice.h"
 #include "IRenderer.h"
-#include "ParticleSpriteEntity.h"
-#include "SmokeSpriteEntity.h"
+#include "ParticleSystem.h"
+#include "ProjectilePhysics.h"
 #include "World.h"
 #include <Core/Debug.h>
 #include <Core/Exception.h>
@@ -105,6 +105,7 @@ namespace spades {
 			matTrans -= origin; // cancel origin
 
 			matrix = Matrix4::Translate(matTrans);
+			lastMatrix = matrix;
 			velocity = {0.0F, 0.0F, 0.0F};
 			rotDir = SampleRandom() & 3; // random initial dir
 			time = 1.0F;
@@ -118,7 +119,7 @@ namespace spades {
 				bounceSound->Release();
 		}
 
-		bool FallingBlock::Update(float dt) {
+		bool FallingBlock::Advance(float dt) {
 			time -= 1.0F / 5.0F * dt;
 
 			const auto& viewOrigin = client->GetLastSceneDef().viewOrigin;
@@ -182,23 +183,21 @@ namespace spades {
 							Vector3 p3 = p2 + vmAxis3 * (float)z;
 
 							for (int i = 0; i < 4; i++) {
-								auto ent = stmp::make_unique<ParticleSpriteEntity>(*client, img, color);
-								ent->SetTrajectory(p3, (RandomVector() + velBias * 0.5F) * 8.0F, 1.0F, 0.6F);
-								ent->SetRadius(0.4F + getRandom() * getRandom() * 0.1F);
-								ent->SetLifeTime(2.0F, 0.0F, 1.0F);
+								auto ent = client->GetParticleSystem().Emit(img, color);
+								ent.SetTrajectory(p3, (RandomVector() + velBias * 0.5F) * 8.0F, 1.0F, 0.6F);
+								ent.SetRadius(0.4F + getRandom() * getRandom() * 0.1F);
+								ent.SetLifeTime(2.0F, 0.0F, 1.0F);
 								if (usePrecisePhysics)
-									ent->SetBlockHitAction(BlockHitAction::BounceWeak);
-								client->AddLocalEntity(std::move(ent));
+									ent.SetBlockHitAction(BlockHitAction::BounceWeak);
 							}
 
 							if (particleMode >= 2) {
-								auto ent = stmp::make_unique<SmokeSpriteEntity>(*client, color, 70.0F);
-								ent->SetTrajectory(p3, RandomVector() * 0.2F, 1.0F, 0.0F);
-								ent->SetRotation(getRandom() * M_PI_F * 2.0F);
-								ent->SetRadius(1.0F, 0.5F);
-								ent->SetBlockHitAction(BlockHitAction::Ignore);
-								ent->SetLifeTime(1.0F + getRandom() * 0.5F, 0.0F, 1.0F);
-								client->AddLocalEntity(std::move(ent));
+								auto ent = client->GetParticleSystem().EmitSmoke(color, 70.0F);
+								ent.SetTrajectory(p3, RandomVector() * 0.2F, 1.0F, 0.0F);
+								ent.SetRotation(getRandom() * M_PI_F * 2.0F);
+								ent.SetRadius(1.0F, 0.5F);
+								ent.SetBlockHitAction(BlockHitAction::Ignore);
+								ent.SetLifeTime(1.0F + getRandom() * 0.5F, 0.0F, 1.0F);
 							}
 						}
 					}
@@ -207,7 +206,7 @@ namespace spades {
 				return false;
 			}
 
-			Matrix4 lastMat = matrix;
+			lastMatrix = matrix;
 
 			matrix = matrix * Matrix4::Rotate(MakeVector3(1, 0, 0),
 				((rotDir & 1) ? 1.0F : -1.0F) * dt);
@@ -216,42 +215,40 @@ namespace spades {
 			matrix = Matrix4::Translate(velocity * dt) * matrix;
 			velocity.z += dt * 32.0F;
 
-			const Handle<GameMap>& map = client->GetWorld()->GetMap();
-			SPAssert(map);
+			return true;
+		}
 
-			// Collision
-			IntVector3 lp = matrix.GetOrigin().Floor();
+		bool FallingBlock::ResolveCollision(uint8_t hitFlags, const Vector3& newVelocity) {
+			if (!(hitFlags & ProjectileHitWall))
+				return true;
 
-			if (map->ClipWorld(lp.x, lp.y, lp.z)) { // hit a wall
-				if (fabsf(velocity.z) > BOUNCE_SOUND_THRESHOLD) {
-					if (bounceSound && !client->IsMuted()) {
-						IAudioDevice& dev = client->GetAudioDevice();
-						dev.Play(bounceSound, matrix.GetOrigin(), AudioParam());
-					}
+			if (hitFlags & ProjectileHitLoud) {
+				if (bounceSound && !client->IsMuted()) {
+					IAudioDevice& dev = client->GetAudioDevice();
+					dev.Play(bounceSound, matrix.GetOrigin(), AudioParam());
 				}
+			}
 
-				IntVector3 lp2 = lastMat.GetOrigin().Floor();
-				if (lp.z != lp2.z &&
-				    ((lp.x == lp2.x && lp.y == lp2.y) || !map->ClipWorld(lp.x, lp.y, lp2.z))) {
-					velocity.z = -velocity.z;
-				} else {
-					return false;
-				}
+			if (!(hitFlags & ProjectileBounced))
+				return false;
 
-				matrix = lastMat;
-				velocity *= 0.46F; // lose some velocity due to friction
-				rotDir = (rotDir + 1) % 4;
-				time -= 0.36F;
-			}
+			matrix = lastMatrix;
+			velocity = newVelocity; // reflected and slowed down by friction
+			rotDir = (rotDir + 1) % 4;
+			time -= 0.36F;
 
 			return true;
 		}
 
-		void FallingBlock::Render3D() {
+		void FallingBlock::Render3D(float alpha) {
 			ModelRenderParam param;
 			param.ghost = true;
 			param.opacity = std::max(0.25F, time);
-			param.matrix = matrix;
+
+			Vector3 origin = matrix.GetOrigin();
+			Vector3 lastOrigin = lastMatrix.GetOrigin();
+			param.matrix = Matrix4::Translate(Mix(lastOrigin, origin, alpha) - origin) * matrix;
+
 			renderer.RenderModel(*model, param);
 		}
 	} // namespace client
@@ -20,9 +20,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
-#include "ILocalEntity.h"
 #include <Core/Math.h>
 #include <Core/VoxelModel.h>
 
@@ -32,12 +32,18 @@ namespace spades {
 		class Client;
 		class IModel;
 		class IAudioChunk;
-		class FallingBlock : public ILocalEntity {
+		/**
+		 * A cluster of blocks detached from the map. Falling blocks live in a
+		 * pool owned by `Client` and are stepped together in fixed steps so
+		 * their collision tests run as one `ProjectileBatch`.
+		 */
+		class FallingBlock {
 			Client* client;
 			IRenderer& renderer;
 			IModel* model;
 			VoxelModel* vmodel;
 			Matrix4 matrix;
+			Matrix4 lastMatrix; // `matrix` before the last step
 			Vector3 velocity;
 			int rotDir;
 			float time;
@@ -49,8 +55,24 @@ namespace spades {
 			FallingBlock(Client*, IAudioChunk* bounceSound, std::vector<IntVector3> blocks);
 			~FallingBlock();
 
-			bool Update(float dt) override;
-			void Render3D() override;
+			/**
+			 * Runs a step up to the collision test, which is done by
+			 * `ProjectileBatch::CollideFallingBlocks`.
+			 * @return false if this block should be removed.
+			 */
+			bool Advance(float dt);
+			/**
+			 * Applies the result of the collision test.
+			 * @return false if this block should be removed.
+			 */
+			bool ResolveCollision(uint8_t hitFlags, const Vector3& newVelocity);
+
+			Vector3 GetLastOrigin() const { return lastMatrix.GetOrigin(); }
+			Vector3 GetOrigin() const { return matrix.GetOrigin(); }
+			Vector3 GetVelocity() const { return velocity; }
+
+			/** @param interpolation the progress into the next step, in `[0, 1]`. */
+			void Render3D(float interpolation);
 		};
 	} // namespace client
 } // namespace spades
\ No newline at end of file
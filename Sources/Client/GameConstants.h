@@ -21,6 +21,7 @@
 
 #pragma once
 
+#define JUMP_VELOCITY -0.36F
 #define FALL_SLOW_DOWN 0.24F
 #define FALL_DAMAGE_VELOCITY 0.58F
 #define FALL_DAMAGE_SCALAR 4096
@@ -0,0 +1,117 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#include <algorithm>
+#include <atomic>
+
+#include "GameMap.h"
+#include "GameMapSurface.h"
+#include <Core/BitOps.h>
+#include <Core/Debug.h>
+#include <Core/Parallel.h>
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	namespace client {
+		GameMapSurface::GameMapSurface(const GameMap& map)
+		    : map(map), w(map.Width()), h(map.Height()) {
+			SPADES_MARK_FUNCTION();
+
+			const std::size_t numColumns = static_cast<std::size_t>(w) * h;
+			heights.resize(numColumns);
+			colors.resize(numColumns);
+			columnDirty.resize(numColumns, 0);
+
+			Stopwatch sw;
+
+			std::atomic<int> nextRow{0};
+			InvokeParallel([&](unsigned int) {
+				int y;
+				while ((y = nextRow.fetch_add(1)) < h)
+					BuildRow(y);
+			});
+
+			SPLog("Map surface (%dx%d) built in %.2f ms", w, h, sw.GetTime() * 1000.0);
+		}
+
+		GameMapSurface::~GameMapSurface() {}
+
+		void GameMapSurface::BuildRow(int y) {
+			for (int x = 0; x < w; x++) {
+				uint64_t solid = map.GetSolidMap(x, y);
+				int index = x + y * w;
+				if (solid) {
+					int z = FindFirstSet(solid);
+					heights[index] = static_cast<uint8_t>(z);
+					colors[index] = map.GetColor(x, y, z) | 0xFF000000UL;
+				} else {
+					heights[index] = 64;
+					colors[index] = 0;
+				}
+			}
+		}
+
+		void GameMapSurface::Invalidate(int x, int y) {
+			SPAssert(x >= 0);
+			SPAssert(x < w);
+			SPAssert(y >= 0);
+			SPAssert(y < h);
+
+			int index = x + y * w;
+			if (columnDirty[index])
+				return;
+			columnDirty[index] = 1;
+			dirtyColumns.push_back(index);
+		}
+
+		bool GameMapSurface::Update() {
+			SPADES_MARK_FUNCTION();
+
+			updatedColumns.swap(dirtyColumns);
+			dirtyColumns.clear();
+			changedRows.clear();
+
+			for (int index : updatedColumns) {
+				columnDirty[index] = 0;
+
+				int x = index % w, y = index / w;
+				uint64_t solid = map.GetSolidMap(x, y);
+				uint8_t height = 64;
+				uint32_t color = 0;
+				if (solid) {
+					int z = FindFirstSet(solid);
+					height = static_cast<uint8_t>(z);
+					color = map.GetColor(x, y, z) | 0xFF000000UL;
+				}
+
+				heights[index] = height;
+				if (colors[index] == color)
+					continue;
+				colors[index] = color;
+				changedRows.push_back(y);
+			}
+
+			std::sort(changedRows.begin(), changedRows.end());
+			changedRows.erase(std::unique(changedRows.begin(), changedRows.end()),
+			                  changedRows.end());
+			return !changedRows.empty();
+		}
+	} // namespace client
+} // namespace spades
@@ -0,0 +1,87 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+
+		/**
+		 * The map as seen from above: the topmost solid voxel of every column
+		 * and its color, which is what the minimap shows.
+		 *
+		 * The top voxel of a column is the lowest set bit of its solid map, so
+		 * a column is recomputed in constant time. The surface is built once
+		 * on all cores and then kept up to date by invalidating the columns
+		 * touched by map changes and calling `Update` once per frame.
+		 *
+		 * This class is not thread-safe.
+		 */
+		class GameMapSurface {
+			const GameMap& map;
+			int w, h;
+
+			/** The Z coordinate of the topmost solid voxel, or 64 if none. */
+			std::vector<uint8_t> heights;
+			/** 0xFFBBGGRR, or 0 for columns without any solid voxel. */
+			std::vector<uint32_t> colors;
+
+			std::vector<uint8_t> columnDirty;
+			std::vector<int> dirtyColumns;
+			std::vector<int> updatedColumns;
+			std::vector<int> changedRows;
+
+			void BuildRow(int y);
+
+		public:
+			GameMapSurface(const GameMap&);
+			~GameMapSurface();
+
+			int GetWidth() const { return w; }
+			int GetHeight() const { return h; }
+
+			int GetTopZ(int x, int y) const { return heights[x + y * w]; }
+			uint32_t GetColor(int x, int y) const { return colors[x + y * w]; }
+			/** The colors of all columns, row by row. */
+			const uint32_t* GetColors() const { return colors.data(); }
+
+			/** Marks the column at (`x`, `y`) as needing an update. */
+			void Invalidate(int x, int y);
+
+			/**
+			 * Recomputes the invalidated columns.
+			 * @return `false` if no color changed.
+			 */
+			bool Update();
+
+			/** The rows whose colors changed in the last `Update`, in
+			 * ascending order and without duplicates. */
+			const std::vector<int>& GetChangedRows() const { return changedRows; }
+
+			/** The indices (`x + y * width`) of the columns recomputed by the
+			 * last `Update`, whether their color changed or not. */
+			const std::vector<int>& GetUpdatedColumns() const { return updatedColumns; }
+		};
+	} // namespace client
+} // namespace spades
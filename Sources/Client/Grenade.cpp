@@ -23,6 +23,7 @@
 #include "GameMap.h"
 #include "Grenade.h"
 #include "IWorldListener.h"
+#include "ProjectilePhysics.h"
 #include "World.h"
 #include <Core/Debug.h>
 
@@ -32,7 +33,7 @@ namespace spades {
 			: world{w}, ownerId{ownerId} {
 			SPADES_MARK_FUNCTION();
 
-			position = pos;
+			position = lastPosition = pos;
 			velocity = vel;
 			this->fuse = fuse;
 			orientation = Quaternion{0.0F, 0.0F, 0.0F, 1.0F};
@@ -40,16 +41,30 @@ namespace spades {
 
 		Grenade::~Grenade() { SPADES_MARK_FUNCTION(); }
 
+		Vector3 Grenade::GetPosition(bool interpolate) const {
+			if (!interpolate)
+				return position;
+			return Mix(lastPosition, position, world.GetInterpolationFactor());
+		}
+
 		bool Grenade::Update(float dt) {
 			SPADES_MARK_FUNCTION();
 
-			fuse -= dt;
-			if (fuse < 0.0F) {
+			if (UpdateFuse(dt)) {
 				Explode();
 				return true;
 			}
 
-			int ret = MoveGrenade(dt);
+			UpdateMoved(dt, MoveGrenade(dt));
+			return false;
+		}
+
+		bool Grenade::UpdateFuse(float dt) {
+			fuse -= dt;
+			return fuse < 0.0F;
+		}
+
+		void Grenade::UpdateMoved(float dt, int ret) {
 			if (ret == 2) {
 				if (world.GetListener())
 					world.GetListener()->GrenadeBounced(*this);
@@ -68,8 +83,6 @@ namespace spades {
 				orientation = Quaternion::MakeRotation(rotAxis) * orientation;
 				orientation = orientation.Normalize();
 			}
-
-			return false;
 		}
 
 		void Grenade::Explode() {
@@ -88,38 +101,21 @@ namespace spades {
 			velocity.z += fsynctics;
 			position += velocity * f;
 
-			const Handle<GameMap> m = world.GetMap();
-
-			// Collision
-			IntVector3 lp = position.Floor();
-			IntVector3 lp2 = oldPos.Floor();
-
-			int ret = 0; // we didn't hit anything, no collision
-			if (lp.z >= 63 && lp2.z < 63)
-				ret = -1; // under water
-
-			if (m->ClipWorld(lp.x, lp.y, lp.z)) {
-				ret = 1; // hit a wall
-				if (fabsf(velocity.x) > BOUNCE_SOUND_THRESHOLD ||
-					fabsf(velocity.y) > BOUNCE_SOUND_THRESHOLD ||
-					fabsf(velocity.z) > BOUNCE_SOUND_THRESHOLD)
-					ret = 2; // play sound
-
-				if (lp.z != lp2.z && ((lp.x == lp2.x && lp.y == lp2.y)
-					|| !m->ClipWorld(lp.x, lp.y, lp2.z)))
-					velocity.z = -velocity.z;
-				else if (lp.x != lp2.x && ((lp.y == lp2.y && lp.z == lp2.z)
-					|| !m->ClipWorld(lp2.x, lp.y, lp.z)))
-					velocity.x = -velocity.x;
-				else if (lp.y != lp2.y && ((lp.x == lp2.x && lp.z == lp2.z)
-					|| !m->ClipWorld(lp.x, lp2.y, lp.z)))
-					velocity.y = -velocity.y;
-
-				position = oldPos; // set back to old position
-				velocity *= 0.36F; // lose some velocity due to friction
-			}
+			const Handle<GameMap>& m = world.GetMap();
+			SPAssert(m);
+
+			return SetMoveResult(position, velocity, CollideGrenade(*m, oldPos, position, velocity));
+		}
+
+		int Grenade::SetMoveResult(const Vector3& pos, const Vector3& vel, uint8_t hitFlags) {
+			position = pos;
+			velocity = vel;
 
-			return ret;
+			if (hitFlags & ProjectileHitWall)
+				return (hitFlags & ProjectileHitLoud) ? 2 : 1; // hit a wall (and play sound)
+			if (hitFlags & ProjectileEnteredWater)
+				return -1; // under water
+			return 0; // we didn't hit anything, no collision
 		}
 
 		int Grenade::GetDamage(const Vector3& playerPosition) const {
@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include <Core/Math.h>
 
 #define GRENADE_DAMAGE_RADIUS 16
@@ -35,14 +37,13 @@ namespace spades {
 			int ownerId;
 			float fuse;
 			Vector3 position;
+			Vector3 lastPosition; // `position` before the last world step
 			Vector3 velocity;
 
 			// FIXME: this actually shouldn't be here because
 			//		  the orientation is actually not a part of grenade physics...
 			Quaternion orientation;
 
-			void Explode();
-
 		public:
 			Grenade(World&, int ownerId, Vector3 pos, Vector3 vel, float fuse);
 			~Grenade();
@@ -50,15 +51,34 @@ namespace spades {
 			/** @return true when exploded. */
 			bool Update(float dt);
 
+			/** The first half of `Update`: burns the fuse. `Explode` must be
+			 * called when it runs out.
+			 * @return true when the fuse ran out. */
+			bool UpdateFuse(float dt);
+			/** Notifies the listener of the explosion. */
+			void Explode();
+			/** The second half of `Update`, given the result of the movement
+			 * done by `MoveGrenade` or `ProjectileBatch::MoveGrenades`. */
+			void UpdateMoved(float dt, int moveResult);
+
 			/** @return -1 if dropped under water, 1 if bounced, 2 when sound should be played. */
 			int MoveGrenade(float fsynctics);
 
+			/** Stores the outcome of `ProjectileBatch::MoveGrenades`.
+			 * @return the same value as `MoveGrenade`. */
+			int SetMoveResult(const Vector3& position, const Vector3& velocity, uint8_t hitFlags);
+
 			// adapted from: https://github.com/piqueserver/piqueserver/blob/master/pyspades/world.pyx#L368
 			/** @return damage given to a player standing at ``playerPosition``.*/
 			int GetDamage(const Vector3& playerPosition) const;
 
 			int GetOwnerId() const { return ownerId; }
+
+			/** Remembers the current state for `GetPosition(true)`. Called by
+			 * `World` before each step. */
+			void SaveInterpolationState() { lastPosition = position; }
 			Vector3 GetPosition() const { return position; }
+			Vector3 GetPosition(bool interpolate) const;
 			Vector3 GetVelocity() const { return velocity; }
 			Quaternion GetOrientation() const { return orientation; }
 			float GetFuse() const { return fuse; }
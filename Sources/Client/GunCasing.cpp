@@ -24,7 +24,7 @@
 #include "IAudioChunk.h"
 #include "IAudioDevice.h"
 #include "IRenderer.h"
-#include "ParticleSpriteEntity.h"
+#include "ParticleSystem.h"
 #include "World.h"
 #include <Core/Settings.h>
 
@@ -108,17 +108,16 @@ namespace spades {
 
 					int splats = SampleRandomInt(1, 3);
 					for (int i = 0; i < splats; i++) {
-						auto ent = stmp::make_unique<ParticleSpriteEntity>(*client, img, col);
-						ent->SetTrajectory(pt,
+						auto ent = client->GetParticleSystem().Emit(img, col);
+						ent.SetTrajectory(pt,
 							MakeVector3(
 								SampleRandomFloat() - SampleRandomFloat(),
 								SampleRandomFloat() - SampleRandomFloat(),
 								-SampleRandomFloat()) * 2.0F, 1.0F, 0.4F
 						);
-						ent->SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
-						ent->SetRadius(0.1F + SampleRandomFloat() * SampleRandomFloat() * 0.1F);
-						ent->SetLifeTime(2.0F, 0.0F, 1.0F);
-						client->AddLocalEntity(std::move(ent));
+						ent.SetRotation(SampleRandomFloat() * M_PI_F * 2.0F);
+						ent.SetRadius(0.1F + SampleRandomFloat() * SampleRandomFloat() * 0.1F);
+						ent.SetLifeTime(2.0F, 0.0F, 1.0F);
 					}
 				}
 
@@ -161,6 +160,11 @@ namespace spades {
 		}
 
 		void GunCasing::Render3D() {
+			const Vector3 origin = matrix.GetOrigin();
+			if (client->IsOccludedByMap(AABB3(origin - MakeVector3(0.5F, 0.5F, 0.5F),
+			                                  origin + MakeVector3(0.5F, 0.5F, 0.5F))))
+				return;
+
 			ModelRenderParam param;
 			param.matrix = matrix * Matrix4::Scale(0.0125F);
 			renderer.RenderModel(*model, param);
@@ -26,28 +26,16 @@
 #include "World.h"
 #include <Core/Settings.h>
 #include <Core/Strings.h>
-#include <Draw/SW/SWPort.h>
+#include <Draw/SW/SWOffscreenPort.h>
 #include <Draw/SW/SWRenderer.h>
 
 SPADES_SETTING(cg_orientationSmoothing);
 
 namespace spades {
 	namespace client {
-		class HitTestDebugger::Port : public draw::SWPort {
-			Handle<Bitmap> bmp;
-
-		public:
-			Port() {
-				SPADES_MARK_FUNCTION();
-				bmp = Handle<Bitmap>::New(512, 512);
-			}
-			Bitmap& GetFramebuffer() override { return *bmp; }
-			void Swap() override {} // nothing to do here
-		};
-
 		HitTestDebugger::HitTestDebugger(World* world) : world(world) {
 			SPADES_MARK_FUNCTION();
-			port = Handle<Port>::New();
+			port = Handle<draw::SWOffscreenPort>::New(512, 512);
 			renderer = Handle<draw::SWRenderer>::New(port.Cast<draw::SWPort>()).Cast<IRenderer>();
 			renderer->Init();
 		}
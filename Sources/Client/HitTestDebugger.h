@@ -31,17 +31,18 @@
 #include <Core/RefCountedObject.h>
 
 namespace spades {
+	namespace draw {
+		class SWOffscreenPort;
+	}
 	namespace client {
 		class IRenderer;
 		class World;
 
 		/** HitTestDebugger is used to debug hit detection issues. */
 		class HitTestDebugger {
-			class Port;
-
 			Handle<IRenderer> renderer;
 			World* world; // weak ref
-			Handle<Port> port;
+			Handle<draw::SWOffscreenPort> port;
 			Handle<Bitmap> displayShot;
 
 		public:
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 
 #include "IImage.h"
 #include "IModel.h"
@@ -95,6 +96,14 @@ namespace spades {
 			bool useLensFlare = false;
 		};
 
+		struct SpriteParam {
+			Vector3 center;
+			float radius;
+			float rotation;
+			/** The color of the sprite, with premultiplied alpha. */
+			Vector4 color;
+		};
+
 		class IRenderer : public RefCountedObject {
 		protected:
 			virtual ~IRenderer() {}
@@ -133,6 +142,9 @@ namespace spades {
 
 			virtual void AddSprite(IImage&, Vector3 center, float radius, float rotation) = 0;
 			virtual void AddLongSprite(IImage&, Vector3 p1, Vector3 p2, float radius) = 0;
+			/** Adds many sprites sharing the same image. Unlike `AddSprite`, the
+			 * color is specified per sprite and the current color is ignored. */
+			virtual void AddSprites(IImage&, const SpriteParam* sprites, std::size_t count) = 0;
 
 			/** Finalizes a scene. 2D drawing follows. */
 			virtual void EndScene() = 0;
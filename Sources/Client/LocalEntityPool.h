@@ -0,0 +1,180 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace spades {
+	namespace client {
+
+		/** Type-erased interface of `LocalEntityPool` used to update and draw
+		 * every pool owned by `Client` in one loop. */
+		class ILocalEntityPool {
+		public:
+			virtual ~ILocalEntityPool() {}
+
+			/** Updates all entities and destroys those whose `Update` returned false. */
+			virtual void Update(float dt) = 0;
+			virtual void Render3D() = 0;
+			virtual void Render2D() = 0;
+			/** Destroys all entities. The memory is kept for reuse. */
+			virtual void Clear() = 0;
+
+			virtual const char* GetName() const = 0;
+			/** @return the number of live entities. */
+			virtual std::size_t GetCount() const = 0;
+			/** @return the number of slots that can be used without a new allocation. */
+			virtual std::size_t GetCapacity() const = 0;
+
+			/** @return the number of entities constructed since the last reset. */
+			std::size_t GetNumConstructed() const { return numConstructed; }
+			/** @return the number of chunk allocations since the last reset. */
+			std::size_t GetNumAllocations() const { return numAllocations; }
+			void ResetStatistics() {
+				numConstructed = 0;
+				numAllocations = 0;
+			}
+
+		protected:
+			std::size_t numConstructed = 0;
+			std::size_t numAllocations = 0;
+		};
+
+		/**
+		 * Arena of local entities of exactly one type `T`.
+		 *
+		 * Entities are constructed in place inside fixed-size chunks that are
+		 * never released while the pool is alive, so an entity never moves and
+		 * a destroyed entity's slot goes to a free list to be recycled by the
+		 * next `Emplace`. After warming up, spawning and removing particles does
+		 * not touch the heap at all.
+		 *
+		 * `Update` calls `T::Update` directly instead of going through the
+		 * vtable, so `T` must be the most derived type of every entity stored.
+		 */
+		template <class T, std::size_t ChunkSize = 256>
+		class LocalEntityPool final : public ILocalEntityPool {
+			struct Chunk {
+				typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[ChunkSize];
+			};
+
+			const char* name;
+			std::vector<std::unique_ptr<Chunk>> chunks;
+			std::vector<T*> freeSlots;
+			std::vector<T*> active;
+
+			T* AllocateSlot() {
+				if (freeSlots.empty()) {
+					chunks.emplace_back(new Chunk());
+					numAllocations++;
+
+					// push in reverse so that slots are handed out in address order
+					Chunk& chunk = *chunks.back();
+					for (std::size_t i = ChunkSize; i > 0; i--)
+						freeSlots.push_back(reinterpret_cast<T*>(&chunk.slots[i - 1]));
+				}
+
+				T* slot = freeSlots.back();
+				freeSlots.pop_back();
+				return slot;
+			}
+
+			void Destroy(T* ent) {
+				ent->~T();
+				freeSlots.push_back(ent);
+			}
+
+		public:
+			explicit LocalEntityPool(const char* name) : name(name) {}
+			LocalEntityPool(const LocalEntityPool&) = delete;
+			void operator=(const LocalEntityPool&) = delete;
+
+			~LocalEntityPool() { Clear(); }
+
+			/** Constructs a new entity in the pool. The returned reference stays
+			 * valid until the entity's `Update` returns false or the pool is cleared. */
+			template <class... Args> T& Emplace(Args&&... args) {
+				T* slot = AllocateSlot();
+				T* ent;
+				try {
+					ent = new (slot) T(std::forward<Args>(args)...);
+				} catch (...) {
+					freeSlots.push_back(slot);
+					throw;
+				}
+				active.push_back(ent);
+				numConstructed++;
+				return *ent;
+			}
+
+			void Update(float dt) override {
+				// `T::Update` may spawn entities into this pool; those are
+				// appended to `active` and are first updated next frame.
+				const std::size_t count = active.size();
+				std::size_t kept = 0;
+				for (std::size_t i = 0; i < count; i++) {
+					T* ent = active[i];
+					if (ent->T::Update(dt))
+						active[kept++] = ent;
+					else
+						Destroy(ent);
+				}
+
+				if (kept != count) {
+					active.erase(std::move(active.begin() + count, active.end(),
+					                       active.begin() + kept),
+					             active.end());
+				}
+			}
+
+			void Render3D() override {
+				for (T* ent : active)
+					ent->T::Render3D();
+			}
+
+			void Render2D() override {
+				for (T* ent : active)
+					ent->T::Render2D();
+			}
+
+			void Clear() override {
+				for (T* ent : active)
+					Destroy(ent);
+				active.clear();
+			}
+
+			template <class F> void ForEach(F f) {
+				for (T* ent : active)
+					f(*ent);
+			}
+
+			const char* GetName() const override { return name; }
+			std::size_t GetCount() const override { return active.size(); }
+			std::size_t GetCapacity() const override { return chunks.size() * ChunkSize; }
+		};
+	} // namespace client
+} // namespace spades
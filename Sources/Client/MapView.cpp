@@ -471,26 +471,22 @@ namespace spades {
 			const AABB2 tracerInRect{0.0F, 0.0F, tracerImg->GetWidth(), tracerImg->GetHeight()};
 
 			renderer.SetColorAlphaPremultiplied(MakeVector4(1, 1, 0, 1) * largeMapAlpha);
-			for (const auto& localEntity : client->localEntities) {
-				auto* const tracer = dynamic_cast<MapViewTracer*>(localEntity.get());
-				if (!tracer)
-					continue;
-
-				const auto line1 = tracer->GetLineSegment();
+			client->GetMapViewTracerPool().ForEach([&](MapViewTracer& tracer) {
+				const auto line1 = tracer.GetLineSegment();
 				if (!line1)
-					continue;
+					return;
 
 				auto line2 = ClipLineSegment(std::make_pair(Vector2{(*line1).first.x,
 					(*line1).first.y}, Vector2{(*line1).second.x, (*line1).second.y}), inRect);
 				if (!line2)
-					continue;
+					return;
 
 				auto& line3 = *line2;
 				line3.first = Project(line3.first);
 				line3.second = Project(line3.second);
 
 				if (line3.first == line3.second)
-					continue;
+					return;
 
 				Vector2 normal = (line3.second - line3.first).Normalize();
 				normal = {-normal.y, normal.x};
@@ -504,7 +500,7 @@ namespace spades {
 
 					renderer.DrawImage(tracerImg, vt[0], vt[1], vt[2], tracerInRect);
 				}
-			}
+			});
 
 			// draw player's icon
 			const int iconMode = cg_minimapPlayerIcon;
@@ -0,0 +1,580 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+
+#include "GameMap.h"
+#include "OcclusionBuffer.h"
+#include "SceneDefinition.h"
+#include <Core/BitOps.h>
+#include <Core/Debug.h>
+#include <Core/Parallel.h>
+#include <Core/Stopwatch.h>
+#include <Draw/SW/SWFeatureLevel.h> // for ENABLE_SSE
+
+namespace spades {
+	namespace client {
+		namespace {
+			/** Columns whose solid part starts this low only hold the water
+			 * floor, which hides nothing. */
+			constexpr int MinOccluderHeight = 62;
+
+			/** Scales every reciprocal depth written to the buffer to absorb
+			 * rounding errors (a larger depth occludes less). */
+			constexpr float InvDepthBias = 0.9999F;
+
+			/** Margin (in pixels) keeping the coverage tests on the safe side
+			 * of rounding errors. */
+			constexpr float CoverageEpsilon = 1.0e-3F;
+
+			/** How far side faces reach below the neighbors hiding them. */
+			constexpr float SideFaceExtension = 2.0F;
+
+			/** The reflection is mirrored at this height. */
+			constexpr float WaterSurface = 63.0F;
+
+			unsigned int GetNumWorkers() {
+				return std::min(GetNumHardwareThreads(), 4U);
+			}
+		} // namespace
+
+		struct OcclusionBuffer::Face {
+			enum { MaxEdges = 8 };
+			/** Edge functions `a * x + b * y + c`, non-negative for the pixel
+			 * centers whose pixel lies entirely inside the face. */
+			float a[MaxEdges], b[MaxEdges], c[MaxEdges];
+			/** `-1 / a` (zero for horizontal edges). */
+			float negInvA[MaxEdges];
+			int numEdges;
+			/** Range of pixels the face may cover entirely (inclusive). */
+			int minX, minY, maxX, maxY;
+			/** The reciprocal of the farthest depth within the pixel centered
+			 * at `(x, y)` is `depthA * x + depthB * y + depthC`. */
+			float depthA, depthB, depthC;
+		};
+
+		OcclusionBuffer::OcclusionBuffer() : faces(GetNumWorkers()) {}
+
+		OcclusionBuffer::~OcclusionBuffer() {}
+
+		void OcclusionBuffer::ResetStatistics() {
+			stats.numQueries = 0;
+			stats.numOccluded = 0;
+		}
+
+		void OcclusionBuffer::Build(const GameMap& map, const SceneDefinition& def) {
+			SPADES_MARK_FUNCTION();
+
+			Stopwatch sw;
+
+			const float tanX = tanf(def.fovX * 0.5F);
+			const float tanY = tanf(def.fovY * 0.5F);
+			width = Width;
+			height = std::max(std::min(static_cast<int>(ceilf(Width * tanY / tanX)), 256), 16);
+			invDepth.assign(static_cast<std::size_t>(width * height), 0.0F);
+
+			eye = def.viewOrigin;
+			axes[0] = def.viewAxis[0];
+			axes[1] = def.viewAxis[1];
+			axes[2] = def.viewAxis[2];
+			zNear = std::max(def.zNear, 0.01F);
+			scaleX = width * 0.5F / tanX;
+			scaleY = height * 0.5F / tanY;
+			centerX = width * 0.5F;
+			centerY = height * 0.5F;
+			frustumPlanes[0] = axes[2] * tanX - axes[0];
+			frustumPlanes[1] = axes[2] * tanX + axes[0];
+			frustumPlanes[2] = axes[2] * tanY - axes[1];
+			frustumPlanes[3] = axes[2] * tanY + axes[1];
+
+			CollectBoxes(map);
+
+			// set up the faces, then rasterize them in bands of rows.
+			// the calling thread takes part in both passes.
+			const auto numWorkers = static_cast<unsigned int>(faces.size());
+			const int numBands = (height + RowsPerBand - 1) / RowsPerBand;
+			std::atomic<int> nextBand{0};
+			auto setupWorker = [&](unsigned int worker) {
+				faces[worker].clear();
+				SetupFaces(boxes.size() * worker / numWorkers,
+				           boxes.size() * (worker + 1) / numWorkers, faces[worker]);
+			};
+			auto rasterizeWorker = [&](unsigned int) {
+				int band;
+				while ((band = nextBand.fetch_add(1)) < numBands)
+					RasterizeBand(band);
+			};
+
+			InvokeParallel(setupWorker, numWorkers);
+			InvokeParallel(rasterizeWorker, numWorkers);
+
+			stats.numOccluders = boxes.size();
+			stats.numFaces = 0;
+			for (const auto& list : faces)
+				stats.numFaces += list.size();
+			stats.buildTime += sw.GetTime();
+			valid = true;
+		}
+
+		void OcclusionBuffer::CollectBoxes(const GameMap& map) {
+			SPADES_MARK_FUNCTION();
+
+			// gather the height of the solid part of every column around the
+			// eye. the region is aligned to the coarsest block size so that
+			// the blocks cover whole columns.
+			enum { Size = Radius * 2 + 4 };
+			const int originX = (static_cast<int>(floorf(eye.x)) - Radius) & ~3;
+			const int originY = (static_cast<int>(floorf(eye.y)) - Radius) & ~3;
+
+			uint8_t heights[Size * Size];
+			for (int y = 0; y < Size; y++) {
+				for (int x = 0; x < Size; x++) {
+					uint64_t air = ~map.GetSolidMapWrapped(originX + x, originY + y);
+					heights[x + y * Size] =
+					  static_cast<uint8_t>(air == 0 ? 0 : FindLastSet(air) + 1);
+				}
+			}
+
+			boxes.clear();
+
+			// level 0 merges runs of columns of equal height along X. the
+			// coarser levels use the lowest height of 2x2 and 4x4 blocks.
+			std::vector<int> blockHeights;
+			for (int level = 0; level < 3; level++) {
+				const int blockSize = 1 << level;
+				const int numBlocks = Size >> level;
+				blockHeights.assign(static_cast<std::size_t>(numBlocks * numBlocks), 0);
+				for (int y = 0; y < Size; y++)
+					for (int x = 0; x < Size; x++) {
+						int& h = blockHeights[(x >> level) + (y >> level) * numBlocks];
+						h = std::max<int>(h, heights[x + y * Size]);
+					}
+
+				// a neighbor outside the region hides nothing
+				auto getHeight = [&](int bx, int by) {
+					if (bx < 0 || by < 0 || bx >= numBlocks || by >= numBlocks)
+						return 64;
+					return blockHeights[bx + by * numBlocks];
+				};
+
+				for (int by = 0; by < numBlocks; by++) {
+					int runStart = 0;
+					int runHeight = getHeight(0, by);
+					for (int bx = 1; bx <= numBlocks; bx++) {
+						int h = bx < numBlocks ? getHeight(bx, by) : -1;
+						if (h == runHeight)
+							continue;
+						if (runHeight < MinOccluderHeight) {
+							Box box;
+							box.minX = static_cast<float>(originX + runStart * blockSize);
+							box.minY = static_cast<float>(originY + by * blockSize);
+							box.minZ = static_cast<float>(runHeight);
+							box.maxX = static_cast<float>(originX + bx * blockSize);
+							box.maxY = box.minY + static_cast<float>(blockSize);
+
+							// a side face is only exposed above the neighbors
+							int front = 0, back = 0;
+							for (int x = runStart; x < bx; x++) {
+								front = std::max(front, getHeight(x, by - 1));
+								back = std::max(back, getHeight(x, by + 1));
+							}
+							box.sideBottoms[0] = static_cast<float>(getHeight(runStart - 1, by));
+							box.sideBottoms[1] = static_cast<float>(h < 0 ? 64 : h);
+							box.sideBottoms[2] = static_cast<float>(front);
+							box.sideBottoms[3] = static_cast<float>(back);
+							boxes.push_back(box);
+						}
+						runStart = bx;
+						runHeight = h;
+					}
+				}
+			}
+		}
+
+		void OcclusionBuffer::SetupFaces(std::size_t first, std::size_t last,
+		                                 std::vector<Face>& out) {
+			SPADES_MARK_FUNCTION();
+
+			for (std::size_t i = first; i < last; i++) {
+				const Box& box = boxes[i];
+				if (!IsBoxInView(box))
+					continue;
+
+				// only the faces facing the eye are visible. side faces reach
+				// a bit below the neighbors hiding the rest so that the seams
+				// along the neighbors' top faces stay covered. below the water
+				// surface they would hide the reflection.
+				auto getBottom = [&](int side) {
+					return std::min(box.sideBottoms[side] + SideFaceExtension, WaterSurface);
+				};
+				if (eye.z < box.minZ) {
+					AddFace({MakeVector3(box.minX, box.minY, box.minZ),
+					         MakeVector3(box.maxX, box.minY, box.minZ),
+					         MakeVector3(box.maxX, box.maxY, box.minZ),
+					         MakeVector3(box.minX, box.maxY, box.minZ)},
+					        MakeVector3(0.0F, 0.0F, -1.0F), out);
+				}
+				if (eye.x < box.minX && box.sideBottoms[0] > box.minZ) {
+					float bottom = getBottom(0);
+					AddFace({MakeVector3(box.minX, box.minY, box.minZ),
+					         MakeVector3(box.minX, box.maxY, box.minZ),
+					         MakeVector3(box.minX, box.maxY, bottom),
+					         MakeVector3(box.minX, box.minY, bottom)},
+					        MakeVector3(-1.0F, 0.0F, 0.0F), out);
+				} else if (eye.x > box.maxX && box.sideBottoms[1] > box.minZ) {
+					float bottom = getBottom(1);
+					AddFace({MakeVector3(box.maxX, box.minY, box.minZ),
+					         MakeVector3(box.maxX, box.maxY, box.minZ),
+					         MakeVector3(box.maxX, box.maxY, bottom),
+					         MakeVector3(box.maxX, box.minY, bottom)},
+					        MakeVector3(1.0F, 0.0F, 0.0F), out);
+				}
+				if (eye.y < box.minY && box.sideBottoms[2] > box.minZ) {
+					float bottom = getBottom(2);
+					AddFace({MakeVector3(box.minX, box.minY, box.minZ),
+					         MakeVector3(box.maxX, box.minY, box.minZ),
+					         MakeVector3(box.maxX, box.minY, bottom),
+					         MakeVector3(box.minX, box.minY, bottom)},
+					        MakeVector3(0.0F, -1.0F, 0.0F), out);
+				} else if (eye.y > box.maxY && box.sideBottoms[3] > box.minZ) {
+					float bottom = getBottom(3);
+					AddFace({MakeVector3(box.minX, box.maxY, box.minZ),
+					         MakeVector3(box.maxX, box.maxY, box.minZ),
+					         MakeVector3(box.maxX, box.maxY, bottom),
+					         MakeVector3(box.minX, box.maxY, bottom)},
+					        MakeVector3(0.0F, 1.0F, 0.0F), out);
+				}
+			}
+		}
+
+		bool OcclusionBuffer::IsBoxInView(const Box& box) const {
+			// the corner of the box farthest along each plane's normal
+			auto getDistance = [&](const Vector3& n) {
+				Vector3 v = MakeVector3(n.x > 0.0F ? box.maxX : box.minX,
+				                        n.y > 0.0F ? box.maxY : box.minY,
+				                        n.z > 0.0F ? 64.0F : box.minZ);
+				return Vector3::Dot(v - eye, n);
+			};
+			if (getDistance(axes[2]) < zNear)
+				return false;
+			for (const Vector3& plane : frustumPlanes)
+				if (getDistance(plane) < 0.0F)
+					return false;
+			return true;
+		}
+
+		void OcclusionBuffer::AddFace(const Vector3 (&vertices)[4], const Vector3& normal,
+		                              std::vector<Face>& out) {
+			// transform into the view space and clip by the near plane
+			Vector3 view[4];
+			for (int i = 0; i < 4; i++) {
+				Vector3 v = vertices[i] - eye;
+				view[i] = MakeVector3(Vector3::Dot(v, axes[0]), Vector3::Dot(v, axes[1]),
+				                      Vector3::Dot(v, axes[2]));
+			}
+
+			Vector3 clipped[Face::MaxEdges];
+			int numVertices = 0;
+			for (int i = 0; i < 4; i++) {
+				const Vector3& v1 = view[i];
+				const Vector3& v2 = view[(i + 1) & 3];
+				if (v1.z >= zNear)
+					clipped[numVertices++] = v1;
+				if ((v1.z >= zNear) != (v2.z >= zNear)) {
+					float per = (zNear - v1.z) / (v2.z - v1.z);
+					clipped[numVertices++] = v1 + (v2 - v1) * per;
+				}
+			}
+			if (numVertices < 3)
+				return;
+
+			// project
+			float sx[Face::MaxEdges], sy[Face::MaxEdges];
+			float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+			float area = 0.0F;
+			for (int i = 0; i < numVertices; i++) {
+				float invZ = 1.0F / clipped[i].z;
+				sx[i] = centerX + clipped[i].x * invZ * scaleX;
+				sy[i] = centerY + clipped[i].y * invZ * scaleY;
+				minX = std::min(minX, sx[i]);
+				minY = std::min(minY, sy[i]);
+				maxX = std::max(maxX, sx[i]);
+				maxY = std::max(maxY, sy[i]);
+			}
+			for (int i = 0; i < numVertices; i++) {
+				int j = i + 1 == numVertices ? 0 : i + 1;
+				area += sx[i] * sy[j] - sx[j] * sy[i];
+			}
+
+			// the pixels entirely inside the bounding box
+			Face face;
+			face.minX = std::max(static_cast<int>(ceilf(minX)), 0);
+			face.minY = std::max(static_cast<int>(ceilf(minY)), 0);
+			face.maxX = std::min(static_cast<int>(floorf(maxX)), width) - 1;
+			face.maxY = std::min(static_cast<int>(floorf(maxY)), height) - 1;
+			if (face.minX > face.maxX || face.minY > face.maxY || area == 0.0F)
+				return;
+
+			// build the edge functions, moved inwards by half a pixel so that
+			// they test the whole pixel instead of its center
+			face.numEdges = numVertices;
+			for (int i = 0; i < numVertices; i++) {
+				int j = i + 1 == numVertices ? 0 : i + 1;
+				float a = sy[i] - sy[j];
+				float b = sx[j] - sx[i];
+				if (area < 0.0F) {
+					a = -a;
+					b = -b;
+				}
+				face.a[i] = a;
+				face.b[i] = b;
+				face.negInvA[i] = a != 0.0F ? -1.0F / a : 0.0F;
+				face.c[i] = -(a * sx[i] + b * sy[i]) -
+				            (0.5F + CoverageEpsilon) * (fabsf(a) + fabsf(b));
+			}
+
+			// the reciprocal of the depth is affine in the screen space:
+			// with the face plane `n . v = d` and `v = z * (u, t, 1)`,
+			// `1 / z = (n.x * u + n.y * t + n.z) / d`.
+			Vector3 n = MakeVector3(Vector3::Dot(normal, axes[0]), Vector3::Dot(normal, axes[1]),
+			                        Vector3::Dot(normal, axes[2]));
+			float d = Vector3::Dot(n, view[0]);
+			if (d > -1.0e-6F)
+				return; // facing away or seen edge-on
+			float invD = 1.0F / d;
+			face.depthA = n.x * invD / scaleX;
+			face.depthB = n.y * invD / scaleY;
+			face.depthC = (n.z - n.x * centerX / scaleX - n.y * centerY / scaleY) * invD;
+			// the farthest point within a pixel has the smallest reciprocal
+			face.depthC -= 0.5F * (fabsf(face.depthA) + fabsf(face.depthB));
+			face.depthA *= InvDepthBias;
+			face.depthB *= InvDepthBias;
+			face.depthC *= InvDepthBias;
+
+			out.push_back(face);
+		}
+
+		void OcclusionBuffer::RasterizeBand(int band) {
+			const int bandMinY = band * RowsPerBand;
+			const int bandMaxY = std::min(bandMinY + RowsPerBand, height) - 1;
+
+			for (const auto& list : faces) {
+				for (const Face& face : list) {
+					const int minY = std::max(face.minY, bandMinY);
+					const int maxY = std::min(face.maxY, bandMaxY);
+					for (int y = minY; y <= maxY; y++) {
+						// find the span of pixel centers passing all edges
+						const float cy = static_cast<float>(y) + 0.5F;
+						int x1 = face.minX, x2 = face.maxX;
+						for (int i = 0; i < face.numEdges && x1 <= x2; i++) {
+							float a = face.a[i];
+							float v = face.b[i] * cy + face.c[i];
+							if (a > 0.0F) {
+								float t = v * face.negInvA[i] - 0.5F + CoverageEpsilon;
+								if (t > static_cast<float>(x1))
+									x1 = static_cast<int>(std::min(ceilf(t), 1.0e6F));
+							} else if (a < 0.0F) {
+								float t = v * face.negInvA[i] - 0.5F - CoverageEpsilon;
+								if (t < static_cast<float>(x2))
+									x2 = static_cast<int>(std::max(floorf(t), -1.0e6F));
+							} else if (v < 0.0F) {
+								x2 = x1 - 1;
+							}
+						}
+						if (x1 > x2)
+							continue;
+
+						// the buffer keeps the nearest face, i.e. the largest
+						// reciprocal depth. a pixel seeing the face at a grazing
+						// angle may get a non-positive reciprocal, which never
+						// wins against the initial zero.
+						float* row = invDepth.data() + y * width;
+						float w = face.depthA * (static_cast<float>(x1) + 0.5F) +
+						          face.depthB * cy + face.depthC;
+						int x = x1;
+#if ENABLE_SSE
+						const __m128 dw4 = _mm_set1_ps(face.depthA * 4.0F);
+						__m128 w4 = _mm_add_ps(
+						  _mm_set1_ps(w),
+						  _mm_mul_ps(_mm_set1_ps(face.depthA), _mm_setr_ps(0.0F, 1.0F, 2.0F, 3.0F)));
+						for (; x + 3 <= x2; x += 4) {
+							_mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), w4));
+							w4 = _mm_add_ps(w4, dw4);
+						}
+						w += face.depthA * static_cast<float>(x - x1);
+#endif
+						for (; x <= x2; x++) {
+							row[x] = std::max(row[x], w);
+							w += face.depthA;
+						}
+					}
+				}
+			}
+		}
+
+		bool OcclusionBuffer::IsOccluded(const AABB3& box) {
+			if (!valid)
+				return false;
+
+			stats.numQueries++;
+			if (!IsHidden(box, false))
+				return false;
+			stats.numOccluded++;
+			return true;
+		}
+
+		bool OcclusionBuffer::IsOccludedWithReflection(const AABB3& box) {
+			if (!valid)
+				return false;
+
+			AABB3 mirrored = box;
+			mirrored.min.z = WaterSurface * 2.0F - box.max.z;
+			mirrored.max.z = WaterSurface * 2.0F - box.min.z;
+
+			// a reflected image outside the view isn't seen at all
+			stats.numQueries++;
+			if (!IsHidden(box, false) || !IsHidden(mirrored, true))
+				return false;
+			stats.numOccluded++;
+			return true;
+		}
+
+		bool OcclusionBuffer::IsHidden(const AABB3& box, bool outsideView) {
+			// project the corners. a box crossing the near plane may cover
+			// the whole screen, so it is never occluded.
+			float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+			float minZ = INFINITY;
+			for (int i = 0; i < 8; i++) {
+				Vector3 v = MakeVector3((i & 1) ? box.max.x : box.min.x,
+				                        (i & 2) ? box.max.y : box.min.y,
+				                        (i & 4) ? box.max.z : box.min.z) -
+				            eye;
+				float z = Vector3::Dot(v, axes[2]);
+				if (z < zNear)
+					return false;
+				float invZ = 1.0F / z;
+				float x = centerX + Vector3::Dot(v, axes[0]) * invZ * scaleX;
+				float y = centerY + Vector3::Dot(v, axes[1]) * invZ * scaleY;
+				minX = std::min(minX, x);
+				minY = std::min(minY, y);
+				maxX = std::max(maxX, x);
+				maxY = std::max(maxY, y);
+				minZ = std::min(minZ, z);
+			}
+
+			// every pixel the box touches
+			int x1 = std::max(static_cast<int>(floorf(minX)), 0);
+			int y1 = std::max(static_cast<int>(floorf(minY)), 0);
+			int x2 = std::min(static_cast<int>(ceilf(maxX)), width) - 1;
+			int y2 = std::min(static_cast<int>(ceilf(maxY)), height) - 1;
+			if (x1 > x2 || y1 > y2)
+				return outsideView;
+
+			// visible if any pixel is farther than the box's nearest point
+			const float invMinZ = 1.0F / minZ;
+			for (int y = y1; y <= y2; y++) {
+				const float* row = invDepth.data() + y * width;
+				int x = x1;
+#if ENABLE_SSE
+				const __m128 invMinZ4 = _mm_set1_ps(invMinZ);
+				for (; x + 3 <= x2; x += 4) {
+					if (_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(row + x), invMinZ4)))
+						return false;
+				}
+#endif
+				for (; x <= x2; x++) {
+					if (row[x] < invMinZ)
+						return false;
+				}
+			}
+
+			return true;
+		}
+
+		void OcclusionBuffer::Benchmark(const GameMap& map) {
+			SPADES_MARK_FUNCTION();
+
+			enum { NumViews = 256, NumQueries = 256 };
+
+			std::mt19937 rng{42};
+			std::uniform_real_distribution<float> unit{0.0F, 1.0F};
+			auto surfaceAt = [&](float x, float y) {
+				uint64_t solid = map.GetSolidMapWrapped(static_cast<int>(floorf(x)),
+				                                        static_cast<int>(floorf(y)));
+				for (int z = 0; z < 64; z++)
+					if (solid & (1ULL << z))
+						return static_cast<float>(z);
+				return 64.0F;
+			};
+
+			// a 16:9 view with the default field of view
+			SceneDefinition def;
+			def.fovY = DEG2RAD(68.0F);
+			def.fovX = 2.0F * atanf(tanf(def.fovY * 0.5F) * 16.0F / 9.0F);
+			def.zNear = 0.05F;
+			def.zFar = 128.0F;
+
+			OcclusionBuffer buffer;
+			double queryTime = 0.0;
+			for (int view = 0; view < NumViews; view++) {
+				// a player standing somewhere on the map looking around
+				float x = unit(rng) * map.Width(), y = unit(rng) * map.Height();
+				float yaw = unit(rng) * static_cast<float>(M_PI) * 2.0F;
+				float pitch = (unit(rng) - 0.5F) * 0.6F;
+				Vector3 front = MakeVector3(cosf(pitch) * -cosf(yaw),
+				                            cosf(pitch) * -sinf(yaw), sinf(pitch));
+				Vector3 up = MakeVector3(0.0F, 0.0F, -1.0F);
+				def.viewOrigin = MakeVector3(x, y, surfaceAt(x, y) - 2.4F);
+				def.viewAxis[0] = -Vector3::Cross(up, front).Normalize();
+				def.viewAxis[1] = -Vector3::Cross(front, def.viewAxis[0]);
+				def.viewAxis[2] = front;
+
+				buffer.Build(map, def);
+
+				// players standing in front of the eye within the fog distance,
+				// in the same box `ClientPlayer` uses
+				Stopwatch sw;
+				for (int i = 0; i < NumQueries; i++) {
+					float dist = sqrtf(unit(rng)) * 128.0F;
+					float angle = yaw + static_cast<float>(M_PI) + (unit(rng) - 0.5F) * def.fovX;
+					float px = x + cosf(angle) * dist, py = y + sinf(angle) * dist;
+					Vector3 origin = MakeVector3(px, py, surfaceAt(px, py) - 1.0F);
+					buffer.IsOccluded(AABB3(origin - MakeVector3(2.0F, 2.0F, 4.0F),
+					                        origin + MakeVector3(2.0F, 2.0F, 2.0F)));
+				}
+				queryTime += sw.GetTime();
+			}
+
+			const Statistics& s = buffer.GetStatistics();
+			SPLog("Occlusion buffer benchmark: %d views (%dx%d, %u threads)", NumViews,
+			      buffer.GetWidth(), buffer.GetHeight(), GetNumWorkers());
+			SPLog("  build: %.3f ms/view (last view: %zu occluders, %zu faces)",
+			      s.buildTime * 1000.0 / NumViews, s.numOccluders, s.numFaces);
+			SPLog("  queries: %zu, %.3f us each", s.numQueries,
+			      queryTime * 1.0e6 / std::max<std::size_t>(s.numQueries, 1));
+			SPLog("  occluded: %zu (%.1f%%)", s.numOccluded,
+			      s.numOccluded * 100.0 / std::max<std::size_t>(s.numQueries, 1));
+		}
+	} // namespace client
+} // namespace spades
@@ -0,0 +1,140 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Core/Math.h>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+		struct SceneDefinition;
+
+		/**
+		 * Low-resolution software depth buffer of the map used to skip models
+		 * hidden behind terrain and buildings.
+		 *
+		 * Every frame, the solid part of the columns near the eye (everything
+		 * below the lowest air voxel of a column) is turned into boxes whose
+		 * camera-facing faces are rasterized into the buffer, several rows
+		 * at once on the dispatch threads. Coarser boxes spanning 2x2 and
+		 * 4x4 columns are added so that the seams between neighboring boxes
+		 * are covered by a single face. Side faces stop a little below the
+		 * neighbors that hide the rest of them, and never reach below the
+		 * water surface, so that the mirrored boxes the water reflection
+		 * shows can be tested too.
+		 *
+		 * The rasterization is conservative: a pixel only receives a face if
+		 * the face covers the whole pixel, and it stores the farthest depth of
+		 * the face within the pixel. Hence `IsOccluded` never reports a box
+		 * with a visible point as occluded.
+		 */
+		class OcclusionBuffer {
+		public:
+			struct Statistics {
+				std::size_t numOccluders = 0;
+				std::size_t numFaces = 0;
+				std::size_t numQueries = 0;
+				std::size_t numOccluded = 0;
+				/** Seconds spent in `Build`. */
+				double buildTime = 0.0;
+			};
+
+			OcclusionBuffer();
+			~OcclusionBuffer();
+
+			/** Rasterizes the map as seen from `def`. */
+			void Build(const GameMap&, const SceneDefinition& def);
+			/** Makes `IsOccluded` return `false` until the next `Build`. */
+			void Invalidate() { valid = false; }
+			bool IsValid() const { return valid; }
+
+			/**
+			 * @return `true` if the box is certainly hidden behind the map when
+			 *         seen from the scene passed to `Build`. Boxes outside the
+			 *         view or crossing the near plane are never occluded.
+			 */
+			bool IsOccluded(const AABB3&);
+
+			/**
+			 * Same as `IsOccluded`, but the box must also be hidden in the
+			 * water reflection, which shows it mirrored at the water surface.
+			 */
+			bool IsOccludedWithReflection(const AABB3&);
+
+			const Statistics& GetStatistics() const { return stats; }
+			void ResetStatistics();
+
+			int GetWidth() const { return width; }
+			int GetHeight() const { return height; }
+
+			/**
+			 * Builds the buffer from random viewpoints over the map and logs
+			 * the build time, the query time and how many player-sized boxes
+			 * around each viewpoint are rejected.
+			 */
+			static void Benchmark(const GameMap&);
+
+		private:
+			struct Box {
+				float minX, minY, minZ, maxX, maxY;
+				/** Height of the lowest neighbor at -X, +X, -Y and +Y. */
+				float sideBottoms[4];
+			};
+			struct Face;
+
+			/** `IsOccluded` without the statistics. Returns `outsideView` for
+			 * boxes outside the view. */
+			bool IsHidden(const AABB3&, bool outsideView);
+
+			enum { Width = 256, Radius = 64, RowsPerBand = 8 };
+
+			bool valid = false;
+			int width = 0, height = 0;
+			/** Reciprocal of the view-space depth of each pixel. */
+			std::vector<float> invDepth;
+
+			Vector3 eye;
+			Vector3 axes[3];
+			float zNear;
+			/** Pixels per unit of `x / z` and `y / z`. */
+			float scaleX, scaleY;
+			float centerX, centerY;
+			/** Normals of the side planes of the view frustum, which pass
+			 * through the eye. */
+			Vector3 frustumPlanes[4];
+
+			std::vector<Box> boxes;
+			std::vector<std::vector<Face>> faces;
+			Statistics stats;
+
+			void CollectBoxes(const GameMap&);
+			bool IsBoxInView(const Box&) const;
+			void SetupFaces(std::size_t first, std::size_t last, std::vector<Face>&);
+			void AddFace(const Vector3 (&vertices)[4], const Vector3& normal,
+			             std::vector<Face>&);
+			void RasterizeBand(int band);
+		};
+	} // namespace client
+} // namespace spades
@@ -0,0 +1,380 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include "Client.h"
+#include "GameMap.h"
+#include "IImage.h"
+#include "ParticleSystem.h"
+#include "ProjectilePhysics.h"
+#include "World.h"
+#include <Core/Debug.h>
+
+namespace spades {
+	namespace client {
+
+		namespace {
+			template <class T>
+			void CompactArray(std::vector<T>& v, const std::vector<uint8_t>& dead) {
+				std::size_t kept = 0;
+				for (std::size_t i = 0; i < v.size(); i++) {
+					if (dead[i])
+						continue;
+					if (kept != i)
+						v[kept] = std::move(v[i]);
+					kept++;
+				}
+				v.resize(kept);
+			}
+		} // namespace
+
+		void ParticleSystem::ParticleRef::SetAdditive(bool b) {
+			if (b)
+				system.flags[index] |= FlagAdditive;
+			else
+				system.flags[index] &= ~FlagAdditive;
+		}
+
+		void ParticleSystem::ParticleRef::SetLifeTime(float lifeTime, float fadeIn,
+		                                              float fadeOut) {
+			system.lifetime[index] = lifeTime;
+			system.fadeInDuration[index] = fadeIn;
+			system.fadeOutDuration[index] = fadeOut;
+		}
+
+		void ParticleSystem::ParticleRef::SetTrajectory(Vector3 pos, Vector3 vel, float damp,
+		                                                float grav) {
+			system.posX[index] = pos.x;
+			system.posY[index] = pos.y;
+			system.posZ[index] = pos.z;
+			system.velX[index] = vel.x;
+			system.velY[index] = vel.y;
+			system.velZ[index] = vel.z;
+			system.logVelocityDamp[index] = logf(damp);
+			system.gravityScale[index] = grav;
+		}
+
+		void ParticleSystem::ParticleRef::SetRotation(float initialAng, float angleVel) {
+			system.angle[index] = initialAng;
+			system.rotationVelocity[index] = angleVel;
+		}
+
+		void ParticleSystem::ParticleRef::SetRadius(float initialRad, float radVel, float damp) {
+			system.radius[index] = initialRad;
+			system.radiusVelocity[index] = radVel;
+			system.logRadiusDamp[index] = logf(damp);
+		}
+
+		void ParticleSystem::ParticleRef::SetBlockHitAction(BlockHitAction act) {
+			system.blockHitActions[index] = act;
+		}
+
+		void ParticleSystem::ParticleRef::SetColor(Vector4 col) {
+			system.colorR[index] = col.x;
+			system.colorG[index] = col.y;
+			system.colorB[index] = col.z;
+			system.colorA[index] = col.w;
+		}
+
+		ParticleSystem::ParticleSystem(Client& client)
+		    : client(client), renderer(client.GetRenderer()) {}
+
+		ParticleSystem::~ParticleSystem() {}
+
+		void ParticleSystem::Preload() {
+			if (smokeLoaded)
+				return;
+
+			for (std::size_t i = 0; i < smokeSequence.size(); i++) {
+				char buf[256];
+				snprintf(buf, sizeof(buf), "Textures/Smoke1/%03d.png", (int)i);
+				smokeSequence[i] = renderer.RegisterImage(buf);
+			}
+			for (std::size_t i = 0; i < explosionSequence.size(); i++) {
+				char buf[256];
+				snprintf(buf, sizeof(buf), "Textures/Smoke2/%03d.png", (int)i);
+				explosionSequence[i] = renderer.RegisterImage(buf);
+			}
+
+			smokeLoaded = true;
+		}
+
+		std::size_t ParticleSystem::Add(Handle<IImage> image, Vector4 color) {
+			const std::size_t oldCapacity = posX.capacity();
+
+			posX.push_back(0.0F);
+			posY.push_back(0.0F);
+			posZ.push_back(0.0F);
+			velX.push_back(0.0F);
+			velY.push_back(0.0F);
+			velZ.push_back(0.0F);
+			radius.push_back(1.0F);
+			radiusVelocity.push_back(0.0F);
+			angle.push_back(0.0F);
+			rotationVelocity.push_back(0.0F);
+			logVelocityDamp.push_back(0.0F);
+			logRadiusDamp.push_back(0.0F);
+			gravityScale.push_back(1.0F);
+			lifetime.push_back(1.0F);
+			time.push_back(0.0F);
+			fadeInDuration.push_back(0.1F);
+			fadeOutDuration.push_back(0.5F);
+			colorR.push_back(color.x);
+			colorG.push_back(color.y);
+			colorB.push_back(color.z);
+			colorA.push_back(color.w);
+			frame.push_back(0.0F);
+			fps.push_back(0.0F);
+			images.push_back(std::move(image));
+			blockHitActions.push_back(BlockHitAction::Delete);
+			flags.push_back(0);
+
+			numConstructed++;
+			if (posX.capacity() != oldCapacity)
+				numAllocations++;
+
+			return posX.size() - 1;
+		}
+
+		ParticleSystem::ParticleRef ParticleSystem::Emit(Handle<IImage> image, Vector4 color) {
+			SPAssert(image);
+			return {*this, Add(std::move(image), color)};
+		}
+
+		ParticleSystem::ParticleRef ParticleSystem::EmitSmoke(Vector4 color, float framesPerSecond,
+		                                                      SmokeType type) {
+			Preload();
+
+			std::size_t i = Add({}, color);
+			fps[i] = framesPerSecond;
+			flags[i] = FlagSmoke;
+			if (type == SmokeType::Explosion)
+				flags[i] |= FlagSmokeExplosion;
+			return {*this, i};
+		}
+
+		IImage& ParticleSystem::GetImage(std::size_t i) {
+			if (flags[i] & FlagSmokeExplosion)
+				return *explosionSequence[(int)floorf(frame[i])];
+			if (flags[i] & FlagSmoke)
+				return *smokeSequence[(int)floorf(frame[i])];
+			return *images[i];
+		}
+
+		void ParticleSystem::Update(float dt) {
+			SPADES_MARK_FUNCTION();
+
+			const std::size_t count = GetCount();
+			if (count == 0)
+				return;
+
+			dead.assign(count, 0);
+			lastX.resize(count);
+			lastY.resize(count);
+			lastZ.resize(count);
+
+			// animation and lifetime
+			for (std::size_t i = 0; i < count; i++) {
+				float f = frame[i] + dt * fps[i];
+				if (flags[i] & FlagSmokeExplosion) {
+					if (f > 47.0F) {
+						f = 47.0F;
+						dead[i] = 1;
+					}
+				} else if (flags[i] & FlagSmoke) {
+					f = fmodf(f, 180.0F);
+				}
+				frame[i] = f;
+
+				time[i] += dt;
+				if (time[i] > lifetime[i])
+					dead[i] = 1;
+			}
+
+			// integration
+			const float gravity = 32.0F * dt;
+			for (std::size_t i = 0; i < count; i++) {
+				lastX[i] = posX[i];
+				lastY[i] = posY[i];
+				lastZ[i] = posZ[i];
+				posX[i] += velX[i] * dt;
+				posY[i] += velY[i] * dt;
+				posZ[i] += velZ[i] * dt;
+				velZ[i] += gravity * gravityScale[i];
+			}
+
+			Collide();
+
+			// rotation, growth and damping
+			for (std::size_t i = 0; i < count; i++) {
+				radius[i] += radiusVelocity[i] * dt;
+				angle[i] += rotationVelocity[i] * dt;
+
+				float velDamp = expf(logVelocityDamp[i] * dt);
+				velX[i] *= velDamp;
+				velY[i] *= velDamp;
+				velZ[i] *= velDamp;
+				radiusVelocity[i] *= expf(logRadiusDamp[i] * dt);
+			}
+
+			Compact();
+		}
+
+		void ParticleSystem::Collide() {
+			World* world = client.GetWorld();
+			if (!world || !world->GetMap())
+				return;
+
+			ClipWorldCache clip{*world->GetMap()};
+
+			const std::size_t count = GetCount();
+			for (std::size_t i = 0; i < count; i++) {
+				BlockHitAction action = blockHitActions[i];
+				if (action == BlockHitAction::Ignore || dead[i])
+					continue;
+
+				IntVector3 lp = MakeVector3(posX[i], posY[i], posZ[i]).Floor();
+
+				if (lp.z >= 64 && action == BlockHitAction::Stick) {
+					dead[i] = 1;
+					continue;
+				}
+
+				if (!clip(lp.x, lp.y, lp.z))
+					continue;
+
+				if (action == BlockHitAction::Delete) {
+					dead[i] = 1;
+					continue;
+				}
+
+				if (action == BlockHitAction::Stick) {
+					rotationVelocity[i] *= 0.5F;
+				} else {
+					IntVector3 lp2 = MakeVector3(lastX[i], lastY[i], lastZ[i]).Floor();
+					if (lp.z != lp2.z &&
+						((lp.x == lp2.x && lp.y == lp2.y) || !clip(lp.x, lp.y, lp2.z)))
+						velZ[i] = -velZ[i];
+					else if (lp.x != lp2.x &&
+						((lp.y == lp2.y && lp.z == lp2.z) || !clip(lp2.x, lp.y, lp.z)))
+						velX[i] = -velX[i];
+					else if (lp.y != lp2.y &&
+						((lp.x == lp2.x && lp.z == lp2.z) || !clip(lp.x, lp2.y, lp.z)))
+						velY[i] = -velY[i];
+
+					radius[i] *= 0.75F;
+				}
+
+				// set back to old position and lose some velocity due to friction
+				posX[i] = lastX[i];
+				posY[i] = lastY[i];
+				posZ[i] = lastZ[i];
+				velX[i] *= 0.46F;
+				velY[i] *= 0.46F;
+				velZ[i] *= 0.46F;
+			}
+		}
+
+		void ParticleSystem::Compact() {
+			bool anyDead = false;
+			for (uint8_t d : dead)
+				anyDead |= d != 0;
+			if (!anyDead)
+				return;
+
+			CompactArray(posX, dead);
+			CompactArray(posY, dead);
+			CompactArray(posZ, dead);
+			CompactArray(velX, dead);
+			CompactArray(velY, dead);
+			CompactArray(velZ, dead);
+			CompactArray(radius, dead);
+			CompactArray(radiusVelocity, dead);
+			CompactArray(angle, dead);
+			CompactArray(rotationVelocity, dead);
+			CompactArray(logVelocityDamp, dead);
+			CompactArray(logRadiusDamp, dead);
+			CompactArray(gravityScale, dead);
+			CompactArray(lifetime, dead);
+			CompactArray(time, dead);
+			CompactArray(fadeInDuration, dead);
+			CompactArray(fadeOutDuration, dead);
+			CompactArray(colorR, dead);
+			CompactArray(colorG, dead);
+			CompactArray(colorB, dead);
+			CompactArray(colorA, dead);
+			CompactArray(frame, dead);
+			CompactArray(fps, dead);
+			CompactArray(images, dead);
+			CompactArray(blockHitActions, dead);
+			CompactArray(flags, dead);
+		}
+
+		void ParticleSystem::Render3D() {
+			SPADES_MARK_FUNCTION();
+
+			const std::size_t count = GetCount();
+			if (count == 0)
+				return;
+
+			spriteParams.resize(count);
+			for (std::size_t i = 0; i < count; i++) {
+				float t = time[i];
+				float fade = 1.0F;
+				if (t < fadeInDuration[i])
+					fade *= t / fadeInDuration[i];
+				if (t > lifetime[i] - fadeOutDuration[i])
+					fade *= (lifetime[i] - t) / fadeOutDuration[i];
+
+				// premultiplied alpha!
+				float alpha = colorA[i] * fade;
+
+				SpriteParam& param = spriteParams[i];
+				param.center = MakeVector3(posX[i], posY[i], posZ[i]);
+				param.radius = radius[i];
+				param.rotation = angle[i];
+				param.color = MakeVector4(colorR[i] * alpha, colorG[i] * alpha,
+				                          colorB[i] * alpha,
+				                          (flags[i] & FlagAdditive) ? 0.0F : alpha);
+			}
+
+			// submit runs of particles sharing the same image at once
+			std::size_t start = 0;
+			IImage* image = &GetImage(0);
+			for (std::size_t i = 1; i <= count; i++) {
+				IImage* next = i < count ? &GetImage(i) : nullptr;
+				if (next == image)
+					continue;
+
+				renderer.AddSprites(*image, spriteParams.data() + start, i - start);
+				start = i;
+				image = next;
+			}
+		}
+
+		void ParticleSystem::Clear() {
+			dead.assign(GetCount(), 1);
+			Compact();
+		}
+	} // namespace client
+} // namespace spades
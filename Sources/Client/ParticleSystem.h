@@ -0,0 +1,140 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "IRenderer.h"
+#include "LocalEntityPool.h"
+#include <Core/Math.h>
+#include <Core/RefCountedObject.h>
+
+namespace spades {
+	namespace client {
+		class Client;
+		class IImage;
+
+		enum class BlockHitAction { Delete, Ignore, BounceWeak, Stick };
+
+		enum class SmokeType {
+			/** Loops through the 180-frame smoke sequence forever. */
+			Steady,
+			/** Plays the 48-frame explosion sequence once. */
+			Explosion
+		};
+
+		/**
+		 * Sprite particles (debris, blood, smoke) stored as structure-of-arrays.
+		 *
+		 * All particles are stepped together: lifetimes, integration and
+		 * damping are plain loops over contiguous arrays that the compiler can
+		 * vectorize, the block collision runs as a separate pass over only the
+		 * particles that collide, and the sprites are submitted to the renderer
+		 * in runs sharing the same image through `IRenderer::AddSprites`.
+		 *
+		 * Particles are created with `Emit`/`EmitSmoke` and configured through
+		 * the returned `ParticleRef`, which must not be kept past the frame.
+		 */
+		class ParticleSystem final : public ILocalEntityPool {
+		public:
+			class ParticleRef {
+				friend class ParticleSystem;
+				ParticleSystem& system;
+				std::size_t index;
+
+				ParticleRef(ParticleSystem& system, std::size_t index)
+				    : system(system), index(index) {}
+
+			public:
+				void SetAdditive(bool b);
+				void SetLifeTime(float lifeTime, float fadeIn, float fadeOut);
+				void SetTrajectory(Vector3 initialPos, Vector3 initialVel,
+					float velDamp = 1.0F, float gravScale = 1.0F);
+				void SetRotation(float initialAng, float angleVel = 0.0F);
+				void SetRadius(float initialRad, float radiusVel = 0.0F, float radDamp = 1.0F);
+				void SetBlockHitAction(BlockHitAction act);
+				void SetColor(Vector4 col);
+			};
+
+		private:
+			enum Flags : uint8_t {
+				FlagAdditive = 1 << 0,
+				FlagSmoke = 1 << 1,
+				FlagSmokeExplosion = 1 << 2
+			};
+
+			Client& client;
+			IRenderer& renderer;
+
+			std::vector<float> posX, posY, posZ;
+			std::vector<float> velX, velY, velZ;
+			std::vector<float> radius, radiusVelocity;
+			std::vector<float> angle, rotationVelocity;
+			/** `logf` of the velocity/radius damping factors so that damping
+			 * becomes `expf(logDamp * dt)`, which is exactly 1 for no damping. */
+			std::vector<float> logVelocityDamp, logRadiusDamp;
+			std::vector<float> gravityScale;
+			std::vector<float> lifetime, time;
+			std::vector<float> fadeInDuration, fadeOutDuration;
+			std::vector<float> colorR, colorG, colorB, colorA;
+			std::vector<float> frame, fps;
+			std::vector<Handle<IImage>> images;
+			std::vector<BlockHitAction> blockHitActions;
+			std::vector<uint8_t> flags;
+
+			// scratch buffers of `Update` and `Render3D`
+			std::vector<float> lastX, lastY, lastZ;
+			std::vector<uint8_t> dead;
+			std::vector<SpriteParam> spriteParams;
+
+			std::array<Handle<IImage>, 180> smokeSequence;
+			std::array<Handle<IImage>, 48> explosionSequence;
+			bool smokeLoaded = false;
+
+			std::size_t Add(Handle<IImage> image, Vector4 color);
+			void Collide();
+			void Compact();
+			IImage& GetImage(std::size_t i);
+
+		public:
+			ParticleSystem(Client&);
+			~ParticleSystem();
+
+			/** Loads the smoke animation frames. */
+			void Preload();
+
+			ParticleRef Emit(Handle<IImage> image, Vector4 color);
+			ParticleRef EmitSmoke(Vector4 color, float fps, SmokeType type = SmokeType::Steady);
+
+			void Update(float dt) override;
+			void Render3D() override;
+			void Render2D() override {}
+			void Clear() override;
+
+			const char* GetName() const override { return "Particles"; }
+			std::size_t GetCount() const override { return posX.size(); }
+			std::size_t GetCapacity() const override { return posX.capacity(); }
+		};
+	} // namespace client
+} // namespace spades
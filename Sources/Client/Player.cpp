@@ -28,6 +28,7 @@
 #include "Grenade.h"
 #include "HitTestDebugger.h"
 #include "IWorldListener.h"
+#include "PlayerPhysics.h"
 #include "Weapon.h"
 #include "World.h"
 #include <Core/Debug.h>
@@ -52,6 +53,7 @@ namespace spades {
 			wade = false;
 			position = MakeVector3(0, 0, 0);
 			eye = position;
+			lastEye = eye;
 			velocity = MakeVector3(0, 0, 0);
 			orientation = MakeVector3((tId == 1) ? -1.0F : 1.0F, 0, 0);
 			orientationSmoothed = orientation;
@@ -368,13 +370,18 @@ namespace spades {
 		void Player::Update(float dt) {
 			SPADES_MARK_FUNCTION();
 
+			MovePlayer(dt);
+			UpdateTool(dt);
+		}
+
+		void Player::UpdateTool(float dt) {
+			SPADES_MARK_FUNCTION();
+
 			bool isLocal = this->IsLocalPlayer();
 
 			const float primaryDelay = GetToolPrimaryDelay(tool);
 			const float secondaryDelay = GetToolSecondaryDelay(tool);
 
-			MovePlayer(dt);
-
 			if (tool == ToolSpade) {
 				if (weapInput.primary) {
 					if (world.GetTime() > nextSpadeTime) {
@@ -1014,9 +1021,22 @@ namespace spades {
 			return Vector3::Cross(GetRight(), GetFront()).Normalize();
 		}
 
-		Vector3 Player::GetOrigin() {
+		Vector3 Player::GetEye(bool interpolate) {
+			// The local player is drawn at its newest state so that the camera
+			// doesn't lag a step behind the input
+			if (!interpolate || IsLocalPlayer())
+				return eye;
+
+			// Don't interpolate respawns and other teleports
+			if ((eye - lastEye).GetSquaredLength() > 4.0F)
+				return eye;
+
+			return Mix(lastEye, eye, world.GetInterpolationFactor());
+		}
+
+		Vector3 Player::GetOrigin(bool interpolate) {
 			SPADES_MARK_FUNCTION_DEBUG();
-			Vector3 v = eye;
+			Vector3 v = GetEye(interpolate);
 			v.z += (input.crouch ? 0.45F : 0.9F);
 			v.z += 0.3F;
 			return v;
@@ -1025,112 +1045,19 @@ namespace spades {
 		void Player::BoxClipMove(float fsynctics) {
 			SPADES_MARK_FUNCTION();
 
-			bool climb = false;
-			float size = 0.45F;
-			float offset, m;
-			if (input.crouch) {
-				offset = 0.45F;
-				m = 0.9F;
-			} else {
-				offset = 0.9F;
-				m = 1.35F;
-			}
-
-			float f = fsynctics * 32.0F;
-			float nx = f * velocity.x + position.x;
-			float ny = f * velocity.y + position.y;
-			float nz = position.z + offset;
-			float z;
-
 			const Handle<GameMap>& map = world.GetMap();
 			SPAssert(map);
 
-			z = m;
-			float bx = nx + ((velocity.x < 0.0F) ? -size : size);
-			while (z >= -1.36F
-				&& !map->ClipBox(bx, position.y - size, nz + z)
-				&& !map->ClipBox(bx, position.y + size, nz + z))
-				z -= 0.9F;
-			if (z < -1.36F) {
-				position.x = nx;
-			} else if (!input.crouch && orientation.z < 0.5F && !input.sprint) {
-				z = 0.35F;
-				while (z >= -2.36F
-					&& !map->ClipBox(bx, position.y - size, nz + z)
-					&& !map->ClipBox(bx, position.y + size, nz + z))
-					z -= 0.9F;
-				if (z < -2.36F) {
-					position.x = nx;
-					climb = true;
-				} else {
-					velocity.x = 0.0F;
-				}
-			} else {
-				velocity.x = 0.0F;
-			}
-
-			z = m;
-			float by = ny + ((velocity.y < 0.0F) ? -size : size);
-			while (z >= -1.36F
-				&& !map->ClipBox(position.x - size, by, nz + z)
-				&& !map->ClipBox(position.x + size, by, nz + z))
-				z -= 0.9F;
-			if (z < -1.36F) {
-				position.y = ny;
-			} else if (!input.crouch && orientation.z < 0.5F && !input.sprint && !climb) {
-				z = 0.35F;
-				while (z >= -2.36F
-					&& !map->ClipBox(position.x - size, by, nz + z)
-					&& !map->ClipBox(position.x + size, by, nz + z))
-					z -= 0.9F;
-				if (z < -2.36F) {
-					position.y = ny;
-					climb = true;
-				} else {
-					velocity.y = 0.0F;
-				}
-			} else if (!climb) {
-				velocity.y = 0.0F;
-			}
-
-			if (climb) {
-				// slow down when climbing
-				velocity.x *= 0.5F;
-				velocity.y *= 0.5F;
+			if (PlayerBoxClipMove(*map, fsynctics, input.crouch, CanClimb(), position, velocity,
+			                      airborne, wade))
 				lastClimbTime = world.GetTime();
-				nz--;
-				m = -1.35F;
-			} else {
-				if (velocity.z < 0.0F)
-					m = -m;
-				nz += velocity.z * f;
-			}
-
-			airborne = true;
-			float x1 = position.x + size;
-			float x2 = position.x - size;
-			float y1 = position.y + size;
-			float y2 = position.y - size;
-			if (map->ClipBox(x2, y2, nz + m) ||
-				map->ClipBox(x2, y1, nz + m) ||
-				map->ClipBox(x1, y2, nz + m) ||
-				map->ClipBox(x1, y1, nz + m)) {
-				if (velocity.z >= 0.0F) {
-					wade = position.z > 61.0F;
-					airborne = false;
-				}
-
-				velocity.z = 0.0F;
-			} else {
-				position.z = nz - offset;
-			}
 
 			RepositionPlayer(position);
 		}
 
 		void Player::PlayerJump() {
 			lastJump = true;
-			velocity.z = -0.36F;
+			velocity.z = JUMP_VELOCITY;
 
 			if (world.GetListener() && world.GetTime() - lastJumpTime > 0.1F) {
 				world.GetListener()->PlayerJumped(*this);
@@ -1182,27 +1109,10 @@ namespace spades {
 				return;
 			}
 
-			bool isZoomed = tool == ToolWeapon && weapInput.secondary;
 			bool isOnGround = IsOnGroundOrWade();
+			HandleJumpInput(isOnGround);
 
-			if (input.jump && !lastJump && isOnGround) {
-				PlayerJump();
-			} else if (!input.jump) {
-				lastJump = false;
-			}
-
-			float f = fsynctics; // player acceleration scalar
-			if (airborne)
-				f *= 0.1F;
-			else if (input.crouch)
-				f *= 0.3F;
-			else if (isZoomed || input.sneak)
-				f *= 0.5F;
-			else if (input.sprint)
-				f *= 1.3F;
-
-			if ((input.moveForward || input.moveBackward) && (input.moveRight || input.moveLeft))
-				f *= sqrtf(0.5F); // if strafe + forward/backwards then limit diagonal velocity
+			float f = GetMoveAcceleration(fsynctics);
 
 			Vector3 front = GetFront();
 			if (input.moveForward) {
@@ -1228,24 +1138,61 @@ namespace spades {
 			velocity.z += fsynctics;
 			velocity.z /= f; // air friction
 
-			if (wade) // water friction
-				f = fsynctics * 6.0F + 1.0F;
-			else if (!airborne) // ground friction
-				f = fsynctics * 4.0F + 1.0F;
-
+			f = GetMoveFriction(fsynctics);
 			velocity.x /= f;
 			velocity.y /= f;
 
 			float f2 = velocity.z;
 			BoxClipMove(fsynctics);
 
+			PlayerMoved(fsynctics, f2, isOnGround);
+		}
+
+		void Player::HandleJumpInput(bool isOnGround) {
+			if (WillJump(isOnGround)) {
+				PlayerJump();
+			} else if (!input.jump) {
+				lastJump = false;
+			}
+		}
+
+		float Player::GetMoveAcceleration(float fsynctics) {
+			bool isZoomed = tool == ToolWeapon && weapInput.secondary;
+
+			float f = fsynctics; // player acceleration scalar
+			if (airborne)
+				f *= 0.1F;
+			else if (input.crouch)
+				f *= 0.3F;
+			else if (isZoomed || input.sneak)
+				f *= 0.5F;
+			else if (input.sprint)
+				f *= 1.3F;
+
+			if ((input.moveForward || input.moveBackward) && (input.moveRight || input.moveLeft))
+				f *= sqrtf(0.5F); // if strafe + forward/backwards then limit diagonal velocity
+
+			return f;
+		}
+
+		float Player::GetMoveFriction(float fsynctics) {
+			if (wade) // water friction
+				return fsynctics * 6.0F + 1.0F;
+			else if (!airborne) // ground friction
+				return fsynctics * 4.0F + 1.0F;
+			return fsynctics + 1.0F;
+		}
+
+		void Player::PlayerMoved(float fsynctics, float fallVelocity, bool wasOnGround) {
+			bool isZoomed = tool == ToolWeapon && weapInput.secondary;
+
 			// hit ground... check if hurt
-			if (!velocity.z && f2 > FALL_SLOW_DOWN) {
+			if (!velocity.z && fallVelocity > FALL_SLOW_DOWN) {
 				// slow down on landing
 				velocity.x *= 0.5F;
 				velocity.y *= 0.5F;
 
-				bool hurtOnLanding = f2 > FALL_DAMAGE_VELOCITY;
+				bool hurtOnLanding = fallVelocity > FALL_DAMAGE_VELOCITY;
 				if (world.GetListener())
 					world.GetListener()->PlayerLanded(*this, hurtOnLanding);
 			}
@@ -1262,7 +1209,7 @@ namespace spades {
 					moveDistance -= 1.0F;
 
 					if (world.GetListener() && !madeFootstep) {
-						if (vel2D > 0.01F && isOnGround
+						if (vel2D > 0.01F && wasOnGround
 							&& !input.crouch && !input.sneak && !isZoomed)
 							world.GetListener()->PlayerMadeFootstep(*this);
 						madeFootstep = true;
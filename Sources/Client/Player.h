@@ -75,6 +75,7 @@ namespace spades {
 			Vector3 orientation;
 			Vector3 orientationSmoothed;
 			Vector3 eye;
+			Vector3 lastEye; // `eye` before the last world step
 			PlayerInput input;
 			WeaponInput weapInput;
 			bool alive;
@@ -131,11 +132,23 @@ namespace spades {
 
 			float respawnTime;
 
+			friend class PlayerPhysicsBatch;
+
 			void MoveCorpse(float fsynctics);
 			void MovePlayer(float fsynctics);
 			void BoxClipMove(float fsynctics);
 			bool TryUncrouch();
 
+			// pieces of `MovePlayer` shared with `PlayerPhysicsBatch`
+			bool WillJump(bool isOnGround) const {
+				return input.jump && !lastJump && isOnGround;
+			}
+			void HandleJumpInput(bool isOnGround);
+			float GetMoveAcceleration(float fsynctics);
+			float GetMoveFriction(float fsynctics);
+			void PlayerMoved(float fsynctics, float fallVelocity, bool wasOnGround);
+			bool CanClimb() { return !input.crouch && orientation.z < 0.5F && !input.sprint; }
+
 			void UseSpade(bool dig);
 			void FireWeapon();
 
@@ -221,8 +234,8 @@ namespace spades {
 			Vector3 GetFront2D();
 			Vector3 GetRight();
 			Vector3 GetUp();
-			Vector3 GetEye() { return eye; }
-			Vector3 GetOrigin(); // actually not origin at all!
+			Vector3 GetEye(bool interpolate = false);
+			Vector3 GetOrigin(bool interpolate = false); // actually not origin at all!
 			Vector3 GetVelocity() { return velocity; }
 
 			World& GetWorld() { return world; }
@@ -232,8 +245,14 @@ namespace spades {
 				return (velocity.z >= 0.0F && velocity.z < 0.017F) && !airborne;
 			}
 
+			/** Remembers the current state for `GetEye(true)`. Called by `World`
+			 * before each step. */
+			void SaveInterpolationState() { lastEye = eye; }
 			void UpdateSmooth(float dt);
 			void Update(float dt);
+			/** Same as `Update`, but without moving the player. Used after the
+			 * movement was done by `PlayerPhysicsBatch`. */
+			void UpdateTool(float dt);
 
 			float GetTimeToNextSpade();
 			float GetTimeToNextDig();
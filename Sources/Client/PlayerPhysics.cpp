@@ -0,0 +1,302 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "PlayerPhysics.h"
+
+#include "GameConstants.h"
+#include "GameMap.h"
+#include "Player.h"
+#include "World.h"
+#include <Core/Debug.h>
+
+namespace spades {
+	namespace client {
+
+		bool PlayerBoxClipMove(const GameMap& map, float fsynctics, bool crouch, bool canClimb,
+		                       Vector3& position, Vector3& velocity, bool& airborne,
+		                       bool& wade) {
+			bool climb = false;
+			float size = 0.45F;
+			float offset, m;
+			if (crouch) {
+				offset = 0.45F;
+				m = 0.9F;
+			} else {
+				offset = 0.9F;
+				m = 1.35F;
+			}
+
+			float f = fsynctics * 32.0F;
+			float nx = f * velocity.x + position.x;
+			float ny = f * velocity.y + position.y;
+			float nz = position.z + offset;
+			float z;
+
+			z = m;
+			float bx = nx + ((velocity.x < 0.0F) ? -size : size);
+			while (z >= -1.36F
+				&& !map.ClipBox(bx, position.y - size, nz + z)
+				&& !map.ClipBox(bx, position.y + size, nz + z))
+				z -= 0.9F;
+			if (z < -1.36F) {
+				position.x = nx;
+			} else if (canClimb) {
+				z = 0.35F;
+				while (z >= -2.36F
+					&& !map.ClipBox(bx, position.y - size, nz + z)
+					&& !map.ClipBox(bx, position.y + size, nz + z))
+					z -= 0.9F;
+				if (z < -2.36F) {
+					position.x = nx;
+					climb = true;
+				} else {
+					velocity.x = 0.0F;
+				}
+			} else {
+				velocity.x = 0.0F;
+			}
+
+			z = m;
+			float by = ny + ((velocity.y < 0.0F) ? -size : size);
+			while (z >= -1.36F
+				&& !map.ClipBox(position.x - size, by, nz + z)
+				&& !map.ClipBox(position.x + size, by, nz + z))
+				z -= 0.9F;
+			if (z < -1.36F) {
+				position.y = ny;
+			} else if (canClimb && !climb) {
+				z = 0.35F;
+				while (z >= -2.36F
+					&& !map.ClipBox(position.x - size, by, nz + z)
+					&& !map.ClipBox(position.x + size, by, nz + z))
+					z -= 0.9F;
+				if (z < -2.36F) {
+					position.y = ny;
+					climb = true;
+				} else {
+					velocity.y = 0.0F;
+				}
+			} else if (!climb) {
+				velocity.y = 0.0F;
+			}
+
+			if (climb) {
+				// slow down when climbing
+				velocity.x *= 0.5F;
+				velocity.y *= 0.5F;
+				nz--;
+				m = -1.35F;
+			} else {
+				if (velocity.z < 0.0F)
+					m = -m;
+				nz += velocity.z * f;
+			}
+
+			airborne = true;
+			float x1 = position.x + size;
+			float x2 = position.x - size;
+			float y1 = position.y + size;
+			float y2 = position.y - size;
+			if (map.ClipBox(x2, y2, nz + m) ||
+				map.ClipBox(x2, y1, nz + m) ||
+				map.ClipBox(x1, y2, nz + m) ||
+				map.ClipBox(x1, y1, nz + m)) {
+				if (velocity.z >= 0.0F) {
+					wade = position.z > 61.0F;
+					airborne = false;
+				}
+
+				velocity.z = 0.0F;
+			} else {
+				position.z = nz - offset;
+			}
+
+			return climb;
+		}
+
+		void PlayerPhysicsBatch::Compute(World& world, float dt) {
+			SPADES_MARK_FUNCTION();
+
+			const Handle<GameMap>& map = world.GetMap();
+			SPAssert(map);
+
+			Gather(world, dt);
+			Integrate(dt);
+			Clip(*map, dt);
+			nextPlayer = 0;
+		}
+
+		void PlayerPhysicsBatch::Gather(World& world, float dt) {
+			players.clear();
+			posX.clear();
+			posY.clear();
+			posZ.clear();
+			velX.clear();
+			velY.clear();
+			velZ.clear();
+			frontX.clear();
+			frontY.clear();
+			rightX.clear();
+			rightY.clear();
+			forward.clear();
+			strafe.clear();
+			accel.clear();
+			friction.clear();
+			flags.clear();
+
+			for (std::size_t i = 0; i < world.GetNumPlayerSlots(); i++) {
+				auto p = world.GetPlayer(static_cast<unsigned int>(i));
+				if (!p || p->IsSpectator())
+					continue;
+
+				Player& player = *p;
+				if (!player.alive)
+					continue;
+
+				// The jump itself (and its event) happens in `Apply`
+				bool isOnGround = player.IsOnGroundOrWade();
+				float vz = player.WillJump(isOnGround) ? JUMP_VELOCITY : player.velocity.z;
+
+				const PlayerInput& input = player.input;
+				Vector3 right = player.GetRight();
+
+				players.push_back(&player);
+				posX.push_back(player.position.x);
+				posY.push_back(player.position.y);
+				posZ.push_back(player.position.z);
+				velX.push_back(player.velocity.x);
+				velY.push_back(player.velocity.y);
+				velZ.push_back(vz);
+				frontX.push_back(player.orientation.x);
+				frontY.push_back(player.orientation.y);
+				rightX.push_back(right.x);
+				rightY.push_back(right.y);
+				forward.push_back(input.moveForward ? 1.0F : input.moveBackward ? -1.0F : 0.0F);
+				strafe.push_back(input.moveLeft ? -1.0F : input.moveRight ? 1.0F : 0.0F);
+				accel.push_back(player.GetMoveAcceleration(dt));
+				friction.push_back(player.GetMoveFriction(dt));
+
+				uint8_t fl = 0;
+				if (input.crouch)
+					fl |= FlagCrouch;
+				if (player.CanClimb())
+					fl |= FlagCanClimb;
+				if (player.airborne)
+					fl |= FlagAirborne;
+				if (player.wade)
+					fl |= FlagWade;
+				if (isOnGround)
+					fl |= FlagWasOnGround;
+				flags.push_back(fl);
+			}
+
+			fallVelocity.resize(players.size());
+		}
+
+		void PlayerPhysicsBatch::Integrate(float dt) {
+			// Multiplying by +1/-1 is exact, so this matches the branchy
+			// version in `Player::MovePlayer` bit by bit.
+			const std::size_t count = players.size();
+			const float airFriction = dt + 1.0F;
+
+			float* vx = velX.data();
+			float* vy = velY.data();
+			float* vz = velZ.data();
+			float* fall = fallVelocity.data();
+			const float* fx = frontX.data();
+			const float* fy = frontY.data();
+			const float* rx = rightX.data();
+			const float* ry = rightY.data();
+			const float* fw = forward.data();
+			const float* st = strafe.data();
+			const float* ac = accel.data();
+			const float* fr = friction.data();
+
+			for (std::size_t i = 0; i < count; i++) {
+				float f = ac[i];
+				float x = vx[i] + fx[i] * f * fw[i];
+				float y = vy[i] + fy[i] * f * fw[i];
+				x += rx[i] * f * st[i];
+				y += ry[i] * f * st[i];
+
+				float z = vz[i] + dt;
+				z /= airFriction;
+
+				vx[i] = x / fr[i];
+				vy[i] = y / fr[i];
+				vz[i] = z;
+				fall[i] = z;
+			}
+		}
+
+		void PlayerPhysicsBatch::Clip(const GameMap& map, float dt) {
+			const std::size_t count = players.size();
+			for (std::size_t i = 0; i < count; i++) {
+				uint8_t fl = flags[i];
+				Vector3 pos = MakeVector3(posX[i], posY[i], posZ[i]);
+				Vector3 vel = MakeVector3(velX[i], velY[i], velZ[i]);
+				bool airborne = (fl & FlagAirborne) != 0;
+				bool wade = (fl & FlagWade) != 0;
+
+				bool climbed = PlayerBoxClipMove(map, dt, (fl & FlagCrouch) != 0,
+				                                 (fl & FlagCanClimb) != 0, pos, vel, airborne,
+				                                 wade);
+
+				fl &= ~(FlagAirborne | FlagWade | FlagClimbed);
+				if (airborne)
+					fl |= FlagAirborne;
+				if (wade)
+					fl |= FlagWade;
+				if (climbed)
+					fl |= FlagClimbed;
+				flags[i] = fl;
+
+				posX[i] = pos.x;
+				posY[i] = pos.y;
+				posZ[i] = pos.z;
+				velX[i] = vel.x;
+				velY[i] = vel.y;
+				velZ[i] = vel.z;
+			}
+		}
+
+		void PlayerPhysicsBatch::Apply(Player& player, float dt) {
+			if (nextPlayer >= players.size() || players[nextPlayer] != &player) {
+				player.MovePlayer(dt);
+				return;
+			}
+
+			const std::size_t i = nextPlayer++;
+			uint8_t fl = flags[i];
+			bool wasOnGround = (fl & FlagWasOnGround) != 0;
+			player.HandleJumpInput(wasOnGround);
+
+			player.velocity = MakeVector3(velX[i], velY[i], velZ[i]);
+			player.airborne = (fl & FlagAirborne) != 0;
+			player.wade = (fl & FlagWade) != 0;
+			if (fl & FlagClimbed)
+				player.lastClimbTime = player.world.GetTime();
+			player.RepositionPlayer(MakeVector3(posX[i], posY[i], posZ[i]));
+
+			player.PlayerMoved(dt, fallVelocity[i], wasOnGround);
+		}
+	} // namespace client
+} // namespace spades
@@ -0,0 +1,98 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Core/Math.h>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+		class Player;
+		class World;
+
+		/**
+		 * Moves a player's bounding box through the map, sliding along walls
+		 * and climbing single blocks. This is the body of `Player::BoxClipMove`
+		 * and is shared by `PlayerPhysicsBatch` so both paths stay identical.
+		 * @return true if the player climbed up a block.
+		 */
+		bool PlayerBoxClipMove(const GameMap&, float fsynctics, bool crouch, bool canClimb,
+		                       Vector3& position, Vector3& velocity, bool& airborne,
+		                       bool& wade);
+
+		/**
+		 * Runs the movement part of `Player::Update` for all players of a world
+		 * at once. Player states are gathered into structure-of-arrays buffers,
+		 * the velocity integration runs as a single branch-free loop and the
+		 * map clipping as a second loop.
+		 *
+		 * `Compute` doesn't modify the players. The results are applied one
+		 * player at a time by `Apply`, so the caller can interleave them with
+		 * the tool updates like `Player::Update` does. The results are
+		 * bit-identical to calling `Player::MovePlayer` on each player.
+		 */
+		class PlayerPhysicsBatch {
+			enum Flags : uint8_t {
+				FlagCrouch = 1 << 0,
+				FlagCanClimb = 1 << 1,
+				FlagAirborne = 1 << 2,
+				FlagWade = 1 << 3,
+				FlagWasOnGround = 1 << 4,
+				FlagClimbed = 1 << 5
+			};
+
+			std::vector<Player*> players;
+			std::size_t nextPlayer = 0;
+
+			std::vector<float> posX, posY, posZ;
+			std::vector<float> velX, velY, velZ;
+			std::vector<float> frontX, frontY;
+			std::vector<float> rightX, rightY;
+			std::vector<float> forward, strafe;
+			std::vector<float> accel, friction;
+			std::vector<float> fallVelocity;
+			std::vector<uint8_t> flags;
+
+			void Gather(World&, float dt);
+			void Integrate(float dt);
+			void Clip(const GameMap&, float dt);
+
+		public:
+			/** Computes the movement of every living non-spectator player of
+			 * the world over `dt`. */
+			void Compute(World&, float dt);
+
+			/**
+			 * Moves a player by the result of the last `Compute`. Must be called
+			 * for every non-spectator player in the world's player order. Players
+			 * that weren't part of it (corpses) are moved by `Player::MovePlayer`.
+			 */
+			void Apply(Player&, float dt);
+
+			/** @return the number of living players moved by the last `Compute`. */
+			std::size_t GetNumPlayers() const { return players.size(); }
+		};
+	} // namespace client
+} // namespace spades
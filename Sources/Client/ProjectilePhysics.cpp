@@ -0,0 +1,220 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cmath>
+
+#include "GameConstants.h"
+#include "GameMap.h"
+#include "ProjectilePhysics.h"
+#include <Core/Debug.h>
+
+namespace spades {
+	namespace client {
+
+		namespace {
+			uint8_t CollideGrenade(ClipWorldCache& clip, const Vector3& oldPos,
+			                       Vector3& position, Vector3& velocity) {
+				IntVector3 lp = position.Floor();
+				IntVector3 lp2 = oldPos.Floor();
+
+				uint8_t ret = 0;
+				if (lp.z >= 63 && lp2.z < 63)
+					ret |= ProjectileEnteredWater;
+
+				if (clip(lp.x, lp.y, lp.z)) {
+					ret |= ProjectileHitWall | ProjectileBounced;
+					if (fabsf(velocity.x) > BOUNCE_SOUND_THRESHOLD ||
+						fabsf(velocity.y) > BOUNCE_SOUND_THRESHOLD ||
+						fabsf(velocity.z) > BOUNCE_SOUND_THRESHOLD)
+						ret |= ProjectileHitLoud;
+
+					if (lp.z != lp2.z && ((lp.x == lp2.x && lp.y == lp2.y)
+						|| !clip(lp.x, lp.y, lp2.z)))
+						velocity.z = -velocity.z;
+					else if (lp.x != lp2.x && ((lp.y == lp2.y && lp.z == lp2.z)
+						|| !clip(lp2.x, lp.y, lp.z)))
+						velocity.x = -velocity.x;
+					else if (lp.y != lp2.y && ((lp.x == lp2.x && lp.z == lp2.z)
+						|| !clip(lp.x, lp2.y, lp.z)))
+						velocity.y = -velocity.y;
+
+					position = oldPos; // set back to old position
+					velocity *= 0.36F; // lose some velocity due to friction
+				}
+
+				return ret;
+			}
+
+			uint8_t CollideFallingBlock(ClipWorldCache& clip, const Vector3& oldPos,
+			                            const Vector3& position, Vector3& velocity) {
+				IntVector3 lp = position.Floor();
+				if (!clip(lp.x, lp.y, lp.z))
+					return 0;
+
+				uint8_t ret = ProjectileHitWall;
+				if (fabsf(velocity.z) > BOUNCE_SOUND_THRESHOLD)
+					ret |= ProjectileHitLoud;
+
+				IntVector3 lp2 = oldPos.Floor();
+				if (lp.z != lp2.z &&
+				    ((lp.x == lp2.x && lp.y == lp2.y) || !clip(lp.x, lp.y, lp2.z))) {
+					velocity.z = -velocity.z;
+					velocity *= 0.46F; // lose some velocity due to friction
+					ret |= ProjectileBounced;
+				}
+
+				return ret;
+			}
+		} // namespace
+
+		bool ClipWorldCache::operator()(int x, int y, int z) {
+			if (x < 0 || x >= GameMap::DefaultWidth || y < 0 || y >= GameMap::DefaultHeight ||
+			    z < 0)
+				return false;
+			if (z == GameMap::DefaultDepth - 1)
+				z = GameMap::DefaultDepth - 2;
+			else if (z >= GameMap::DefaultDepth - 1)
+				return true;
+
+			if (x != columnX || y != columnY) {
+				column = map.GetSolidMap(x, y);
+				columnX = x;
+				columnY = y;
+			}
+			return ((column >> (uint64_t)z) & 1ULL) != 0;
+		}
+
+		uint8_t CollideGrenade(const GameMap& map, const Vector3& oldPosition,
+		                       Vector3& position, Vector3& velocity) {
+			ClipWorldCache clip{map};
+			return CollideGrenade(clip, oldPosition, position, velocity);
+		}
+
+		uint8_t CollideFallingBlock(const GameMap& map, const Vector3& oldPosition,
+		                            const Vector3& position, Vector3& velocity) {
+			ClipWorldCache clip{map};
+			return CollideFallingBlock(clip, oldPosition, position, velocity);
+		}
+
+		void ProjectileBatch::Clear() {
+			posX.clear();
+			posY.clear();
+			posZ.clear();
+			velX.clear();
+			velY.clear();
+			velZ.clear();
+			oldX.clear();
+			oldY.clear();
+			oldZ.clear();
+			hits.clear();
+		}
+
+		void ProjectileBatch::Reserve(std::size_t count) {
+			posX.reserve(count);
+			posY.reserve(count);
+			posZ.reserve(count);
+			velX.reserve(count);
+			velY.reserve(count);
+			velZ.reserve(count);
+			oldX.reserve(count);
+			oldY.reserve(count);
+			oldZ.reserve(count);
+			hits.reserve(count);
+		}
+
+		std::size_t ProjectileBatch::Add(const Vector3& position, const Vector3& velocity) {
+			return Add(position, position, velocity);
+		}
+
+		std::size_t ProjectileBatch::Add(const Vector3& oldPosition, const Vector3& position,
+		                                 const Vector3& velocity) {
+			posX.push_back(position.x);
+			posY.push_back(position.y);
+			posZ.push_back(position.z);
+			velX.push_back(velocity.x);
+			velY.push_back(velocity.y);
+			velZ.push_back(velocity.z);
+			oldX.push_back(oldPosition.x);
+			oldY.push_back(oldPosition.y);
+			oldZ.push_back(oldPosition.z);
+			hits.push_back(0);
+			return posX.size() - 1;
+		}
+
+		void ProjectileBatch::MoveGrenades(const GameMap& map, float fsynctics) {
+			SPADES_MARK_FUNCTION();
+
+			const std::size_t count = GetCount();
+			const float f = fsynctics * 32.0F;
+
+			// integration (vectorizable)
+			for (std::size_t i = 0; i < count; i++) {
+				oldX[i] = posX[i];
+				oldY[i] = posY[i];
+				oldZ[i] = posZ[i];
+				velZ[i] += fsynctics;
+				posX[i] += velX[i] * f;
+				posY[i] += velY[i] * f;
+				posZ[i] += velZ[i] * f;
+			}
+
+			ClipWorldCache clip{map};
+			for (std::size_t i = 0; i < count; i++) {
+				Vector3 oldPos = MakeVector3(oldX[i], oldY[i], oldZ[i]);
+				Vector3 pos = GetPosition(i);
+				Vector3 vel = GetVelocity(i);
+
+				hits[i] = CollideGrenade(clip, oldPos, pos, vel);
+				if (hits[i] & ProjectileHitWall) {
+					posX[i] = pos.x;
+					posY[i] = pos.y;
+					posZ[i] = pos.z;
+					velX[i] = vel.x;
+					velY[i] = vel.y;
+					velZ[i] = vel.z;
+				}
+			}
+		}
+
+		void ProjectileBatch::CollideFallingBlocks(const GameMap& map) {
+			SPADES_MARK_FUNCTION();
+
+			const std::size_t count = GetCount();
+
+			ClipWorldCache clip{map};
+			for (std::size_t i = 0; i < count; i++) {
+				Vector3 oldPos = MakeVector3(oldX[i], oldY[i], oldZ[i]);
+				Vector3 vel = GetVelocity(i);
+
+				hits[i] = CollideFallingBlock(clip, oldPos, GetPosition(i), vel);
+				if (hits[i] & ProjectileBounced) {
+					// a bounce moves the block back to where it was
+					posX[i] = oldX[i];
+					posY[i] = oldY[i];
+					posZ[i] = oldZ[i];
+					velX[i] = vel.x;
+					velY[i] = vel.y;
+					velZ[i] = vel.z;
+				}
+			}
+		}
+	} // namespace client
+} // namespace spades
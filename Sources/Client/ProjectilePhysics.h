@@ -0,0 +1,117 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Core/Math.h>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+
+		/** Collision outcome flags returned by the projectile collision functions. */
+		enum ProjectileHitFlags : uint8_t {
+			/** The body moved into a solid voxel. */
+			ProjectileHitWall = 1 << 0,
+			/** The impact was fast enough to make a sound. */
+			ProjectileHitLoud = 1 << 1,
+			/** The body bounced off the voxel (otherwise it got stuck). */
+			ProjectileBounced = 1 << 2,
+			/** The body dropped below the water surface. */
+			ProjectileEnteredWater = 1 << 3
+		};
+
+		/**
+		 * `GameMap::ClipWorld` that remembers the last solid-map column. Bodies
+		 * moving through the map mostly probe the same column several times in
+		 * a row, so this saves most of the map lookups of a collision pass.
+		 */
+		class ClipWorldCache {
+			const GameMap& map;
+			int columnX = -1, columnY = -1;
+			uint64_t column = 0;
+
+		public:
+			ClipWorldCache(const GameMap& map) : map(map) {}
+
+			bool operator()(int x, int y, int z);
+		};
+
+		/**
+		 * Resolves a grenade's collision after it moved from `oldPosition` to
+		 * `position`, using the rules of `Grenade::MoveGrenade`.
+		 * @return a combination of `ProjectileHitFlags`.
+		 */
+		uint8_t CollideGrenade(const GameMap&, const Vector3& oldPosition, Vector3& position,
+		                       Vector3& velocity);
+
+		/**
+		 * Resolves a falling block's collision after its center moved from
+		 * `oldPosition` to `position`. Only vertical bounces are allowed; a block
+		 * hitting a wall sideways gets stuck.
+		 * @return a combination of `ProjectileHitFlags`.
+		 */
+		uint8_t CollideFallingBlock(const GameMap&, const Vector3& oldPosition,
+		                            const Vector3& position, Vector3& velocity);
+
+		/**
+		 * Contiguous structure-of-arrays storage for projectile-like bodies
+		 * (grenades, falling blocks) so they can be integrated and collided in
+		 * one pass. Collision probes are served from a cached solid-map column
+		 * since consecutive probes of a body mostly hit the same column.
+		 */
+		class ProjectileBatch {
+			std::vector<float> posX, posY, posZ;
+			std::vector<float> velX, velY, velZ;
+			std::vector<float> oldX, oldY, oldZ;
+			std::vector<uint8_t> hits;
+
+		public:
+			void Clear();
+			void Reserve(std::size_t);
+
+			/** @return the index of the added body. */
+			std::size_t Add(const Vector3& position, const Vector3& velocity);
+			/** Adds a body whose movement was already integrated by the caller. */
+			std::size_t Add(const Vector3& oldPosition, const Vector3& position,
+			                const Vector3& velocity);
+
+			std::size_t GetCount() const { return posX.size(); }
+			Vector3 GetPosition(std::size_t i) const {
+				return MakeVector3(posX[i], posY[i], posZ[i]);
+			}
+			Vector3 GetVelocity(std::size_t i) const {
+				return MakeVector3(velX[i], velY[i], velZ[i]);
+			}
+			uint8_t GetHitFlags(std::size_t i) const { return hits[i]; }
+
+			/** Integrates and collides all bodies like `Grenade::MoveGrenade`. */
+			void MoveGrenades(const GameMap&, float fsynctics);
+
+			/** Collides all bodies like falling blocks. The movement must have
+			 * been integrated already. */
+			void CollideFallingBlocks(const GameMap&);
+		};
+	} // namespace client
+} // namespace spades
@@ -19,6 +19,7 @@
 
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <deque>
@@ -31,14 +32,20 @@
 #include "IGameMode.h"
 #include "IWorldListener.h"
 #include "Player.h"
+#include "PlayerPhysics.h"
+#include "ProjectilePhysics.h"
 #include "Weapon.h"
 #include "World.h"
 #include <Core/Debug.h>
 #include <Core/FileManager.h>
 #include <Core/IStream.h>
 #include <Core/Settings.h>
+#include <Core/Stopwatch.h>
 
 DEFINE_SPADES_SETTING(cg_debugHitTest, "0");
+DEFINE_SPADES_SETTING(cg_batchPlayerPhysics, "1");
+DEFINE_SPADES_SETTING(cg_physicsStatistics, "0");
+DEFINE_SPADES_SETTING(cg_interpolateWorld, "1");
 
 SPADES_SETTING(cg_orientationSmoothing);
 
@@ -46,7 +53,9 @@ namespace spades {
 	namespace client {
 
 		World::World(const std::shared_ptr<GameProperties>& gameProperties)
-			: gameProperties{gameProperties} {
+			: gameProperties{gameProperties},
+			  playerPhysics{stmp::make_unique<PlayerPhysicsBatch>()},
+			  grenadeBatch{stmp::make_unique<ProjectileBatch>()} {
 			SPADES_MARK_FUNCTION();
 		}
 		World::~World() { SPADES_MARK_FUNCTION(); }
@@ -61,14 +70,48 @@ namespace spades {
 		}
 
 		void World::UpdatePlayer(float dt, bool locked) {
-			for (const auto& p : players) {
-				if (p && !p->IsSpectator()) {
-					if (locked) {
-						p->Update(dt);
-					} else {
+			if (!locked) {
+				for (const auto& p : players) {
+					if (p && !p->IsSpectator())
 						p->UpdateSmooth(dt);
+				}
+				return;
+			}
+
+			Stopwatch stopwatch;
+			bool batched = map && cg_batchPlayerPhysics;
+
+			if (batched) {
+				// Compute everyone's movement in one batch, but apply it player
+				// by player right before their tool update. Movement only depends
+				// on the player itself and the map (block edits are deferred to
+				// `ApplyBlockActions`), so each tool sees the other players at
+				// the same positions as in the per-player order.
+				playerPhysics->Compute(*this, dt);
+				for (const auto& p : players) {
+					if (p && !p->IsSpectator()) {
+						playerPhysics->Apply(*p, dt);
+						p->UpdateTool(dt);
 					}
 				}
+			} else {
+				for (const auto& p : players) {
+					if (p && !p->IsSpectator())
+						p->Update(dt);
+				}
+			}
+
+			if (cg_physicsStatistics) {
+				physicsStatTime += stopwatch.GetTime();
+				if (++physicsStatTicks >= 60) {
+					SPLog("==== Player Physics Statistics ====");
+					SPLog("Mode: %s, Players: %d", batched ? "batched" : "per-player",
+					      (int)GetNumPlayers());
+					SPLog("Average Time per Tick: %.3fus",
+					      physicsStatTime / physicsStatTicks * 1000000.0);
+					physicsStatTime = 0.0;
+					physicsStatTicks = 0;
+				}
 			}
 		}
 
@@ -77,6 +120,13 @@ namespace spades {
 
 			ApplyBlockActions();
 
+			for (const auto& p : players) {
+				if (p)
+					p->SaveInterpolationState();
+			}
+			for (const auto& g : grenades)
+				g->SaveInterpolationState();
+
 			UpdatePlayer(dt, true);
 
 			while (!damagedBlocksQueue.empty()) {
@@ -95,18 +145,120 @@ namespace spades {
 				damagedBlocksQueue.erase(it);
 			}
 
-			std::vector<decltype(grenades.begin())> removedGrenades;
-			for (auto it = grenades.begin(); it != grenades.end(); it++) {
-				Grenade& g = **it;
-				if (g.Update(dt))
-					removedGrenades.push_back(it);
+			if (!grenades.empty()) {
+				SPAssert(map);
+
+				// Burn the fuses first, then move the remaining grenades in one
+				// batch. The explosions and the bounces are reported afterwards,
+				// in the order of the grenades, as `Grenade::Update` would.
+				grenadeExploded.assign(grenades.size(), false);
+				grenadeBatch->Clear();
+				for (std::size_t i = 0; i < grenades.size(); i++) {
+					Grenade& g = *grenades[i];
+					if (g.UpdateFuse(dt))
+						grenadeExploded[i] = true;
+					else
+						grenadeBatch->Add(g.GetPosition(), g.GetVelocity());
+				}
+
+				grenadeBatch->MoveGrenades(*map, dt);
+
+				std::size_t index = 0;
+				for (std::size_t i = 0; i < grenades.size(); i++) {
+					Grenade& g = *grenades[i];
+					if (grenadeExploded[i]) {
+						g.Explode();
+						continue;
+					}
+
+					int ret = g.SetMoveResult(grenadeBatch->GetPosition(index),
+					                          grenadeBatch->GetVelocity(index),
+					                          grenadeBatch->GetHitFlags(index));
+					g.UpdateMoved(dt, ret);
+					index++;
+				}
+
+				std::size_t numRemaining = 0;
+				for (std::size_t i = 0; i < grenades.size(); i++) {
+					if (!grenadeExploded[i])
+						grenades[numRemaining++] = std::move(grenades[i]);
+				}
+				grenades.resize(numRemaining);
 			}
-			for (auto it : removedGrenades)
-				grenades.erase(it);
 
 			time += dt;
 		}
 
+		int World::AdvanceFixed(float dt) {
+			SPADES_MARK_FUNCTION();
+
+			int numSteps = 0;
+			timeAccumulator += dt;
+			while (timeAccumulator >= WorldTimeStep) {
+				Advance(WorldTimeStep);
+				timeAccumulator -= WorldTimeStep;
+				numSteps++;
+			}
+			return numSteps;
+		}
+
+		float World::GetInterpolationFactor() {
+			if (!cg_interpolateWorld)
+				return 1.0F;
+			return std::min(timeAccumulator / WorldTimeStep, 1.0F);
+		}
+
+		uint64_t World::GetStateHash() {
+			SPADES_MARK_FUNCTION();
+
+			// FNV-1a
+			uint64_t hash = 14695981039346656037ULL;
+			auto feed = [&](const void* data, std::size_t size) {
+				const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+				for (std::size_t i = 0; i < size; i++) {
+					hash ^= bytes[i];
+					hash *= 1099511628211ULL;
+				}
+			};
+			auto feedVector = [&](const Vector3& v) {
+				feed(&v.x, sizeof(float));
+				feed(&v.y, sizeof(float));
+				feed(&v.z, sizeof(float));
+			};
+
+			feed(&time, sizeof(time));
+
+			for (std::size_t i = 0; i < players.size(); i++) {
+				const auto& p = players[i];
+				if (!p)
+					continue;
+
+				uint32_t id = static_cast<uint32_t>(i);
+				uint8_t alive = p->IsAlive() ? 1 : 0;
+				feed(&id, sizeof(id));
+				feed(&alive, sizeof(alive));
+				feedVector(p->GetPosition());
+				feedVector(p->GetVelocity());
+				feedVector(p->GetFront());
+			}
+
+			for (const auto& g : grenades) {
+				feedVector(g->GetPosition());
+				feedVector(g->GetVelocity());
+			}
+
+			// Colors are excluded because new blocks get a random jitter
+			if (map) {
+				for (int x = 0; x < map->Width(); x++)
+					for (int y = 0; y < map->Height(); y++) {
+						uint64_t column = map->GetSolidMap(x, y);
+						feed(&column, sizeof(column));
+					}
+			}
+
+			return hash;
+		}
+
 		void World::SetMap(Handle<GameMap> newMap) {
 			if (map == newMap)
 				return;
@@ -45,10 +45,15 @@ namespace spades {
 		class Grenade;
 		class IGameMode;
 		class HitTestDebugger;
+		class PlayerPhysicsBatch;
+		class ProjectileBatch;
 		struct GameProperties;
 
 		constexpr std::size_t NumPlayerSlots = 256;
 
+		/** The fixed time step of the world simulation (matches the server). */
+		constexpr float WorldTimeStep = 1.0F / 60.0F;
+
 		class World {
 		public:
 			struct Team {
@@ -69,6 +74,7 @@ namespace spades {
 			Handle<GameMap> map;
 			std::unique_ptr<GameMapWrapper> mapWrapper;
 			float time = 0.0F;
+			float timeAccumulator = 0.0F;
 			IntVector3 fogColor;
 			Team teams[3];
 
@@ -77,8 +83,13 @@ namespace spades {
 			std::array<std::unique_ptr<Player>, NumPlayerSlots> players;
 			std::array<PlayerPersistent, NumPlayerSlots> playerPersistents;
 			stmp::optional<int> localPlayerIndex;
+			std::unique_ptr<PlayerPhysicsBatch> playerPhysics;
+			double physicsStatTime = 0.0;
+			int physicsStatTicks = 0;
 
-			std::list<std::unique_ptr<Grenade>> grenades;
+			std::vector<std::unique_ptr<Grenade>> grenades;
+			std::unique_ptr<ProjectileBatch> grenadeBatch;
+			std::vector<bool> grenadeExploded;
 			std::unique_ptr<HitTestDebugger> hitTestDebugger;
 
 			std::unordered_map<CellPos, spades::IntVector3, CellPosHash> createdBlocks;
@@ -109,8 +120,25 @@ namespace spades {
 			void UpdatePlayer(float dt, bool locked);
 			void Advance(float dt);
 
+			/**
+			 * Accumulates `dt` and runs as many `WorldTimeStep` steps of `Advance`
+			 * as fit in it, so the simulation doesn't depend on the frame rate.
+			 * @return the number of steps run.
+			 */
+			int AdvanceFixed(float dt);
+
+			/**
+			 * Returns how far the accumulated time is into the next step, in
+			 * `[0, 1]`. Renderers use it to interpolate between the states
+			 * before and after the last step.
+			 */
+			float GetInterpolationFactor();
+
+			/** Computes a hash of the simulation state, for determinism checks. */
+			uint64_t GetStateHash();
+
 			void AddGrenade(std::unique_ptr<Grenade>);
-			const std::list<std::unique_ptr<Grenade>>& GetAllGrenades() { return grenades; }
+			const std::vector<std::unique_ptr<Grenade>>& GetAllGrenades() { return grenades; }
 
 			void MarkBlockForRegeneration(const IntVector3& blockLocation);
 			void UnmarkBlockForRegeneration(const IntVector3& blockLocation);
@@ -0,0 +1,53 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace spades {
+	/** @return the index of the lowest set bit. `v` must not be zero. */
+	inline int FindFirstSet(uint64_t v) {
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward64(&idx, v);
+		return static_cast<int>(idx);
+#else
+		return __builtin_ctzll(v);
+#endif
+	}
+
+	/** @return the index of the highest set bit. `v` must not be zero. */
+	inline int FindLastSet(uint64_t v) {
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanReverse64(&idx, v);
+		return static_cast<int>(idx);
+#else
+		return 63 - __builtin_clzll(v);
+#endif
+	}
+} // namespace spades
@@ -19,44 +19,229 @@
 
  */
 
+#include <algorithm>
+
+#include "BitOps.h"
 #include "MiniHeap.h"
 
 namespace spades {
+	MiniHeap::MiniHeap(size_t initialSize) : firstLevelBitmap(0), freeBytes(0) {
+		freeLists.fill(NoFreeRegion);
+		secondLevelBitmaps.fill(0);
+
+		buffer.resize(std::max<size_t>(initialSize, 1));
+		InsertFreeRegion(0, buffer.size());
+		SPAssert(Validate());
+	}
+
+	size_t MiniHeap::SizeClassOf(size_t bytes) {
+		SPAssert(bytes > 0);
+		int msb = FindLastSet(bytes);
+		if (msb < NumSecondLevelBits)
+			return bytes; // first level 0 is linear
+		size_t fl = msb - NumSecondLevelBits + 1;
+		size_t sl = (bytes >> (msb - NumSecondLevelBits)) & (NumSecondLevels - 1);
+		return fl * NumSecondLevels + sl;
+	}
+
+	size_t MiniHeap::RoundUpToSizeClass(size_t bytes) {
+		int msb = FindLastSet(bytes);
+		if (msb >= NumSecondLevelBits)
+			bytes += (size_t(1) << (msb - NumSecondLevelBits)) - 1;
+		return bytes;
+	}
+
+	void MiniHeap::InsertFreeRegion(Ref start, Ref len) {
+		size_t index;
+		if (regionPool.empty()) {
+			index = regions.size();
+			regions.emplace_back();
+		} else {
+			index = regionPool.back();
+			regionPool.pop_back();
+		}
+
+		size_t sizeClass = SizeClassOf(len);
+		FreeRegion& r = regions[index];
+		r.start = start;
+		r.len = len;
+		r.prev = NoFreeRegion;
+		r.next = freeLists[sizeClass];
+		if (r.next != NoFreeRegion)
+			regions[r.next].prev = index;
+		freeLists[sizeClass] = index;
+
+		firstLevelBitmap |= 1ULL << (sizeClass / NumSecondLevels);
+		secondLevelBitmaps[sizeClass / NumSecondLevels] |= 1U << (sizeClass % NumSecondLevels);
+
+		regionByStart[start] = index;
+		regionByEnd[start + len] = index;
+		freeBytes += len;
+	}
+
+	void MiniHeap::RemoveFreeRegion(size_t index) {
+		FreeRegion& r = regions[index];
+		size_t sizeClass = SizeClassOf(r.len);
+
+		if (r.prev != NoFreeRegion)
+			regions[r.prev].next = r.next;
+		else
+			freeLists[sizeClass] = r.next;
+		if (r.next != NoFreeRegion)
+			regions[r.next].prev = r.prev;
+
+		if (freeLists[sizeClass] == NoFreeRegion) {
+			uint32_t& sl = secondLevelBitmaps[sizeClass / NumSecondLevels];
+			sl &= ~(1U << (sizeClass % NumSecondLevels));
+			if (sl == 0)
+				firstLevelBitmap &= ~(1ULL << (sizeClass / NumSecondLevels));
+		}
+
+		regionByStart.erase(r.start);
+		regionByEnd.erase(r.GetEnd());
+		freeBytes -= r.len;
+		regionPool.push_back(index);
+	}
+
+	void MiniHeap::AddFreeRegion(Ref start, Ref len) {
+		auto it = regionByEnd.find(start);
+		if (it != regionByEnd.end()) {
+			size_t prev = it->second;
+			start = regions[prev].start;
+			len += regions[prev].len;
+			RemoveFreeRegion(prev);
+		}
+
+		it = regionByStart.find(start + len);
+		if (it != regionByStart.end()) {
+			size_t next = it->second;
+			len += regions[next].len;
+			RemoveFreeRegion(next);
+		}
+
+		InsertFreeRegion(start, len);
+	}
+
+	size_t MiniHeap::FindFreeRegion(size_t bytes) {
+		// round up to the next size class so that any region of the found
+		// class is large enough
+		size_t sizeClass = SizeClassOf(RoundUpToSizeClass(bytes));
+		size_t fl = sizeClass / NumSecondLevels;
+		size_t sl = sizeClass % NumSecondLevels;
+		if (fl >= NumFirstLevels)
+			return NoFreeRegion;
+
+		uint32_t slMap = secondLevelBitmaps[fl] & (~0U << sl);
+		if (slMap == 0) {
+			uint64_t flMap = fl + 1 < NumFirstLevels ? firstLevelBitmap & (~0ULL << (fl + 1)) : 0;
+			if (flMap == 0)
+				return NoFreeRegion;
+			fl = FindFirstSet(flMap);
+			slMap = secondLevelBitmaps[fl];
+		}
+		sl = FindFirstSet(slMap);
+
+		return freeLists[fl * NumSecondLevels + sl];
+	}
+
+	void MiniHeap::Reserve(size_t bytes) {
+		size_t newSize = buffer.size();
+		while (newSize < bytes)
+			newSize <<= 1;
+		if (newSize == buffer.size())
+			return;
+		size_t oldSize = buffer.size();
+		buffer.resize(newSize);
+
+		AddFreeRegion(oldSize, newSize - oldSize);
+		SPAssert(Validate());
+	}
+
+	MiniHeap::Ref MiniHeap::Alloc(size_t bytes) {
+		SPAssert(bytes > 0);
+
+		size_t index = FindFreeRegion(bytes);
+		if (index == NoFreeRegion) {
+			// `FindFreeRegion` only accepts regions of the rounded-up size, so
+			// the free region at the end must be grown to that size
+			Reserve(buffer.size() + RoundUpToSizeClass(bytes));
+			index = FindFreeRegion(bytes);
+			if (index == NoFreeRegion)
+				SPRaise("Failed to allocate %llu bytes", static_cast<unsigned long long>(bytes));
+		}
+
+		Ref pos = regions[index].start;
+		Ref len = regions[index].len;
+		SPAssert(len >= bytes);
+		RemoveFreeRegion(index);
+
+		// the rest can't be adjacent to another free region
+		if (len > bytes)
+			InsertFreeRegion(pos + bytes, len - bytes);
+
+		SPAssert(pos + bytes <= buffer.size());
+		return pos;
+	}
+
+	void MiniHeap::Free(Ref offset, Ref len) {
+		SPAssert(len > 0);
+		if (offset + len > buffer.size())
+			SPRaise("Internal inconsistency detected: freeing out of bounds");
+		if (regionByStart.find(offset) != regionByStart.end() ||
+		    regionByEnd.find(offset + len) != regionByEnd.end())
+			SPRaise("Internal inconsistency detected: double free");
+
+		AddFreeRegion(offset, len);
+	}
+
+	size_t MiniHeap::GetLargestFreeRegion() const {
+		if (firstLevelBitmap == 0)
+			return 0;
+		size_t fl = FindLastSet(firstLevelBitmap);
+		size_t sl = FindLastSet(secondLevelBitmaps[fl]);
+		size_t largest = 0;
+		for (size_t r = freeLists[fl * NumSecondLevels + sl]; r != NoFreeRegion;
+		     r = regions[r].next)
+			largest = std::max(largest, regions[r].len);
+		return largest;
+	}
+
 	bool MiniHeap::Validate() {
-		Ref fl = firstFreeRegion;
-		Ref minPos = 0;
-		int count = 1000000;
-		Ref lst = NoFreeRegion;
-		while (fl != NoFreeRegion) {
-			if (fl > buffer.size())
-				SPRaise("Inconsistency detected: broken link");
-			if ((--count) < 1)
-				SPRaise("Inconsistency detected: looped linked list");
-			auto* f = Dereference<FreeRegion>(fl);
-			if (f->start < minPos) {
-				if (f->start == minPos - 1)
+		size_t count = 0, total = 0;
+		for (size_t sizeClass = 0; sizeClass < freeLists.size(); sizeClass++) {
+			bool listed = (secondLevelBitmaps[sizeClass / NumSecondLevels] >>
+			               (sizeClass % NumSecondLevels)) & 1;
+			if (listed != (freeLists[sizeClass] != NoFreeRegion))
+				SPRaise("Inconsistency detected: bitmap out of sync");
+
+			size_t prev = NoFreeRegion;
+			for (size_t r = freeLists[sizeClass]; r != NoFreeRegion; r = regions[r].next) {
+				const FreeRegion& f = regions[r];
+				if (++count > regions.size())
+					SPRaise("Inconsistency detected: looped linked list");
+				if (f.prev != prev)
+					SPRaise("Inconsistency detected: singly linked");
+				if (SizeClassOf(f.len) != sizeClass)
+					SPRaise("Inconsistency detected: wrong size class");
+				if (f.GetEnd() > buffer.size())
+					SPRaise("Inconsistency detected: overflow");
+				if (regionByEnd.find(f.start) != regionByEnd.end())
 					SPRaise("Inconsistency detected: uncombined");
-				SPRaise("Inconsistency detected: unsorted list");
+				auto it = regionByStart.find(f.start);
+				if (it == regionByStart.end() || it->second != r)
+					SPRaise("Inconsistency detected: not indexed");
+				total += f.len;
+				prev = r;
 			}
-			if (f->start == 0xDEADBEEF)
-				SPRaise("Inconsistency detected: not initialized (1)");
-			if (f->len == 0xDEADBEEF)
-				SPRaise("Inconsistency detected: not initialized (1)");
-			if (f->next == 0xDEADBEEF)
-				SPRaise("Inconsistency detected: not initialized (1)");
-			if (f->prev == 0xDEADBEEF)
-				SPRaise("Inconsistency detected: not initialized (1)");
-			if (f->GetEnd() > buffer.size())
-				SPRaise("Inconsistency detected: overflow");
-			minPos = f->GetEnd() + 1; // detect uncombineds
-
-			if (f->next == fl)
-				SPRaise("Inconsistency detected: self link");
-			if (f->prev != lst)
-				SPRaise("Inconsistency detected: singly linked");
-			lst = fl;
-			fl = f->next;
 		}
+		for (size_t fl = 0; fl < NumFirstLevels; fl++) {
+			if (((firstLevelBitmap >> fl) & 1) != (secondLevelBitmaps[fl] != 0))
+				SPRaise("Inconsistency detected: bitmap out of sync");
+		}
+		if (count != regionByStart.size() || count != regionByEnd.size())
+			SPRaise("Inconsistency detected: stale index");
+		if (total != freeBytes)
+			SPRaise("Inconsistency detected: wrong free byte count");
 		return true;
 	}
-} // namespace spades
\ No newline at end of file
+} // namespace spades
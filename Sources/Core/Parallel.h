@@ -0,0 +1,65 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentDispatch.h"
+
+namespace spades {
+	/** The number of threads `InvokeParallel` uses unless told otherwise. */
+	inline unsigned int GetNumHardwareThreads() {
+		return std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	/**
+	 * Calls `f(i)` for every `i` in `[0, numThreads)` and returns when all of
+	 * them have returned. `f(0)` runs on the calling thread, and the others
+	 * on the global dispatch queue.
+	 *
+	 * The calls run at the same time on different threads, so `f` must not
+	 * touch OpenGL, whose context belongs to the render thread. The CPU-side
+	 * helpers of the OpenGL renderer (`GLMapChunkMesher`,
+	 * `GLRadiosityEvaluator`, ...) never do, and are run through this.
+	 */
+	template <class F>
+	void InvokeParallel(F f, unsigned int numThreads = GetNumHardwareThreads()) {
+		std::vector<std::unique_ptr<ConcurrentDispatch>> disp;
+		for (auto i = 1U; i < numThreads; i++) {
+			auto ff = [i, &f]() { f(i); };
+			disp.emplace_back(new FunctionDispatch<decltype(ff)>(ff));
+			disp.back()->Start();
+		}
+		f(0);
+		for (auto& d : disp)
+			d->Join();
+	}
+
+	/** Same as `InvokeParallel`, but calls `f(i, numThreads)`. */
+	template <class F> void InvokeParallel2(F f, unsigned int numThreads) {
+		numThreads = std::max(numThreads, 1U);
+		InvokeParallel([&f, numThreads](unsigned int i) { f(i, numThreads); }, numThreads);
+	}
+} // namespace spades
@@ -64,6 +64,90 @@ namespace spades {
 		int count = width * height * depth;
 		for (int i = 0; i < count; ++i)
 			colors[i] = (colors[i] & 0xFFFFFF) | (static_cast<uint32_t>(newMaterialId) << 24);
+		DiscardLevels();
+	}
+
+	Handle<VoxelModel> VoxelModel::Downsample() const {
+		auto out = Handle<VoxelModel>::New((width + 1) / 2, (height + 1) / 2, (depth + 1) / 2);
+		out->SetOrigin(origin * 0.5F);
+
+		auto IsVisible = [&](int x, int y, int z) {
+			return !IsSolid(x - 1, y, z) || !IsSolid(x + 1, y, z) || !IsSolid(x, y - 1, z) ||
+			       !IsSolid(x, y + 1, z) || !IsSolid(x, y, z - 1) || !IsSolid(x, y, z + 1);
+		};
+
+		for (int x = 0; x < out->width; x++) {
+			for (int y = 0; y < out->height; y++) {
+				for (int z = 0; z < out->depth; z++) {
+					// Voxels hidden inside the model (e.g., the ones added by
+					// `HollowFill`) only count if none of them is visible
+					uint32_t r = 0, g = 0, b = 0;
+					int count = 0, numVisible = 0, numEmissive = 0;
+					for (int i = 0; i < 8; i++) {
+						int sx = x * 2 + (i & 1);
+						int sy = y * 2 + ((i >> 1) & 1);
+						int sz = z * 2 + (i >> 2);
+						if (!IsSolid(sx, sy, sz))
+							continue;
+
+						bool visible = IsVisible(sx, sy, sz);
+						if (visible && numVisible == 0) {
+							r = g = b = 0;
+							count = numEmissive = 0;
+						} else if (!visible && numVisible > 0) {
+							continue;
+						}
+						numVisible += visible ? 1 : 0;
+
+						uint32_t col = GetColorUnchecked(sx, sy, sz);
+						r += col & 0xFF;
+						g += (col >> 8) & 0xFF;
+						b += (col >> 16) & 0xFF;
+						if (static_cast<MaterialType>(col >> 24) == MaterialType::Emissive)
+							numEmissive++;
+						count++;
+					}
+					if (count == 0)
+						continue;
+
+					uint32_t col = (r / count) | ((g / count) << 8) | ((b / count) << 16);
+					if (numEmissive * 2 > count)
+						col |= static_cast<uint32_t>(MaterialType::Emissive) << 24;
+					out->SetSolid(x, y, z, col);
+				}
+			}
+		}
+		return out;
+	}
+
+	void VoxelModel::BuildLevels() {
+		SPADES_MARK_FUNCTION();
+
+		if (levelsValid)
+			return;
+
+		levels.clear();
+		const VoxelModel* last = this;
+		while (GetNumLevels() < MaxLevels &&
+		       std::max({last->width, last->height, last->depth}) > 1) {
+			levels.push_back(last->Downsample());
+			last = levels.back().GetPointerOrNull();
+		}
+		levelsValid = true;
+	}
+
+	const VoxelModel& VoxelModel::GetLevel(int i) const {
+		SPAssert(i >= 0 && i < GetNumLevels());
+		return i == 0 ? *this : *levels[i - 1];
+	}
+
+	int VoxelModel::GetLevelForVoxelSize(float voxelPixels) const {
+		int level = 0;
+		while (level + 1 < GetNumLevels() && voxelPixels * 2.0F <= 1.0F) {
+			voxelPixels *= 2.0F;
+			level++;
+		}
+		return level;
 	}
 
 	namespace {
@@ -22,6 +22,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "IStream.h"
 #include "Math.h"
@@ -65,6 +66,34 @@ namespace spades {
 		 */
 		void ForceMaterial(MaterialType newMaterialId);
 
+		/** Maximum number of levels of detail including the model itself. */
+		enum { MaxLevels = 4 };
+
+		/**
+		 * Build the downsampled levels of detail of the model (2x, 4x, 8x)
+		 * unless they are up to date. Each voxel of a level is solid if any of
+		 * the voxels it covers is solid, and has their average color.
+		 *
+		 * Modifying the model through `SetSolid`, `SetAir`, `ForceMaterial`
+		 * or `HollowFill` discards the levels.
+		 */
+		void BuildLevels();
+
+		/** Get the number of levels of detail. `1` unless `BuildLevels` was called. */
+		int GetNumLevels() const { return static_cast<int>(levels.size()) + 1; }
+
+		/**
+		 * Get a level of detail. Level `0` is the model itself, and each voxel
+		 * of level `i` covers `2^i` voxels of the model along each axis.
+		 */
+		const VoxelModel& GetLevel(int i) const;
+
+		/**
+		 * Choose the coarsest level of detail whose voxels still cover at most
+		 * one pixel when a voxel of the model covers `voxelPixels` pixels.
+		 */
+		int GetLevelForVoxelSize(float voxelPixels) const;
+
 		/** `GetSolidBits` without bounds checking. */
 		const uint64_t& GetSolidBitsAtUnchecked(int x, int y) const {
 			return solidBits[x + y * width];
@@ -141,6 +170,7 @@ namespace spades {
 
 			uint64_t mask = 1ULL << z;
 			GetSolidBitsAt(x, y) &= ~mask;
+			DiscardLevels();
 		}
 
 		/**
@@ -154,6 +184,7 @@ namespace spades {
 			// doesn't cause UB
 			uint64_t mask = 1ULL << z;
 			GetSolidBitsAtUnchecked(x, y) |= mask;
+			DiscardLevels();
 		}
 
 		/**
@@ -184,6 +215,19 @@ namespace spades {
 		std::unique_ptr<uint64_t[]> solidBits;
 		std::unique_ptr<uint32_t[]> colors;
 
+		/** Levels of detail `1` and later. */
+		std::vector<Handle<VoxelModel>> levels;
+		bool levelsValid = false;
+
+		Handle<VoxelModel> Downsample() const;
+
+		void DiscardLevels() {
+			if (levelsValid) {
+				levels.clear();
+				levelsValid = false;
+			}
+		}
+
 		void ValidateSpan(int x, int y) const {
 			if (static_cast<unsigned int>(x) >= static_cast<unsigned int>(width) ||
 			    static_cast<unsigned int>(y) >= static_cast<unsigned int>(height)) {
@@ -117,6 +117,8 @@ namespace spades {
 		if (meta.forceMaterial)
 			voxelModel->ForceMaterial(*meta.forceMaterial);
 
+		voxelModel->BuildLevels();
+
 		return voxelModel;
 	}
 } // namespace spades
\ No newline at end of file
@@ -0,0 +1,542 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "GLAmbientShadowEvaluator.h"
+#include <Client/GameMap.h>
+#include <Core/Debug.h>
+#include <Core/Parallel.h>
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	namespace draw {
+		/**
+		 * Solid map columns around a chunk, covering everything the rays and
+		 * the blur of the chunk can reach, and the occupancy mip of them.
+		 * Coordinates are global; Z outside the map follows
+		 * `GameMap::IsSolidWrapped`.
+		 */
+		class GLAmbientShadowEvaluator::ColumnCache {
+		public:
+			enum {
+				Margin = RayLength + 4,
+				Size = ChunkSize + Margin * 2,
+				BlockSizeBits = 2,
+				BlockSize = 1 << BlockSizeBits,
+				NumBlocks = Size / BlockSize
+			};
+			static_assert(Margin % BlockSize == 0, "blocks must be aligned to the chunk");
+
+		private:
+			int originX, originY;
+			uint64_t columns[Size][Size];
+			/** Union of the columns of each `BlockSize` x `BlockSize` block. */
+			uint64_t blocks[NumBlocks][NumBlocks];
+
+		public:
+			void Load(const client::GameMap& map, int cx, int cy) {
+				originX = cx * ChunkSize - Margin;
+				originY = cy * ChunkSize - Margin;
+
+				for (int y = 0; y < Size; y++)
+					for (int x = 0; x < Size; x++)
+						columns[y][x] = map.GetSolidMapWrapped(originX + x, originY + y);
+
+				for (int by = 0; by < NumBlocks; by++)
+					for (int bx = 0; bx < NumBlocks; bx++) {
+						uint64_t bits = 0;
+						for (int y = 0; y < BlockSize; y++)
+							for (int x = 0; x < BlockSize; x++)
+								bits |= columns[by * BlockSize + y][bx * BlockSize + x];
+						blocks[by][bx] = bits;
+					}
+			}
+
+			uint64_t GetColumn(int x, int y) const {
+				x -= originX;
+				y -= originY;
+				SPAssert(x >= 0 && x < Size);
+				SPAssert(y >= 0 && y < Size);
+				return columns[y][x];
+			}
+
+			bool IsSolid(int x, int y, int z) const {
+				if (z < 0)
+					return false;
+				if (z >= 64)
+					return true;
+				return ((GetColumn(x, y) >> z) & 1) != 0;
+			}
+
+			/** @return `false` if no voxel within the inclusive box is solid. */
+			bool MayHaveSolid(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) const {
+				if (maxZ >= 64)
+					return true;
+				if (maxZ < 0)
+					return false;
+				minZ = std::max(minZ, 0);
+				uint64_t zMask = (~0ULL >> (63 - maxZ)) & (~0ULL << minZ);
+
+				int bx1 = (minX - originX) >> BlockSizeBits;
+				int by1 = (minY - originY) >> BlockSizeBits;
+				int bx2 = (maxX - originX) >> BlockSizeBits;
+				int by2 = (maxY - originY) >> BlockSizeBits;
+				SPAssert(bx1 >= 0 && bx2 < NumBlocks);
+				SPAssert(by1 >= 0 && by2 < NumBlocks);
+
+				uint64_t bits = 0;
+				for (int by = by1; by <= by2; by++)
+					for (int bx = bx1; bx <= bx2; bx++)
+						bits |= blocks[by][bx];
+				return (bits & zMask) != 0;
+			}
+		};
+
+		namespace {
+			/**
+			 * `GameMap::CastRay` against a `ColumnCache`. The box the ray can
+			 * reach is tested against the occupancy mip before stepping.
+			 */
+			template <class Cache>
+			bool CastRay(const Cache& cache, Vector3 v0, Vector3 v1, float length,
+			             IntVector3& vOut) {
+				v1 = v0 + v1 * length;
+
+				Vector3 f, g;
+				IntVector3 a, c, d, p, i;
+				long cnt = 0;
+
+				a = v0.Floor();
+				c = v1.Floor();
+
+				if (c.x < a.x) {
+					d.x = -1;
+					f.x = v0.x - a.x;
+					g.x = (v0.x - v1.x) * 1024;
+					cnt += a.x - c.x;
+				} else if (c.x != a.x) {
+					d.x = 1;
+					f.x = a.x + 1 - v0.x;
+					g.x = (v1.x - v0.x) * 1024;
+					cnt += c.x - a.x;
+				} else {
+					d.x = 0;
+					f.x = g.x = 0.0F;
+				}
+				if (c.y < a.y) {
+					d.y = -1;
+					f.y = v0.y - a.y;
+					g.y = (v0.y - v1.y) * 1024;
+					cnt += a.y - c.y;
+				} else if (c.y != a.y) {
+					d.y = 1;
+					f.y = a.y + 1 - v0.y;
+					g.y = (v1.y - v0.y) * 1024;
+					cnt += c.y - a.y;
+				} else {
+					d.y = 0;
+					f.y = g.y = 0.0F;
+				}
+				if (c.z < a.z) {
+					d.z = -1;
+					f.z = v0.z - a.z;
+					g.z = (v0.z - v1.z) * 1024;
+					cnt += a.z - c.z;
+				} else if (c.z != a.z) {
+					d.z = 1;
+					f.z = a.z + 1 - v0.z;
+					g.z = (v1.z - v0.z) * 1024;
+					cnt += c.z - a.z;
+				} else {
+					d.z = 0;
+					f.z = g.z = 0.0F;
+				}
+
+				Vector3 pp =
+				  MakeVector3(f.x * g.z - f.z * g.x, f.y * g.z - f.z * g.y, f.y * g.x - f.x * g.y);
+				p = pp.Floor();
+				i = g.Floor();
+
+				if (cnt > (long)length)
+					cnt = (long)length;
+
+				// X and Z only step toward `c`; Y takes the remaining steps
+				int endY = a.y + d.y * static_cast<int>(cnt);
+				if (!cache.MayHaveSolid(std::min(a.x, c.x), std::min(a.y, endY),
+				                        std::min(a.z, c.z), std::max(a.x, c.x),
+				                        std::max(a.y, endY), std::max(a.z, c.z)))
+					return false;
+
+				while (cnt > 0) {
+					if (((p.x | p.y) >= 0) && (a.z != c.z)) {
+						a.z += d.z;
+						p.x -= i.x;
+						p.y -= i.y;
+					} else if ((p.z >= 0) && (a.x != c.x)) {
+						a.x += d.x;
+						p.x += i.z;
+						p.z -= i.y;
+					} else {
+						a.y += d.y;
+						p.y += i.z;
+						p.z += i.x;
+					}
+
+					if (cache.IsSolid(a.x, a.y, a.z)) {
+						vOut = a;
+						return true;
+					}
+					cnt--;
+				}
+
+				return false;
+			}
+
+			/** @return the solidity of `z - 1`, `z` and `z + 1` in bits 0-2. */
+			unsigned int GetSolidWindow(uint64_t column, int z) {
+				if (z >= 1 && z <= 62)
+					return static_cast<unsigned int>(column >> (z - 1)) & 7;
+
+				unsigned int bits = 0;
+				for (int k = 0; k < 3; k++) {
+					int zz = z - 1 + k;
+					bool solid = zz < 0 ? false : zz >= 64 ? true : ((column >> zz) & 1) != 0;
+					bits |= static_cast<unsigned int>(solid) << k;
+				}
+				return bits;
+			}
+		} // namespace
+
+		GLAmbientShadowEvaluator::GLAmbientShadowEvaluator(const client::GameMap& map,
+		                                                   const std::array<Vector3, NumRays>& rays)
+		    : map(map), rays(rays) {
+			SPAssert(map.Depth() == 64);
+		}
+
+		float GLAmbientShadowEvaluator::EvaluateReference(IntVector3 ipos) const {
+			SPADES_MARK_FUNCTION_DEBUG();
+
+			float sum = 0.0F;
+			Vector3 pos = MakeVector3(ipos) + 0.5F;
+
+			for (int i = 0; i < NumRays; i++) {
+				Vector3 dir = rays[i];
+
+				unsigned int bits = i & 7;
+				if (bits & 1)
+					dir.x = -dir.x;
+				if (bits & 2)
+					dir.y = -dir.y;
+				if (bits & 4)
+					dir.z = -dir.z;
+
+				IntVector3 hitBlock;
+				float brightness = 1.0F;
+				if (map.CastRay(pos, dir, (float)RayLength, hitBlock)) {
+					float dist = ((MakeVector3(hitBlock) + 0.5F) - pos).GetSquaredLength();
+					brightness = dist * (1.0F / float((RayLength - 1) * (RayLength - 1)));
+					if (brightness > 1.0F)
+						brightness = 1.0F;
+				}
+
+				sum += brightness;
+			}
+
+			sum = std::min(sum * (2.f / (float)NumRays), 1.0f);
+
+			return sum;
+		}
+
+		float GLAmbientShadowEvaluator::Evaluate(const ColumnCache& cache, IntVector3 ipos) const {
+			// nothing to hit within the reach of the rays
+			const int reach = RayLength + 1;
+			if (!cache.MayHaveSolid(ipos.x - reach, ipos.y - reach, ipos.z - reach,
+			                        ipos.x + reach, ipos.y + reach, ipos.z + reach))
+				return 1.0F;
+
+			float sum = 0.0F;
+			Vector3 pos = MakeVector3(ipos) + 0.5F;
+
+			for (int i = 0; i < NumRays; i++) {
+				Vector3 dir = rays[i];
+
+				unsigned int bits = i & 7;
+				if (bits & 1)
+					dir.x = -dir.x;
+				if (bits & 2)
+					dir.y = -dir.y;
+				if (bits & 4)
+					dir.z = -dir.z;
+
+				IntVector3 hitBlock;
+				float brightness = 1.0F;
+				if (CastRay(cache, pos, dir, (float)RayLength, hitBlock)) {
+					float dist = ((MakeVector3(hitBlock) + 0.5F) - pos).GetSquaredLength();
+					brightness = dist * (1.0F / float((RayLength - 1) * (RayLength - 1)));
+					if (brightness > 1.0F)
+						brightness = 1.0F;
+				}
+
+				sum += brightness;
+			}
+
+			sum = std::min(sum * (2.f / (float)NumRays), 1.0f);
+
+			return sum;
+		}
+
+		void GLAmbientShadowEvaluator::ChunkData::CopyRegion(const ChunkData& other,
+		                                                     const IntVector3& min,
+		                                                     const IntVector3& max) {
+			int numX = max.x - min.x + 1;
+			for (int z = min.z; z <= max.z; z++)
+				for (int y = min.y; y <= max.y; y++)
+					std::copy_n(&other.data[z][y][min.x][0], numX * 2, &data[z][y][min.x][0]);
+		}
+
+		void GLAmbientShadowEvaluator::UpdateChunk(int cx, int cy, int cz, const IntVector3& min,
+		                                           const IntVector3& max, ChunkData& c) const {
+			SPADES_MARK_FUNCTION();
+
+			std::unique_ptr<ColumnCache> cache{new ColumnCache()};
+			cache->Load(map, cx, cy);
+
+			int originX = cx * ChunkSize;
+			int originY = cy * ChunkSize;
+			int originZ = cz * ChunkSize;
+
+			// Compute the slightly larger volume for blurring
+			constexpr int padding = 2;
+			float wData[ChunkSize + padding * 2][ChunkSize + padding * 2][ChunkSize + padding * 2][2];
+			std::uint8_t wFlags[ChunkSize + padding * 2][ChunkSize + padding * 2][ChunkSize + padding * 2];
+			int wOriginX = originX - padding;
+			int wOriginY = originY - padding;
+			int wOriginZ = originZ - padding;
+			int wDirtyMinX = min.x;
+			int wDirtyMinY = min.y;
+			int wDirtyMinZ = min.z;
+			int wDirtyMaxX = max.x + padding * 2;
+			int wDirtyMaxY = max.y + padding * 2;
+			int wDirtyMaxZ = max.z + padding * 2;
+
+			auto b = [](int i) -> std::uint8_t { return (std::uint8_t)1 << i; };
+			auto to_b = [](bool b, int i) -> std::uint8_t { return (std::uint8_t)b << i; };
+
+			for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
+				for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
+					for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
+						IntVector3 pos{
+						  x + wOriginX,
+						  y + wOriginY,
+						  z + wOriginZ,
+						};
+
+						bool solid = cache->IsSolid(pos.x, pos.y, pos.z);
+						if (solid) {
+							wData[z][y][x][0] = 0.0;
+							wData[z][y][x][1] = 0.0;
+						} else {
+							wData[z][y][x][0] = Evaluate(*cache, pos);
+							wData[z][y][x][1] = 1.0;
+						}
+
+						// any of the 26 neighbors solid?
+						unsigned int neighbors = 0;
+						for (int dy = -1; dy <= 1; dy++)
+							for (int dx = -1; dx <= 1; dx++) {
+								unsigned int window =
+								  GetSolidWindow(cache->GetColumn(pos.x + dx, pos.y + dy), pos.z);
+								neighbors |= (dx | dy) ? window : (window & 5);
+							}
+
+						// bit 0: solids
+						// bit 1: contact (by-surface voxel)
+						wFlags[z][y][x] = to_b(solid, 0) | to_b(neighbors != 0, 1);
+					}
+
+			// The AO terms are sampled 0.5 blocks away from the terrain surface,
+			// which leads to under-shadowing. Compensate for this effect.
+			for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
+			for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
+			for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
+				float& d = wData[z][y][x][0];
+				d *= d * d + 1.0F - d;
+			}
+
+			// Blur the result to remove noise
+			//
+			//	  |     this        |     neighbor    |
+			//	  | solid | contact | solid | contact | blur
+			//	  |   0        0    |   0        x    |   1
+			//	  |   0        1    |   0        0    |   0  (prevent under-shadowing)
+			//	  |   0        1    |   0        1    |   1
+			//	  |   0        x    |   1        x    |   0  (solid voxel's value is zero)
+			//	  |   1        x    |   0        x    |   0  (solid voxel's value must remain zero)
+			//	  |   1        x    |   1        x    |   x
+			//
+			//
+			//	             this voxel
+			//
+			//	                    solid
+			//	                  /-------\  				.
+			//	          +---+---+---+---+
+			//	          | 1 | 0 | 0 | 0 |
+			//	          +---+---+---+---+\				.
+			//	          | 1 | 1 | 0 | 0 | |
+			//	         /+---+---+---+---+ | contact  neighbor
+			//	        | | 0 | 0 |   |   | |
+			//	  solid | +---+---+---+---+/
+			//	        | | 0 | 0 |   |   |
+			//	         \+---+---+---+---+
+			//	              \-------/
+			//	               contact
+			//
+			static const float divider[] = {1.0F, 1.0F / 2.0F, 1.0F / 3.0F};
+			auto mask = [](bool b, float x) { return b ? x : 0.0F; };
+			auto shouldBlur = [=](std::uint8_t thisFlags, std::uint8_t neighborFlags) {
+				return ((neighborFlags & b(0)) | ((~thisFlags | neighborFlags) & b(1))) == 0b10;
+			};
+			for (int blurPass = 0; blurPass < 2; ++blurPass) {
+				for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
+				for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
+				for (int x = wDirtyMinX + 1; x < wDirtyMaxX; x++) {
+					if (wFlags[z][y][x] & b(0))
+						continue;
+					// Do not blur between by-surface voxels and
+					// in-the-air voxels
+					bool m1 = shouldBlur(wFlags[z][y][x], wFlags[z][y][x - 1]);
+					bool m2 = shouldBlur(wFlags[z][y][x], wFlags[z][y][x + 1]);
+					wData[z][y][x][0] =
+						(wData[z][y][x][0] + mask(m1, wData[z][y][x - 1][0]) +
+						mask(m2, wData[z][y][x + 1][0])) *
+						divider[(int)m1 + (int)m2];
+				}
+				for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
+				for (int y = wDirtyMinY + 1; y < wDirtyMaxY; y++)
+				for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
+					if (wFlags[z][y][x] & b(0))
+						continue;
+					bool m1 = shouldBlur(wFlags[z][y][x], wFlags[z][y - 1][x]);
+					bool m2 = shouldBlur(wFlags[z][y][x], wFlags[z][y + 1][x]);
+					wData[z][y][x][0] =
+						(wData[z][y][x][0] + mask(m1, wData[z][y - 1][x][0]) +
+						mask(m2, wData[z][y + 1][x][0])) *
+						divider[(int)m1 + (int)m2];
+				}
+				for (int z = wDirtyMinZ + 1; z < wDirtyMaxZ; z++)
+				for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
+				for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
+					if (wFlags[z][y][x] & b(0))
+						continue;
+					bool m1 = shouldBlur(wFlags[z][y][x], wFlags[z - 1][y][x]);
+					bool m2 = shouldBlur(wFlags[z][y][x], wFlags[z + 1][y][x]);
+					wData[z][y][x][0] =
+						(wData[z][y][x][0] + mask(m1, wData[z - 1][y][x][0]) +
+						mask(m2, wData[z + 1][y][x][0])) *
+						divider[(int)m1 + (int)m2];
+				}
+			}
+
+			// Copy the result to `c.data`
+			for (int z = min.z; z <= max.z; z++)
+			for (int y = min.y; y <= max.y; y++)
+			for (int x = min.x; x <= max.x; x++) {
+				c.data[z][y][x][0] = wData[z + padding][y + padding][x + padding][0];
+				c.data[z][y][x][1] = wData[z + padding][y + padding][x + padding][1];
+			}
+		}
+
+		void GLAmbientShadowEvaluator::Benchmark(const client::GameMap& map) {
+			SPADES_MARK_FUNCTION();
+
+			std::array<Vector3, NumRays> rays;
+			for (auto& rayDir : rays)
+				rayDir = RandomUnitVector();
+			GLAmbientShadowEvaluator evaluator{map, rays};
+
+			const int chunkW = map.Width() / ChunkSize;
+			const int chunkH = map.Height() / ChunkSize;
+			const int chunkD = map.Depth() / ChunkSize;
+			const int numChunks = chunkW * chunkH * chunkD;
+			unsigned int numThreads = GetNumHardwareThreads();
+
+			SPLog("Ambient occlusion benchmark: %d chunks", numChunks);
+
+			// compare the traced rays with `GameMap::CastRay` on a subset of
+			// the chunks
+			int numSampledChunks = 0;
+			double referenceTime = 0.0, cachedTime = 0.0;
+			int numVoxels = 0, numMismatches = 0;
+			std::unique_ptr<ColumnCache> cache{new ColumnCache()};
+			std::vector<float> reference(ChunkSize * ChunkSize * ChunkSize);
+			for (int i = 0; i < numChunks; i += 17) {
+				int cx = i / chunkD / chunkH, cy = (i / chunkD) % chunkH, cz = i % chunkD;
+				auto voxel = [&](int j) {
+					return IntVector3::Make(cx * ChunkSize + (j & (ChunkSize - 1)),
+					                        cy * ChunkSize + ((j >> ChunkSizeBits) & (ChunkSize - 1)),
+					                        cz * ChunkSize + (j >> (ChunkSizeBits * 2)));
+				};
+
+				Stopwatch sw;
+				for (std::size_t j = 0; j < reference.size(); j++)
+					reference[j] = evaluator.EvaluateReference(voxel(static_cast<int>(j)));
+				referenceTime += sw.GetTime();
+
+				sw.Reset();
+				cache->Load(map, cx, cy);
+				for (std::size_t j = 0; j < reference.size(); j++) {
+					if (evaluator.Evaluate(*cache, voxel(static_cast<int>(j))) != reference[j])
+						numMismatches++;
+				}
+				cachedTime += sw.GetTime();
+				numSampledChunks++;
+				numVoxels += static_cast<int>(reference.size());
+			}
+
+			// update the whole map on all cores
+			const IntVector3 chunkMin = IntVector3::Make(0, 0, 0);
+			const IntVector3 chunkMax = IntVector3::Make(ChunkSize - 1, ChunkSize - 1, ChunkSize - 1);
+			std::atomic<int> nextChunk{0};
+			Stopwatch sw;
+			InvokeParallel(
+			  [&](unsigned int) {
+				  std::unique_ptr<ChunkData> data{new ChunkData()};
+				  int i;
+				  while ((i = nextChunk.fetch_add(1)) < numChunks)
+					  evaluator.UpdateChunk(i / chunkD / chunkH, (i / chunkD) % chunkH,
+					                        i % chunkD, chunkMin, chunkMax, *data);
+			  },
+			  numThreads);
+			double parallelTime = sw.GetTime();
+
+			SPLog("  rays with CastRay: %.2f ms/chunk", referenceTime * 1000.0 / numSampledChunks);
+			SPLog("  rays with occupancy mip: %.2f ms/chunk (%.2fx), %d/%d voxels differ",
+			      cachedTime * 1000.0 / numSampledChunks,
+			      referenceTime / std::max(cachedTime, 1.0e-9), numMismatches, numVoxels);
+			SPLog("  whole map, parallel (%u threads): %.0f ms (%.2f ms/chunk)", numThreads,
+			      parallelTime * 1000.0, parallelTime * 1000.0 / numChunks);
+		}
+	} // namespace draw
+} // namespace spades
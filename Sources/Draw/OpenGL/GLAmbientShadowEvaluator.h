@@ -0,0 +1,88 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <Core/Math.h>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+	}
+	namespace draw {
+		/**
+		 * Computes the large-scale ambient occlusion volume by casting a few
+		 * short rays from every voxel.
+		 *
+		 * A chunk is evaluated against a copy of the solid map columns around
+		 * it and a 4x4-column occupancy mip of them; a ray whose reach is
+		 * empty in the mip is a miss without being traced.
+		 *
+		 * `UpdateChunk` is thread-safe as long as the map is not modified.
+		 */
+		class GLAmbientShadowEvaluator {
+		public:
+			static constexpr int NumRays = 16;
+			static constexpr int ChunkSizeBits = 4;
+			static constexpr int ChunkSize = 1 << ChunkSizeBits;
+			static constexpr int RayLength = 16;
+
+			/** The AO term and the "not solid" flag of the voxels of a chunk,
+			 * indexed by `[z][y][x]`. */
+			struct ChunkData {
+				float data[ChunkSize][ChunkSize][ChunkSize][2];
+
+				/** Copies the voxels within the inclusive range `[min, max]`
+				 * from `other`. */
+				void CopyRegion(const ChunkData& other, const IntVector3& min,
+				                const IntVector3& max);
+			};
+
+			GLAmbientShadowEvaluator(const client::GameMap&, const std::array<Vector3, NumRays>& rays);
+
+			/** Evaluates the AO term of a voxel with `GameMap::CastRay`. */
+			float EvaluateReference(IntVector3) const;
+
+			/** Evaluates the voxels of the chunk `(cx, cy, cz)` within the
+			 * inclusive range `[min, max]` (in the chunk's coordinates). */
+			void UpdateChunk(int cx, int cy, int cz, const IntVector3& min, const IntVector3& max,
+			                 ChunkData&) const;
+
+			/**
+			 * Logs the time to update every chunk of the map on all cores, and
+			 * how the traced rays compare to `EvaluateReference` on a subset.
+			 */
+			static void Benchmark(const client::GameMap&);
+
+		private:
+			class ColumnCache;
+
+			const client::GameMap& map;
+			std::array<Vector3, NumRays> rays;
+
+			float Evaluate(const ColumnCache&, IntVector3) const;
+		};
+	} // namespace draw
+} // namespace spades
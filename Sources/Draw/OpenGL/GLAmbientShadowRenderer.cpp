@@ -18,6 +18,7 @@
 
  */
 
+#include <algorithm>
 #include <atomic>
 #include <cstdlib>
 
@@ -30,54 +31,30 @@
 
 namespace spades {
 	namespace draw {
-		class GLAmbientShadowRenderer::UpdateDispatch : public ConcurrentDispatch {
-			GLAmbientShadowRenderer& renderer;
-
-		public:
-			std::atomic<bool> done{false};
-			UpdateDispatch(GLAmbientShadowRenderer& r) : renderer(r) {}
-			void Run() override {
-				SPADES_MARK_FUNCTION();
-
-				renderer.UpdateDirtyChunks();
-
-				done = true;
-			}
-		};
-
 		GLAmbientShadowRenderer::GLAmbientShadowRenderer(GLRenderer& r, client::GameMap& m)
 		    : renderer(r), device(r.GetGLDevice()), map(m) {
 			SPADES_MARK_FUNCTION();
 
 			for (auto& rayDir : rays)
 				rayDir = RandomUnitVector();
+			evaluator.reset(new GLAmbientShadowEvaluator(*map, rays));
+
+			if (r.GetSettings().r_ambientShadowBenchmark)
+				GLAmbientShadowEvaluator::Benchmark(*map);
 
 			w = map->Width();
 			h = map->Height();
 			d = map->Depth();
 
-			chunkW = w / ChunkSize;
-			chunkH = h / ChunkSize;
-			chunkD = d / ChunkSize;
-
-			chunks = std::vector<Chunk>{static_cast<std::size_t>(chunkW * chunkH * chunkD)};
+			scheduler.reset(new Scheduler(*evaluator, w, h, d));
 
-			for (Chunk& c : chunks) {
-				float* data = (float*)c.data;
+			for (Chunk& c : scheduler->GetChunks()) {
+				float* data = (float*)c.data.data;
 				std::fill(data, data + ChunkSize * ChunkSize * ChunkSize * 2, 1.0F);
 			}
 
-			for (int x = 0; x < chunkW; x++)
-			for (int y = 0; y < chunkH; y++)
-			for (int z = 0; z < chunkD; z++) {
-				Chunk& c = GetChunk(x, y, z);
-				c.cx = x;
-				c.cy = y;
-				c.cz = z;
-			}
-
 			SPLog("Chunk buffer allocated (%d bytes)",
-			      (int)sizeof(Chunk) * chunkW * chunkH * chunkD);
+			      (int)(sizeof(Chunk) * scheduler->GetChunks().size()));
 
 			// make texture
 			texture = device.GenTexture();
@@ -104,133 +81,26 @@ namespace spades {
 			}
 
 			SPLog("Chunk texture initialized");
-
-			dispatch = NULL;
 		}
 
 		GLAmbientShadowRenderer::~GLAmbientShadowRenderer() {
 			SPADES_MARK_FUNCTION();
-			if (dispatch) {
-				dispatch->Join();
-				delete dispatch;
-			}
 			device.DeleteTexture(texture);
 		}
 
-		/**
-		 * Evaluate the AO term at the point specified by given world coordinates.
-		 */
-		float GLAmbientShadowRenderer::Evaluate(IntVector3 ipos) {
-			SPADES_MARK_FUNCTION_DEBUG();
-
-			float sum = 0.0F;
-			Vector3 pos = MakeVector3(ipos) + 0.5F;
-
-			for (int i = 0; i < NumRays; i++) {
-				Vector3 dir = rays[i];
-
-				unsigned int bits = i & 7;
-				if (bits & 1)
-					dir.x = -dir.x;
-				if (bits & 2)
-					dir.y = -dir.y;
-				if (bits & 4)
-					dir.z = -dir.z;
-
-				IntVector3 hitBlock;
-				float brightness = 1.0F;
-				if (map->CastRay(pos, dir, (float)RayLength, hitBlock)) {
-					float dist = ((MakeVector3(hitBlock) + 0.5F) - pos).GetSquaredLength();
-					brightness = dist * (1.0F / float((RayLength - 1) * (RayLength - 1)));
-					if (brightness > 1.0F)
-						brightness = 1.0F;
-				}
-
-				sum += brightness;
-			}
-
-			sum = std::min(sum * (2.f / (float)NumRays), 1.0f);
-
-			return sum;
-		}
-
 		void GLAmbientShadowRenderer::GameMapChanged(int x, int y, int z, client::GameMap* map) {
 			SPADES_MARK_FUNCTION_DEBUG();
 			if (map != this->map.GetPointerOrNull())
 				return;
 
-			Invalidate(x - RayLength, y - RayLength, z - RayLength, x + RayLength, y + RayLength,
-			           z + RayLength);
-		}
-
-		void GLAmbientShadowRenderer::Invalidate(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
-			SPADES_MARK_FUNCTION_DEBUG();
-			if (minZ < 0)
-				minZ = 0;
-			if (maxZ > d - 1)
-				maxZ = d - 1;
-			if (minX > maxX || minY > maxY || minZ > maxZ)
-				return;
-
-			// these should be floor div
-			int cx1 = minX >> ChunkSizeBits;
-			int cy1 = minY >> ChunkSizeBits;
-			int cz1 = minZ >> ChunkSizeBits;
-			int cx2 = maxX >> ChunkSizeBits;
-			int cy2 = maxY >> ChunkSizeBits;
-			int cz2 = maxZ >> ChunkSizeBits;
-
-			for (int cx = cx1; cx <= cx2; cx++) {
-				for (int cy = cy1; cy <= cy2; cy++) {
-					for (int cz = cz1; cz <= cz2; cz++) {
-						Chunk& c = GetChunkWrapped(cx, cy, cz);
-						int originX = cx * ChunkSize;
-						int originY = cy * ChunkSize;
-						int originZ = cz * ChunkSize;
-
-						int inMinX = std::max(minX - originX, 0);
-						int inMinY = std::max(minY - originY, 0);
-						int inMinZ = std::max(minZ - originZ, 0);
-						int inMaxX = std::min(maxX - originX, ChunkSize - 1);
-						int inMaxY = std::min(maxY - originY, ChunkSize - 1);
-						int inMaxZ = std::min(maxZ - originZ, ChunkSize - 1);
-
-						if (!c.dirty) {
-							c.dirtyMinX = inMinX;
-							c.dirtyMinY = inMinY;
-							c.dirtyMinZ = inMinZ;
-							c.dirtyMaxX = inMaxX;
-							c.dirtyMaxY = inMaxY;
-							c.dirtyMaxZ = inMaxZ;
-							c.dirty = true;
-						} else {
-							c.dirtyMinX = std::min(inMinX, c.dirtyMinX);
-							c.dirtyMinY = std::min(inMinY, c.dirtyMinY);
-							c.dirtyMinZ = std::min(inMinZ, c.dirtyMinZ);
-							c.dirtyMaxX = std::max(inMaxX, c.dirtyMaxX);
-							c.dirtyMaxY = std::max(inMaxY, c.dirtyMaxY);
-							c.dirtyMaxZ = std::max(inMaxZ, c.dirtyMaxZ);
-						}
-					}
-				}
-			}
-		}
-
-		int GLAmbientShadowRenderer::GetNumDirtyChunks() {
-			return (int)std::count_if(chunks.begin(), chunks.end(),
-			                          [](const Chunk& c) { return c.dirty; });
+			scheduler->Invalidate(x - RayLength, y - RayLength, z - RayLength, x + RayLength,
+			                      y + RayLength, z + RayLength);
 		}
 
 		void GLAmbientShadowRenderer::Update() {
-			if (GetNumDirtyChunks() > 0 && (dispatch == NULL || dispatch->done)) {
-				if (dispatch) {
-					dispatch->Join();
-					delete dispatch;
-				}
-				dispatch = new UpdateDispatch(*this);
-				dispatch->Start();
-			}
+			scheduler->Update(renderer.GetSceneDef().viewOrigin);
 
+			auto& chunks = scheduler->GetChunks();
 			// Count the number of chunks that need to be uploaded to GPU.
 			// This value is approximate but it should be okay for profiling use
 			std::size_t numChunksToLoad = std::count_if(
@@ -245,235 +115,9 @@ namespace spades {
 					device.TexSubImage3D(IGLDevice::Texture3D, 0, c.cx * ChunkSize,
 					                     c.cy * ChunkSize, c.cz * ChunkSize + 1, ChunkSize,
 					                     ChunkSize, ChunkSize, IGLDevice::RG, IGLDevice::FloatType,
-					                     c.data);
-				}
-			}
-		}
-
-		void GLAmbientShadowRenderer::UpdateDirtyChunks() {
-			std::array<std::size_t, 256> dirtyChunkIds;
-			std::size_t numDirtyChunks = 0;
-
-			// first, check only chunks in near range
-			const auto& viewOrigin = renderer.GetSceneDef().viewOrigin;
-			int eyeX = (int)(viewOrigin.x) >> ChunkSizeBits;
-			int eyeY = (int)(viewOrigin.y) >> ChunkSizeBits;
-			int eyeZ = (int)(viewOrigin.z) >> ChunkSizeBits;
-
-			for (size_t i = 0; i < chunks.size(); i++) {
-				Chunk& c = chunks[i];
-				int dx = (c.cx - eyeX) & (chunkW - 1);
-				int dy = (c.cy - eyeY) & (chunkH - 1);
-				int dz = (c.cz - eyeZ);
-				if (dx >= 6 && dx <= chunkW - 6)
-					continue;
-				if (dy >= 6 && dy <= chunkW - 6)
-					continue;
-				if (dz >= 6 || dz <= -6)
-					continue;
-				if (c.dirty) {
-					dirtyChunkIds[numDirtyChunks++] = static_cast<int>(i);
-					if (numDirtyChunks >= dirtyChunkIds.size())
-						break;
-				}
-			}
-
-			// far chunks
-			if (numDirtyChunks == 0) {
-				for (size_t i = 0; i < chunks.size(); i++) {
-					Chunk& c = chunks[i];
-					if (c.dirty) {
-						dirtyChunkIds[numDirtyChunks++] = static_cast<int>(i);
-						if (numDirtyChunks >= dirtyChunkIds.size())
-							break;
-					}
-				}
-			}
-
-			// limit update count per frame
-			for (int i = 0; i < 8; i++) {
-				if (numDirtyChunks <= 0)
-					break;
-				std::size_t idx = SampleRandomInt(std::size_t{0}, numDirtyChunks - 1);
-				Chunk& c = chunks[dirtyChunkIds[idx]];
-
-				// remove from list (fast)
-				if (idx < numDirtyChunks - 1)
-					std::swap(dirtyChunkIds[idx], dirtyChunkIds[numDirtyChunks - 1]);
-				numDirtyChunks--;
-
-				UpdateChunk(c.cx, c.cy, c.cz);
-			}
-		}
-
-		void GLAmbientShadowRenderer::UpdateChunk(int cx, int cy, int cz) {
-			Chunk& c = GetChunk(cx, cy, cz);
-			if (!c.dirty)
-				return;
-
-			int originX = cx * ChunkSize;
-			int originY = cy * ChunkSize;
-			int originZ = cz * ChunkSize;
-
-			// Compute the slightly larger volume for blurring
-			constexpr int padding = 2;
-			float wData[ChunkSize + padding * 2][ChunkSize + padding * 2][ChunkSize + padding * 2][2];
-			std::uint8_t wFlags[ChunkSize + padding * 2][ChunkSize + padding * 2][ChunkSize + padding * 2];
-			int wOriginX = originX - padding;
-			int wOriginY = originY - padding;
-			int wOriginZ = originZ - padding;
-			int wDirtyMinX = c.dirtyMinX;
-			int wDirtyMinY = c.dirtyMinY;
-			int wDirtyMinZ = c.dirtyMinZ;
-			int wDirtyMaxX = c.dirtyMaxX + padding * 2;
-			int wDirtyMaxY = c.dirtyMaxY + padding * 2;
-			int wDirtyMaxZ = c.dirtyMaxZ + padding * 2;
-
-			auto b = [](int i) -> std::uint8_t { return (std::uint8_t)1 << i; };
-			auto to_b = [](bool b, int i) -> std::uint8_t { return (std::uint8_t)b << i; };
-
-			for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
-				for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
-					for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
-						IntVector3 pos{
-						  x + wOriginX,
-						  y + wOriginY,
-						  z + wOriginZ,
-						};
-
-						if (map->IsSolidWrapped(pos.x, pos.y, pos.z)) {
-							wData[z][y][x][0] = 0.0;
-							wData[z][y][x][1] = 0.0;
-						} else {
-							wData[z][y][x][0] = Evaluate(pos);
-							wData[z][y][x][1] = 1.0;
-						}
-						// bit 0: solids
-						// bit 1: contact (by-surface voxel)
-						wFlags[z][y][x] =
-						  to_b(map->IsSolidWrapped(pos.x, pos.y, pos.z), 0) |
-						  to_b(map->IsSolidWrapped(pos.x - 1, pos.y - 1, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y - 1, pos.z) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y - 1, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y, pos.z) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y + 1, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y + 1, pos.z) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y + 1, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x - 1, pos.y - 1, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x, pos.y - 1, pos.z) ||
-						         map->IsSolidWrapped(pos.x, pos.y - 1, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x, pos.y, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x, pos.y, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x, pos.y + 1, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x, pos.y + 1, pos.z) ||
-						         map->IsSolidWrapped(pos.x, pos.y + 1, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y - 1, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y - 1, pos.z) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y - 1, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y, pos.z) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y, pos.z + 1) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y + 1, pos.z - 1) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y + 1, pos.z) ||
-						         map->IsSolidWrapped(pos.x + 1, pos.y + 1, pos.z + 1),
-						       1);
-					}
-
-			// The AO terms are sampled 0.5 blocks away from the terrain surface,
-			// which leads to under-shadowing. Compensate for this effect.
-			for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
-			for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
-			for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
-				float& d = wData[z][y][x][0];
-				d *= d * d + 1.0F - d;
-			}
-
-			// Blur the result to remove noise
-			//
-			//	  |     this        |     neighbor    |
-			//	  | solid | contact | solid | contact | blur
-			//	  |   0        0    |   0        x    |   1
-			//	  |   0        1    |   0        0    |   0  (prevent under-shadowing)
-			//	  |   0        1    |   0        1    |   1
-			//	  |   0        x    |   1        x    |   0  (solid voxel's value is zero)
-			//	  |   1        x    |   0        x    |   0  (solid voxel's value must remain zero)
-			//	  |   1        x    |   1        x    |   x
-			//
-			//
-			//	             this voxel
-			//
-			//	                    solid
-			//	                  /-------\  				.
-			//	          +---+---+---+---+
-			//	          | 1 | 0 | 0 | 0 |
-			//	          +---+---+---+---+\				.
-			//	          | 1 | 1 | 0 | 0 | |
-			//	         /+---+---+---+---+ | contact  neighbor
-			//	        | | 0 | 0 |   |   | |
-			//	  solid | +---+---+---+---+/
-			//	        | | 0 | 0 |   |   |
-			//	         \+---+---+---+---+
-			//	              \-------/
-			//	               contact
-			//
-			static const float divider[] = {1.0F, 1.0F / 2.0F, 1.0F / 3.0F};
-			auto mask = [](bool b, float x) { return b ? x : 0.0F; };
-			auto shouldBlur = [=](std::uint8_t thisFlags, std::uint8_t neighborFlags) {
-				return ((neighborFlags & b(0)) | ((~thisFlags | neighborFlags) & b(1))) == 0b10;
-			};
-			for (int blurPass = 0; blurPass < 2; ++blurPass) {
-				for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
-				for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
-				for (int x = wDirtyMinX + 1; x < wDirtyMaxX; x++) {
-					if (wFlags[z][y][x] & b(0))
-						continue;
-					// Do not blur between by-surface voxels and
-					// in-the-air voxels
-					bool m1 = shouldBlur(wFlags[z][y][x], wFlags[z][y][x - 1]);
-					bool m2 = shouldBlur(wFlags[z][y][x], wFlags[z][y][x + 1]);
-					wData[z][y][x][0] =
-						(wData[z][y][x][0] + mask(m1, wData[z][y][x - 1][0]) +
-						mask(m2, wData[z][y][x + 1][0])) *
-						divider[(int)m1 + (int)m2];
-				}
-				for (int z = wDirtyMinZ; z <= wDirtyMaxZ; z++)
-				for (int y = wDirtyMinY + 1; y < wDirtyMaxY; y++)
-				for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
-					if (wFlags[z][y][x] & b(0))
-						continue;
-					bool m1 = shouldBlur(wFlags[z][y][x], wFlags[z][y - 1][x]);
-					bool m2 = shouldBlur(wFlags[z][y][x], wFlags[z][y + 1][x]);
-					wData[z][y][x][0] =
-						(wData[z][y][x][0] + mask(m1, wData[z][y - 1][x][0]) +
-						mask(m2, wData[z][y + 1][x][0])) *
-						divider[(int)m1 + (int)m2];
+					                     c.data.data);
 				}
-				for (int z = wDirtyMinZ + 1; z < wDirtyMaxZ; z++)
-				for (int y = wDirtyMinY; y <= wDirtyMaxY; y++)
-				for (int x = wDirtyMinX; x <= wDirtyMaxX; x++) {
-					if (wFlags[z][y][x] & b(0))
-						continue;
-					bool m1 = shouldBlur(wFlags[z][y][x], wFlags[z - 1][y][x]);
-					bool m2 = shouldBlur(wFlags[z][y][x], wFlags[z + 1][y][x]);
-					wData[z][y][x][0] =
-						(wData[z][y][x][0] + mask(m1, wData[z - 1][y][x][0]) +
-						mask(m2, wData[z + 1][y][x][0])) *
-						divider[(int)m1 + (int)m2];
-				}
-			}
-
-			// Copy the result to `c.data`
-			for (int z = c.dirtyMinZ; z <= c.dirtyMaxZ; z++)
-			for (int y = c.dirtyMinY; y <= c.dirtyMaxY; y++)
-			for (int x = c.dirtyMinX; x <= c.dirtyMaxX; x++) {
-				c.data[z][y][x][0] = wData[z + padding][y + padding][x + padding][0];
-				c.data[z][y][x][1] = wData[z + padding][y + padding][x + padding][1];
 			}
-
-			c.dirty = false;
-			c.transferDone = false;
 		}
 	} // namespace draw
 } // namespace spades
\ No newline at end of file
@@ -21,9 +21,10 @@
 #pragma once
 
 #include <array>
-#include <atomic>
-#include <vector>
+#include <memory>
 
+#include "GLAmbientShadowEvaluator.h"
+#include "GLChunkUpdateScheduler.h"
 #include "IGLDevice.h"
 #include <Core/Debug.h>
 #include <Core/Math.h>
@@ -37,65 +38,30 @@ namespace spades {
 		class GLRenderer;
 		class IGLDevice;
 		class GLAmbientShadowRenderer {
-			class UpdateDispatch;
-
-			static constexpr int NumRays = 16;
-			static constexpr int ChunkSizeBits = 4;
-			static constexpr int ChunkSize = 1 << ChunkSizeBits;
-			static constexpr int RayLength = 16;
+			static constexpr int NumRays = GLAmbientShadowEvaluator::NumRays;
+			static constexpr int ChunkSizeBits = GLAmbientShadowEvaluator::ChunkSizeBits;
+			static constexpr int ChunkSize = GLAmbientShadowEvaluator::ChunkSize;
+			static constexpr int RayLength = GLAmbientShadowEvaluator::RayLength;
 
 			GLRenderer& renderer;
 			IGLDevice& device;
 			Handle<client::GameMap> map;
 			std::array<Vector3, NumRays> rays;
 
-			struct Chunk {
-				int cx, cy, cz;
-				float data[ChunkSize][ChunkSize][ChunkSize][2];
-				bool dirty = true;
-				int dirtyMinX = 0, dirtyMaxX = ChunkSize - 1;
-				int dirtyMinY = 0, dirtyMaxY = ChunkSize - 1;
-				int dirtyMinZ = 0, dirtyMaxZ = ChunkSize - 1;
+			typedef GLChunkUpdateScheduler<GLAmbientShadowEvaluator> Scheduler;
+			typedef Scheduler::Chunk Chunk;
 
-				std::atomic<bool> transferDone{true};
-			};
+			std::unique_ptr<GLAmbientShadowEvaluator> evaluator;
+			std::unique_ptr<Scheduler> scheduler;
 
 			IGLDevice::UInteger texture;
 
 			int w, h, d;
-			int chunkW, chunkH, chunkD;
-
-			std::vector<Chunk> chunks;
-
-			inline Chunk& GetChunk(int cx, int cy, int cz) {
-				SPAssert(cx >= 0);
-				SPAssert(cx < chunkW);
-				SPAssert(cy >= 0);
-				SPAssert(cy < chunkH);
-				SPAssert(cz >= 0);
-				SPAssert(cz < chunkD);
-				return chunks[(cx + cy * chunkW) * chunkD + cz];
-			}
-
-			inline Chunk& GetChunkWrapped(int cx, int cy, int cz) {
-				// FIXME: support for non-POT dimensions?
-				return GetChunk(cx & (chunkW - 1), cy & (chunkH - 1), cz);
-			}
-
-			void Invalidate(int minX, int minY, int minZ, int maxX, int maxY, int maxZ);
-
-			void UpdateChunk(int cx, int cy, int cz);
-			void UpdateDirtyChunks();
-			int GetNumDirtyChunks();
-
-			UpdateDispatch* dispatch;
 
 		public:
 			GLAmbientShadowRenderer(GLRenderer& renderer, client::GameMap& map);
 			~GLAmbientShadowRenderer();
 
-			float Evaluate(IntVector3);
-
 			void GameMapChanged(int x, int y, int z, client::GameMap*);
 
 			void Update();
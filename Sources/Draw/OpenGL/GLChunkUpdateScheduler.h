@@ -0,0 +1,305 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <Core/ConcurrentDispatch.h>
+#include <Core/Debug.h>
+#include <Core/Math.h>
+#include <Core/Parallel.h>
+
+namespace spades {
+	namespace draw {
+		/** The worker thread budget shared by all `GLChunkUpdateScheduler`s. */
+		class GLChunkUpdateSchedulerBase {
+		protected:
+			/**
+			 * The batches started by all schedulers and not collected yet.
+			 * The render thread's own parallel work (the occlusion buffer and
+			 * the wave simulation) waits behind them in the global dispatch
+			 * queue, so they are kept to half of the dispatch threads. Only
+			 * the render thread touches it.
+			 */
+			static inline unsigned int numBatchesInFlight = 0;
+
+			static unsigned int GetMaxBatchesInFlight() {
+				return std::max(GetNumHardwareThreads() / 2, 1U);
+			}
+		};
+
+		/**
+		 * Keeps the chunks of a volume computed by `Evaluator`
+		 * (`GLRadiosityEvaluator` or `GLAmbientShadowEvaluator`) up to date,
+		 * evaluating the dirty ones in batches on worker threads, nearest to
+		 * the camera first.
+		 *
+		 * The data the evaluator reads may be modified by the render thread
+		 * while a batch is running; such chunks are invalidated again and
+		 * evaluated once more, so a torn result is never kept for long.
+		 */
+		template <class Evaluator>
+		class GLChunkUpdateScheduler : GLChunkUpdateSchedulerBase {
+		public:
+			typedef typename Evaluator::ChunkData ChunkData;
+			enum { ChunkSize = Evaluator::ChunkSize, ChunkSizeBits = Evaluator::ChunkSizeBits };
+
+			struct Chunk {
+				int cx, cy, cz;
+				ChunkData data;
+				bool dirty = true;
+				int dirtyMinX = 0, dirtyMaxX = ChunkSize - 1;
+				int dirtyMinY = 0, dirtyMaxY = ChunkSize - 1;
+				int dirtyMinZ = 0, dirtyMaxZ = ChunkSize - 1;
+				/** The chunk is being evaluated by a worker thread. */
+				bool updating = false;
+
+				/** `false` until the render thread uploads the new `data`. */
+				std::atomic<bool> transferDone{true};
+			};
+
+		private:
+			/** The dirty region of a chunk evaluated on a worker thread. */
+			struct UpdateJob {
+				int chunkIndex;
+				IntVector3 chunkPos;
+				/** The region to evaluate, in the chunk's coordinates. */
+				IntVector3 dirtyMin, dirtyMax;
+				std::unique_ptr<ChunkData> data;
+			};
+
+			class UpdateDispatch : public ConcurrentDispatch {
+				const Evaluator& evaluator;
+
+			public:
+				std::vector<UpdateJob> jobs;
+				std::atomic<bool> done{false};
+
+				UpdateDispatch(const Evaluator& evaluator) : evaluator(evaluator) {}
+
+				void Run() override {
+					SPADES_MARK_FUNCTION();
+
+					for (auto& job : jobs)
+						evaluator.UpdateChunk(job.chunkPos.x, job.chunkPos.y, job.chunkPos.z,
+						                      job.dirtyMin, job.dirtyMax, *job.data);
+					done = true;
+				}
+			};
+			enum { UpdateBatchSize = 2 };
+
+			const Evaluator& evaluator;
+			int chunkW, chunkH, chunkD;
+			std::vector<Chunk> chunks;
+
+			/** Batches of chunks being evaluated on worker threads. */
+			std::vector<std::unique_ptr<UpdateDispatch>> dispatches;
+			std::vector<int> dirtyChunks;
+
+		public:
+			/** `w` and `h` must be powers of two; the volume wraps around
+			 * horizontally. */
+			GLChunkUpdateScheduler(const Evaluator& evaluator, int w, int h, int d)
+			    : evaluator(evaluator),
+			      chunkW(w / ChunkSize),
+			      chunkH(h / ChunkSize),
+			      chunkD(d / ChunkSize),
+			      chunks(static_cast<std::size_t>(chunkW * chunkH * chunkD)) {
+				for (int x = 0; x < chunkW; x++)
+				for (int y = 0; y < chunkH; y++)
+				for (int z = 0; z < chunkD; z++) {
+					Chunk& c = GetChunk(x, y, z);
+					c.cx = x;
+					c.cy = y;
+					c.cz = z;
+				}
+			}
+
+			~GLChunkUpdateScheduler() {
+				for (auto& dispatch : dispatches)
+					dispatch->Join();
+				numBatchesInFlight -= static_cast<unsigned int>(dispatches.size());
+			}
+
+			std::vector<Chunk>& GetChunks() { return chunks; }
+
+			Chunk& GetChunk(int cx, int cy, int cz) {
+				SPAssert(cx >= 0);
+				SPAssert(cx < chunkW);
+				SPAssert(cy >= 0);
+				SPAssert(cy < chunkH);
+				SPAssert(cz >= 0);
+				SPAssert(cz < chunkD);
+				return chunks[(cx + cy * chunkW) * chunkD + cz];
+			}
+
+			Chunk& GetChunkWrapped(int cx, int cy, int cz) {
+				return GetChunk(cx & (chunkW - 1), cy & (chunkH - 1), cz);
+			}
+
+			/** Marks the voxels in the inclusive range `[min, max]` dirty. */
+			void Invalidate(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+				SPADES_MARK_FUNCTION_DEBUG();
+				if (minZ < 0)
+					minZ = 0;
+				if (maxZ > chunkD * ChunkSize - 1)
+					maxZ = chunkD * ChunkSize - 1;
+				if (minX > maxX || minY > maxY || minZ > maxZ)
+					return;
+
+				// these should be floor div
+				int cx1 = minX >> ChunkSizeBits;
+				int cy1 = minY >> ChunkSizeBits;
+				int cz1 = minZ >> ChunkSizeBits;
+				int cx2 = maxX >> ChunkSizeBits;
+				int cy2 = maxY >> ChunkSizeBits;
+				int cz2 = maxZ >> ChunkSizeBits;
+
+				for (int cx = cx1; cx <= cx2; cx++)
+				for (int cy = cy1; cy <= cy2; cy++)
+				for (int cz = cz1; cz <= cz2; cz++) {
+					Chunk& c = GetChunkWrapped(cx, cy, cz);
+					int originX = cx * ChunkSize;
+					int originY = cy * ChunkSize;
+					int originZ = cz * ChunkSize;
+
+					int inMinX = std::max(minX - originX, 0);
+					int inMinY = std::max(minY - originY, 0);
+					int inMinZ = std::max(minZ - originZ, 0);
+					int inMaxX = std::min(maxX - originX, ChunkSize - 1);
+					int inMaxY = std::min(maxY - originY, ChunkSize - 1);
+					int inMaxZ = std::min(maxZ - originZ, ChunkSize - 1);
+
+					if (!c.dirty) {
+						c.dirtyMinX = inMinX;
+						c.dirtyMinY = inMinY;
+						c.dirtyMinZ = inMinZ;
+						c.dirtyMaxX = inMaxX;
+						c.dirtyMaxY = inMaxY;
+						c.dirtyMaxZ = inMaxZ;
+						c.dirty = true;
+					} else {
+						c.dirtyMinX = std::min(inMinX, c.dirtyMinX);
+						c.dirtyMinY = std::min(inMinY, c.dirtyMinY);
+						c.dirtyMinZ = std::min(inMinZ, c.dirtyMinZ);
+						c.dirtyMaxX = std::max(inMaxX, c.dirtyMaxX);
+						c.dirtyMaxY = std::max(inMaxY, c.dirtyMaxY);
+						c.dirtyMaxZ = std::max(inMaxZ, c.dirtyMaxZ);
+					}
+				}
+			}
+
+			/** Copies the results of finished batches to the chunks, and
+			 * starts evaluating the dirty chunks around `eye`. */
+			void Update(const Vector3& eye) {
+				CollectChunks();
+				ScheduleChunks(eye);
+			}
+
+		private:
+			void CollectChunks() {
+				SPADES_MARK_FUNCTION();
+
+				for (auto it = dispatches.begin(); it != dispatches.end();) {
+					UpdateDispatch& dispatch = **it;
+					if (!dispatch.done.load()) {
+						++it;
+						continue;
+					}
+
+					dispatch.Join();
+					for (auto& job : dispatch.jobs) {
+						Chunk& c = chunks[job.chunkIndex];
+						c.updating = false;
+
+						// only the dirty region was evaluated
+						c.data.CopyRegion(*job.data, job.dirtyMin, job.dirtyMax);
+						c.transferDone = false;
+					}
+					it = dispatches.erase(it);
+					numBatchesInFlight--;
+				}
+			}
+
+			void ScheduleChunks(const Vector3& eye) {
+				SPADES_MARK_FUNCTION();
+
+				const unsigned int maxBatchesInFlight = GetMaxBatchesInFlight();
+				if (numBatchesInFlight >= maxBatchesInFlight)
+					return;
+
+				dirtyChunks.clear();
+				for (std::size_t i = 0; i < chunks.size(); i++) {
+					const Chunk& c = chunks[i];
+					if (c.dirty && !c.updating)
+						dirtyChunks.push_back(static_cast<int>(i));
+				}
+				if (dirtyChunks.empty())
+					return;
+
+				int eyeX = (int)(eye.x) >> ChunkSizeBits;
+				int eyeY = (int)(eye.y) >> ChunkSizeBits;
+				int eyeZ = (int)(eye.z) >> ChunkSizeBits;
+				auto distance = [&](int i) {
+					const Chunk& c = chunks[i];
+					int dx = (c.cx - eyeX) & (chunkW - 1);
+					int dy = (c.cy - eyeY) & (chunkH - 1);
+					int dz = c.cz - eyeZ;
+					dx = std::min(dx, chunkW - dx);
+					dy = std::min(dy, chunkH - dy);
+					return dx * dx + dy * dy + dz * dz;
+				};
+				std::sort(dirtyChunks.begin(), dirtyChunks.end(),
+				          [&](int a, int b) { return distance(a) < distance(b); });
+
+				for (std::size_t i = 0;
+				     i < dirtyChunks.size() && numBatchesInFlight < maxBatchesInFlight;
+				     i += UpdateBatchSize) {
+					std::unique_ptr<UpdateDispatch> dispatch{new UpdateDispatch(evaluator)};
+
+					std::size_t end =
+					  std::min<std::size_t>(i + UpdateBatchSize, dirtyChunks.size());
+					for (std::size_t j = i; j < end; j++) {
+						Chunk& c = chunks[dirtyChunks[j]];
+						c.dirty = false;
+						c.updating = true;
+
+						UpdateJob job;
+						job.chunkIndex = dirtyChunks[j];
+						job.chunkPos = IntVector3::Make(c.cx, c.cy, c.cz);
+						job.dirtyMin = IntVector3::Make(c.dirtyMinX, c.dirtyMinY, c.dirtyMinZ);
+						job.dirtyMax = IntVector3::Make(c.dirtyMaxX, c.dirtyMaxY, c.dirtyMaxZ);
+						job.data.reset(new ChunkData());
+						dispatch->jobs.push_back(std::move(job));
+					}
+
+					dispatch->Start();
+					dispatches.push_back(std::move(dispatch));
+					numBatchesInFlight++;
+				}
+			}
+		};
+	} // namespace draw
+} // namespace spades
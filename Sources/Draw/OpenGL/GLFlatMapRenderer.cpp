@@ -28,15 +28,12 @@
 namespace spades {
 	namespace draw {
 		GLFlatMapRenderer::GLFlatMapRenderer(GLRenderer& r, client::GameMap& m)
-		    : renderer(r), map(m) {
+		    : renderer(r), map(m), surface(m) {
 			SPADES_MARK_FUNCTION();
 
-			chunkRows = m.Height() >> ChunkBits;
-			chunkCols = m.Width() >> ChunkBits;
-			for (int i = 0; i < chunkRows * chunkCols; i++)
-				chunkInvalid.push_back(false);
-
-			Handle<Bitmap> bmp(GenerateBitmap(0, 0, m.Width(), m.Height()), false);
+			// the bitmap only borrows the surface's colors for the upload
+			auto bmp = Handle<Bitmap>::New(const_cast<uint32_t*>(surface.GetColors()),
+			                               surface.GetWidth(), surface.GetHeight());
 			image = renderer.CreateImage(*bmp).Cast<GLImage>();
 
 			image->Bind(IGLDevice::Texture2D);
@@ -47,67 +44,38 @@ namespace spades {
 
 		GLFlatMapRenderer::~GLFlatMapRenderer() {}
 
-		Bitmap* GLFlatMapRenderer::GenerateBitmap(int mx, int my, int w, int h) {
-			SPADES_MARK_FUNCTION();
-			auto bmp = Handle<Bitmap>::New(w, h);
-			try {
-				uint32_t* pixels = bmp->GetPixels();
-
-				for (int y = 0; y < h; y++) {
-					for (int x = 0; x < w; x++) {
-						int px = mx + x, py = my + y;
-						for (int z = 0; z < 64; z++) { // int z = 2
-							if (map->IsSolid(px, py, z)) {
-								uint32_t col = map->GetColor(px, py, z);
-								col |= 0xFF000000UL;
-								*pixels = col;
-								break;
-							}
-						}
-						pixels++;
-					}
-				}
-			} catch (...) {
-				throw;
-			}
-			return std::move(bmp).Unmanage();
-		}
-
 		void GLFlatMapRenderer::GameMapChanged(int x, int y, int z, client::GameMap& map) {
 			if (this->map.GetPointerOrNull() != &map)
 				return;
 
-			SPAssert(x >= 0);
-			SPAssert(x < map.Width());
-			SPAssert(y >= 0);
-			SPAssert(y < map.Height());
 			SPAssert(z >= 0);
 			SPAssert(z < map.Depth());
 
-			int chunkX = x >> ChunkBits;
-			int chunkY = y >> ChunkBits;
-			int chunkId = chunkX + chunkY * chunkCols;
-			SPAssert(chunkId >= 0);
-			SPAssert(chunkId < chunkCols * chunkRows);
-			chunkInvalid[chunkId] = true;
+			surface.Invalidate(x, y);
 		}
 
 		void GLFlatMapRenderer::UpdateChunks() {
-			for (size_t i = 0; i < chunkInvalid.size(); i++) {
-				if (!chunkInvalid[i])
-					continue;
-
-				int chunkX = ((int)i) % chunkCols;
-				int chunkY = ((int)i) / chunkCols;
-
-				Handle<Bitmap> bmp(GenerateBitmap(chunkX * ChunkSize,
-					chunkY * ChunkSize, ChunkSize, ChunkSize), false);
-				try {
-					image->SubImage(bmp.GetPointerOrNull(), chunkX * ChunkSize, chunkY * ChunkSize);
-				} catch (...) {
-					throw;
-				}
-				chunkInvalid[i] = false;
+			SPADES_MARK_FUNCTION();
+
+			if (!surface.Update())
+				return;
+
+			// full rows are contiguous in the surface, so each run of changed
+			// rows can be uploaded in place without packing it into a new
+			// buffer
+			const int w = surface.GetWidth();
+			const std::vector<int>& rows = surface.GetChangedRows();
+			for (std::size_t i = 0; i < rows.size();) {
+				std::size_t j = i + 1;
+				while (j < rows.size() && rows[j] == rows[j - 1] + 1)
+					j++;
+
+				const int minY = rows[i], numRows = rows[j - 1] - minY + 1;
+				auto bmp = Handle<Bitmap>::New(
+				  const_cast<uint32_t*>(surface.GetColors()) + static_cast<std::size_t>(minY) * w,
+				  w, numRows);
+				image->SubImage(bmp.GetPointerOrNull(), 0, minY);
+				i = j;
 			}
 		}
 
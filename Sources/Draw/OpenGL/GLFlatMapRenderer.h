@@ -20,8 +20,7 @@
 
 #pragma once
 
-#include <vector>
-
+#include <Client/GameMapSurface.h>
 #include <Core/Math.h>
 #include <Core/RefCountedObject.h>
 
@@ -33,19 +32,19 @@ namespace spades {
 	namespace draw {
 		class GLRenderer;
 		class GLImage;
+		/**
+		 * Draws the minimap from a `client::GameMapSurface`. Map changes
+		 * are applied to the surface incrementally, and each run of rows
+		 * changed since the previous frame is uploaded with one sub-image
+		 * update in `UpdateChunks`.
+		 */
 		class GLFlatMapRenderer {
-			enum { ChunkSize = 16, ChunkBits = 4 };
-
 			GLRenderer& renderer;
 			Handle<client::GameMap> map;
-			std::vector<bool> chunkInvalid;
+			client::GameMapSurface surface;
 
 			Handle<GLImage> image;
 
-			int chunkCols, chunkRows;
-
-			Bitmap* GenerateBitmap(int x, int y, int w, int h);
-
 		public:
 			GLFlatMapRenderer(GLRenderer& renderer, client::GameMap& map);
 			~GLFlatMapRenderer();
@@ -44,7 +44,9 @@ namespace spades {
 			chunkX = cx;
 			chunkY = cy;
 			chunkZ = cz;
-			needsUpdate = true;
+			version = 1;
+			meshVersion = 0;
+			meshing = false;
 			realized = false;
 
 			centerPos = MakeVector3(
@@ -65,6 +67,7 @@ namespace spades {
 
 			buffer = 0;
 			iBuffer = 0;
+			numIndices = 0;
 		}
 
 		GLMapChunk::~GLMapChunk() { SetRealized(false); }
@@ -84,248 +87,56 @@ namespace spades {
 					device.DeleteBuffer(iBuffer);
 					iBuffer = 0;
 				}
-				std::vector<Vertex> i;
-				i.swap(vertices);
-
-				std::vector<uint16_t> i2;
-				i2.swap(indices);
+				numIndices = 0;
 			} else {
-				needsUpdate = true;
+				version++;
 			}
 
 			realized = b;
 		}
 
-		uint8_t GLMapChunk::calcAOID(int x, int y, int z,
-			int ux, int uy, int uz, int vx, int vy, int vz) {
-			int v = 0;
-			if (IsSolid(x - ux, y - uy, z - uz))
-				v |= 1;
-			if (IsSolid(x + ux, y + uy, z + uz))
-				v |= 1 << 1;
-			if (IsSolid(x - vx, y - vy, z - vz))
-				v |= 1 << 2;
-			if (IsSolid(x + vx, y + vy, z + vz))
-				v |= 1 << 3;
-			if (IsSolid(x - ux + vx, y - uy + vy, z - uz + vz))
-				v |= 1 << 4;
-			if (IsSolid(x - ux - vx, y - uy - vy, z - uz - vz))
-				v |= 1 << 5;
-			if (IsSolid(x + ux + vx, y + uy + vy, z + uz + vz))
-				v |= 1 << 6;
-			if (IsSolid(x + ux - vx, y + uy - vy, z + uz - vz))
-				v |= 1 << 7;
-			return (uint8_t)v;
-		}
-
-		/**
-		 * @param aoX Global X coordinate of the cell to evaluate ambient occlusion.
-		 * @param aoY Global Y coordinate of the cell to evaluate ambient occlusion.
-		 * @param aoZ Global Z coordinate of the cell to evaluate ambient occlusion.
-		 * @param x Chunk local X coordinate
-		 * @param y Chunk local Y coordinate
-		 * @param z Chunk local Z coordinate
-		 */
-		void GLMapChunk::EmitVertex(int x, int y, int z, int aoX, int aoY, int aoZ,
-			int ux, int uy, int vx, int vy, uint32_t color, int nx, int ny, int nz) {
-			SPADES_MARK_FUNCTION_DEBUG();
-
-			int uz = (ux == 0 && uy == 0) ? 1 : 0;
-			int vz = (vx == 0 && vy == 0) ? 1 : 0;
-
-			// evaluate ambient occlusion
-			unsigned int aoID = calcAOID(aoX, aoY, aoZ, ux, uy, uz, vx, vy, vz);
-
-			Vertex inst;
-			if (nz == 1 || ny == 1)
-				inst.shading = 0;
-			else if (nx == 1 || nx == -1)
-				inst.shading = 0; // 50;
-			else if (nz == -1)
-				inst.shading = 220;
-			else
-				inst.shading = 255;
-
-			inst.x = x;
-			inst.y = y;
-			inst.z = z;
-
-			inst.colorRed = (uint8_t)(color);
-			inst.colorGreen = (uint8_t)(color >> 8);
-			inst.colorBlue = (uint8_t)(color >> 16);
-
-			inst.nx = nx;
-			inst.ny = ny;
-			inst.nz = nz;
-
-			// fixed position to avoid self-shadow glitch
-			inst.sx = (x << 1) + ux + vx;
-			inst.sy = (y << 1) + uy + vy;
-			inst.sz = (z << 1) + uz + vz;
-
-			unsigned int aoTexX = (aoID & 15) * 16;
-			unsigned int aoTexY = (aoID >> 4) * 16;
-
-			uint16_t idx = (uint16_t)vertices.size();
-			inst.x = x;
-			inst.y = y;
-			inst.z = z;
-			inst.aoX = aoTexX;
-			inst.aoY = aoTexY;
-			vertices.push_back(inst);
-
-			inst.x = x + ux;
-			inst.y = y + uy;
-			inst.z = z + uz;
-			inst.aoX = aoTexX + 15;
-			inst.aoY = aoTexY;
-			vertices.push_back(inst);
-
-			inst.x = x + vx;
-			inst.y = y + vy;
-			inst.z = z + vz;
-			inst.aoX = aoTexX;
-			inst.aoY = aoTexY + 15;
-			vertices.push_back(inst);
-
-			inst.x = x + ux + vx;
-			inst.y = y + uy + vy;
-			inst.z = z + uz + vz;
-			inst.aoX = aoTexX + 15;
-			inst.aoY = aoTexY + 15;
-			vertices.push_back(inst);
-
-			indices.push_back(idx);
-			indices.push_back(idx + 1);
-			indices.push_back(idx + 2);
-			indices.push_back(idx + 1);
-			indices.push_back(idx + 3);
-			indices.push_back(idx + 2);
-		}
-
-		bool GLMapChunk::IsSolid(int x, int y, int z) {
-			if (z < 0)
-				return false;
-			if (z >= 64)
-				return true;
-
-			// FIXME: variable map size
-			x &= 511;
-			y &= 511;
-
-			return map->IsSolid(x, y, (z == 63)
-				? (renderer.renderer.GetSettings().r_water ? 62 : 63) : z);
-		}
-
-		void GLMapChunk::Update() {
+		void GLMapChunk::SetMesh(const GLMapChunkMesher::Mesh& mesh, unsigned int v) {
 			SPADES_MARK_FUNCTION();
 
-			vertices.clear();
-			indices.clear();
-			if (buffer) {
-				device.DeleteBuffer(buffer);
-				buffer = 0;
-			}
-			if (iBuffer) {
-				device.DeleteBuffer(iBuffer);
-				iBuffer = 0;
-			}
+			meshVersion = v;
+			numIndices = mesh.indices.size();
 
-			int rchunkX = chunkX * Size;
-			int rchunkY = chunkY * Size;
-			int rchunkZ = chunkZ * Size;
-
-			int x, y, z;
-			for (x = 0; x < Size; x++) {
-				for (y = 0; y < Size; y++) {
-					for (z = 0; z < Size; z++) {
-						int xx = x + rchunkX;
-						int yy = y + rchunkY;
-						int zz = z + rchunkZ;
-
-						if (!IsSolid(xx, yy, zz))
-							continue;
-
-						uint32_t col = map->GetColor(xx, yy, zz);
-
-						// apply block darkening
-						int health = col >> 24;
-						uint32_t f = (std::max(health, 32) << 8) / 100;
-						col = DarkenColor(col, f);
-
-						if (!IsSolid(xx, yy, zz + 1))
-							EmitVertex(x + 1, y, z + 1, xx, yy, zz + 1, -1, 0, 0, 1, col, 0, 0, 1);
-						if (!IsSolid(xx, yy, zz - 1))
-							EmitVertex(x, y, z, xx, yy, zz - 1, 1, 0, 0, 1, col, 0, 0, -1);
-						if (!IsSolid(xx - 1, yy, zz))
-							EmitVertex(x, y + 1, z, xx - 1, yy, zz, 0, 0, 0, -1, col, -1, 0, 0);
-						if (!IsSolid(xx + 1, yy, zz))
-							EmitVertex(x + 1, y, z, xx + 1, yy, zz, 0, 0, 0, 1, col, 1, 0, 0);
-						if (!IsSolid(xx, yy - 1, zz))
-							EmitVertex(x, y, z, xx, yy - 1, zz, 0, 0, 1, 0, col, 0, -1, 0);
-						if (!IsSolid(xx, yy + 1, zz))
-							EmitVertex(x + 1, y + 1, z, xx, yy + 1, zz, 0, 0, -1, 0, col, 0, 1, 0);
-					}
+			if (mesh.vertices.empty() || mesh.indices.empty()) {
+				if (buffer) {
+					device.DeleteBuffer(buffer);
+					buffer = 0;
 				}
-			}
-
-			if (vertices.size() == 0)
+				if (iBuffer) {
+					device.DeleteBuffer(iBuffer);
+					iBuffer = 0;
+				}
+				numIndices = 0;
 				return;
+			}
 
-			buffer = device.GenBuffer();
+			if (!buffer)
+				buffer = device.GenBuffer();
 			device.BindBuffer(IGLDevice::ArrayBuffer, buffer);
-
 			device.BufferData(IGLDevice::ArrayBuffer,
-			                  static_cast<IGLDevice::Sizei>(vertices.size() * sizeof(Vertex)),
-			                  vertices.data(), IGLDevice::DynamicDraw);
+			                  static_cast<IGLDevice::Sizei>(mesh.vertices.size() * sizeof(Vertex)),
+			                  mesh.vertices.data(), IGLDevice::DynamicDraw);
 
-			if (!indices.empty()) {
+			if (!iBuffer)
 				iBuffer = device.GenBuffer();
-				device.BindBuffer(IGLDevice::ArrayBuffer, iBuffer);
-
-				device.BufferData(IGLDevice::ArrayBuffer,
-				                  static_cast<IGLDevice::Sizei>(indices.size() * sizeof(uint16_t)),
-				                  indices.data(), IGLDevice::DynamicDraw);
-			}
+			device.BindBuffer(IGLDevice::ArrayBuffer, iBuffer);
+			device.BufferData(IGLDevice::ArrayBuffer,
+			                  static_cast<IGLDevice::Sizei>(mesh.indices.size() * sizeof(uint16_t)),
+			                  mesh.indices.data(), IGLDevice::DynamicDraw);
 			device.BindBuffer(IGLDevice::ArrayBuffer, 0);
 		}
 
-		void GLMapChunk::RenderDepthPass() {
+		void GLMapChunk::RenderDepthPass(const Vector3& offset) {
 			SPADES_MARK_FUNCTION();
 
-			const auto& eye = renderer.renderer.GetSceneDef().viewOrigin;
-
-			if (!realized)
+			if (!HasMesh())
 				return;
-			if (needsUpdate) {
-				Update();
-				needsUpdate = false;
-			}
-			if (!buffer)
-				return; // empty chunk
 
-			Vector3 diff = eye - centerPos;
-			float sx = 0.0F, sy = 0.0F;
-
-			// FIXME: variable map size?
-			if (diff.x > 256.0F)
-				sx += 512.0F;
-			if (diff.y > 256.0F)
-				sy += 512.0F;
-			if (diff.x < -256.0F)
-				sx -= 512.0F;
-			if (diff.y < -256.0F)
-				sy -= 512.0F;
-
-			AABB3 bx = aabb;
-			bx.min.x += sx;
-			bx.min.y += sy;
-			bx.max.x += sx;
-			bx.max.y += sy;
-
-			// frustrum cull
-			if (!renderer.renderer.BoxFrustrumCull(bx))
-				return;
+			float sx = offset.x, sy = offset.y;
 
 			GLProgram* depthOnlyProgram = renderer.depthonlyProgram;
 
@@ -346,47 +157,18 @@ namespace spades {
 
 			device.BindBuffer(IGLDevice::ArrayBuffer, 0);
 			device.BindBuffer(IGLDevice::ElementArrayBuffer, iBuffer);
-			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(indices.size()),
+			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(numIndices),
 			                    IGLDevice::UnsignedShort, NULL);
 			device.BindBuffer(IGLDevice::ElementArrayBuffer, 0);
 		}
 
-		void GLMapChunk::RenderSunlightPass() {
+		void GLMapChunk::RenderSunlightPass(const Vector3& offset) {
 			SPADES_MARK_FUNCTION();
 
-			const auto& eye = renderer.renderer.GetSceneDef().viewOrigin;
-
-			if (!realized)
+			if (!HasMesh())
 				return;
-			if (needsUpdate) {
-				Update();
-				needsUpdate = false;
-			}
-			if (!buffer)
-				return; // empty chunk
-
-			Vector3 diff = eye - centerPos;
-			float sx = 0.0F, sy = 0.0F;
-
-			// FIXME: variable map size?
-			if (diff.x > 256.0F)
-				sx += 512.0F;
-			if (diff.y > 256.0F)
-				sy += 512.0F;
-			if (diff.x < -256.0F)
-				sx -= 512.0F;
-			if (diff.y < -256.0F)
-				sy -= 512.0F;
-
-			AABB3 bx = aabb;
-			bx.min.x += sx;
-			bx.min.y += sy;
-			bx.max.x += sx;
-			bx.max.y += sy;
 
-			// frustrum cull
-			if (!renderer.renderer.BoxFrustrumCull(bx))
-				return;
+			float sx = offset.x, sy = offset.y;
 
 			GLProgram* basicProgram = renderer.basicProgram;
 
@@ -428,47 +210,20 @@ namespace spades {
 
 			device.BindBuffer(IGLDevice::ArrayBuffer, 0);
 			device.BindBuffer(IGLDevice::ElementArrayBuffer, iBuffer);
-			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(indices.size()),
+			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(numIndices),
 			                    IGLDevice::UnsignedShort, NULL);
 			device.BindBuffer(IGLDevice::ElementArrayBuffer, 0);
 		}
 
-		void GLMapChunk::RenderDynamicLightPass(std::vector<GLDynamicLight> lights) {
+		void GLMapChunk::RenderDynamicLightPass(const Vector3& offset,
+		                                        const std::vector<GLDynamicLight>& lights) {
 			SPADES_MARK_FUNCTION();
 
-			const auto& eye = renderer.renderer.GetSceneDef().viewOrigin;
-
-			if (!realized)
+			if (!HasMesh())
 				return;
-			if (needsUpdate) {
-				Update();
-				needsUpdate = false;
-			}
-			if (!buffer)
-				return; // empty chunk
 
-			Vector3 diff = eye - centerPos;
-			float sx = 0.0F, sy = 0.0F;
-
-			// FIXME: variable map size?
-			if (diff.x > 256.0F)
-				sx += 512.0F;
-			if (diff.y > 256.0F)
-				sy += 512.0F;
-			if (diff.x < -256.0F)
-				sx -= 512.0F;
-			if (diff.y < -256.0F)
-				sy -= 512.0F;
-
-			AABB3 bx = aabb;
-			bx.min.x += sx;
-			bx.min.y += sy;
-			bx.max.x += sx;
-			bx.max.y += sy;
-
-			// frustrum cull
-			if (!renderer.renderer.BoxFrustrumCull(bx))
-				return;
+			float sx = offset.x, sy = offset.y;
+			AABB3 bx = GetBounds(offset);
 
 			GLProgram* program = renderer.dlightProgram;
 
@@ -506,49 +261,20 @@ namespace spades {
 					continue;
 
 				device.DrawElements(IGLDevice::Triangles,
-				                    static_cast<IGLDevice::Sizei>(indices.size()),
+				                    static_cast<IGLDevice::Sizei>(numIndices),
 				                    IGLDevice::UnsignedShort, NULL);
 			}
 
 			device.BindBuffer(IGLDevice::ElementArrayBuffer, 0);
 		}
 
-		void GLMapChunk::RenderOutlinePass() {
+		void GLMapChunk::RenderOutlinePass(const Vector3& offset) {
 			SPADES_MARK_FUNCTION();
 
-			const auto& eye = renderer.renderer.GetSceneDef().viewOrigin;
-
-			if (!realized)
+			if (!HasMesh())
 				return;
-			if (needsUpdate) {
-				Update();
-				needsUpdate = false;
-			}
-			if (!buffer)
-				return; // empty chunk
-
-			Vector3 diff = eye - centerPos;
-			float sx = 0.0F, sy = 0.0F;
-
-			// FIXME: variable map size?
-			if (diff.x > 256.0F)
-				sx += 512.0F;
-			if (diff.y > 256.0F)
-				sy += 512.0F;
-			if (diff.x < -256.0F)
-				sx -= 512.0F;
-			if (diff.y < -256.0F)
-				sy -= 512.0F;
-
-			AABB3 bx = aabb;
-			bx.min.x += sx;
-			bx.min.y += sy;
-			bx.max.x += sx;
-			bx.max.y += sy;
 
-			// frustrum cull
-			if (!renderer.renderer.BoxFrustrumCull(bx))
-				return;
+			float sx = offset.x, sy = offset.y;
 
 			GLProgram* program = renderer.outlinesProgram;
 
@@ -569,11 +295,31 @@ namespace spades {
 
 			device.BindBuffer(IGLDevice::ArrayBuffer, 0);
 			device.BindBuffer(IGLDevice::ElementArrayBuffer, iBuffer);
-			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(indices.size()),
+			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(numIndices),
                      IGLDevice::UnsignedShort, NULL);
 			device.BindBuffer(IGLDevice::ElementArrayBuffer, 0);
 		}
 
+		Vector3 GLMapChunk::GetWrapOffset(const Vector3& eye) const {
+			Vector3 diff = eye - centerPos;
+			Vector3 offset = MakeVector3(0.0F, 0.0F, 0.0F);
+
+			// FIXME: variable map size?
+			if (diff.x > 256.0F)
+				offset.x += 512.0F;
+			if (diff.y > 256.0F)
+				offset.y += 512.0F;
+			if (diff.x < -256.0F)
+				offset.x -= 512.0F;
+			if (diff.y < -256.0F)
+				offset.y -= 512.0F;
+			return offset;
+		}
+
+		AABB3 GLMapChunk::GetBounds(const Vector3& offset) const {
+			return AABB3(aabb.min + offset, aabb.max + offset);
+		}
+
 		float GLMapChunk::DistanceFromEye(const Vector3& eye) {
 			Vector3 diff = eye - centerPos;
 
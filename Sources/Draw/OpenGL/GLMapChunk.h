@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "GLDynamicLight.h"
+#include "GLMapChunkMesher.h"
 #include "IGLDevice.h"
 #include <Client/GameMap.h>
 #include <Client/IRenderer.h>
@@ -33,23 +34,7 @@ namespace spades {
 		class GLMapRenderer;
 		class IGLDevice;
 		class GLMapChunk {
-			struct Vertex {
-				uint8_t x, y, z;
-				uint8_t pad;
-
-				uint16_t aoX, aoY;
-
-				uint8_t colorRed;
-				uint8_t colorGreen;
-				uint8_t colorBlue;
-				uint8_t shading;
-
-				int8_t nx, ny, nz;
-				uint8_t pad2;
-
-				int8_t sx, sy, sz;
-				uint8_t pad3;
-			};
+			using Vertex = GLMapChunkMesher::Vertex;
 
 			GLMapRenderer& renderer;
 			IGLDevice& device;
@@ -60,38 +45,56 @@ namespace spades {
 			Vector3 centerPos;
 			float radius;
 
-			std::vector<Vertex> vertices;
-			std::vector<uint16_t> indices;
 			IGLDevice::UInteger buffer;
 			IGLDevice::UInteger iBuffer;
-
-			bool needsUpdate;
+			std::size_t numIndices;
+
+			/** Incremented whenever the map content of the chunk changes. */
+			unsigned int version;
+			/** The version the uploaded mesh was built from. */
+			unsigned int meshVersion;
+			/** A mesh of this chunk is being built on a worker thread. */
+			bool meshing;
 			bool realized;
 
-			uint8_t calcAOID(int x, int y, int z, int ux, int uy, int uz, int vx, int vy, int vz);
-
-			void EmitVertex(int aoX, int aoY, int aoZ, int x, int y, int z, int ux, int uy, int vx,
-			                int vy, uint32_t color, int nx, int ny, int nz);
-
-			bool IsSolid(int x, int y, int z);
-
-			void Update();
-
 		public:
-			enum { Size = 16, SizeBits = 4 };
+			enum { Size = GLMapChunkMesher::Size, SizeBits = GLMapChunkMesher::SizeBits };
 			GLMapChunk(GLMapRenderer&, client::GameMap* mp, int cx, int cy, int cz);
 			~GLMapChunk();
 
-			void SetNeedsUpdate() { needsUpdate = true; }
+			void SetNeedsUpdate() { version++; }
 
 			void SetRealized(bool);
+			bool IsRealized() const { return realized; }
+
+			IntVector3 GetChunkPos() const { return IntVector3::Make(chunkX, chunkY, chunkZ); }
+			unsigned int GetVersion() const { return version; }
+
+			/** @return `true` if the chunk is realized and its mesh is out of
+			 * date without a rebuild being in progress. */
+			bool NeedsMesh() const { return realized && !meshing && meshVersion != version; }
+			void SetMeshing(bool b) { meshing = b; }
+
+			/** Uploads a mesh built from the chunk's map content at `version`.
+			 * The previous mesh is drawn until this is called. */
+			void SetMesh(const GLMapChunkMesher::Mesh&, unsigned int version);
 
 			float DistanceFromEye(const Vector3& eye);
 
-			void RenderSunlightPass();
-			void RenderDepthPass();
-			void RenderDynamicLightPass(std::vector<GLDynamicLight> lights);
-			void RenderOutlinePass();
+			bool HasMesh() const { return realized && buffer != 0; }
+
+			/** @return the offset to the copy of the chunk nearest to `eye`
+			 * (the map wraps around horizontally). */
+			Vector3 GetWrapOffset(const Vector3& eye) const;
+			AABB3 GetBounds(const Vector3& offset) const;
+
+			// `offset` is the value returned by `GetWrapOffset` for the eye.
+			// the caller is responsible for the culling.
+			void RenderSunlightPass(const Vector3& offset);
+			void RenderDepthPass(const Vector3& offset);
+			void RenderDynamicLightPass(const Vector3& offset,
+			                            const std::vector<GLDynamicLight>& lights);
+			void RenderOutlinePass(const Vector3& offset);
 		};
 	} // namespace draw
 } // namespace spades
\ No newline at end of file
@@ -0,0 +1,414 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <atomic>
+
+#include "GLMapChunkMesher.h"
+#include <Client/GameMap.h>
+#include <Core/BitOps.h>
+#include <Core/Debug.h>
+#include <Core/Parallel.h>
+#include <Core/Math.h>
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	namespace draw {
+		namespace {
+			/**
+			 * Solid-map columns of a chunk and its one-voxel border, which is
+			 * everything the face and ambient occlusion tests of a chunk can
+			 * reach. Coordinates are chunk local (-1 to `Size`) in X and Y,
+			 * and global in Z.
+			 */
+			class ColumnCache {
+				enum { Size = GLMapChunkMesher::Size };
+				uint64_t columns[Size + 2][Size + 2];
+
+			public:
+				ColumnCache(const client::GameMap& map, int ox, int oy, bool waterSurface) {
+					for (int x = 0; x < Size + 2; x++)
+						for (int y = 0; y < Size + 2; y++) {
+							uint64_t col = map.GetSolidMapWrapped(ox + x - 1, oy + y - 1);
+							// the bottom layer is drawn like the one above it
+							// when it is hidden under the water surface
+							if (waterSurface)
+								col = (col & ~(1ULL << 63)) | ((col >> 62 & 1ULL) << 63);
+							columns[x][y] = col;
+						}
+				}
+
+				uint64_t GetColumn(int x, int y) const { return columns[x + 1][y + 1]; }
+
+				bool IsSolid(int x, int y, int z) const {
+					if (z < 0)
+						return false;
+					if (z >= 64)
+						return true;
+					return ((columns[x + 1][y + 1] >> (uint64_t)z) & 1ULL) != 0;
+				}
+			};
+
+			/** An exposed face direction, in the order faces are emitted. */
+			struct FaceDirection {
+				/** Neighbor cell, which also is the cell to evaluate ambient occlusion */
+				int nx, ny, nz;
+				/** Offset of the first vertex from the voxel */
+				int px, py, pz;
+				int ux, uy, vx, vy;
+			};
+
+			const FaceDirection faceDirections[] = {
+			  {0, 0, 1, 1, 0, 1, -1, 0, 0, 1},  {0, 0, -1, 0, 0, 0, 1, 0, 0, 1},
+			  {-1, 0, 0, 0, 1, 0, 0, 0, 0, -1}, {1, 0, 0, 1, 0, 0, 0, 0, 0, 1},
+			  {0, -1, 0, 0, 0, 0, 0, 0, 1, 0},  {0, 1, 0, 1, 1, 0, 0, 0, -1, 0}};
+
+			class MeshBuilder {
+				const ColumnCache& cache;
+				GLMapChunkMesher::Mesh& mesh;
+
+				uint8_t CalcAOID(int x, int y, int z, int ux, int uy, int uz, int vx, int vy,
+				                 int vz) const {
+					int v = 0;
+					if (cache.IsSolid(x - ux, y - uy, z - uz))
+						v |= 1;
+					if (cache.IsSolid(x + ux, y + uy, z + uz))
+						v |= 1 << 1;
+					if (cache.IsSolid(x - vx, y - vy, z - vz))
+						v |= 1 << 2;
+					if (cache.IsSolid(x + vx, y + vy, z + vz))
+						v |= 1 << 3;
+					if (cache.IsSolid(x - ux + vx, y - uy + vy, z - uz + vz))
+						v |= 1 << 4;
+					if (cache.IsSolid(x - ux - vx, y - uy - vy, z - uz - vz))
+						v |= 1 << 5;
+					if (cache.IsSolid(x + ux + vx, y + uy + vy, z + uz + vz))
+						v |= 1 << 6;
+					if (cache.IsSolid(x + ux - vx, y + uy - vy, z + uz - vz))
+						v |= 1 << 7;
+					return (uint8_t)v;
+				}
+
+			public:
+				MeshBuilder(const ColumnCache& cache, GLMapChunkMesher::Mesh& mesh)
+				    : cache(cache), mesh(mesh) {}
+
+				/**
+				 * @param x Chunk local X coordinate of the voxel
+				 * @param y Chunk local Y coordinate of the voxel
+				 * @param z Chunk local Z coordinate of the voxel
+				 * @param zz Global Z coordinate of the voxel
+				 * @return the ambient occlusion ID of the face (0 = unoccluded)
+				 */
+				unsigned int GetFaceAOID(int x, int y, int z, int zz,
+				                         const FaceDirection& dir) const {
+					int uz = (dir.ux == 0 && dir.uy == 0) ? 1 : 0;
+					int vz = (dir.vx == 0 && dir.vy == 0) ? 1 : 0;
+					return CalcAOID(x + dir.nx, y + dir.ny, zz + dir.nz, dir.ux, dir.uy, uz,
+					                dir.vx, dir.vy, vz);
+				}
+
+				/** Computes the four vertices of a voxel face. */
+				static void MakeFace(int x, int y, int z, const FaceDirection& dir,
+				                     unsigned int aoID, uint32_t color,
+				                     GLMapChunkMesher::Vertex (&out)[4]) {
+					int ux = dir.ux, uy = dir.uy, vx = dir.vx, vy = dir.vy;
+					int uz = (ux == 0 && uy == 0) ? 1 : 0;
+					int vz = (vx == 0 && vy == 0) ? 1 : 0;
+					int nx = dir.nx, ny = dir.ny, nz = dir.nz;
+					x += dir.px;
+					y += dir.py;
+					z += dir.pz;
+
+					GLMapChunkMesher::Vertex inst;
+					inst.pad = inst.pad2 = inst.pad3 = 0;
+					if (nz == 1 || ny == 1)
+						inst.shading = 0;
+					else if (nx == 1 || nx == -1)
+						inst.shading = 0; // 50;
+					else if (nz == -1)
+						inst.shading = 220;
+					else
+						inst.shading = 255;
+
+					inst.colorRed = (uint8_t)(color);
+					inst.colorGreen = (uint8_t)(color >> 8);
+					inst.colorBlue = (uint8_t)(color >> 16);
+
+					inst.nx = nx;
+					inst.ny = ny;
+					inst.nz = nz;
+
+					// fixed position to avoid self-shadow glitch
+					inst.sx = (x << 1) + ux + vx;
+					inst.sy = (y << 1) + uy + vy;
+					inst.sz = (z << 1) + uz + vz;
+
+					unsigned int aoTexX = (aoID & 15) * 16;
+					unsigned int aoTexY = (aoID >> 4) * 16;
+
+					for (int i = 0; i < 4; i++) {
+						int du = i & 1, dv = i >> 1;
+						out[i] = inst;
+						out[i].x = x + ux * du + vx * dv;
+						out[i].y = y + uy * du + vy * dv;
+						out[i].z = z + uz * du + vz * dv;
+						out[i].aoX = aoTexX + 15 * du;
+						out[i].aoY = aoTexY + 15 * dv;
+					}
+				}
+
+				void EmitQuad(const GLMapChunkMesher::Vertex (&quad)[4]) {
+					auto& vertices = mesh.vertices;
+					uint16_t idx = (uint16_t)vertices.size();
+					vertices.insert(vertices.end(), quad, quad + 4);
+
+					auto& indices = mesh.indices;
+					indices.push_back(idx);
+					indices.push_back(idx + 1);
+					indices.push_back(idx + 2);
+					indices.push_back(idx + 1);
+					indices.push_back(idx + 3);
+					indices.push_back(idx + 2);
+				}
+
+				void EmitFace(int x, int y, int z, const FaceDirection& dir, unsigned int aoID,
+				              uint32_t color) {
+					GLMapChunkMesher::Vertex quad[4];
+					MakeFace(x, y, z, dir, aoID, color, quad);
+					EmitQuad(quad);
+				}
+
+				/**
+				 * Emits one quad covering a rectangle of unoccluded faces, given
+				 * the chunk local coordinates of its four corner voxels. Each
+				 * corner takes its vertex from the face of the voxel at that
+				 * corner. Its fixed position is the corner itself, so that it is
+				 * interpolated across the quad and the map shadow shaders can
+				 * find the voxel face under each fragment.
+				 */
+				void EmitMergedFace(const IntVector3 (&voxels)[4], const FaceDirection& dir,
+				                    uint32_t color) {
+					GLMapChunkMesher::Vertex corners[4][4];
+					for (int j = 0; j < 4; j++)
+						MakeFace(voxels[j].x, voxels[j].y, voxels[j].z, dir, 0, color, corners[j]);
+
+					int uz = (dir.ux == 0 && dir.uy == 0) ? 1 : 0;
+					int vz = (dir.vx == 0 && dir.vy == 0) ? 1 : 0;
+
+					GLMapChunkMesher::Vertex quad[4];
+					for (int i = 0; i < 4; i++) {
+						// pick the candidate farthest towards this corner
+						int su = (i & 1) ? 1 : -1, sv = (i >> 1) ? 1 : -1;
+						int dx = su * dir.ux + sv * dir.vx;
+						int dy = su * dir.uy + sv * dir.vy;
+						int dz = su * uz + sv * vz;
+						int best = 0, bestScore = 0;
+						for (int j = 0; j < 4; j++) {
+							const auto& v = corners[j][i];
+							int score = v.x * dx + v.y * dy + v.z * dz;
+							if (j == 0 || score > bestScore) {
+								best = j;
+								bestScore = score;
+							}
+						}
+						quad[i] = corners[best][i];
+						quad[i].sx = quad[i].x * 2;
+						quad[i].sy = quad[i].y * 2;
+						quad[i].sz = quad[i].z * 2;
+					}
+					EmitQuad(quad);
+				}
+			};
+
+			/** Local coordinates of the faces of a direction, as (slice, a, b). */
+			IntVector3 FaceToVoxel(int dirIndex, int slice, int a, int b) {
+				switch (dirIndex >> 1) {
+					case 0: return IntVector3::Make(a, b, slice);
+					case 1: return IntVector3::Make(slice, a, b);
+					default: return IntVector3::Make(a, slice, b);
+				}
+			}
+		} // namespace
+
+		GLMapChunkMesher::GLMapChunkMesher(const client::GameMap& map, bool waterSurface,
+		                                   bool greedy)
+		    : map(map), waterSurface(waterSurface), greedy(greedy) {}
+
+		void GLMapChunkMesher::Build(int cx, int cy, int cz, Mesh& out) const {
+			SPADES_MARK_FUNCTION();
+
+			out.Clear();
+
+			int rchunkX = cx * Size;
+			int rchunkY = cy * Size;
+			int rchunkZ = cz * Size;
+
+			ColumnCache cache{map, rchunkX, rchunkY, waterSurface};
+			MeshBuilder builder{cache, out};
+
+			// unoccluded faces waiting to be merged, indexed by direction and
+			// `FaceToVoxel`'s (slice, a, b); 0 = none, otherwise color | 1 << 24.
+			// the merge pass leaves it all zero, so it is reused without clearing.
+			static thread_local std::vector<uint32_t> mergeable;
+			if (greedy && mergeable.empty())
+				mergeable.resize(6 * Size * Size * Size, 0);
+			auto mergeableAt = [&](int dirIndex, int slice, int a, int b) -> uint32_t& {
+				return mergeable[((dirIndex * Size + slice) * Size + b) * Size + a];
+			};
+			// the slices of each direction with mergeable faces
+			uint32_t mergeableSlices[6] = {0, 0, 0, 0, 0, 0};
+
+			for (int x = 0; x < Size; x++) {
+				for (int y = 0; y < Size; y++) {
+					// visit only the solid voxels of the column, in ascending order
+					uint64_t solid = (cache.GetColumn(x, y) >> rchunkZ) & ((1ULL << Size) - 1);
+					while (solid) {
+						int z = FindFirstSet(solid);
+						solid &= solid - 1;
+
+						int xx = x + rchunkX;
+						int yy = y + rchunkY;
+						int zz = z + rchunkZ;
+
+						uint32_t col = map.GetColor(xx, yy, zz);
+
+						// apply block darkening
+						int health = col >> 24;
+						uint32_t f = (std::max(health, 32) << 8) / 100;
+						col = DarkenColor(col, f);
+
+						for (int d = 0; d < 6; d++) {
+							const FaceDirection& dir = faceDirections[d];
+							if (cache.IsSolid(x + dir.nx, y + dir.ny, zz + dir.nz))
+								continue;
+
+							unsigned int aoID = builder.GetFaceAOID(x, y, z, zz, dir);
+							if (greedy && aoID == 0) {
+								int slice = (d >> 1) == 0 ? z : (d >> 1) == 1 ? x : y;
+								int a = (d >> 1) == 1 ? y : x;
+								int b = (d >> 1) == 0 ? y : z;
+								mergeableAt(d, slice, a, b) = (col & 0xFFFFFF) | (1U << 24);
+								mergeableSlices[d] |= 1U << slice;
+								continue;
+							}
+							builder.EmitFace(x, y, z, dir, aoID, col);
+						}
+					}
+				}
+			}
+
+			if (!greedy)
+				return;
+
+			// merge the unoccluded faces of each slice into rectangles. the
+			// ambient occlusion tile of such faces is uniform, and the map
+			// shadow is evaluated per voxel face by the shaders, so a merged
+			// quad looks the same as the faces it replaces.
+			for (int d = 0; d < 6; d++) {
+				for (uint32_t slices = mergeableSlices[d]; slices; slices &= slices - 1) {
+					int slice = FindFirstSet(slices);
+					for (int b = 0; b < Size; b++) {
+						for (int a = 0; a < Size; a++) {
+							uint32_t key = mergeableAt(d, slice, a, b);
+							if (key == 0)
+								continue;
+
+							int w = 1;
+							while (a + w < Size && mergeableAt(d, slice, a + w, b) == key)
+								w++;
+
+							int h = 1;
+							for (; b + h < Size; h++) {
+								bool rowMatches = true;
+								for (int i = 0; i < w; i++) {
+									if (mergeableAt(d, slice, a + i, b + h) != key) {
+										rowMatches = false;
+										break;
+									}
+								}
+								if (!rowMatches)
+									break;
+							}
+
+							for (int j = 0; j < h; j++)
+								for (int i = 0; i < w; i++)
+									mergeableAt(d, slice, a + i, b + j) = 0;
+
+							const IntVector3 voxels[4] = {
+							  FaceToVoxel(d, slice, a, b), FaceToVoxel(d, slice, a + w - 1, b),
+							  FaceToVoxel(d, slice, a, b + h - 1),
+							  FaceToVoxel(d, slice, a + w - 1, b + h - 1)};
+							builder.EmitMergedFace(voxels, faceDirections[d], key & 0xFFFFFF);
+							a += w - 1;
+						}
+					}
+				}
+			}
+		}
+
+		void GLMapChunkMesher::Benchmark(const client::GameMap& map, bool waterSurface) {
+			SPADES_MARK_FUNCTION();
+
+			const int numChunkWidth = map.Width() / Size;
+			const int numChunkHeight = map.Height() / Size;
+			const int numChunkDepth = map.Depth() / Size;
+			const int numChunks = numChunkWidth * numChunkHeight * numChunkDepth;
+			unsigned int numThreads = GetNumHardwareThreads();
+
+			SPLog("Map mesher benchmark: %d chunks", numChunks);
+
+			for (bool greedy : {false, true}) {
+				GLMapChunkMesher mesher{map, waterSurface, greedy};
+				auto buildChunk = [&](int i, Mesh& mesh) {
+					mesher.Build(i / numChunkDepth / numChunkHeight,
+					             (i / numChunkDepth) % numChunkHeight, i % numChunkDepth, mesh);
+					return mesh.vertices.size();
+				};
+
+				Mesh mesh;
+				std::size_t numVertices = 0;
+				Stopwatch sw;
+				for (int i = 0; i < numChunks; i++)
+					numVertices += buildChunk(i, mesh);
+				double serialTime = sw.GetTime();
+
+				std::atomic<int> nextChunk{0};
+				sw.Reset();
+				InvokeParallel(
+				  [&](unsigned int) {
+					  Mesh mesh;
+					  int i;
+					  while ((i = nextChunk.fetch_add(1)) < numChunks)
+						  buildChunk(i, mesh);
+				  },
+				  numThreads);
+				double parallelTime = sw.GetTime();
+
+				SPLog("  %s: %zu vertices", greedy ? "greedy" : "per-face", numVertices);
+				SPLog("    serial: %.2f ms (%.1f us/chunk)", serialTime * 1000.0,
+				      serialTime * 1.0e6 / numChunks);
+				SPLog("    parallel (%u threads): %.2f ms (%.2fx)", numThreads,
+				      parallelTime * 1000.0, serialTime / std::max(parallelTime, 1.0e-9));
+			}
+		}
+	} // namespace draw
+} // namespace spades
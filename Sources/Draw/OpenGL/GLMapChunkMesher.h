@@ -0,0 +1,98 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+	}
+	namespace draw {
+		/**
+		 * Builds the vertex/index data of a `GLMapChunk` from the game map.
+		 *
+		 * Chunks are built on worker threads while the render thread keeps
+		 * drawing their previous mesh.
+		 */
+		class GLMapChunkMesher {
+		public:
+			struct Vertex {
+				uint8_t x, y, z;
+				uint8_t pad;
+
+				uint16_t aoX, aoY;
+
+				uint8_t colorRed;
+				uint8_t colorGreen;
+				uint8_t colorBlue;
+				uint8_t shading;
+
+				int8_t nx, ny, nz;
+				uint8_t pad2;
+
+				/** Twice the position the map shadow is evaluated at: the
+				 * center of the face, or the vertex itself on merged faces. */
+				int8_t sx, sy, sz;
+				uint8_t pad3;
+			};
+
+			struct Mesh {
+				std::vector<Vertex> vertices;
+				std::vector<uint16_t> indices;
+
+				void Clear() {
+					vertices.clear();
+					indices.clear();
+				}
+			};
+
+			enum { Size = 16, SizeBits = 4 };
+
+			/**
+			 * @param waterSurface `true` if the bottom layer (z = 63) lies under
+			 *                     the water surface and should be meshed like
+			 *                     the layer above it.
+			 * @param greedy `true` to merge adjacent coplanar faces with the
+			 *               same color and no ambient occlusion into larger
+			 *               quads.
+			 */
+			GLMapChunkMesher(const client::GameMap&, bool waterSurface, bool greedy = false);
+
+			/** Meshes the chunk at the given chunk coordinates into `out`.
+			 * Safe to call from several threads at once as long as the map
+			 * is not being modified. */
+			void Build(int cx, int cy, int cz, Mesh& out) const;
+
+			/** Meshes every chunk of the map with and without face merging,
+			 * first on the calling thread and then on all cores, and logs the
+			 * vertex counts and timings. */
+			static void Benchmark(const client::GameMap&, bool waterSurface);
+
+		private:
+			const client::GameMap& map;
+			bool waterSurface;
+			bool greedy;
+		};
+	} // namespace draw
+} // namespace spades
@@ -0,0 +1,254 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "GLMapOccluder.h"
+#include <Client/GameMap.h>
+#include <Core/Debug.h>
+
+namespace spades {
+	namespace draw {
+		namespace {
+			float GetComponent(const Vector3& v, int axis) {
+				return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+			}
+
+			/** @return `true` if the segment `a`-`b` intersects `box`, storing the
+			 * entry point's parameter to `tEnter`. */
+			bool SegmentIntersectsBox(const Vector3& a, const Vector3& b, const AABB3& box,
+			                          float& tEnter) {
+				float t0 = 0.0F, t1 = 1.0F;
+				for (int axis = 0; axis < 3; axis++) {
+					float origin = GetComponent(a, axis);
+					float dir = GetComponent(b, axis) - origin;
+					float lo = GetComponent(box.min, axis), hi = GetComponent(box.max, axis);
+					if (fabsf(dir) < 1.0e-6F) {
+						if (origin < lo || origin > hi)
+							return false;
+						continue;
+					}
+					float ta = (lo - origin) / dir;
+					float tb = (hi - origin) / dir;
+					if (ta > tb)
+						std::swap(ta, tb);
+					t0 = std::max(t0, ta);
+					t1 = std::min(t1, tb);
+					if (t0 > t1)
+						return false;
+				}
+				tEnter = t0;
+				return true;
+			}
+
+			/** @return `true` if the segment from `eye` reaches `target` without
+			 * passing through a solid voxel before `tLimit`. */
+			bool TraceLineOfSight(const client::GameMap& map, const Vector3& eye,
+			                      const Vector3& target, float tLimit) {
+				Vector3 dir = target - eye;
+				IntVector3 eyeVoxel = eye.Floor();
+				int voxel[3] = {eyeVoxel.x, eyeVoxel.y, eyeVoxel.z};
+				int step[3];
+				float tMax[3], tDelta[3];
+				for (int axis = 0; axis < 3; axis++) {
+					float d = GetComponent(dir, axis);
+					float origin = GetComponent(eye, axis);
+					if (d > 0.0F) {
+						step[axis] = 1;
+						tDelta[axis] = 1.0F / d;
+						tMax[axis] = ((float)voxel[axis] + 1.0F - origin) / d;
+					} else if (d < 0.0F) {
+						step[axis] = -1;
+						tDelta[axis] = -1.0F / d;
+						tMax[axis] = ((float)voxel[axis] - origin) / d;
+					} else {
+						step[axis] = 0;
+						tDelta[axis] = 0.0F;
+						tMax[axis] = INFINITY;
+					}
+				}
+
+				float t = 0.0F;
+				while (t < tLimit) {
+					if (map.IsSolidWrapped(voxel[0], voxel[1], voxel[2]))
+						return false;
+
+					int axis = 0;
+					if (tMax[1] < tMax[axis])
+						axis = 1;
+					if (tMax[2] < tMax[axis])
+						axis = 2;
+					t = tMax[axis];
+					voxel[axis] += step[axis];
+					tMax[axis] += tDelta[axis];
+				}
+				return true;
+			}
+		} // namespace
+
+		GLMapOccluder::GLMapOccluder(const client::GameMap& map) : map(map) {
+			numCellsX = map.Width() >> CellSizeBits;
+			numCellsY = map.Height() >> CellSizeBits;
+			cellHeights.resize(numCellsX * numCellsY, 64);
+			dirtyCells.resize(numCellsX * numCellsY, true);
+		}
+
+		void GLMapOccluder::ColumnChanged(int x, int y) {
+			int cx = (x >> CellSizeBits) & (numCellsX - 1);
+			int cy = (y >> CellSizeBits) & (numCellsY - 1);
+			dirtyCells[cx + cy * numCellsX] = true;
+		}
+
+		int GLMapOccluder::GetCellHeight(int cx, int cy) {
+			cx &= numCellsX - 1;
+			cy &= numCellsY - 1;
+			int index = cx + cy * numCellsX;
+			if (dirtyCells[index]) {
+				int height = 0;
+				for (int x = 0; x < CellSize; x++) {
+					for (int y = 0; y < CellSize; y++) {
+						uint64_t col = map.GetSolidMap((cx << CellSizeBits) + x,
+						                               (cy << CellSizeBits) + y);
+						// the column is solid from just below its lowest air voxel
+						uint64_t air = ~col;
+						int columnHeight = 0;
+						for (int z = 63; z >= 0; z--) {
+							if ((air >> z) & 1) {
+								columnHeight = z + 1;
+								break;
+							}
+						}
+						height = std::max(height, columnHeight);
+					}
+				}
+				cellHeights[index] = static_cast<uint8_t>(height);
+				dirtyCells[index] = false;
+			}
+			return cellHeights[index];
+		}
+
+		bool GLMapOccluder::CellBlocksBox(int cx, int cy, const Vector3& eye, const AABB3& box) {
+			int height = GetCellHeight(cx, cy);
+			if (height >= 64)
+				return false;
+
+			// shrink the occluder slightly so that grazing lines of sight are
+			// not considered blocked
+			const float margin = 0.01F;
+			AABB3 occluder{Vector3::Make((float)(cx * CellSize) + margin,
+			                             (float)(cy * CellSize) + margin, (float)height + margin),
+			               Vector3::Make((float)((cx + 1) * CellSize) - margin,
+			                             (float)((cy + 1) * CellSize) - margin, 64.0F)};
+			if (eye.x > occluder.min.x && eye.x < occluder.max.x && eye.y > occluder.min.y &&
+			    eye.y < occluder.max.y && eye.z > occluder.min.z)
+				return false;
+
+			// the set of points hidden by a convex occluder is convex, so it is
+			// enough to test the corners of the top face. a line of sight to a
+			// point lower in the box passes the occluder's footprint even lower,
+			// where the occluder is still solid.
+			for (int i = 0; i < 4; i++) {
+				Vector3 corner = Vector3::Make((i & 1) ? box.max.x : box.min.x,
+				                               (i & 2) ? box.max.y : box.min.y, box.min.z);
+				float t;
+				if (!SegmentIntersectsBox(eye, corner, occluder, t))
+					return false;
+			}
+			return true;
+		}
+
+		bool GLMapOccluder::IsOccluded(const Vector3& eye, const AABB3& box) {
+			if (eye.z >= 64.0F || box.max.z > 64.0F)
+				return false;
+
+			// walk the cells on the line from the eye to the box's center
+			Vector3 center = (box.min + box.max) * 0.5F;
+			float dx = center.x - eye.x, dy = center.y - eye.y;
+			int cx = (int)floorf(eye.x / (float)CellSize);
+			int cy = (int)floorf(eye.y / (float)CellSize);
+			int endX = (int)floorf(center.x / (float)CellSize);
+			int endY = (int)floorf(center.y / (float)CellSize);
+			int stepX = dx > 0.0F ? 1 : -1, stepY = dy > 0.0F ? 1 : -1;
+			float tDeltaX = dx != 0.0F ? (float)CellSize / fabsf(dx) : INFINITY;
+			float tDeltaY = dy != 0.0F ? (float)CellSize / fabsf(dy) : INFINITY;
+			float tMaxX = dx != 0.0F
+			                ? ((float)((cx + (stepX > 0 ? 1 : 0)) * CellSize) - eye.x) / dx
+			                : INFINITY;
+			float tMaxY = dy != 0.0F
+			                ? ((float)((cy + (stepY > 0 ? 1 : 0)) * CellSize) - eye.y) / dy
+			                : INFINITY;
+
+			int numSteps = std::abs(endX - cx) + std::abs(endY - cy);
+			for (int i = 0; i < numSteps; i++) {
+				if (tMaxX < tMaxY) {
+					cx += stepX;
+					tMaxX += tDeltaX;
+				} else {
+					cy += stepY;
+					tMaxY += tDeltaY;
+				}
+
+				// the occluder must be outside the box's footprint
+				float minX = (float)(cx * CellSize), minY = (float)(cy * CellSize);
+				if (minX < box.max.x && minX + (float)CellSize > box.min.x &&
+				    minY < box.max.y && minY + (float)CellSize > box.min.y)
+					break;
+
+				if (CellBlocksBox(cx, cy, eye, box))
+					return true;
+			}
+			return false;
+		}
+
+		bool GLMapOccluder::IsVisibleBruteForce(const client::GameMap& map, const Vector3& eye,
+		                                        const AABB3& box) {
+			SPADES_MARK_FUNCTION();
+
+			if (box && eye)
+				return true;
+
+			// sample the centers of the voxel faces on the box's surface
+			float boxMin[3] = {box.min.x, box.min.y, box.min.z};
+			float boxMax[3] = {box.max.x, box.max.y, box.max.z};
+			for (int axis = 0; axis < 3; axis++) {
+				int u = (axis + 1) % 3, v = (axis + 2) % 3;
+				for (int side = 0; side < 2; side++) {
+					float coords[3];
+					coords[axis] = side ? boxMax[axis] : boxMin[axis];
+					for (coords[u] = boxMin[u] + 0.5F; coords[u] < boxMax[u]; coords[u] += 1.0F) {
+						for (coords[v] = boxMin[v] + 0.5F; coords[v] < boxMax[v];
+						     coords[v] += 1.0F) {
+							Vector3 target = Vector3::Make(coords[0], coords[1], coords[2]);
+
+							float tEnter;
+							if (!SegmentIntersectsBox(eye, target, box, tEnter))
+								continue;
+							if (TraceLineOfSight(map, eye, target, tEnter))
+								return true;
+						}
+					}
+				}
+			}
+			return false;
+		}
+	} // namespace draw
+} // namespace spades
@@ -0,0 +1,85 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Core/Math.h>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+	}
+	namespace draw {
+		/**
+		 * Coarse horizon occlusion for map chunks.
+		 *
+		 * The map is divided into cells of `CellSize` x `CellSize` columns.
+		 * For every cell the occluder keeps the highest Z (towards the bottom
+		 * of the map) from which all of its columns are solid down to the
+		 * bottom, which makes each cell a solid box no line of sight can pass
+		 * through. A box is occluded if a single such cell between it and the
+		 * eye blocks every line of sight to it.
+		 *
+		 * The test is conservative: it never reports a box with a visible
+		 * point as occluded. `IsVisibleBruteForce` can be used to check that.
+		 */
+		class GLMapOccluder {
+		public:
+			enum { CellSize = 16, CellSizeBits = 4 };
+
+			GLMapOccluder(const client::GameMap&);
+
+			/** Must be called when a column of the map was modified. */
+			void ColumnChanged(int x, int y);
+
+			/**
+			 * @param eye The eye position.
+			 * @param box The box to test, in the same (possibly unwrapped)
+			 *            coordinate space as `eye`.
+			 * @return `true` if every line of sight from `eye` to `box` is
+			 *         blocked by the map before reaching the box.
+			 */
+			bool IsOccluded(const Vector3& eye, const AABB3& box);
+
+			/**
+			 * Tests the visibility of a box by tracing lines of sight from
+			 * `eye` to points on its surface through the map, voxel by voxel.
+			 * Slow; meant for validating `IsOccluded`.
+			 */
+			static bool IsVisibleBruteForce(const client::GameMap&, const Vector3& eye,
+			                                const AABB3& box);
+
+		private:
+			const client::GameMap& map;
+			int numCellsX, numCellsY;
+			/** For each cell, the Z from which the cell is entirely solid
+			 * (64 if no such Z exists). */
+			std::vector<uint8_t> cellHeights;
+			std::vector<bool> dirtyCells;
+
+			int GetCellHeight(int cx, int cy);
+			bool CellBlocksBox(int cx, int cy, const Vector3& eye, const AABB3& box);
+		};
+	} // namespace draw
+} // namespace spades
@@ -18,6 +18,10 @@
 
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 #include "GLMapRenderer.h"
 #include "GLDynamicLightShader.h"
 #include "GLImage.h"
@@ -31,11 +35,37 @@
 #include "GLShadowShader.h"
 #include "IGLDevice.h"
 #include <Client/GameMap.h>
+#include <Core/ConcurrentDispatch.h>
 #include <Core/Debug.h>
 #include <Core/Settings.h>
+#include <Core/Stopwatch.h>
 
 namespace spades {
 	namespace draw {
+		/**
+		 * Meshes a batch of chunks on a worker thread. The map may be modified
+		 * by the render thread meanwhile; such chunks have their version bumped
+		 * and are meshed again, so a torn result is never kept for long.
+		 */
+		class GLMapRenderer::MeshDispatch : public ConcurrentDispatch {
+			GLMapChunkMesher mesher;
+
+		public:
+			std::vector<MeshJob> jobs;
+			std::atomic<bool> done{false};
+
+			MeshDispatch(const client::GameMap& map, bool waterSurface, bool greedy)
+			    : mesher(map, waterSurface, greedy) {}
+
+			void Run() override {
+				SPADES_MARK_FUNCTION();
+
+				for (auto& job : jobs)
+					mesher.Build(job.chunkPos.x, job.chunkPos.y, job.chunkPos.z, job.mesh);
+				done = true;
+			}
+		};
+
 		void GLMapRenderer::PreloadShaders(GLRenderer& renderer) {
 			if (renderer.GetSettings().r_physicalLighting)
 				renderer.RegisterProgram("Shaders/OpenGL/BasicBlockPhys.program");
@@ -48,7 +78,11 @@ namespace spades {
 		}
 
 		GLMapRenderer::GLMapRenderer(client::GameMap* m, GLRenderer& r)
-		    : renderer(r), device(r.GetGLDevice()), gameMap(m) {
+		    : renderer(r),
+		      device(r.GetGLDevice()),
+		      gameMap(m),
+		      occluder(*m),
+		      visibleChunksValid(false) {
 			SPADES_MARK_FUNCTION();
 
 			numChunkWidth = gameMap->Width() / GLMapChunk::Size;
@@ -80,11 +114,18 @@ namespace spades {
 			device.BufferData(IGLDevice::ArrayBuffer, sizeof(squareVertices), squareVertices,
 			                  IGLDevice::StaticDraw);
 			device.BindBuffer(IGLDevice::ArrayBuffer, 0);
+
+			if (r.GetSettings().r_mapMeshBenchmark)
+				GLMapChunkMesher::Benchmark(*gameMap, r.GetSettings().r_water != 0);
 		}
 
 		GLMapRenderer::~GLMapRenderer() {
 			SPADES_MARK_FUNCTION();
 
+			for (auto& dispatch : meshDispatches)
+				dispatch->Join();
+			meshDispatches.clear();
+
 			device.DeleteBuffer(squareVertexBuffer);
 			for (int i = 0; i < numChunks; i++)
 				delete chunks[i];
@@ -94,6 +135,8 @@ namespace spades {
 		void GLMapRenderer::GameMapChanged(int x, int y, int z, client::GameMap* map) {
 			SPADES_MARK_FUNCTION_DEBUG();
 
+			occluder.ColumnChanged(x, y);
+
 			int fz = z & (GLMapChunk::Size - 1);
 			int sx = -1;
 			int sy = -1;
@@ -121,13 +164,96 @@ namespace spades {
 
 			float cullDistance = 128.0F;
 			float releaseDistance = cullDistance + 32.0F;
-			for (int i = 0; i < numChunks; i++) {
+			// the distance ignores Z, so it is the same for the whole column
+			for (int i = 0; i < numChunks; i += numChunkDepth) {
 				float dist = chunks[i]->DistanceFromEye(eye);
-				chunkInfos[i].distance = dist;
-				if (dist < cullDistance)
-					chunks[i]->SetRealized(true);
-				else if (dist > releaseDistance)
-					chunks[i]->SetRealized(false);
+				for (int j = i; j < i + numChunkDepth; j++) {
+					chunkInfos[j].distance = dist;
+					if (dist < cullDistance)
+						chunks[j]->SetRealized(true);
+					else if (dist > releaseDistance)
+						chunks[j]->SetRealized(false);
+				}
+			}
+		}
+
+		void GLMapRenderer::CollectMeshes() {
+			SPADES_MARK_FUNCTION();
+
+			for (auto it = meshDispatches.begin(); it != meshDispatches.end();) {
+				MeshDispatch& dispatch = **it;
+				if (!dispatch.done.load()) {
+					++it;
+					continue;
+				}
+
+				dispatch.Join();
+				for (auto& job : dispatch.jobs)
+					meshUploadQueue.push_back(std::move(job));
+				it = meshDispatches.erase(it);
+			}
+		}
+
+		void GLMapRenderer::UploadMeshes() {
+			SPADES_MARK_FUNCTION();
+
+			// always upload at least one mesh so that the map keeps updating
+			double budget = renderer.GetSettings().r_mapUploadBudget * 0.001;
+			Stopwatch sw;
+			int numUploaded = 0;
+			while (!meshUploadQueue.empty()) {
+				if (numUploaded > 0 && sw.GetTime() >= budget)
+					break;
+
+				MeshJob& job = meshUploadQueue.front();
+				job.chunk->SetMeshing(false);
+
+				// a chunk released meanwhile gets a new version when realized
+				// again, so its result can be dropped
+				if (job.chunk->IsRealized()) {
+					job.chunk->SetMesh(job.mesh, job.version);
+					numUploaded++;
+				}
+
+				meshUploadQueue.pop_front();
+			}
+		}
+
+		void GLMapRenderer::ScheduleMeshing() {
+			SPADES_MARK_FUNCTION();
+
+			if (meshDispatches.size() >= MaxMeshDispatches)
+				return;
+
+			dirtyChunks.clear();
+			for (int i = 0; i < numChunks; i++) {
+				if (chunks[i]->NeedsMesh())
+					dirtyChunks.push_back(i);
+			}
+			if (dirtyChunks.empty())
+				return;
+
+			std::sort(dirtyChunks.begin(), dirtyChunks.end(), [&](int a, int b) {
+				return chunkInfos[a].distance < chunkInfos[b].distance;
+			});
+
+			bool waterSurface = renderer.GetSettings().r_water != 0;
+			bool greedy = renderer.GetSettings().r_mapGreedyMeshing;
+			for (std::size_t i = 0;
+			     i < dirtyChunks.size() && meshDispatches.size() < MaxMeshDispatches;
+			     i += MeshBatchSize) {
+				std::unique_ptr<MeshDispatch> dispatch{new MeshDispatch(*gameMap, waterSurface, greedy)};
+
+				std::size_t end = std::min<std::size_t>(i + MeshBatchSize, dirtyChunks.size());
+				for (std::size_t j = i; j < end; j++) {
+					GLMapChunk* chunk = chunks[dirtyChunks[j]];
+					chunk->SetMeshing(true);
+					dispatch->jobs.push_back(
+					  MeshJob{chunk, chunk->GetChunkPos(), chunk->GetVersion(), {}});
+				}
+
+				dispatch->Start();
+				meshDispatches.push_back(std::move(dispatch));
 			}
 		}
 
@@ -135,6 +261,87 @@ namespace spades {
 			GLProfiler::Context profiler(renderer.GetGLProfiler(), "Map Chunks");
 			const auto& viewOrigin = renderer.GetSceneDef().viewOrigin;
 			RealizeChunks(viewOrigin);
+
+			CollectMeshes();
+			UploadMeshes();
+			ScheduleMeshing();
+
+			visibleChunksValid = false;
+		}
+
+		void GLMapRenderer::UpdateVisibleChunks() {
+			SPADES_MARK_FUNCTION();
+
+			// the mirrored scene is rendered with a different matrix
+			const Matrix4& matrix = renderer.GetProjectionViewMatrix();
+			if (visibleChunksValid &&
+			    std::memcmp(matrix.m, visibleChunksMatrix.m, sizeof(matrix.m)) == 0)
+				return;
+			visibleChunksMatrix = matrix;
+			visibleChunksValid = true;
+			visibleChunks.clear();
+
+			// the horizon test works in the world space, so it cannot be
+			// used for the mirrored view
+			bool occlusionCulling =
+			  renderer.GetSettings().r_mapOcclusionCulling && !renderer.IsRenderingMirror();
+
+			const auto& eye = renderer.GetSceneDef().viewOrigin;
+
+			// from nearest to farthest
+			IntVector3 c = eye.Floor() / GLMapChunk::Size;
+			AddVisibleColumn(c.x, c.y, c.z, eye, occlusionCulling);
+			for (int dist = 1; dist <= 128 / GLMapChunk::Size; dist++) {
+				for (int x = c.x - dist; x <= c.x + dist; x++) {
+					AddVisibleColumn(x, c.y + dist, c.z, eye, occlusionCulling);
+					AddVisibleColumn(x, c.y - dist, c.z, eye, occlusionCulling);
+				}
+				for (int y = c.y - dist + 1; y <= c.y + dist - 1; y++) {
+					AddVisibleColumn(c.x + dist, y, c.z, eye, occlusionCulling);
+					AddVisibleColumn(c.x - dist, y, c.z, eye, occlusionCulling);
+				}
+			}
+		}
+
+		void GLMapRenderer::AddVisibleColumn(int cx, int cy, int cz, const Vector3& eye,
+		                                     bool occlusionCulling) {
+			cx &= numChunkWidth - 1;
+			cy &= numChunkHeight - 1;
+
+			// cull the whole column first
+			Vector3 offset = GetChunk(cx, cy, 0)->GetWrapOffset(eye);
+			AABB3 columnBounds = GetChunk(cx, cy, 0)->GetBounds(offset);
+			columnBounds.max.z = (float)(numChunkDepth * GLMapChunk::Size);
+			if (!renderer.BoxFrustrumCull(columnBounds))
+				return;
+
+			auto addChunk = [&](int z) {
+				GLMapChunk* chunk = GetChunk(cx, cy, z);
+				if (!chunk->HasMesh())
+					return;
+
+				AABB3 bounds = chunk->GetBounds(offset);
+				if (!renderer.BoxFrustrumCull(bounds))
+					return;
+
+				if (occlusionCulling && occluder.IsOccluded(eye, bounds)) {
+					if (renderer.GetSettings().r_mapOcclusionCheck &&
+					    GLMapOccluder::IsVisibleBruteForce(*gameMap, eye, bounds)) {
+						SPLog("Map chunk [%d, %d, %d] was culled while being visible from "
+						      "(%.2f, %.2f, %.2f)",
+						      cx, cy, z, eye.x, eye.y, eye.z);
+					} else {
+						return;
+					}
+				}
+
+				visibleChunks.push_back(VisibleChunk{chunk, offset});
+			};
+
+			for (int z = std::max(cz, 0); z < numChunkDepth; z++)
+				addChunk(z);
+			for (int z = std::min(cz - 1, numChunkDepth - 1); z >= 0; z--)
+				addChunk(z);
 		}
 
 		void GLMapRenderer::Prerender() {
@@ -142,7 +349,6 @@ namespace spades {
 			// depth-only pass
 
 			GLProfiler::Context profiler(renderer.GetGLProfiler(), "Map");
-			const auto& viewOrigin = renderer.GetSceneDef().viewOrigin;
 
 			device.Enable(IGLDevice::CullFace, true);
 			device.Enable(IGLDevice::DepthTest, true);
@@ -156,19 +362,9 @@ namespace spades {
 			projectionViewMatrix(depthonlyProgram);
 			projectionViewMatrix.SetValue(renderer.GetProjectionViewMatrix());
 
-			// draw from nearest to farthest
-			IntVector3 c = viewOrigin.Floor() / GLMapChunk::Size;
-			DrawColumnDepth(c.x, c.y, c.z, viewOrigin);
-			for (int dist = 1; dist <= 128 / GLMapChunk::Size; dist++) {
-				for (int x = c.x - dist; x <= c.x + dist; x++) {
-					DrawColumnDepth(x, c.y + dist, c.z, viewOrigin);
-					DrawColumnDepth(x, c.y - dist, c.z, viewOrigin);
-				}
-				for (int y = c.y - dist + 1; y <= c.y + dist - 1; y++) {
-					DrawColumnDepth(c.x + dist, y, c.z, viewOrigin);
-					DrawColumnDepth(c.x - dist, y, c.z, viewOrigin);
-				}
-			}
+			UpdateVisibleChunks();
+			for (const auto& visible : visibleChunks)
+				visible.chunk->RenderDepthPass(visible.offset);
 
 			device.EnableVertexAttribArray(positionAttribute(), false);
 			device.ColorMask(true, true, true, true);
@@ -265,19 +461,9 @@ namespace spades {
 			// TODO maybe add some way of checking if the chunks have been realized for the current
 			// eye? Probably just a bool called "alreadyrealized" that gets checked in RealizeChunks
 
-			// draw from nearest to farthest
-			IntVector3 c = viewOrigin.Floor() / GLMapChunk::Size;
-			DrawColumnSunlight(c.x, c.y, c.z, viewOrigin);
-			for (int dist = 1; dist <= 128 / GLMapChunk::Size; dist++) {
-				for (int x = c.x - dist; x <= c.x + dist; x++) {
-					DrawColumnSunlight(x, c.y + dist, c.z, viewOrigin);
-					DrawColumnSunlight(x, c.y - dist, c.z, viewOrigin);
-				}
-				for (int y = c.y - dist + 1; y <= c.y + dist - 1; y++) {
-					DrawColumnSunlight(c.x + dist, y, c.z, viewOrigin);
-					DrawColumnSunlight(c.x - dist, y, c.z, viewOrigin);
-				}
-			}
+			UpdateVisibleChunks();
+			for (const auto& visible : visibleChunks)
+				visible.chunk->RenderSunlightPass(visible.offset);
 
 			device.EnableVertexAttribArray(positionAttribute(), false);
 			if (ambientOcclusionCoordAttribute() != -1)
@@ -343,22 +529,9 @@ namespace spades {
 
 			// RealizeChunks(eye); // should already be realized from the prepass
 
-			// draw from nearest to farthest
-			IntVector3 c = viewOrigin.Floor() / GLMapChunk::Size;
-			DrawColumnDynamicLight(c.x, c.y, c.z, viewOrigin, lights);
-			// TODO: optimize call
-			//	ex. don't call a chunk'r render method if
-			//  no dlight lights it
-			for (int dist = 1; dist <= 128 / GLMapChunk::Size; dist++) {
-				for (int x = c.x - dist; x <= c.x + dist; x++) {
-					DrawColumnDynamicLight(x, c.y + dist, c.z, viewOrigin, lights);
-					DrawColumnDynamicLight(x, c.y - dist, c.z, viewOrigin, lights);
-				}
-				for (int y = c.y - dist + 1; y <= c.y + dist - 1; y++) {
-					DrawColumnDynamicLight(c.x + dist, y, c.z, viewOrigin, lights);
-					DrawColumnDynamicLight(c.x - dist, y, c.z, viewOrigin, lights);
-				}
-			}
+			UpdateVisibleChunks();
+			for (const auto& visible : visibleChunks)
+				visible.chunk->RenderDynamicLightPass(visible.offset, lights);
 
 			device.EnableVertexAttribArray(positionAttribute(), false);
 			device.EnableVertexAttribArray(colorAttribute(), false);
@@ -406,59 +579,13 @@ namespace spades {
 
 			RealizeChunks(viewOrigin);
 
-			// draw from nearest to farthest
-			IntVector3 c = viewOrigin.Floor() / GLMapChunk::Size;
-			DrawColumnOutline(c.x, c.y, c.z, viewOrigin);
-			for (int dist = 1; dist <= 128 / GLMapChunk::Size; dist++) {
-				for (int x = c.x - dist; x <= c.x + dist; x++) {
-					DrawColumnOutline(x, c.y + dist, c.z, viewOrigin);
-					DrawColumnOutline(x, c.y - dist, c.z, viewOrigin);
-				}
-				for (int y = c.y - dist + 1; y <= c.y + dist - 1; y++) {
-					DrawColumnOutline(c.x + dist, y, c.z, viewOrigin);
-					DrawColumnOutline(c.x - dist, y, c.z, viewOrigin);
-				}
-			}
+			UpdateVisibleChunks();
+			for (const auto& visible : visibleChunks)
+				visible.chunk->RenderOutlinePass(visible.offset);
 
 			device.EnableVertexAttribArray(positionAttribute(), false);
 		}
 
-		void GLMapRenderer::DrawColumnDepth(int cx, int cy, int cz, spades::Vector3 eye) {
-			cx &= numChunkWidth - 1;
-			cy &= numChunkHeight - 1;
-			for (int z = std::max(cz, 0); z < numChunkDepth; z++)
-				GetChunk(cx, cy, z)->RenderDepthPass();
-			for (int z = std::min(cz - 1, 63); z >= 0; z--)
-				GetChunk(cx, cy, z)->RenderDepthPass();
-		}
-		void GLMapRenderer::DrawColumnSunlight(int cx, int cy, int cz, spades::Vector3 eye) {
-			cx &= numChunkWidth - 1;
-			cy &= numChunkHeight - 1;
-			for (int z = std::max(cz, 0); z < numChunkDepth; z++)
-				GetChunk(cx, cy, z)->RenderSunlightPass();
-			for (int z = std::min(cz - 1, 63); z >= 0; z--)
-				GetChunk(cx, cy, z)->RenderSunlightPass();
-		}
-
-		void GLMapRenderer::DrawColumnDynamicLight(int cx, int cy, int cz, spades::Vector3 eye,
-		                                     const std::vector<GLDynamicLight>& lights) {
-			cx &= numChunkWidth - 1;
-			cy &= numChunkHeight - 1;
-			for (int z = std::max(cz, 0); z < numChunkDepth; z++)
-				GetChunk(cx, cy, z)->RenderDynamicLightPass(lights);
-			for (int z = std::min(cz - 1, 63); z >= 0; z--)
-				GetChunk(cx, cy, z)->RenderDynamicLightPass(lights);
-		}
-
-		void GLMapRenderer::DrawColumnOutline(int cx, int cy, int cz, spades::Vector3 eye) {
-			cx &= numChunkWidth - 1;
-			cy &= numChunkHeight - 1;
-			for (int z = std::max(cz, 0); z < numChunkDepth; z++)
-				GetChunk(cx, cy, z)->RenderOutlinePass();
-			for (int z = std::min(cz - 1, 63); z >= 0; z--)
-				GetChunk(cx, cy, z)->RenderOutlinePass();
-		}
-
 #pragma mark - BackFaceBlock
 
 		struct BFVertex {
@@ -20,7 +20,13 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <vector>
+
 #include "GLDynamicLight.h"
+#include "GLMapChunkMesher.h"
+#include "GLMapOccluder.h"
 #include "IGLDevice.h"
 #include <Client/IGameMapListener.h>
 #include <Client/IRenderer.h>
@@ -62,6 +68,35 @@ namespace spades {
 			int numChunkWidth, numChunkHeight;
 			int numChunkDepth, numChunks;
 
+			/** A chunk mesh built on a worker thread. */
+			struct MeshJob {
+				GLMapChunk* chunk;
+				IntVector3 chunkPos;
+				/** The chunk's version when the job was scheduled. */
+				unsigned int version;
+				GLMapChunkMesher::Mesh mesh;
+			};
+			class MeshDispatch;
+			enum { MeshBatchSize = 16, MaxMeshDispatches = 8 };
+
+			/** Batches of chunks being meshed on worker threads. */
+			std::vector<std::unique_ptr<MeshDispatch>> meshDispatches;
+			/** Built meshes waiting to be uploaded by the render thread. */
+			std::deque<MeshJob> meshUploadQueue;
+			std::vector<int> dirtyChunks;
+
+			struct VisibleChunk {
+				GLMapChunk* chunk;
+				/** `GLMapChunk::GetWrapOffset` for the eye */
+				Vector3 offset;
+			};
+			GLMapOccluder occluder;
+			/** Chunks passing the culling for the current view, nearest first.
+			 * Built once per view and shared by all passes. */
+			std::vector<VisibleChunk> visibleChunks;
+			Matrix4 visibleChunksMatrix;
+			bool visibleChunksValid;
+
 			inline int GetChunkIndex(int x, int y, int z) {
 				return (x * numChunkHeight + y) * numChunkDepth + z;
 			}
@@ -72,11 +107,18 @@ namespace spades {
 
 			void RealizeChunks(Vector3 eye);
 
-			void DrawColumnDepth(int cx, int cy, int cz, Vector3 eye);
-			void DrawColumnSunlight(int cx, int cy, int cz, Vector3 eye);
-			void DrawColumnDynamicLight(int cx, int cy, int cz, Vector3 eye,
-			                            const std::vector<GLDynamicLight>& lights);
-			void DrawColumnOutline(int cx, int cy, int cz, Vector3 eye);
+			/** Moves the meshes of finished dispatches to the upload queue. */
+			void CollectMeshes();
+			/** Uploads queued meshes until the `r_mapUploadBudget` runs out. */
+			void UploadMeshes();
+			/** Starts meshing the out-of-date chunks, nearest first. */
+			void ScheduleMeshing();
+
+			/** Rebuilds `visibleChunks` unless it is up to date for the
+			 * current view. */
+			void UpdateVisibleChunks();
+			void AddVisibleColumn(int cx, int cy, int cz, const Vector3& eye,
+			                      bool occlusionCulling);
 
 			void RenderBackface();
 
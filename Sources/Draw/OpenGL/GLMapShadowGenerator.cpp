@@ -0,0 +1,256 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <atomic>
+
+#include "../SW/SWFeatureLevel.h" // for ENABLE_SSE2
+#include "GLMapShadowGenerator.h"
+#include <Client/GameMap.h>
+#include <Core/BitOps.h>
+#include <Core/Debug.h>
+#include <Core/Parallel.h>
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	namespace draw {
+		namespace {
+			/** The bottom layer (z = 63) never casts a shadow. */
+			const uint64_t ShadowCasterMask = ~(1ULL << 63);
+
+			uint32_t BuildPixel(int distance, uint32_t color, bool side) {
+				int r = (uint8_t)(color);
+				int g = (uint8_t)(color >> 8);
+				int b = (uint8_t)(color >> 16);
+
+				r >>= 2;
+				g >>= 2;
+				b >>= 2;
+
+				int ex1 = side ? 1 : 0, ex2 = 0, ex3 = 0;
+
+				return r + (g << 8) + (b << 16) + (distance << 24) + (ex1 << 7) + (ex2 << 15) +
+				       (ex3 << 23);
+			}
+
+			/**
+			 * `columns[i] = (columns[i] & ~mask) | (columns[i + step] & mask)`
+			 * for `i` in `[0, count)`. Done in place; every element is read
+			 * before it is overwritten.
+			 */
+			void SelectBits(uint64_t* columns, std::size_t count, std::size_t step,
+			                uint64_t mask) {
+				std::size_t i = 0;
+#if ENABLE_SSE2
+				const __m128i maskV = _mm_set1_epi64x(static_cast<long long>(mask));
+				for (; i + 2 <= count; i += 2) {
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + i));
+					__m128i b =
+					  _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + i + step));
+					a = _mm_or_si128(_mm_andnot_si128(maskV, a), _mm_and_si128(maskV, b));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(columns + i), a);
+				}
+#endif
+				for (; i < count; i++)
+					columns[i] = (columns[i] & ~mask) | (columns[i + step] & mask);
+			}
+		} // namespace
+
+		GLMapShadowGenerator::GLMapShadowGenerator(const client::GameMap& map)
+		    : map(map), w(map.Width()), h(map.Height()) {
+			// rays are wrapped with masks
+			SPAssert((h & (h - 1)) == 0);
+			SPAssert(map.Depth() == 64);
+		}
+
+		uint32_t GLMapShadowGenerator::GeneratePixelReference(int x, int y) const {
+			const int d = map.Depth();
+			for (int z = 0; z < d; z++) {
+				// z-plane hit
+				if (map.IsSolid(x, y, z) && z < 63) {
+					return BuildPixel(z, map.GetColor(x, y, z), false);
+				}
+
+				y = y + 1;
+				if (y == h)
+					y = 0;
+
+				// y-plane hit
+				if (map.IsSolid(x, y, z) && z < 63) {
+					return BuildPixel(z + 1, map.GetColor(x, y, z), true);
+				}
+			}
+			return BuildPixel(64, map.GetColor(x, y == h ? 0 : y, 63), false);
+		}
+
+		uint32_t GLMapShadowGenerator::GeneratePixel(int x, int y) const {
+			const int yMask = h - 1;
+
+			// the ray enters the column `y + z` through its top face at `z`,
+			// and leaves it through its +Y face into the next column
+			uint64_t column = map.GetSolidMap(x, y) & ShadowCasterMask;
+			for (int z = 0; z < 63; z++) {
+				if ((column >> z) & 1)
+					return BuildPixel(z, map.GetColor(x, (y + z) & yMask, z), false);
+
+				int nextY = (y + z + 1) & yMask;
+				column = map.GetSolidMap(x, nextY) & ShadowCasterMask;
+				if ((column >> z) & 1)
+					return BuildPixel(z + 1, map.GetColor(x, nextY, z), true);
+			}
+			return BuildPixel(64, map.GetColor(x, (y + 64) & yMask, 63), false);
+		}
+
+		void GLMapShadowGenerator::GenerateColumn(int x, uint32_t* out, int pitch,
+		                                          std::vector<uint64_t>& scratch) const {
+			const int yMask = h - 1;
+
+			// After the skew, bit `z` of `skewed[y]` is bit `z` of the solid
+			// map column `y + z`: the voxels hit by the top faces along the
+			// ray of the pixel `y`. `skewed[y + 1]` has the voxels hit by
+			// the +Y faces.
+			//
+			// Each step `m` takes the bits whose bit `m` of `z` is set from
+			// `2^m` columns further.
+			static const uint64_t masks[] = {0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL,
+			                                 0xF0F0F0F0F0F0F0F0ULL, 0xFF00FF00FF00FF00ULL,
+			                                 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL};
+			std::size_t count = static_cast<std::size_t>(h) + 64;
+			scratch.resize(count);
+			uint64_t* skewed = scratch.data();
+			for (std::size_t i = 0; i < count; i++)
+				skewed[i] = map.GetSolidMap(x, static_cast<int>(i) & yMask);
+			for (int m = 0; m < 6; m++) {
+				std::size_t step = std::size_t(1) << m;
+				count -= step;
+				SelectBits(skewed, count, step, masks[m]);
+			}
+
+			for (int y = 0; y < h; y++) {
+				uint64_t top = skewed[y] & ShadowCasterMask;
+				uint64_t side = skewed[y + 1] & ShadowCasterMask;
+				uint32_t pixel;
+				if ((top | side) == 0) {
+					pixel = BuildPixel(64, map.GetColor(x, (y + 64) & yMask, 63), false);
+				} else {
+					int topZ = top ? FindFirstSet(top) : 64;
+					int sideZ = side ? FindFirstSet(side) : 64;
+					if (topZ <= sideZ)
+						pixel = BuildPixel(topZ, map.GetColor(x, (y + topZ) & yMask, topZ), false);
+					else
+						pixel = BuildPixel(sideZ + 1,
+						                   map.GetColor(x, (y + sideZ + 1) & yMask, sideZ), true);
+				}
+				out[static_cast<std::size_t>(y) * pitch] = pixel;
+			}
+		}
+
+		void GLMapShadowGenerator::Generate(uint32_t* bitmap) const {
+			SPADES_MARK_FUNCTION();
+
+			std::atomic<int> nextColumn{0};
+			InvokeParallel([&](unsigned int) {
+				std::vector<uint64_t> scratch;
+				int x;
+				while ((x = nextColumn.fetch_add(1)) < w)
+					GenerateColumn(x, bitmap + x, w, scratch);
+			});
+		}
+
+		void GLMapShadowGenerator::Benchmark(const client::GameMap& map) {
+			SPADES_MARK_FUNCTION();
+
+			GLMapShadowGenerator generator{map};
+			const int w = map.Width(), h = map.Height();
+			unsigned int numThreads = GetNumHardwareThreads();
+
+			SPLog("Terrain shadow map benchmark: %dx%d pixels", w, h);
+
+			std::vector<uint32_t> reference(static_cast<std::size_t>(w) * h);
+			std::vector<uint32_t> bitmap(reference.size());
+
+			Stopwatch sw;
+			for (int y = 0; y < h; y++)
+				for (int x = 0; x < w; x++)
+					reference[x + y * w] = generator.GeneratePixelReference(x, y);
+			double referenceTime = sw.GetTime();
+
+			sw.Reset();
+			for (int y = 0; y < h; y++)
+				for (int x = 0; x < w; x++)
+					bitmap[x + y * w] = generator.GeneratePixel(x, y);
+			double pixelTime = sw.GetTime();
+			bool pixelMatches = bitmap == reference;
+
+			sw.Reset();
+			std::vector<uint64_t> scratch;
+			for (int x = 0; x < w; x++)
+				generator.GenerateColumn(x, bitmap.data() + x, w, scratch);
+			double columnTime = sw.GetTime();
+			bool columnMatches = bitmap == reference;
+
+			sw.Reset();
+			generator.Generate(bitmap.data());
+			double parallelTime = sw.GetTime();
+
+			SPLog("  map load:");
+			SPLog("    voxel walk: %.2f ms", referenceTime * 1000.0);
+			SPLog("    column walk: %.2f ms (%.2fx)%s", pixelTime * 1000.0,
+			      referenceTime / std::max(pixelTime, 1.0e-9),
+			      pixelMatches ? "" : " MISMATCH");
+			SPLog("    skewed columns: %.2f ms (%.2fx)%s", columnTime * 1000.0,
+			      referenceTime / std::max(columnTime, 1.0e-9),
+			      columnMatches ? "" : " MISMATCH");
+			SPLog("    skewed columns, parallel (%u threads): %.2f ms (%.2fx)", numThreads,
+			      parallelTime * 1000.0, referenceTime / std::max(parallelTime, 1.0e-9));
+
+			// a block edit at (x, y, z) updates the pixels (x, y - z) and
+			// (x, y - z - 1)
+			const int numEdits = 65536;
+			std::vector<int> editX(numEdits), editY(numEdits);
+			for (int i = 0; i < numEdits; i++) {
+				int z = SampleRandomInt(0, 62);
+				editX[i] = SampleRandomInt(0, w - 1);
+				editY[i] = (SampleRandomInt(0, h - 1) - z) & (h - 1);
+			}
+
+			uint32_t sum = 0;
+			sw.Reset();
+			for (int i = 0; i < numEdits; i++) {
+				sum += generator.GeneratePixelReference(editX[i], editY[i]);
+				sum += generator.GeneratePixelReference(editX[i], (editY[i] - 1) & (h - 1));
+			}
+			double editReferenceTime = sw.GetTime();
+
+			sw.Reset();
+			for (int i = 0; i < numEdits; i++) {
+				sum -= generator.GeneratePixel(editX[i], editY[i]);
+				sum -= generator.GeneratePixel(editX[i], (editY[i] - 1) & (h - 1));
+			}
+			double editTime = sw.GetTime();
+
+			SPLog("  block edit:");
+			SPLog("    voxel walk: %.3f us", editReferenceTime * 1.0e6 / numEdits);
+			SPLog("    column walk: %.3f us (%.2fx)%s", editTime * 1.0e6 / numEdits,
+			      editReferenceTime / std::max(editTime, 1.0e-9), sum ? " MISMATCH" : "");
+		}
+	} // namespace draw
+} // namespace spades
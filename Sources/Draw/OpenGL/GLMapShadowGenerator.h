@@ -0,0 +1,70 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace spades {
+	namespace client {
+		class GameMap;
+	}
+	namespace draw {
+		/**
+		 * Computes the pixels of the terrain shadow map: for every pixel, the
+		 * first voxel face hit by a ray going diagonally (+Y, +Z) from the top
+		 * of the map, with its color and depth. `Generate` spreads the
+		 * columns over all cores.
+		 */
+		class GLMapShadowGenerator {
+			const client::GameMap& map;
+			int w, h;
+
+		public:
+			GLMapShadowGenerator(const client::GameMap&);
+
+			/** Computes a single pixel, reading the solid map columns of the
+			 * ray directly. Used for incremental updates. */
+			uint32_t GeneratePixel(int x, int y) const;
+
+			/** Computes a single pixel one voxel at a time. */
+			uint32_t GeneratePixelReference(int x, int y) const;
+
+			/**
+			 * Computes all pixels of the column `x` at once. The solid map
+			 * columns are skewed with bit operations so that the voxels of a
+			 * ray end up in a single word.
+			 * @param out The pixel `(x, y)` is written to `out[y * pitch]`.
+			 * @param scratch A buffer reused between calls.
+			 */
+			void GenerateColumn(int x, uint32_t* out, int pitch,
+			                    std::vector<uint64_t>& scratch) const;
+
+			/** Computes the whole `w` x `h` shadow map using all cores. */
+			void Generate(uint32_t* bitmap) const;
+
+			/** Logs the time to generate the whole shadow map and to update
+			 * the pixels of a block edit with each method. */
+			static void Benchmark(const client::GameMap&);
+		};
+	} // namespace draw
+} // namespace spades
@@ -18,6 +18,8 @@
 
  */
 
+#include <algorithm>
+
 #include "GLMapShadowRenderer.h"
 #include "GLProfiler.h"
 #include "GLRadiosityRenderer.h"
@@ -25,17 +27,42 @@
 #include "IGLDevice.h"
 #include <Client/GameMap.h>
 #include <Core/Debug.h>
+#include <Core/Stopwatch.h>
 
 namespace spades {
 	namespace draw {
 		GLMapShadowRenderer::GLMapShadowRenderer(GLRenderer &renderer, client::GameMap *map)
-		    : renderer(renderer), device(renderer.GetGLDevice()), map(map) {
+		    : renderer(renderer), device(renderer.GetGLDevice()), map(map), generator(*map) {
 			SPADES_MARK_FUNCTION();
+
+			w = map->Width();
+			h = map->Height();
+			d = map->Depth();
+
+			if (renderer.GetSettings().r_mapShadowBenchmark)
+				GLMapShadowGenerator::Benchmark(*map);
+
+			updateBitmapPitch = (w + 31) / 32;
+			updateBitmap.resize(updateBitmapPitch * h);
+			rowDirty.resize(h);
+
+			coarseBitmap.resize((w * h) >> (CoarseBits * 2));
+			coarsePixelDirty.resize(coarseBitmap.size());
+
+			{
+				Stopwatch sw;
+				bitmap.resize(w * h);
+				generator.Generate(bitmap.data());
+				for (int i = 0; i < static_cast<int>(coarseBitmap.size()); i++)
+					UpdateCoarsePixel(i);
+				SPLog("Terrain shadow map generated in %.2f ms", sw.GetTime() * 1000.0);
+			}
+
 			texture = device.GenTexture();
 			coarseTexture = device.GenTexture();
 			device.BindTexture(IGLDevice::Texture2D, texture);
 			device.TexImage2D(IGLDevice::Texture2D, 0, IGLDevice::RGBA, map->Width(), map->Height(),
-			                  0, IGLDevice::RGBA, IGLDevice::UnsignedByte, NULL);
+			                  0, IGLDevice::RGBA, IGLDevice::UnsignedByte, bitmap.data());
 			device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureMagFilter,
 			                    IGLDevice::Nearest);
 			device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureMinFilter,
@@ -46,26 +73,13 @@ namespace spades {
 			device.BindTexture(IGLDevice::Texture2D, coarseTexture);
 			device.TexImage2D(IGLDevice::Texture2D, 0, IGLDevice::RGBA8, map->Width() / CoarseSize,
 			                  map->Height() / CoarseSize, 0, IGLDevice::BGRA,
-			                  IGLDevice::UnsignedByte, NULL);
+			                  IGLDevice::UnsignedByte, coarseBitmap.data());
 			device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureMagFilter,
 			                    IGLDevice::Nearest);
 			device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureMinFilter,
 			                    IGLDevice::Nearest);
 			device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureWrapS, IGLDevice::Repeat);
 			device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureWrapT, IGLDevice::Repeat);
-
-			w = map->Width();
-			h = map->Height();
-			d = map->Depth();
-
-			updateBitmapPitch = (w + 31) / 32;
-			updateBitmap.resize(updateBitmapPitch * h);
-
-			coarseBitmap.resize((w * h) >> (CoarseBits * 2));
-
-			bitmap.resize(w * h);
-			std::fill(updateBitmap.begin(), updateBitmap.end(), 0xffffffffUL);
-			std::fill(bitmap.begin(), bitmap.end(), 0xffffffffUL);
 		}
 
 		GLMapShadowRenderer::~GLMapShadowRenderer() {
@@ -81,146 +95,117 @@ namespace spades {
 			GLProfiler::Context profiler(renderer.GetGLProfiler(), "Terrain Shadow Map");
 			GLRadiosityRenderer *radiosity = renderer.GetRadiosityRenderer();
 
-			std::vector<uint8_t> coarseUpdateBitmap;
-			coarseUpdateBitmap.resize(coarseBitmap.size());
-			std::fill(coarseUpdateBitmap.begin(), coarseUpdateBitmap.end(), 0);
+			if (!dirtyRows.empty())
+				device.BindTexture(IGLDevice::Texture2D, texture);
+
+			for (int y : dirtyRows) {
+				rowDirty[y] = 0;
+
+				uint32_t *words = updateBitmap.data() + y * updateBitmapPitch;
+				for (size_t i = 0; i < updateBitmapPitch; i++) {
+					uint32_t word = words[i];
+					if (word == 0)
+						continue;
+					words[i] = 0;
+
+					int x = static_cast<int>(i * 32);
+					uint32_t *pixels = bitmap.data() + x + y * w;
+					int minModified = 32, maxModified = -1;
+					for (int j = 0; j < 32; j++) {
+						if (!((word >> j) & 1))
+							continue;
+
+						uint32_t pixel = generator.GeneratePixel(x + j, y);
+						if (pixels[j] == pixel)
+							continue;
 
-			device.BindTexture(IGLDevice::Texture2D, texture);
-			for (size_t i = 0; i < updateBitmap.size(); i++) {
-				int y = static_cast<int>(i / updateBitmapPitch);
-				int x = static_cast<int>((i - y * updateBitmapPitch) * 32);
-				if (updateBitmap[i] == 0)
-					continue;
-
-				size_t bitmapPixelPosBase = i * 32;
-
-				uint32_t pixels[32];
-				bool modified = false;
-				for (int j = 0; j < 32; j++) {
-					pixels[j] = GeneratePixel(x + j, y);
-					if (bitmap[bitmapPixelPosBase + j] != pixels[j]) {
 						if (radiosity) {
-							int dist = pixels[j] >> 24;
+							int dist = pixel >> 24;
 							radiosity->GameMapChanged(x + j, (y + dist) & (h - 1), dist, map);
 
-							dist = bitmap[bitmapPixelPosBase + j] >> 24;
+							dist = pixels[j] >> 24;
 							radiosity->GameMapChanged(x + j, (y + dist) & (h - 1), dist, map);
 						}
-						bitmap[bitmapPixelPosBase + j] = pixels[j];
-						modified = true;
+						pixels[j] = pixel;
+						minModified = std::min(minModified, j);
+						maxModified = j;
 					}
-				}
-
-				if (modified) {
-					if (!coarseUpdateBitmap[(x >> CoarseBits) +
-					                        (y >> CoarseBits) * (w >> CoarseBits)])
-						for (int j = 0; j < 32; j += CoarseSize)
-							coarseUpdateBitmap[((x + j) >> CoarseBits) +
-							                   (y >> CoarseBits) * (w >> CoarseBits)] = 1;
-
-					device.TexSubImage2D(IGLDevice::Texture2D, 0, x, y, 32, 1, IGLDevice::RGBA,
-					                     IGLDevice::UnsignedByte, pixels);
-				}
-
-				updateBitmap[i] = 0;
-			}
 
-			{
-				bool coarseUpdated = false;
-				int bx = 0, by = 0;
-				for (size_t i = 0; i < coarseUpdateBitmap.size(); i++) {
-					if (coarseUpdateBitmap[i]) {
-						int minValue = -1, maxValue = 0;
-
-						uint32_t *bmp = bitmap.data();
-						bmp += bx + by * w;
-						for (int y = 0; y < CoarseSize; y++) {
-							for (int x = 0; x < CoarseSize; x++) {
-								uint32_t value = bmp[x];
-								int depth = (int)(value >> 24);
-								if (minValue == -1) {
-									minValue = maxValue = depth;
-								} else {
-									if (depth < minValue)
-										minValue = depth;
-									if (depth > maxValue)
-										maxValue = depth;
-								}
-							}
-							bmp += w;
-						}
+					if (maxModified < 0)
+						continue;
 
-						uint32_t out = minValue << 16;
-						out |= maxValue << 8;
-						coarseBitmap[i] = out;
+					for (int j = minModified & ~(CoarseSize - 1); j <= maxModified; j += CoarseSize)
+						MarkCoarseUpdate(x + j, y);
 
-						coarseUpdated = true;
-					}
-					bx += CoarseSize;
-					if (bx >= w) {
-						bx = 0;
-						by += CoarseSize;
-					}
-				}
-				if (coarseUpdated) {
-					GLProfiler::Context profiler(renderer.GetGLProfiler(),
-					                             "Coarse Shadow Map Upload");
-
-					device.BindTexture(IGLDevice::Texture2D, coarseTexture);
-					device.TexSubImage2D(IGLDevice::Texture2D, 0, 0, 0, w >> CoarseBits,
-					                     h >> CoarseBits, IGLDevice::BGRA, IGLDevice::UnsignedByte,
-					                     coarseBitmap.data());
+					device.TexSubImage2D(IGLDevice::Texture2D, 0, x + minModified, y,
+					                     maxModified - minModified + 1, 1, IGLDevice::RGBA,
+					                     IGLDevice::UnsignedByte, pixels + minModified);
 				}
 			}
-		}
+			dirtyRows.clear();
 
-		static uint32_t BuildPixel(int distance, uint32_t color, bool side) {
-			int r = (uint8_t)(color);
-			int g = (uint8_t)(color >> 8);
-			int b = (uint8_t)(color >> 16);
-
-			r >>= 2;
-			g >>= 2;
-			b >>= 2;
-
-			SPAssert(r < 64);
-			SPAssert(g < 64);
-			SPAssert(b < 64);
-			SPAssert(r >= 0);
-			SPAssert(g >= 0);
-			SPAssert(b >= 0);
+			if (!dirtyCoarsePixels.empty()) {
+				for (int i : dirtyCoarsePixels) {
+					coarsePixelDirty[i] = 0;
+					UpdateCoarsePixel(i);
+				}
+				dirtyCoarsePixels.clear();
 
-			int ex1 = side ? 1 : 0, ex2 = 0, ex3 = 0;
+				GLProfiler::Context profiler(renderer.GetGLProfiler(), "Coarse Shadow Map Upload");
 
-			return r + (g << 8) + (b << 16) + (distance << 24) + (ex1 << 7) + (ex2 << 15) +
-			       (ex3 << 23);
+				device.BindTexture(IGLDevice::Texture2D, coarseTexture);
+				device.TexSubImage2D(IGLDevice::Texture2D, 0, 0, 0, w >> CoarseBits,
+				                     h >> CoarseBits, IGLDevice::BGRA, IGLDevice::UnsignedByte,
+				                     coarseBitmap.data());
+			}
 		}
 
-		uint32_t GLMapShadowRenderer::GeneratePixel(int x, int y) {
-			for (int z = 0; z < d; z++) {
-				// z-plane hit
-				if (map->IsSolid(x, y, z) && z < 63) {
-					return BuildPixel(z, map->GetColor(x, y, z), false);
-					// return (uint8_t)z;
-				}
-
-				y = y + 1;
-				if (y == h)
-					y = 0;
-
-				// y-plane hit
-				if (map->IsSolid(x, y, z) && z < 63) {
-					return BuildPixel(z + 1, map->GetColor(x, y, z), true);
-					// return (uint8_t)z + 1;
+		void GLMapShadowRenderer::UpdateCoarsePixel(int index) {
+			int pitch = w >> CoarseBits;
+			int bx = (index % pitch) << CoarseBits;
+			int by = (index / pitch) << CoarseBits;
+
+			int minValue = -1, maxValue = 0;
+
+			const uint32_t *bmp = bitmap.data();
+			bmp += bx + by * w;
+			for (int y = 0; y < CoarseSize; y++) {
+				for (int x = 0; x < CoarseSize; x++) {
+					uint32_t value = bmp[x];
+					int depth = (int)(value >> 24);
+					if (minValue == -1) {
+						minValue = maxValue = depth;
+					} else {
+						if (depth < minValue)
+							minValue = depth;
+						if (depth > maxValue)
+							maxValue = depth;
+					}
 				}
+				bmp += w;
 			}
-			return BuildPixel(64, map->GetColor(x, y == h ? 0 : y, 63), false);
+
+			uint32_t out = minValue << 16;
+			out |= maxValue << 8;
+			coarseBitmap[index] = out;
 		}
 
 		void GLMapShadowRenderer::MarkUpdate(int x, int y) {
 			x &= w - 1;
 			y &= h - 1;
 			updateBitmap[(x >> 5) + y * updateBitmapPitch] |= 1UL << (x & 31);
+			if (!rowDirty[y]) {
+				rowDirty[y] = 1;
+				dirtyRows.push_back(y);
+			}
+		}
+
+		void GLMapShadowRenderer::MarkCoarseUpdate(int x, int y) {
+			int index = (x >> CoarseBits) + (y >> CoarseBits) * (w >> CoarseBits);
+			if (!coarsePixelDirty[index]) {
+				coarsePixelDirty[index] = 1;
+				dirtyCoarsePixels.push_back(index);
+			}
 		}
 
 		void GLMapShadowRenderer::GameMapChanged(int x, int y, int z, client::GameMap *m) {
@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <vector>
 
+#include "GLMapShadowGenerator.h"
 #include "IGLDevice.h"
 
 namespace spades {
@@ -46,14 +47,25 @@ namespace spades {
 
 			int w, h, d;
 
+			GLMapShadowGenerator generator;
+
+			/** One bit per pixel to regenerate. */
 			size_t updateBitmapPitch;
 			std::vector<uint32_t> updateBitmap;
+			/** The rows having bits set in `updateBitmap`, so that `Update`
+			 * does not have to scan the whole of it. */
+			std::vector<int> dirtyRows;
+			std::vector<uint8_t> rowDirty;
 
 			std::vector<uint32_t> bitmap;
 			std::vector<uint32_t> coarseBitmap;
+			/** The coarse pixels to recompute. */
+			std::vector<int> dirtyCoarsePixels;
+			std::vector<uint8_t> coarsePixelDirty;
 
-			uint32_t GeneratePixel(int x, int y);
 			void MarkUpdate(int x, int y);
+			void MarkCoarseUpdate(int x, int y);
+			void UpdateCoarsePixel(int index);
 
 		public:
 			GLMapShadowRenderer(GLRenderer& renderer, client::GameMap* map);
@@ -52,7 +52,14 @@ namespace spades {
 			: renderer{r}, device{r.GetGLDevice()} {
 			SPADES_MARK_FUNCTION();
 
-			BuildVertices(m);
+			m->BuildLevels();
+			for (int i = 0; i < m->GetNumLevels(); i++) {
+				Level level;
+				level.firstIndex = static_cast<unsigned int>(indices.size());
+				BuildVertices(&m->GetLevel(i));
+				level.numIndices = static_cast<unsigned int>(indices.size()) - level.firstIndex;
+				levels.push_back(level);
+			}
 			GenerateTexture();
 
 			if (r.GetSettings().r_physicalLighting)
@@ -98,8 +105,14 @@ namespace spades {
 			boundingBox.min = minPos;
 			boundingBox.max = maxPos;
 
+			// a voxel of level `i` covers `2^i` voxels starting at the same corner
+			for (std::size_t i = 0; i < levels.size(); i++) {
+				float scale = static_cast<float>(1 << i);
+				levels[i].matrix =
+				  Matrix4::Translate(origin * (1.0F - scale)) * Matrix4::Scale(scale);
+			}
+
 			// clean up
-			numIndices = (unsigned int)indices.size();
 			std::vector<Vertex>().swap(vertices);
 			std::vector<uint32_t>().swap(indices);
 		}
@@ -148,7 +161,7 @@ namespace spades {
 			image = renderer.CreateImage(*bmp).Cast<GLImage>();
 		}
 
-		uint8_t GLOptimizedVoxelModel::calcAOID(VoxelModel* m, int x, int y, int z, int ux, int uy,
+		uint8_t GLOptimizedVoxelModel::calcAOID(const VoxelModel* m, int x, int y, int z, int ux, int uy,
 												int uz, int vx, int vy, int vz) {
 			int v = 0;
 			if (m->IsSolid(x - ux, y - uy, z - uz))
@@ -237,7 +250,7 @@ namespace spades {
 		void GLOptimizedVoxelModel::EmitSlice(uint8_t* slice, int usize, int vsize, int sx, int sy,
 											  int sz, int ux, int uy, int uz, int vx, int vy,
 											  int vz, int mx, int my, int mz, bool flip,
-											  VoxelModel* model) {
+											  const VoxelModel* model) {
 			SPADES_MARK_FUNCTION();
 			int minU = -1, minV = -1, maxU = -1, maxV = -1;
 
@@ -427,12 +440,9 @@ namespace spades {
 			}
 		}
 
-		void GLOptimizedVoxelModel::BuildVertices(spades::VoxelModel* model) {
+		void GLOptimizedVoxelModel::BuildVertices(const VoxelModel* model) {
 			SPADES_MARK_FUNCTION();
 
-			SPAssert(vertices.empty());
-			SPAssert(indices.empty());
-
 			int w = model->GetWidth();
 			int h = model->GetHeight();
 			int d = model->GetDepth();
@@ -523,6 +533,29 @@ namespace spades {
 			printf("%d vertices emit\n", (int)indices.size());
 		}
 
+		const GLOptimizedVoxelModel::Level&
+		GLOptimizedVoxelModel::SelectLevel(const client::ModelRenderParam& param) {
+			if (levels.size() == 1 || param.depthHack || !renderer.GetSettings().r_modelLod)
+				return levels[0];
+
+			const auto& sceneDef = renderer.GetSceneDef();
+			const auto& modelMatrix = param.matrix;
+			float depth = Vector3::Dot(modelMatrix.GetOrigin() - sceneDef.viewOrigin,
+			                           sceneDef.viewAxis[2]);
+			if (depth <= sceneDef.zNear)
+				return levels[0];
+
+			float pixelsPerUnit =
+			  renderer.GetRenderHeight() / (2.0F * tanf(sceneDef.fovY * 0.5F) * depth);
+			float voxelPixels = modelMatrix.GetAxis(0).GetLength() * pixelsPerUnit;
+			int lod = 0;
+			while (lod + 1 < static_cast<int>(levels.size()) && voxelPixels * 2.0F <= 1.0F) {
+				voxelPixels *= 2.0F;
+				lod++;
+			}
+			return levels[lod];
+		}
+
 		void GLOptimizedVoxelModel::Prerender(
 			std::vector<client::ModelRenderParam> params, bool ghostPass) {
 			SPADES_MARK_FUNCTION();
@@ -581,16 +614,20 @@ namespace spades {
 				if (!renderer.GetShadowMapRenderer()->SphereCull(modelOrigin, rad))
 					continue;
 
+				const Level& level = SelectLevel(param);
+				Matrix4 levelMatrix = modelMatrix * level.matrix;
+
 				static GLProgramUniform modelMatrixU("modelMatrix");
 				modelMatrixU(shadowMapProgram);
-				modelMatrixU.SetValue(modelMatrix);
+				modelMatrixU.SetValue(levelMatrix);
 
 				bool isMirrored = Vector3::Dot(Vector3::Cross(axisX, axisY), axisZ) < 0.0F;
 				if (isMirrored)
 					device.FrontFace(IGLDevice::CCW);
 
 				device.DrawElements(IGLDevice::Triangles,
-					numIndices, IGLDevice::UnsignedInt, (void*)0);
+					level.numIndices, IGLDevice::UnsignedInt,
+					(void*)(level.firstIndex * sizeof(uint32_t)));
 
 				if (isMirrored)
 					device.FrontFace(IGLDevice::CW);
@@ -721,21 +758,24 @@ namespace spades {
 				if (!renderer.SphereFrustrumCull(modelOrigin, rad))
 					continue;
 
+				const Level& level = SelectLevel(param);
+				Matrix4 levelMatrix = modelMatrix * level.matrix;
+
 				static GLProgramUniform customColor("customColor");
 				customColor(program);
 				customColor.SetValue(param.customColor.x, param.customColor.y, param.customColor.z);
 
 				static GLProgramUniform projectionViewModelMatrix("projectionViewModelMatrix");
 				projectionViewModelMatrix(program);
-				projectionViewModelMatrix.SetValue(pvMat * modelMatrix);
+				projectionViewModelMatrix.SetValue(pvMat * levelMatrix);
 
 				static GLProgramUniform viewModelMatrix("viewModelMatrix");
 				viewModelMatrix(program);
-				viewModelMatrix.SetValue(viewMatrix * modelMatrix);
+				viewModelMatrix.SetValue(viewMatrix * levelMatrix);
 
 				static GLProgramUniform modelMatrixU("modelMatrix");
 				modelMatrixU(program);
-				modelMatrixU.SetValue(modelMatrix);
+				modelMatrixU.SetValue(levelMatrix);
 
 				static GLProgramUniform modelOpacity("modelOpacity");
 				modelOpacity(program);
@@ -749,7 +789,8 @@ namespace spades {
 					device.DepthRange(0.0F, 0.1F);
 
 				device.DrawElements(IGLDevice::Triangles,
-					numIndices, IGLDevice::UnsignedInt, (void*)0);
+					level.numIndices, IGLDevice::UnsignedInt,
+					(void*)(level.firstIndex * sizeof(uint32_t)));
 
 				if (isMirrored)
 					device.FrontFace(IGLDevice::CW);
@@ -859,21 +900,24 @@ namespace spades {
 				if (!renderer.SphereFrustrumCull(modelOrigin, rad))
 					continue;
 
+				const Level& level = SelectLevel(param);
+				Matrix4 levelMatrix = modelMatrix * level.matrix;
+
 				static GLProgramUniform customColor("customColor");
 				customColor(dlightProgram);
 				customColor.SetValue(param.customColor.x, param.customColor.y, param.customColor.z);
 
 				static GLProgramUniform projectionViewModelMatrix("projectionViewModelMatrix");
 				projectionViewModelMatrix(dlightProgram);
-				projectionViewModelMatrix.SetValue(pvMat * modelMatrix);
+				projectionViewModelMatrix.SetValue(pvMat * levelMatrix);
 
 				static GLProgramUniform viewModelMatrix("viewModelMatrix");
 				viewModelMatrix(dlightProgram);
-				viewModelMatrix.SetValue(viewMatrix * modelMatrix);
+				viewModelMatrix.SetValue(viewMatrix * levelMatrix);
 
 				static GLProgramUniform modelMatrixU("modelMatrix");
 				modelMatrixU(dlightProgram);
-				modelMatrixU.SetValue(modelMatrix);
+				modelMatrixU.SetValue(levelMatrix);
 
 				bool isMirrored = Vector3::Dot(Vector3::Cross(axisX, axisY), axisZ) < 0.0F;
 				if (isMirrored)
@@ -888,7 +932,8 @@ namespace spades {
 
 					dlightShader(&renderer, dlightProgram, light, 2);
 					device.DrawElements(IGLDevice::Triangles,
-						numIndices, IGLDevice::UnsignedInt, (void*)0);
+						level.numIndices, IGLDevice::UnsignedInt,
+						(void*)(level.firstIndex * sizeof(uint32_t)));
 				}
 
 				if (isMirrored)
@@ -981,13 +1026,16 @@ namespace spades {
 				if (!renderer.SphereFrustrumCull(modelOrigin, rad))
 					continue;
 
+				const Level& level = SelectLevel(param);
+				Matrix4 levelMatrix = modelMatrix * level.matrix;
+
 				static GLProgramUniform projectionViewModelMatrix("projectionViewModelMatrix");
 				projectionViewModelMatrix(outlinesProgram);
-				projectionViewModelMatrix.SetValue(pvMat * modelMatrix);
+				projectionViewModelMatrix.SetValue(pvMat * levelMatrix);
 
 				static GLProgramUniform modelMatrixU("modelMatrix");
 				modelMatrixU(outlinesProgram);
-				modelMatrixU.SetValue(modelMatrix);
+				modelMatrixU.SetValue(levelMatrix);
 
 				bool isMirrored = Vector3::Dot(Vector3::Cross(axisX, axisY), axisZ) < 0.0F;
 				if (isMirrored)
@@ -997,7 +1045,8 @@ namespace spades {
 					device.DepthRange(0.0F, 0.1F);
 
 				device.DrawElements(IGLDevice::Triangles,
-					numIndices, IGLDevice::UnsignedInt, (void*)0);
+					level.numIndices, IGLDevice::UnsignedInt,
+					(void*)(level.firstIndex * sizeof(uint32_t)));
 
 				if (isMirrored)
 					device.FrontFace(IGLDevice::CW);
@@ -63,7 +63,15 @@ namespace spades {
 			std::vector<uint32_t> indices;
 			std::vector<uint16_t> bmpIndex; // bmp id for vertex (not index)
 			std::vector<Bitmap*> bmps;
-			unsigned int numIndices;
+
+			/** A level of detail of the model (`VoxelModel::GetLevel`). */
+			struct Level {
+				/** Range of `idxBuffer` */
+				unsigned int firstIndex, numIndices;
+				/** Maps the level's voxel coordinates to the model's. */
+				Matrix4 matrix;
+			};
+			std::vector<Level> levels;
 
 			Vector3 origin;
 			float radius;
@@ -71,15 +79,18 @@ namespace spades {
 
 			AABB3 boundingBox;
 
-			uint8_t calcAOID(VoxelModel*, int x, int y, int z,
+			uint8_t calcAOID(const VoxelModel*, int x, int y, int z,
 				int ux, int uy, int uz, int vx, int vy, int vz);
 			// v major
 			void EmitSlice(uint8_t* slice, int usize, int vsize, int sx, int sy, int sz, int ux,
 			               int uy, int uz, int vx, int vy, int vz, int mx, int my, int mz,
-			               bool flip, VoxelModel*);
-			void BuildVertices(VoxelModel*);
+			               bool flip, const VoxelModel*);
+			void BuildVertices(const VoxelModel*);
 			void GenerateTexture();
 
+			/** Chooses the level of detail from the projected size of the voxels. */
+			const Level& SelectLevel(const client::ModelRenderParam&);
+
 		protected:
 			~GLOptimizedVoxelModel();
 
@@ -0,0 +1,475 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "../SW/SWFeatureLevel.h" // for ENABLE_SSE2
+#include "GLRadiosityEvaluator.h"
+#include <Core/Debug.h>
+#include <Core/Parallel.h>
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	namespace draw {
+		GLRadiosityEvaluator::GLRadiosityEvaluator(const uint32_t* bitmap, int w, int h,
+		                                           bool highPrecision)
+		    : bitmap(bitmap), w(w), h(h), highPrecision(highPrecision) {
+			SPAssert(bitmap);
+			// the envelope is wrapped with masks
+			SPAssert((w & (w - 1)) == 0);
+			SPAssert((h & (h - 1)) == 0);
+		}
+
+		GLRadiosityEvaluator::Result
+		GLRadiosityEvaluator::EvaluateReference(IntVector3 ipos) const {
+			SPADES_MARK_FUNCTION_DEBUG();
+
+			Result result;
+			result.base = MakeVector3(0, 0, 0);
+			result.x = MakeVector3(0, 0, 0);
+			result.y = MakeVector3(0, 0, 0);
+			result.z = MakeVector3(0, 0, 0);
+
+			Vector3 pos = MakeVector3(ipos) + 0.5F;
+
+			int centerX = ipos.x;
+			int centerY = ipos.y - ipos.z;
+			const int yMask = h - 1;
+			const int pitch = w;
+
+			for (int x = -Envelope; x <= Envelope; x++) {
+				const uint32_t* column = bitmap + ((centerX + x) & (w - 1));
+				for (int y = -Envelope; y <= Envelope; y++) {
+					uint32_t pixel = column[pitch * ((centerY + y) & yMask)];
+					int depth = pixel >> 24;
+
+					// shadowmap pixel's world coord
+					int wx = centerX + x;
+					int wy = centerY + y + depth;
+					int wz = depth;
+
+					// if true, this is negative-y faced plane
+					// if false, this is negative-z faced plane
+					bool isSide = (pixel & 0x80) != 0;
+
+					// direction dependent process
+					Vector3 center; // center of face
+					Vector3 diff;   // pos - center
+					float diffDot;  // dot(diff, normal)
+					if (isSide) {
+						// normal cull
+						if (wy <= ipos.y)
+							continue;
+
+						center.x = wx + 0.5F;
+						center.y = (float)wy;
+						center.z = wz - 0.5F;
+
+						diff = pos - center;
+						diffDot = -diff.y;
+					} else {
+						if (wz <= ipos.z)
+							continue;
+
+						center.x = wx + 0.5F;
+						center.y = wy + 0.5F;
+						center.z = (float)wz;
+
+						diff = pos - center;
+						diffDot = -diff.z;
+					}
+
+					SPAssert(diffDot >= 0.0F);
+
+					float diffLen = diff.GetLength();
+					float invDiffLen = 1.0F / diffLen;
+					float invDiffLenSmooth = 1.0F / ((diffLen) + 0.4F);
+
+					// fall-off because of direciton
+					float intensity = diffDot * invDiffLen;
+
+					// 1/(r^2) distance fall-off
+					intensity *= invDiffLenSmooth;
+					intensity *= invDiffLenSmooth;
+
+					// normalize
+					Vector3 normDiff = diff * -invDiffLen;
+
+					// extract shadowmap color
+					float red = static_cast<float>((pixel) & 0x3F);
+					float green = static_cast<float>((pixel >> 8) & 0x3F);
+					float blue = static_cast<float>((pixel >> 16) & 0x3F);
+
+					Vector3 color = {red, green, blue};
+					color *= intensity;
+
+					// add to result
+					result.base += color;
+					result.x += color * normDiff.x;
+					result.y += color * normDiff.y;
+					result.z += color * normDiff.z;
+
+					SPAssert(!std::isnan(intensity));
+					SPAssert(intensity >= 0.0F);
+				}
+			}
+
+			float scale = 0.1F / 64.0F;
+			result.base *= scale;
+			result.x *= scale;
+			result.y *= scale;
+			result.z *= scale;
+
+			return result;
+		}
+
+#if ENABLE_SSE2
+		namespace {
+			inline float HorizontalSum(__m128 v) {
+				v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+				v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+				return _mm_cvtss_f32(v);
+			}
+		} // namespace
+
+		GLRadiosityEvaluator::Result GLRadiosityEvaluator::Evaluate(IntVector3 ipos) const {
+			SPADES_MARK_FUNCTION_DEBUG();
+
+			// A row of the envelope is processed as 4 groups of 4 shadow map
+			// pixels; the last group only has one pixel in the envelope.
+			//
+			// In the voxel's coordinates, a pixel at (`xo`, `yo`) of the
+			// envelope with `depth` and `s` = 0.5 for a side face (0 otherwise):
+			//   diff = (-xo, ipos.z - yo - depth + s, ipos.z + 0.5 + s - depth)
+			//   diffDot = side ? -diff.y : -diff.z
+			// and the face is facing the voxel iff `diffDot > 0`.
+			enum { NumGroups = 4, RowSize = NumGroups * 4 };
+
+			const int centerX = ipos.x;
+			const int centerY = ipos.y - ipos.z;
+			const int xMask = w - 1;
+			const int yMask = h - 1;
+			const bool contiguous = centerX - Envelope >= 0 && centerX - Envelope + RowSize <= w;
+
+			const __m128i colorMask = _mm_set1_epi32(0x3F);
+			const __m128i sideMask = _mm_set1_epi32(0x80);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 half = _mm_set1_ps(0.5F);
+			const __m128 smooth = _mm_set1_ps(0.4F);
+			const __m128 one = _mm_set1_ps(1.0F);
+			const __m128 posZ = _mm_set1_ps(static_cast<float>(ipos.z));
+
+			__m128 offsetX[NumGroups], laneValid[NumGroups];
+			for (int g = 0; g < NumGroups; g++) {
+				float base = static_cast<float>(g * 4 - Envelope);
+				__m128 xo = _mm_add_ps(_mm_set1_ps(base), _mm_setr_ps(0.0F, 1.0F, 2.0F, 3.0F));
+				offsetX[g] = _mm_sub_ps(zero, xo);
+				laneValid[g] =
+				  _mm_cmple_ps(xo, _mm_set1_ps(static_cast<float>(Envelope)));
+			}
+
+			__m128 baseR = zero, baseG = zero, baseB = zero;
+			__m128 xR = zero, xG = zero, xB = zero;
+			__m128 yR = zero, yG = zero, yB = zero;
+			__m128 zR = zero, zG = zero, zB = zero;
+
+			alignas(16) uint32_t rowPixels[RowSize];
+
+			for (int yo = -Envelope; yo <= Envelope; yo++) {
+				const uint32_t* row = bitmap + w * ((centerY + yo) & yMask);
+				const uint32_t* pixels;
+				if (contiguous) {
+					pixels = row + (centerX - Envelope);
+				} else {
+					for (int i = 0; i < RowSize; i++)
+						rowPixels[i] = row[(centerX - Envelope + i) & xMask];
+					pixels = rowPixels;
+				}
+
+				// ipos.z - yo
+				const __m128 rowY = _mm_set1_ps(static_cast<float>(ipos.z - yo));
+
+				for (int g = 0; g < NumGroups; g++) {
+					__m128i pixel =
+					  _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + g * 4));
+
+					__m128 depth = _mm_cvtepi32_ps(_mm_srli_epi32(pixel, 24));
+					__m128 side = _mm_castsi128_ps(
+					  _mm_cmpeq_epi32(_mm_and_si128(pixel, sideMask), sideMask));
+					__m128 s = _mm_and_ps(side, half);
+
+					__m128 dx = offsetX[g];
+					__m128 dy = _mm_add_ps(_mm_sub_ps(rowY, depth), s);
+					__m128 dz = _mm_sub_ps(_mm_add_ps(posZ, _mm_add_ps(half, s)), depth);
+
+					// -dot(diff, normal)
+					__m128 diffDot =
+					  _mm_sub_ps(zero, _mm_or_ps(_mm_and_ps(side, dy), _mm_andnot_ps(side, dz)));
+					__m128 valid = _mm_and_ps(laneValid[g], _mm_cmpgt_ps(diffDot, zero));
+					if (_mm_movemask_ps(valid) == 0)
+						continue;
+
+					__m128 lenSq =
+					  _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+					             _mm_mul_ps(dz, dz));
+					__m128 len = _mm_sqrt_ps(lenSq);
+					// the culled lanes may have a zero length
+					__m128 invLen = _mm_and_ps(valid, _mm_div_ps(one, _mm_max_ps(len, half)));
+					__m128 invLenSmooth = _mm_div_ps(one, _mm_add_ps(len, smooth));
+
+					__m128 intensity = _mm_mul_ps(diffDot, invLen);
+					intensity = _mm_mul_ps(intensity, _mm_mul_ps(invLenSmooth, invLenSmooth));
+
+					// normDiff = -diff / len
+					__m128 nx = _mm_sub_ps(zero, _mm_mul_ps(dx, invLen));
+					__m128 ny = _mm_sub_ps(zero, _mm_mul_ps(dy, invLen));
+					__m128 nz = _mm_sub_ps(zero, _mm_mul_ps(dz, invLen));
+
+					__m128 r = _mm_cvtepi32_ps(_mm_and_si128(pixel, colorMask));
+					__m128 gr =
+					  _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixel, 8), colorMask));
+					__m128 b =
+					  _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixel, 16), colorMask));
+					r = _mm_mul_ps(r, intensity);
+					gr = _mm_mul_ps(gr, intensity);
+					b = _mm_mul_ps(b, intensity);
+
+					baseR = _mm_add_ps(baseR, r);
+					baseG = _mm_add_ps(baseG, gr);
+					baseB = _mm_add_ps(baseB, b);
+					xR = _mm_add_ps(xR, _mm_mul_ps(r, nx));
+					xG = _mm_add_ps(xG, _mm_mul_ps(gr, nx));
+					xB = _mm_add_ps(xB, _mm_mul_ps(b, nx));
+					yR = _mm_add_ps(yR, _mm_mul_ps(r, ny));
+					yG = _mm_add_ps(yG, _mm_mul_ps(gr, ny));
+					yB = _mm_add_ps(yB, _mm_mul_ps(b, ny));
+					zR = _mm_add_ps(zR, _mm_mul_ps(r, nz));
+					zG = _mm_add_ps(zG, _mm_mul_ps(gr, nz));
+					zB = _mm_add_ps(zB, _mm_mul_ps(b, nz));
+				}
+			}
+
+			const float scale = 0.1F / 64.0F;
+			Result result;
+			result.base = MakeVector3(HorizontalSum(baseR), HorizontalSum(baseG),
+			                          HorizontalSum(baseB)) * scale;
+			result.x =
+			  MakeVector3(HorizontalSum(xR), HorizontalSum(xG), HorizontalSum(xB)) * scale;
+			result.y =
+			  MakeVector3(HorizontalSum(yR), HorizontalSum(yG), HorizontalSum(yB)) * scale;
+			result.z =
+			  MakeVector3(HorizontalSum(zR), HorizontalSum(zG), HorizontalSum(zB)) * scale;
+			return result;
+		}
+#else
+		GLRadiosityEvaluator::Result GLRadiosityEvaluator::Evaluate(IntVector3 ipos) const {
+			return EvaluateReference(ipos);
+		}
+#endif
+
+		float GLRadiosityEvaluator::CompressDynamicRange(float v) const {
+			if (highPrecision)
+				return v;
+			if (v >= 0.0F)
+				return sqrtf(v);
+			else
+				return -sqrtf(-v);
+		}
+
+		uint32_t GLRadiosityEvaluator::EncodeValue(Vector3 vec) const {
+			float v;
+			int iv;
+			unsigned int out = 0xC0000000;
+
+			vec.x = CompressDynamicRange(vec.x);
+			vec.y = CompressDynamicRange(vec.y);
+			vec.z = CompressDynamicRange(vec.z);
+
+			vec *= 0.5F;
+			vec += 0.5F;
+			vec *= 1022.0F / 1023.0F;
+
+			v = vec.x * 1023.0F + 0.5F;
+			if (v > 1023.2F)
+				v = 1023.2F;
+			if (v < 0.0F)
+				v = 0.0F;
+			iv = (unsigned int)v;
+			if (iv > 1023)
+				iv = 1023;
+			if (iv < 0)
+				iv = 0;
+			out |= iv << 20;
+
+			v = vec.y * 1023.0F + 0.5F;
+			if (v > 1023.2F)
+				v = 1023.2F;
+			if (v < 0.0F)
+				v = 0.0F;
+			iv = (unsigned int)v;
+			if (iv > 1023)
+				iv = 1023;
+			if (iv < 0)
+				iv = 0;
+			out |= iv << 10;
+
+			v = vec.z * 1023.0F + 0.5F;
+			if (v > 1023.2F)
+				v = 1023.2F;
+			if (v < 0.0F)
+				v = 0.0F;
+			iv = (unsigned int)v;
+			if (iv > 1023)
+				iv = 1023;
+			if (iv < 0)
+				iv = 0;
+			out |= iv;
+
+			return (uint32_t)out;
+		}
+
+		void GLRadiosityEvaluator::ChunkData::CopyRegion(const ChunkData& other,
+		                                                 const IntVector3& min,
+		                                                 const IntVector3& max) {
+			int numX = max.x - min.x + 1;
+			for (int z = min.z; z <= max.z; z++)
+				for (int y = min.y; y <= max.y; y++) {
+					std::copy_n(&other.dataFlat[z][y][min.x], numX, &dataFlat[z][y][min.x]);
+					std::copy_n(&other.dataX[z][y][min.x], numX, &dataX[z][y][min.x]);
+					std::copy_n(&other.dataY[z][y][min.x], numX, &dataY[z][y][min.x]);
+					std::copy_n(&other.dataZ[z][y][min.x], numX, &dataZ[z][y][min.x]);
+				}
+		}
+
+		void GLRadiosityEvaluator::UpdateChunk(int cx, int cy, int cz, const IntVector3& min,
+		                                       const IntVector3& max, ChunkData& c) const {
+			SPADES_MARK_FUNCTION_DEBUG();
+
+			int originX = cx * ChunkSize;
+			int originY = cy * ChunkSize;
+			int originZ = cz * ChunkSize;
+
+			for (int z = min.z; z <= max.z; z++)
+			for (int y = min.y; y <= max.y; y++)
+			for (int x = min.x; x <= max.x; x++) {
+				IntVector3 pos;
+				pos.x = (x + originX);
+				pos.y = (y + originY);
+				pos.z = (z + originZ);
+
+				Result res = Evaluate(pos);
+				c.dataFlat[z][y][x] = EncodeValue(res.base);
+				c.dataX[z][y][x] = EncodeValue(res.x);
+				c.dataY[z][y][x] = EncodeValue(res.y);
+				c.dataZ[z][y][x] = EncodeValue(res.z);
+			}
+		}
+
+		void GLRadiosityEvaluator::Benchmark(const uint32_t* bitmap, int w, int h,
+		                                     bool highPrecision) {
+			SPADES_MARK_FUNCTION();
+
+			GLRadiosityEvaluator evaluator{bitmap, w, h, highPrecision};
+
+			const int chunkW = w / ChunkSize;
+			const int chunkH = h / ChunkSize;
+			const int chunkD = 64 / ChunkSize;
+			const int numChunks = chunkW * chunkH * chunkD;
+			const int numVoxels = numChunks * ChunkSize * ChunkSize * ChunkSize;
+			unsigned int numThreads = GetNumHardwareThreads();
+
+			SPLog("Radiosity benchmark: %d chunks", numChunks);
+
+			// compare both evaluators over every chunk of a sparse set (the
+			// odd stride samples every depth), and time the serial reference
+			// with it
+			int numSampledChunks = 0;
+			double referenceTime = 0.0, simdTime = 0.0;
+			float maxError = 0.0F;
+			int numMismatches = 0;
+			std::vector<Result> reference(ChunkSize * ChunkSize * ChunkSize);
+			for (int i = 0; i < numChunks; i += 17) {
+				int cx = i / chunkD / chunkH, cy = (i / chunkD) % chunkH, cz = i % chunkD;
+				auto voxel = [&](int j) {
+					return IntVector3::Make(cx * ChunkSize + (j & (ChunkSize - 1)),
+					                        cy * ChunkSize + ((j >> ChunkSizeBits) & (ChunkSize - 1)),
+					                        cz * ChunkSize + (j >> (ChunkSizeBits * 2)));
+				};
+
+				Stopwatch sw;
+				for (std::size_t j = 0; j < reference.size(); j++)
+					reference[j] = evaluator.EvaluateReference(voxel(static_cast<int>(j)));
+				referenceTime += sw.GetTime();
+
+				sw.Reset();
+				for (std::size_t j = 0; j < reference.size(); j++) {
+					Result res = evaluator.Evaluate(voxel(static_cast<int>(j)));
+					const Result& ref = reference[j];
+					const Vector3 diffs[] = {res.base - ref.base, res.x - ref.x, res.y - ref.y,
+					                         res.z - ref.z};
+					for (const Vector3& diff : diffs) {
+						maxError = std::max(maxError, std::fabs(diff.x));
+						maxError = std::max(maxError, std::fabs(diff.y));
+						maxError = std::max(maxError, std::fabs(diff.z));
+					}
+					if (evaluator.EncodeValue(res.base) != evaluator.EncodeValue(ref.base))
+						numMismatches++;
+				}
+				simdTime += sw.GetTime();
+				numSampledChunks++;
+			}
+
+			// update the whole map on all cores
+			const IntVector3 chunkMin = IntVector3::Make(0, 0, 0);
+			const IntVector3 chunkMax = IntVector3::Make(ChunkSize - 1, ChunkSize - 1, ChunkSize - 1);
+			std::atomic<int> nextChunk{0};
+			Stopwatch sw;
+			InvokeParallel(
+			  [&](unsigned int) {
+				  std::unique_ptr<ChunkData> data{new ChunkData()};
+				  int i;
+				  while ((i = nextChunk.fetch_add(1)) < numChunks)
+					  evaluator.UpdateChunk(i / chunkD / chunkH, (i / chunkD) % chunkH,
+					                        i % chunkD, chunkMin, chunkMax, *data);
+			  },
+			  numThreads);
+			double parallelTime = sw.GetTime();
+
+			int numSampledVoxels = numSampledChunks * ChunkSize * ChunkSize * ChunkSize;
+			double referenceRate = numSampledVoxels / std::max(referenceTime, 1.0e-9);
+			double simdRate = numSampledVoxels / std::max(simdTime, 1.0e-9);
+			double parallelRate = numVoxels / std::max(parallelTime, 1.0e-9);
+			SPLog("  reference: %.2f Mvoxels/s (%.1f ms/chunk)", referenceRate * 1.0e-6,
+			      referenceTime * 1000.0 / numSampledChunks);
+			SPLog("  vectorized: %.2f Mvoxels/s (%.2fx), max error %g, %d/%d encoded "
+			      "values differ",
+			      simdRate * 1.0e-6, simdRate / referenceRate, maxError, numMismatches,
+			      numSampledVoxels);
+			SPLog("  parallel (%u threads): %.2f Mvoxels/s (%.2fx), whole map in %.0f ms",
+			      numThreads, parallelRate * 1.0e-6, parallelRate / referenceRate,
+			      parallelTime * 1000.0);
+		}
+	} // namespace draw
+} // namespace spades
@@ -0,0 +1,93 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <Core/Math.h>
+
+namespace spades {
+	namespace draw {
+		/**
+		 * Computes the radiosity volumes from the terrain shadow map bitmap
+		 * built by `GLMapShadowRenderer`. Every voxel gathers the light
+		 * bounced by the lit faces within `Envelope` pixels of the shadow map.
+		 * `UpdateChunk` is thread-safe.
+		 */
+		class GLRadiosityEvaluator {
+		public:
+			typedef uint32_t VoxelType;
+			enum { ChunkSize = 16, ChunkSizeBits = 4, Envelope = 6 };
+
+			struct Result {
+				Vector3 base, x, y, z;
+			};
+
+			/** The encoded volumes of a chunk, indexed by `[z][y][x]`. */
+			struct ChunkData {
+				VoxelType dataFlat[ChunkSize][ChunkSize][ChunkSize];
+				VoxelType dataX[ChunkSize][ChunkSize][ChunkSize];
+				VoxelType dataY[ChunkSize][ChunkSize][ChunkSize];
+				VoxelType dataZ[ChunkSize][ChunkSize][ChunkSize];
+
+				/** Copies the voxels within the inclusive range `[min, max]`
+				 * from `other`. */
+				void CopyRegion(const ChunkData& other, const IntVector3& min,
+				                const IntVector3& max);
+			};
+
+			/**
+			 * @param bitmap The shadow map bitmap (`w` x `h` pixels). Must
+			 *               outlive the evaluator.
+			 * @param highPrecision `true` to store linear values in the
+			 *                      volumes (`r_radiosity 2`).
+			 */
+			GLRadiosityEvaluator(const uint32_t* bitmap, int w, int h, bool highPrecision);
+
+			/** Evaluates a voxel, using SSE2 when available. */
+			Result Evaluate(IntVector3) const;
+			/** Evaluates a voxel one shadow map pixel at a time. */
+			Result EvaluateReference(IntVector3) const;
+
+			uint32_t EncodeValue(Vector3) const;
+
+			/** Evaluates the voxels of the chunk `(cx, cy, cz)` within the
+			 * inclusive range `[min, max]` (in the chunk's coordinates). */
+			void UpdateChunk(int cx, int cy, int cz, const IntVector3& min, const IntVector3& max,
+			                 ChunkData&) const;
+
+			/**
+			 * Logs the time to update every chunk of a 64-deep map with the
+			 * reference and the vectorized evaluators, serially and on all
+			 * cores, and how much the two evaluators differ.
+			 */
+			static void Benchmark(const uint32_t* bitmap, int w, int h, bool highPrecision);
+
+		private:
+			const uint32_t* bitmap;
+			int w, h;
+			bool highPrecision;
+
+			float CompressDynamicRange(float) const;
+		};
+	} // namespace draw
+} // namespace spades
@@ -20,10 +20,10 @@
 
 #pragma once
 
-#include <atomic>
 #include <cstdint>
-#include <vector>
 
+#include "GLChunkUpdateScheduler.h"
+#include "GLRadiosityEvaluator.h"
 #include "IGLDevice.h"
 #include <Core/Debug.h>
 #include <Core/Math.h>
@@ -38,28 +38,21 @@ namespace spades {
 		class GLSettings;
 		class GLRadiosityRenderer {
 
-			typedef uint32_t VoxelType;
-
-			class UpdateDispatch;
-			enum { ChunkSize = 16, ChunkSizeBits = 4, Envelope = 6 };
+			enum {
+				ChunkSize = GLRadiosityEvaluator::ChunkSize,
+				ChunkSizeBits = GLRadiosityEvaluator::ChunkSizeBits,
+				Envelope = GLRadiosityEvaluator::Envelope
+			};
 			GLRenderer &renderer;
 			IGLDevice &device;
 			GLSettings &settings;
 			client::GameMap *map;
 
-			struct Chunk {
-				int cx, cy, cz;
-				VoxelType dataFlat[ChunkSize][ChunkSize][ChunkSize];
-				VoxelType dataX[ChunkSize][ChunkSize][ChunkSize];
-				VoxelType dataY[ChunkSize][ChunkSize][ChunkSize];
-				VoxelType dataZ[ChunkSize][ChunkSize][ChunkSize];
-				bool dirty = true;
-				int dirtyMinX = 0, dirtyMaxX = ChunkSize - 1;
-				int dirtyMinY = 0, dirtyMaxY = ChunkSize - 1;
-				int dirtyMinZ = 0, dirtyMaxZ = ChunkSize - 1;
-
-				std::atomic<bool> transferDone{true};
-			};
+			typedef GLChunkUpdateScheduler<GLRadiosityEvaluator> Scheduler;
+			typedef Scheduler::Chunk Chunk;
+
+			GLRadiosityEvaluator evaluator;
+			Scheduler scheduler;
 
 			IGLDevice::UInteger textureFlat;
 			IGLDevice::UInteger textureX;
@@ -67,46 +60,11 @@ namespace spades {
 			IGLDevice::UInteger textureZ;
 
 			int w, h, d;
-			int chunkW, chunkH, chunkD;
-
-			std::vector<Chunk> chunks;
-
-			inline Chunk &GetChunk(int cx, int cy, int cz) {
-				SPAssert(cx >= 0);
-				SPAssert(cx < chunkW);
-				SPAssert(cy >= 0);
-				SPAssert(cy < chunkH);
-				SPAssert(cz >= 0);
-				SPAssert(cz < chunkD);
-				return chunks[(cx + cy * chunkW) * chunkD + cz];
-			}
-
-			inline Chunk &GetChunkWrapped(int cx, int cy, int cz) {
-				// FIXME: support for non-POT dimensions?
-				return GetChunk(cx & (chunkW - 1), cy & (chunkH - 1), cz);
-			}
-
-			void Invalidate(int minX, int minY, int minZ, int maxX, int maxY, int maxZ);
-
-			void UpdateChunk(int cx, int cy, int cz);
-			void UpdateDirtyChunks();
-			int GetNumDirtyChunks();
-
-			uint32_t EncodeValue(Vector3 vec);
-			float CompressDynamicRange(float v);
-
-			UpdateDispatch *dispatch;
 
 		public:
-			struct Result {
-				Vector3 base, x, y, z;
-			};
-
 			GLRadiosityRenderer(GLRenderer &renderer, client::GameMap *map);
 			~GLRadiosityRenderer();
 
-			Result Evaluate(IntVector3);
-
 			void GameMapChanged(int x, int y, int z, client::GameMap *);
 
 			void Update();
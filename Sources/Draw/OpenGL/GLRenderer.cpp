@@ -515,6 +515,25 @@ namespace spades {
 			spriteRenderer->Add(&glImage, center, radius, rotation, drawColorAlphaPremultiplied);
 		}
 
+		void GLRenderer::AddSprites(client::IImage& img, const client::SpriteParam* sprites,
+		                            std::size_t count) {
+			SPADES_MARK_FUNCTION_DEBUG();
+
+			GLImage& glImage = dynamic_cast<GLImage&>(img);
+
+			EnsureInitialized();
+			EnsureSceneStarted();
+
+			for (std::size_t i = 0; i < count; i++) {
+				const client::SpriteParam& sprite = sprites[i];
+				if (!SphereFrustrumCull(sprite.center, sprite.radius * 1.5F))
+					continue;
+
+				spriteRenderer->Add(&glImage, sprite.center, sprite.radius, sprite.rotation,
+				                    sprite.color);
+			}
+		}
+
 		void GLRenderer::AddLongSprite(client::IImage& img, spades::Vector3 p1, spades::Vector3 p2,
 		                               float radius) {
 			SPADES_MARK_FUNCTION_DEBUG();
@@ -191,6 +191,8 @@ namespace spades {
 
 			void AddSprite(client::IImage&, Vector3 center, float radius, float rotation) override;
 			void AddLongSprite(client::IImage&, Vector3 p1, Vector3 p2, float radius) override;
+			void AddSprites(client::IImage&, const client::SpriteParam* sprites,
+			                std::size_t count) override;
 
 			void EndScene() override;
 
@@ -22,6 +22,7 @@
 
 #include "GLSettings.h"
 
+DEFINE_SPADES_SETTING(r_ambientShadowBenchmark, "0");
 DEFINE_SPADES_SETTING(r_blitFramebuffer, "1");
 DEFINE_SPADES_SETTING(r_bloom, "1");
 DEFINE_SPADES_SETTING(r_cameraBlur, "1");
@@ -49,13 +50,21 @@ DEFINE_SPADES_SETTING(r_hdrGamma, "2.2");
 DEFINE_SPADES_SETTING(r_highPrec, "1");
 DEFINE_SPADES_SETTING(r_lensFlare, "1");
 DEFINE_SPADES_SETTING(r_lensFlareDynamic, "1");
+DEFINE_SPADES_SETTING(r_mapGreedyMeshing, "0");
+DEFINE_SPADES_SETTING(r_mapMeshBenchmark, "0");
+DEFINE_SPADES_SETTING(r_mapOcclusionCheck, "0");
+DEFINE_SPADES_SETTING(r_mapOcclusionCulling, "1");
+DEFINE_SPADES_SETTING(r_mapShadowBenchmark, "0");
+DEFINE_SPADES_SETTING(r_mapUploadBudget, "2");
 DEFINE_SPADES_SETTING(r_maxAnisotropy, "8");
+DEFINE_SPADES_SETTING(r_modelLod, "1");
 DEFINE_SPADES_SETTING(r_modelShadows, "1");
 DEFINE_SPADES_SETTING(r_multisamples, "0");
 DEFINE_SPADES_SETTING(r_occlusionQuery, "0");
 DEFINE_SPADES_SETTING(r_physicalLighting, "0");
 DEFINE_SPADES_SETTING(r_outlines, "0");
 DEFINE_SPADES_SETTING(r_radiosity, "0");
+DEFINE_SPADES_SETTING(r_radiosityBenchmark, "0");
 DEFINE_SPADES_SETTING(r_saturation, "1");
 DEFINE_SPADES_SETTING(r_scale, "1");
 DEFINE_SPADES_SETTING(r_scaleFilter, "1");
@@ -63,11 +72,13 @@ DEFINE_SPADES_SETTING(r_shadowMapSize, "2048");
 DEFINE_SPADES_SETTING(r_sharpen, "0");
 DEFINE_SPADES_SETTING(r_softParticles, "1");
 DEFINE_SPADES_SETTING(r_sparseShadowMaps, "1");
+DEFINE_SPADES_SETTING(r_spriteBatchBenchmark, "0");
 DEFINE_SPADES_SETTING(r_srgb, "0");
 DEFINE_SPADES_SETTING(r_srgb2D, "1");
 DEFINE_SPADES_SETTING(r_ssao, "0");
 DEFINE_SPADES_SETTING(r_temporalAA, "0");
 DEFINE_SPADES_SETTING(r_water, "2");
+DEFINE_SPADES_SETTING(r_waterBenchmark, "0");
 
 namespace spades {
 	namespace draw {
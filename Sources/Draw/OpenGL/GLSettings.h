@@ -29,6 +29,7 @@ namespace spades {
 			GLSettings();
 
 			// clang-format off
+			TypedItemHandle<bool> r_ambientShadowBenchmark { *this, "r_ambientShadowBenchmark" };
 			TypedItemHandle<bool> r_blitFramebuffer     { *this, "r_blitFramebuffer", ItemFlags::Latch };
 			TypedItemHandle<bool> r_bloom               { *this, "r_bloom", ItemFlags::Latch };
 			TypedItemHandle<float> r_cameraBlur         { *this, "r_cameraBlur" };
@@ -56,13 +57,21 @@ namespace spades {
 			TypedItemHandle<bool> r_highPrec            { *this, "r_highPrec", ItemFlags::Latch };
 			TypedItemHandle<bool> r_lensFlare           { *this, "r_lensFlare" };
 			TypedItemHandle<bool> r_lensFlareDynamic    { *this, "r_lensFlareDynamic" };
+			TypedItemHandle<bool> r_mapGreedyMeshing    { *this, "r_mapGreedyMeshing", ItemFlags::Latch };
+			TypedItemHandle<bool> r_mapMeshBenchmark    { *this, "r_mapMeshBenchmark" };
+			TypedItemHandle<bool> r_mapOcclusionCheck   { *this, "r_mapOcclusionCheck" };
+			TypedItemHandle<bool> r_mapOcclusionCulling { *this, "r_mapOcclusionCulling" };
+			TypedItemHandle<bool> r_mapShadowBenchmark  { *this, "r_mapShadowBenchmark" };
+			TypedItemHandle<float> r_mapUploadBudget    { *this, "r_mapUploadBudget" };
 			TypedItemHandle<float> r_maxAnisotropy      { *this, "r_maxAnisotropy", ItemFlags::Latch };
+			TypedItemHandle<bool> r_modelLod            { *this, "r_modelLod" };
 			TypedItemHandle<bool> r_modelShadows        { *this, "r_modelShadows", ItemFlags::Latch };
 			TypedItemHandle<int> r_multisamples         { *this, "r_multisamples", ItemFlags::Latch };
 			TypedItemHandle<bool> r_occlusionQuery      { *this, "r_occlusionQuery" };
 			TypedItemHandle<bool> r_physicalLighting    { *this, "r_physicalLighting", ItemFlags::Latch };
 			TypedItemHandle<bool> r_outlines            { *this, "r_outlines" };
 			TypedItemHandle<int> r_radiosity            { *this, "r_radiosity", ItemFlags::Latch };
+			TypedItemHandle<bool> r_radiosityBenchmark  { *this, "r_radiosityBenchmark" };
 			TypedItemHandle<float> r_saturation         { *this, "r_saturation" };
 			TypedItemHandle<float> r_scale              { *this, "r_scale" };
 			TypedItemHandle<int> r_scaleFilter          { *this, "r_scaleFilter" };
@@ -70,11 +79,13 @@ namespace spades {
 			TypedItemHandle<float> r_sharpen            { *this, "r_sharpen" };
 			TypedItemHandle<int> r_softParticles        { *this, "r_softParticles", ItemFlags::Latch };
 			TypedItemHandle<bool> r_sparseShadowMaps    { *this, "r_sparseShadowMaps", ItemFlags::Latch };
+			TypedItemHandle<bool> r_spriteBatchBenchmark { *this, "r_spriteBatchBenchmark" };
 			TypedItemHandle<bool> r_srgb                { *this, "r_srgb", ItemFlags::Latch };
 			TypedItemHandle<bool> r_srgb2D              { *this, "r_srgb2D", ItemFlags::Latch };
 			TypedItemHandle<int> r_ssao                 { *this, "r_ssao", ItemFlags::Latch };
 			TypedItemHandle<bool> r_temporalAA          { *this, "r_temporalAA" };
 			TypedItemHandle<int> r_water                { *this, "r_water", ItemFlags::Latch };
+			TypedItemHandle<bool> r_waterBenchmark      { *this, "r_waterBenchmark" };
 			// clang-format on
 
 			/** Check illegal settings and report via `SPLog`. */
@@ -18,6 +18,7 @@
 
  */
 
+
 #include "GLSoftSpriteRenderer.h"
 #include "GLFramebufferManager.h"
 #include "GLImage.h"
@@ -25,6 +26,7 @@
 #include "GLProgram.h"
 #include "GLQuadRenderer.h"
 #include "GLRenderer.h"
+#include "GLSettings.h"
 #include "IGLDevice.h"
 #include "../SW/SWFeatureLevel.h" // for fastRcp
 #include <Core/Debug.h>
@@ -36,6 +38,7 @@ namespace spades {
 		    : renderer(renderer),
 		      device(renderer.GetGLDevice()),
 		      settings(renderer.GetSettings()),
+		      drawer(renderer),
 		      projectionViewMatrix("projectionViewMatrix"),
 		      rightVector("rightVector"),
 		      upVector("upVector"),
@@ -48,14 +51,20 @@ namespace spades {
 		      fogColor("fogColor"),
 		      zNearFar("zNearFar"),
 		      positionAttribute("positionAttribute"),
-		      spritePosAttribute("spritePosAttribute"),
-		      colorAttribute("colorAttribute") {
+		      angleAttribute("angleAttribute"),
+		      colorAttribute("colorAttribute"),
+		      cornerAttribute("cornerAttribute") {
 			SPADES_MARK_FUNCTION();
 
 			program = renderer.RegisterProgram("Shaders/OpenGL/SoftSprite.program");
+
+			if (settings.r_spriteBatchBenchmark)
+				GLSpriteBatcher::Benchmark();
 		}
 
-		GLSoftSpriteRenderer::~GLSoftSpriteRenderer() { SPADES_MARK_FUNCTION(); }
+		GLSoftSpriteRenderer::~GLSoftSpriteRenderer() {
+			SPADES_MARK_FUNCTION();
+		}
 
 		void GLSoftSpriteRenderer::Add(spades::draw::GLImage *img, spades::Vector3 center,
 		                               float rad, float ang, Vector4 color) {
@@ -100,9 +109,32 @@ namespace spades {
 			return v;
 		}
 
+		void GLSoftSpriteRenderer::BuildLayer(bool lowRes) {
+			batcher.Clear();
+			for (const Sprite &spr : sprites) {
+				float layer = LayerForSprite(spr);
+				if (layer == (lowRes ? 0.f : 1.f))
+					continue;
+
+				GLSpriteBatcher::Instance inst;
+				inst.x = spr.center.x;
+				inst.y = spr.center.y;
+				inst.z = spr.center.z;
+				inst.radius = spr.radius;
+				inst.angle = spr.angle;
+
+				float fade = lowRes ? layer : 1.f - layer;
+				inst.r = spr.color.x * fade;
+				inst.g = spr.color.y * fade;
+				inst.b = spr.color.z * fade;
+				inst.a = spr.color.w * fade;
+				batcher.Add(spr.image, inst);
+			}
+			batcher.Build(renderer.GetProjectionViewMatrix(), renderer.GetSceneDef());
+		}
+
 		void GLSoftSpriteRenderer::Render() {
 			SPADES_MARK_FUNCTION();
-			lastImage = NULL;
 			program->Use();
 
 			device.Enable(IGLDevice::Blend, true);
@@ -121,8 +153,9 @@ namespace spades {
 			zNearFar(program);
 
 			positionAttribute(program);
-			spritePosAttribute(program);
+			angleAttribute(program);
 			colorAttribute(program);
+			cornerAttribute(program);
 
 			projectionViewMatrix.SetValue(renderer.GetProjectionViewMatrix());
 			viewMatrix.SetValue(renderer.GetViewMatrix());
@@ -148,67 +181,14 @@ namespace spades {
 			                   renderer.GetFramebufferManager()->GetDepthTexture());
 			device.ActiveTexture(0);
 
-			device.EnableVertexAttribArray(positionAttribute(), true);
-			device.EnableVertexAttribArray(spritePosAttribute(), true);
-			device.EnableVertexAttribArray(colorAttribute(), true);
-
 			thresLow = tanf(def.fovX * .5f) * tanf(def.fovY * .5f) * 1.8f;
 			thresRange = thresLow * .5f;
 
 			// full-resolution sprites
 			{
 				GLProfiler::Context measure(renderer.GetGLProfiler(), "Full Resolution");
-				for (size_t i = 0; i < sprites.size(); i++) {
-					Sprite &spr = sprites[i];
-					float layer = LayerForSprite(spr);
-					if (layer == 1.f)
-						continue;
-					if (spr.image != lastImage) {
-						Flush();
-						lastImage = spr.image;
-						SPAssert(vertices.empty());
-					}
-
-					Vertex v;
-					v.x = spr.center.x;
-					v.y = spr.center.y;
-					v.z = spr.center.z;
-					v.radius = spr.radius;
-					v.angle = spr.angle;
-					v.r = spr.color.x;
-					v.g = spr.color.y;
-					v.b = spr.color.z;
-					v.a = spr.color.w;
-
-					float fade = 1.f - layer;
-					v.r *= fade;
-					v.g *= fade;
-					v.b *= fade;
-					v.a *= fade;
-
-					uint32_t idx = (uint32_t)vertices.size();
-					v.sx = -1;
-					v.sy = -1;
-					vertices.push_back(v);
-					v.sx = 1;
-					v.sy = -1;
-					vertices.push_back(v);
-					v.sx = -1;
-					v.sy = 1;
-					vertices.push_back(v);
-					v.sx = 1;
-					v.sy = 1;
-					vertices.push_back(v);
-
-					indices.push_back(idx);
-					indices.push_back(idx + 1);
-					indices.push_back(idx + 2);
-					indices.push_back(idx + 1);
-					indices.push_back(idx + 3);
-					indices.push_back(idx + 2);
-				}
-
-				Flush();
+				BuildLayer(false);
+				DrawBatches();
 			}
 
 			// low-res sprites
@@ -224,58 +204,9 @@ namespace spades {
 			device.Viewport(0, 0, lW, lH);
 			{
 				GLProfiler::Context measure(renderer.GetGLProfiler(), "Low Resolution");
-				for (size_t i = 0; i < sprites.size(); i++) {
-					Sprite &spr = sprites[i];
-					float layer = LayerForSprite(spr);
-					if (layer == 0.f)
-						continue;
-					if (spr.image != lastImage) {
-						Flush();
-						lastImage = spr.image;
-						SPAssert(vertices.empty());
-					}
-
-					numLowResSprites++;
-
-					Vertex v;
-					v.x = spr.center.x;
-					v.y = spr.center.y;
-					v.z = spr.center.z;
-					v.radius = spr.radius;
-					v.angle = spr.angle;
-					v.r = spr.color.x;
-					v.g = spr.color.y;
-					v.b = spr.color.z;
-					v.a = spr.color.w;
-
-					float fade = layer;
-					v.r *= fade;
-					v.g *= fade;
-					v.b *= fade;
-					v.a *= fade;
-
-					uint32_t idx = (uint32_t)vertices.size();
-					v.sx = -1;
-					v.sy = -1;
-					vertices.push_back(v);
-					v.sx = 1;
-					v.sy = -1;
-					vertices.push_back(v);
-					v.sx = -1;
-					v.sy = 1;
-					vertices.push_back(v);
-					v.sx = 1;
-					v.sy = 1;
-					vertices.push_back(v);
-
-					indices.push_back(idx);
-					indices.push_back(idx + 1);
-					indices.push_back(idx + 2);
-					indices.push_back(idx + 1);
-					indices.push_back(idx + 3);
-					indices.push_back(idx + 2);
-				}
-				Flush();
+				BuildLayer(true);
+				numLowResSprites = static_cast<int>(batcher.GetInstances().size());
+				DrawBatches();
 			}
 
 			// finalize
@@ -284,9 +215,6 @@ namespace spades {
 			device.BindTexture(IGLDevice::Texture2D, 0);
 			device.ActiveTexture(0);
 			device.BindTexture(IGLDevice::Texture2D, 0);
-			device.EnableVertexAttribArray(positionAttribute(), false);
-			device.EnableVertexAttribArray(spritePosAttribute(), false);
-			device.EnableVertexAttribArray(colorAttribute(), false);
 
 			// composite downsampled sprite
 			device.BlendFunc(IGLDevice::One, IGLDevice::OneMinusSrcAlpha);
@@ -365,27 +293,9 @@ namespace spades {
 			buf.Release();
 		}
 
-		void GLSoftSpriteRenderer::Flush() {
-			SPADES_MARK_FUNCTION_DEBUG();
-
-			if (vertices.empty())
-				return;
-
-			device.VertexAttribPointer(positionAttribute(), 4, IGLDevice::FloatType, false,
-			                           sizeof(Vertex), &(vertices[0].x));
-			device.VertexAttribPointer(spritePosAttribute(), 4, IGLDevice::FloatType, false,
-			                           sizeof(Vertex), &(vertices[0].sx));
-			device.VertexAttribPointer(colorAttribute(), 4, IGLDevice::FloatType, false,
-			                           sizeof(Vertex), &(vertices[0].r));
-
-			SPAssert(lastImage);
-			lastImage->Bind(IGLDevice::Texture2D);
-
-			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(indices.size()),
-			                    IGLDevice::UnsignedInt, indices.data());
-
-			vertices.clear();
-			indices.clear();
+		void GLSoftSpriteRenderer::DrawBatches() {
+			drawer.Draw(batcher, {positionAttribute(), angleAttribute(), colorAttribute(),
+			                      cornerAttribute()});
 		}
 	} // namespace draw
 } // namespace spades
@@ -25,6 +25,9 @@
 
 #include "GLProgramAttribute.h"
 #include "GLProgramUniform.h"
+#include "GLSpriteBatchDrawer.h"
+#include "GLSpriteBatcher.h"
+#include "IGLDevice.h"
 #include "IGLSpriteRenderer.h"
 #include <Core/Math.h>
 
@@ -34,6 +37,11 @@ namespace spades {
 		class IGLDevice;
 		class GLImage;
 		class GLSettings;
+		/**
+		 * Draws depth-faded sprites as instanced quads, the large ones at a
+		 * quarter resolution. Each pass is grouped into per-image batches by
+		 * `GLSpriteBatcher`.
+		 */
 		class GLSoftSpriteRenderer : public IGLSpriteRenderer {
 			struct Sprite {
 				GLImage *image;
@@ -44,28 +52,13 @@ namespace spades {
 				float area;
 			};
 
-			struct Vertex {
-				// center position
-				float x, y, z;
-				float radius;
-
-				// point coord
-				float sx, sy;
-				float angle;
-
-				// color
-				float r, g, b, a;
-			};
-
 			GLRenderer &renderer;
 			IGLDevice &device;
 			GLSettings &settings;
 			std::vector<Sprite> sprites;
+			GLSpriteBatcher batcher;
 
-			GLImage *lastImage;
-
-			std::vector<Vertex> vertices;
-			std::vector<uint32_t> indices;
+			GLSpriteBatchDrawer drawer;
 
 			GLProgram *program;
 			GLProgramUniform projectionViewMatrix;
@@ -81,13 +74,17 @@ namespace spades {
 			GLProgramUniform zNearFar;
 
 			GLProgramAttribute positionAttribute;
-			GLProgramAttribute spritePosAttribute;
+			GLProgramAttribute angleAttribute;
 			GLProgramAttribute colorAttribute;
+			GLProgramAttribute cornerAttribute;
 
 			float thresLow, thresRange;
 
-			void Flush();
+			void DrawBatches();
 			float LayerForSprite(const Sprite &);
+			/** Batches the sprites of a layer, scaling their color by their
+			 * weight in the layer. */
+			void BuildLayer(bool lowRes);
 
 		public:
 			GLSoftSpriteRenderer(GLRenderer &);
@@ -0,0 +1,143 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#include <cstddef>
+
+#include "GLImage.h"
+#include "GLProfiler.h"
+#include "GLRenderer.h"
+#include "GLSpriteBatchDrawer.h"
+#include <Core/Debug.h>
+
+namespace spades {
+	namespace draw {
+		GLSpriteBatchDrawer::GLSpriteBatchDrawer(GLRenderer& renderer)
+		    : renderer(renderer), device(renderer.GetGLDevice()) {
+			SPADES_MARK_FUNCTION();
+
+			// drawn as a triangle strip
+			static const float corners[] = {-1.0F, -1.0F, 1.0F, -1.0F, -1.0F, 1.0F, 1.0F, 1.0F};
+			cornerBuffer = device.GenBuffer();
+			device.BindBuffer(IGLDevice::ArrayBuffer, cornerBuffer);
+			device.BufferData(IGLDevice::ArrayBuffer, sizeof(corners), corners,
+			                  IGLDevice::StaticDraw);
+			device.BindBuffer(IGLDevice::ArrayBuffer, 0);
+
+			instanceBuffer = device.GenBuffer();
+		}
+
+		GLSpriteBatchDrawer::~GLSpriteBatchDrawer() {
+			SPADES_MARK_FUNCTION();
+			device.DeleteBuffer(cornerBuffer);
+			device.DeleteBuffer(instanceBuffer);
+		}
+
+		void GLSpriteBatchDrawer::Draw(const GLSpriteBatcher& batcher, const Attributes& attrs) {
+			SPADES_MARK_FUNCTION_DEBUG();
+
+			const auto& instances = batcher.GetInstances();
+			const auto& batches = batcher.GetBatches();
+			GLProfiler::Context measure(renderer.GetGLProfiler(), "Draw [%d sprite(s), %d batch(es)]",
+			                            static_cast<int>(instances.size()),
+			                            static_cast<int>(batches.size()));
+			if (instances.empty())
+				return;
+
+			device.EnableVertexAttribArray(attrs.position, true);
+			device.EnableVertexAttribArray(attrs.angle, true);
+			device.EnableVertexAttribArray(attrs.color, true);
+			device.EnableVertexAttribArray(attrs.corner, true);
+
+			if (device.IsInstancingSupported())
+				DrawInstanced(batcher, attrs);
+			else
+				DrawQuads(batcher, attrs);
+
+			device.EnableVertexAttribArray(attrs.position, false);
+			device.EnableVertexAttribArray(attrs.angle, false);
+			device.EnableVertexAttribArray(attrs.color, false);
+			device.EnableVertexAttribArray(attrs.corner, false);
+		}
+
+		void GLSpriteBatchDrawer::DrawInstanced(const GLSpriteBatcher& batcher,
+		                                        const Attributes& attrs) {
+			typedef GLSpriteBatcher::Instance Instance;
+			const auto& instances = batcher.GetInstances();
+
+			device.VertexAttribDivisor(attrs.position, 1);
+			device.VertexAttribDivisor(attrs.angle, 1);
+			device.VertexAttribDivisor(attrs.color, 1);
+
+			device.BindBuffer(IGLDevice::ArrayBuffer, cornerBuffer);
+			device.VertexAttribPointer(attrs.corner, 2, IGLDevice::FloatType, false,
+			                           sizeof(float) * 2, nullptr);
+
+			device.BindBuffer(IGLDevice::ArrayBuffer, instanceBuffer);
+			device.BufferData(IGLDevice::ArrayBuffer,
+			                  static_cast<IGLDevice::Sizei>(instances.size() * sizeof(Instance)),
+			                  instances.data(), IGLDevice::StreamDraw);
+
+			for (const auto& batch : batcher.GetBatches()) {
+				std::size_t offset = batch.first * sizeof(Instance);
+				device.VertexAttribPointer(attrs.position, 4, IGLDevice::FloatType, false,
+				                           sizeof(Instance),
+				                           (void*)(offset + offsetof(Instance, x)));
+				device.VertexAttribPointer(attrs.angle, 1, IGLDevice::FloatType, false,
+				                           sizeof(Instance),
+				                           (void*)(offset + offsetof(Instance, angle)));
+				device.VertexAttribPointer(attrs.color, 4, IGLDevice::FloatType, false,
+				                           sizeof(Instance),
+				                           (void*)(offset + offsetof(Instance, r)));
+
+				batch.image->Bind(IGLDevice::Texture2D);
+				device.DrawArraysInstanced(IGLDevice::TriangleStrip, 0, 4,
+				                           static_cast<IGLDevice::Sizei>(batch.count));
+			}
+
+			device.BindBuffer(IGLDevice::ArrayBuffer, 0);
+
+			device.VertexAttribDivisor(attrs.position, 0);
+			device.VertexAttribDivisor(attrs.angle, 0);
+			device.VertexAttribDivisor(attrs.color, 0);
+		}
+
+		void GLSpriteBatchDrawer::DrawQuads(const GLSpriteBatcher& batcher,
+		                                    const Attributes& attrs) {
+			typedef GLSpriteBatcher::Vertex Vertex;
+			batcher.BuildQuads(vertices, indices);
+
+			device.VertexAttribPointer(attrs.position, 4, IGLDevice::FloatType, false,
+			                           sizeof(Vertex), &vertices[0].instance.x);
+			device.VertexAttribPointer(attrs.angle, 1, IGLDevice::FloatType, false,
+			                           sizeof(Vertex), &vertices[0].instance.angle);
+			device.VertexAttribPointer(attrs.color, 4, IGLDevice::FloatType, false,
+			                           sizeof(Vertex), &vertices[0].instance.r);
+			device.VertexAttribPointer(attrs.corner, 2, IGLDevice::FloatType, false,
+			                           sizeof(Vertex), &vertices[0].sx);
+
+			for (const auto& batch : batcher.GetBatches()) {
+				batch.image->Bind(IGLDevice::Texture2D);
+				device.DrawElements(IGLDevice::Triangles,
+				                    static_cast<IGLDevice::Sizei>(batch.count * 6),
+				                    IGLDevice::UnsignedInt, indices.data() + batch.first * 6);
+			}
+		}
+	} // namespace draw
+} // namespace spades
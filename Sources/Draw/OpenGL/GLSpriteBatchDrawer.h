@@ -0,0 +1,69 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GLSpriteBatcher.h"
+#include "IGLDevice.h"
+
+namespace spades {
+	namespace draw {
+		class GLRenderer;
+
+		/**
+		 * Draws the batches built by `GLSpriteBatcher` with the attributes of
+		 * the sprite shaders. Each batch is one instanced draw of a
+		 * four-corner triangle strip, and the instances of a pass are uploaded
+		 * to a single stream buffer. If the device doesn't support instancing,
+		 * the sprites are expanded into quads instead.
+		 */
+		class GLSpriteBatchDrawer {
+		public:
+			/** The attribute locations of the sprite program. */
+			struct Attributes {
+				int position, angle, color, corner;
+			};
+
+		private:
+			GLRenderer& renderer;
+			IGLDevice& device;
+
+			IGLDevice::UInteger instanceBuffer;
+			IGLDevice::UInteger cornerBuffer;
+
+			std::vector<GLSpriteBatcher::Vertex> vertices;
+			std::vector<uint32_t> indices;
+
+			void DrawInstanced(const GLSpriteBatcher&, const Attributes&);
+			void DrawQuads(const GLSpriteBatcher&, const Attributes&);
+
+		public:
+			GLSpriteBatchDrawer(GLRenderer&);
+			~GLSpriteBatchDrawer();
+
+			/** Draws the batches of `batcher`. The sprite program and its
+			 * uniforms must be set up. */
+			void Draw(const GLSpriteBatcher& batcher, const Attributes&);
+		};
+	} // namespace draw
+} // namespace spades
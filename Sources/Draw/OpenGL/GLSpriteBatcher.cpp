@@ -0,0 +1,241 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#include <algorithm>
+#include <cmath>
+
+#include "GLSpriteBatcher.h"
+#include <Client/SceneDefinition.h>
+#include <Core/Debug.h>
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	namespace draw {
+		namespace {
+			/** The soft sprite shader moves the quad towards the eye but not
+			 * closer than this. */
+			const float MinSpriteDepth = 0.3F;
+		}
+
+		void GLSpriteBatcher::Clear() {
+			sprites.clear();
+			instances.clear();
+			batches.clear();
+		}
+
+		void GLSpriteBatcher::Add(GLImage* image, const Instance& instance) {
+			Sprite spr;
+			spr.image = image;
+			spr.instance = instance;
+			sprites.push_back(spr);
+		}
+
+		void GLSpriteBatcher::Build(const Matrix4& projectionViewMatrix,
+		                            const client::SceneDefinition& def) {
+			SPADES_MARK_FUNCTION();
+
+			const Vector3& right = def.viewAxis[0];
+			const Vector3& up = def.viewAxis[1];
+			const float infinity = 1.0e+30F;
+
+			// conservative screen bounds. The rotated quad fits in the square
+			// of half size `radius * sqrt(2)`, and the quad may be moved up to
+			// that far towards the eye.
+			for (Sprite& spr : sprites) {
+				const Instance& inst = spr.instance;
+				float halfSize = inst.radius * 1.41422F;
+				Vector4 clip = projectionViewMatrix * MakeVector4(inst.x, inst.y, inst.z, 1.0F);
+				float nearW = clip.w - halfSize;
+				if (nearW < MinSpriteDepth) {
+					spr.bounds = AABB2(MakeVector2(-infinity, -infinity),
+					                   MakeVector2(infinity, infinity));
+					continue;
+				}
+
+				Vector4 dx = projectionViewMatrix * MakeVector4(right.x, right.y, right.z, 0.0F);
+				Vector4 dy = projectionViewMatrix * MakeVector4(up.x, up.y, up.z, 0.0F);
+				float extX = (fabsf(dx.x) + fabsf(dy.x)) * halfSize;
+				float extY = (fabsf(dx.y) + fabsf(dy.y)) * halfSize;
+
+				float rcpFar = 1.0F / clip.w, rcpNear = 1.0F / nearW;
+				float minX = clip.x - extX, maxX = clip.x + extX;
+				float minY = clip.y - extY, maxY = clip.y + extY;
+				spr.bounds.min = MakeVector2(std::min(minX * rcpFar, minX * rcpNear),
+				                             std::min(minY * rcpFar, minY * rcpNear));
+				spr.bounds.max = MakeVector2(std::max(maxX * rcpFar, maxX * rcpNear),
+				                             std::max(maxY * rcpFar, maxY * rcpNear));
+			}
+
+			// assign batches
+			pendingBatches.clear();
+			for (Sprite& spr : sprites) {
+
+				std::size_t target = pendingBatches.size();
+				std::size_t stop = pendingBatches.size() > MaxLookBack
+				                     ? pendingBatches.size() - MaxLookBack
+				                     : 0;
+				for (std::size_t i = pendingBatches.size(); i > stop; i--) {
+					const PendingBatch& batch = pendingBatches[i - 1];
+					if (batch.image == spr.image) {
+						target = i - 1;
+						break;
+					}
+					if (batch.bounds.Intersects(spr.bounds))
+						break;
+				}
+
+				if (target == pendingBatches.size())
+					pendingBatches.push_back(PendingBatch{spr.image, spr.bounds});
+				else
+					pendingBatches[target].bounds += spr.bounds;
+				spr.batch = static_cast<uint32_t>(target);
+			}
+
+			// lay the instances out batch by batch, keeping the submission
+			// order within each batch
+			batches.resize(pendingBatches.size());
+			for (std::size_t i = 0; i < batches.size(); i++) {
+				batches[i].image = pendingBatches[i].image;
+				batches[i].count = 0;
+			}
+			for (const Sprite& spr : sprites)
+				batches[spr.batch].count++;
+
+			std::size_t first = 0;
+			for (Batch& batch : batches) {
+				batch.first = first;
+				first += batch.count;
+				batch.count = 0;
+			}
+
+			instances.resize(sprites.size());
+			for (Sprite& spr : sprites) {
+				Batch& batch = batches[spr.batch];
+				spr.slot = static_cast<uint32_t>(batch.first + batch.count++);
+				instances[spr.slot] = spr.instance;
+			}
+		}
+
+		void GLSpriteBatcher::BuildQuads(std::vector<Vertex>& vertices,
+		                                 std::vector<uint32_t>& indices) const {
+			SPADES_MARK_FUNCTION();
+
+			vertices.clear();
+			indices.clear();
+			vertices.reserve(instances.size() * 4);
+			indices.reserve(instances.size() * 6);
+
+			for (const Instance& inst : instances) {
+				Vertex v;
+				v.instance = inst;
+
+				uint32_t idx = static_cast<uint32_t>(vertices.size());
+				v.sx = -1;
+				v.sy = -1;
+				vertices.push_back(v);
+				v.sx = 1;
+				v.sy = -1;
+				vertices.push_back(v);
+				v.sx = -1;
+				v.sy = 1;
+				vertices.push_back(v);
+				v.sx = 1;
+				v.sy = 1;
+				vertices.push_back(v);
+
+				indices.push_back(idx);
+				indices.push_back(idx + 1);
+				indices.push_back(idx + 2);
+				indices.push_back(idx + 1);
+				indices.push_back(idx + 3);
+				indices.push_back(idx + 2);
+			}
+		}
+
+		void GLSpriteBatcher::Benchmark() {
+			SPADES_MARK_FUNCTION();
+
+			// an eye at the origin looking at +Y with a 90 degree field of view
+			client::SceneDefinition def;
+			def.viewOrigin = MakeVector3(0.0F, 0.0F, 0.0F);
+			def.viewAxis[0] = MakeVector3(1.0F, 0.0F, 0.0F);
+			def.viewAxis[1] = MakeVector3(0.0F, 0.0F, -1.0F);
+			def.viewAxis[2] = MakeVector3(0.0F, 1.0F, 0.0F);
+
+			Matrix4 projectionViewMatrix;
+			std::fill(projectionViewMatrix.m, projectionViewMatrix.m + 16, 0.0F);
+			projectionViewMatrix.m[0] = 1.0F;   // x' = x
+			projectionViewMatrix.m[9] = -1.0F;  // y' = -z
+			projectionViewMatrix.m[6] = 1.0F;   // z' = y - 0.1
+			projectionViewMatrix.m[14] = -0.1F;
+			projectionViewMatrix.m[7] = 1.0F;   // w' = y
+
+			// smoke, blood and sparks emitted in short runs from a few places
+			const int numImages = 4;
+			const int numSprites = 4000;
+			GLSpriteBatcher batcher;
+			int numImageChanges = 0;
+			GLImage* lastImage = nullptr;
+			while (batcher.GetNumSprites() < numSprites) {
+				GLImage* image = reinterpret_cast<GLImage*>(
+				  static_cast<uintptr_t>(SampleRandomInt(1, numImages)) * 16);
+				Vector3 origin = MakeVector3(SampleRandomFloat() * 60.0F - 30.0F,
+				                             SampleRandomFloat() * 60.0F + 2.0F,
+				                             SampleRandomFloat() * 20.0F - 10.0F);
+				for (int count = SampleRandomInt(1, 8); count > 0; count--) {
+					Instance inst;
+					inst.x = origin.x + SampleRandomFloat() * 4.0F - 2.0F;
+					inst.y = origin.y + SampleRandomFloat() * 4.0F - 2.0F;
+					inst.z = origin.z + SampleRandomFloat() * 4.0F - 2.0F;
+					inst.radius = SampleRandomFloat() * 1.5F + 0.1F;
+					inst.angle = SampleRandomFloat() * 6.0F;
+					inst.r = inst.g = inst.b = inst.a = 1.0F;
+					batcher.Add(image, inst);
+					if (image != lastImage)
+						numImageChanges++;
+					lastImage = image;
+				}
+			}
+
+			const int numIterations = 100;
+			Stopwatch sw;
+			for (int i = 0; i < numIterations; i++)
+				batcher.Build(projectionViewMatrix, def);
+			double buildTime = sw.GetTime() / numIterations;
+
+			// overlapping sprites must be drawn in the submission order
+			const auto& sprites = batcher.sprites;
+			long numViolations = 0;
+			for (std::size_t i = 0; i < sprites.size(); i++)
+				for (std::size_t j = i + 1; j < sprites.size(); j++) {
+					const Sprite& a = sprites[i];
+					const Sprite& b = sprites[j];
+					if (a.slot > b.slot && a.bounds.Intersects(b.bounds))
+						numViolations++;
+				}
+
+			SPLog("Sprite batching benchmark: %d sprites, %d images", numSprites, numImages);
+			SPLog("  build: %.3f ms", buildTime * 1000.0);
+			SPLog("  batches without merging: %d", numImageChanges);
+			SPLog("  batches after merging: %d%s", static_cast<int>(batcher.batches.size()),
+			      numViolations ? " ORDER VIOLATION" : "");
+		}
+	} // namespace draw
+} // namespace spades
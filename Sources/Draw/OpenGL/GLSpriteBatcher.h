@@ -0,0 +1,120 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Core/Math.h>
+
+namespace spades {
+	namespace client {
+		struct SceneDefinition;
+	}
+	namespace draw {
+		class GLImage;
+
+		/**
+		 * Orders the sprites of a frame into as few texture batches as
+		 * possible without changing the blended result.
+		 *
+		 * Sprites are taken in submission order, and each sprite joins the
+		 * most recent batch using its image unless a batch in between
+		 * overlaps it on screen. Premultiplied "over" blending of sprites that
+		 * don't overlap commutes, so the order of overlapping sprites is kept
+		 * and the picture is the same as drawing them one by one.
+		 */
+		class GLSpriteBatcher {
+		public:
+			/** The per-instance attributes of a sprite. */
+			struct Instance {
+				// center position
+				float x, y, z;
+				float radius;
+
+				float angle;
+
+				// color
+				float r, g, b, a;
+			};
+
+			struct Batch {
+				GLImage* image;
+				std::size_t first;
+				std::size_t count;
+			};
+
+			/** A corner of a sprite, for drawing without instancing. */
+			struct Vertex {
+				Instance instance;
+				// point coord
+				float sx, sy;
+			};
+
+		private:
+			/** The number of batches a sprite may be moved back over. */
+			enum { MaxLookBack = 16 };
+
+			struct Sprite {
+				GLImage* image;
+				Instance instance;
+				AABB2 bounds;
+				uint32_t batch;
+				/** The index in `instances`. */
+				uint32_t slot;
+			};
+
+			struct PendingBatch {
+				GLImage* image;
+				AABB2 bounds;
+			};
+
+			std::vector<Sprite> sprites;
+			std::vector<PendingBatch> pendingBatches;
+
+			std::vector<Instance> instances;
+			std::vector<Batch> batches;
+
+		public:
+			void Clear();
+			void Add(GLImage* image, const Instance&);
+
+			std::size_t GetNumSprites() const { return sprites.size(); }
+
+			/** Batches the sprites added since the last `Clear`. */
+			void Build(const Matrix4& projectionViewMatrix, const client::SceneDefinition&);
+
+			/** The instances in drawing order, each batch being a contiguous
+			 * range. Valid after `Build`. */
+			const std::vector<Instance>& GetInstances() const { return instances; }
+			const std::vector<Batch>& GetBatches() const { return batches; }
+
+			/** Expands the instances into quads: the four corners of every
+			 * instance, and two triangles (six indices) per instance in the
+			 * same order. Valid after `Build`. */
+			void BuildQuads(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) const;
+
+			/** Logs the time to build the batches of randomly placed sprites
+			 * using a few interleaved images and the resulting batch counts. */
+			static void Benchmark();
+		};
+	} // namespace draw
+} // namespace spades
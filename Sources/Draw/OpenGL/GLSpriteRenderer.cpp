@@ -18,10 +18,12 @@
 
  */
 
+
 #include "GLSpriteRenderer.h"
 #include "GLImage.h"
 #include "GLProgram.h"
 #include "GLRenderer.h"
+#include "GLSettings.h"
 #include "IGLDevice.h"
 #include "../SW/SWFeatureLevel.h" // for fastRcp
 #include <Core/Debug.h>
@@ -33,6 +35,7 @@ namespace spades {
 		    : renderer(renderer),
 		      device(renderer.GetGLDevice()),
 		      settings(renderer.GetSettings()),
+		      drawer(renderer),
 		      projectionViewMatrix("projectionViewMatrix"),
 		      rightVector("rightVector"),
 		      upVector("upVector"),
@@ -42,23 +45,24 @@ namespace spades {
 		      fogColor("fogColor"),
 		      viewOriginVector("viewOriginVector"),
 		      positionAttribute("positionAttribute"),
-		      spritePosAttribute("spritePosAttribute"),
-		      colorAttribute("colorAttribute") {
+		      angleAttribute("angleAttribute"),
+		      colorAttribute("colorAttribute"),
+		      cornerAttribute("cornerAttribute") {
 			SPADES_MARK_FUNCTION();
 
 			program = renderer.RegisterProgram("Shaders/OpenGL/Sprite.program");
+
+			if (settings.r_spriteBatchBenchmark)
+				GLSpriteBatcher::Benchmark();
 		}
 
-		GLSpriteRenderer::~GLSpriteRenderer() { SPADES_MARK_FUNCTION(); }
+		GLSpriteRenderer::~GLSpriteRenderer() {
+			SPADES_MARK_FUNCTION();
+		}
 
 		void GLSpriteRenderer::Add(spades::draw::GLImage *img, spades::Vector3 center, float rad,
 		                           float ang, Vector4 color) {
 			SPADES_MARK_FUNCTION_DEBUG();
-			Sprite spr;
-			spr.image = img;
-			spr.center = center;
-			spr.radius = rad;
-			spr.angle = ang;
 			if (settings.r_hdr) {
 				// linearize color
 				if (color.x > color.w || color.y > color.w || color.z > color.w) {
@@ -74,18 +78,27 @@ namespace spades {
 					color.z *= color.z * rcp;
 				}
 			}
-			spr.color = color;
-			sprites.push_back(spr);
+
+			GLSpriteBatcher::Instance inst;
+			inst.x = center.x;
+			inst.y = center.y;
+			inst.z = center.z;
+			inst.radius = rad;
+			inst.angle = ang;
+			inst.r = color.x;
+			inst.g = color.y;
+			inst.b = color.z;
+			inst.a = color.w;
+			batcher.Add(img, inst);
 		}
 
 		void GLSpriteRenderer::Clear() {
 			SPADES_MARK_FUNCTION();
-			sprites.clear();
+			batcher.Clear();
 		}
 
 		void GLSpriteRenderer::Render() {
 			SPADES_MARK_FUNCTION();
-			lastImage = NULL;
 			program->Use();
 
 			projectionViewMatrix(program);
@@ -98,8 +111,9 @@ namespace spades {
 			viewOriginVector(program);
 
 			positionAttribute(program);
-			spritePosAttribute(program);
+			angleAttribute(program);
 			colorAttribute(program);
+			cornerAttribute(program);
 
 			projectionViewMatrix.SetValue(renderer.GetProjectionViewMatrix());
 			viewMatrix.SetValue(renderer.GetViewMatrix());
@@ -120,79 +134,13 @@ namespace spades {
 
 			device.ActiveTexture(0);
 
-			device.EnableVertexAttribArray(positionAttribute(), true);
-			device.EnableVertexAttribArray(spritePosAttribute(), true);
-			device.EnableVertexAttribArray(colorAttribute(), true);
-
-			for (size_t i = 0; i < sprites.size(); i++) {
-				Sprite &spr = sprites[i];
-				if (spr.image != lastImage) {
-					Flush();
-					lastImage = spr.image;
-					SPAssert(vertices.empty());
-				}
-
-				Vertex v;
-				v.x = spr.center.x;
-				v.y = spr.center.y;
-				v.z = spr.center.z;
-				v.radius = spr.radius;
-				v.angle = spr.angle;
-				v.r = spr.color.x;
-				v.g = spr.color.y;
-				v.b = spr.color.z;
-				v.a = spr.color.w;
-
-				uint32_t idx = (uint32_t)vertices.size();
-				v.sx = -1;
-				v.sy = -1;
-				vertices.push_back(v);
-				v.sx = 1;
-				v.sy = -1;
-				vertices.push_back(v);
-				v.sx = -1;
-				v.sy = 1;
-				vertices.push_back(v);
-				v.sx = 1;
-				v.sy = 1;
-				vertices.push_back(v);
-
-				indices.push_back(idx);
-				indices.push_back(idx + 1);
-				indices.push_back(idx + 2);
-				indices.push_back(idx + 1);
-				indices.push_back(idx + 3);
-				indices.push_back(idx + 2);
-			}
-
-			Flush();
-
-			device.EnableVertexAttribArray(positionAttribute(), false);
-			device.EnableVertexAttribArray(spritePosAttribute(), false);
-			device.EnableVertexAttribArray(colorAttribute(), false);
+			batcher.Build(renderer.GetProjectionViewMatrix(), def);
+			DrawBatches();
 		}
 
-		void GLSpriteRenderer::Flush() {
-			SPADES_MARK_FUNCTION_DEBUG();
-
-			if (vertices.empty())
-				return;
-
-			device.VertexAttribPointer(positionAttribute(), 4, IGLDevice::FloatType, false,
-			                           sizeof(Vertex), &(vertices[0].x));
-			device.VertexAttribPointer(spritePosAttribute(), 4, IGLDevice::FloatType, false,
-			                           sizeof(Vertex), &(vertices[0].sx));
-			device.VertexAttribPointer(colorAttribute(), 4, IGLDevice::FloatType, false,
-			                           sizeof(Vertex), &(vertices[0].r));
-
-			SPAssert(lastImage);
-			lastImage->Bind(IGLDevice::Texture2D);
-
-			device.DrawElements(IGLDevice::Triangles, static_cast<IGLDevice::Sizei>(indices.size()),
-			                    IGLDevice::UnsignedInt, indices.data());
-
-			vertices.clear();
-			indices.clear();
+		void GLSpriteRenderer::DrawBatches() {
+			drawer.Draw(batcher, {positionAttribute(), angleAttribute(), colorAttribute(),
+			                      cornerAttribute()});
 		}
 	} // namespace draw
 } // namespace spades
@@ -20,11 +20,11 @@
 
 #pragma once
 
-#include <cstdint>
-#include <vector>
-
 #include "GLProgramAttribute.h"
 #include "GLProgramUniform.h"
+#include "GLSpriteBatchDrawer.h"
+#include "GLSpriteBatcher.h"
+#include "IGLDevice.h"
 #include "IGLSpriteRenderer.h"
 #include <Core/Math.h>
 
@@ -34,37 +34,18 @@ namespace spades {
 		class IGLDevice;
 		class GLImage;
 		class GLSettings;
+		/**
+		 * Draws sprites as instanced quads. The sprites of a frame are
+		 * grouped into per-image batches by `GLSpriteBatcher` and uploaded to
+		 * a single stream buffer.
+		 */
 		class GLSpriteRenderer : public IGLSpriteRenderer {
-			struct Sprite {
-				GLImage *image;
-				Vector3 center;
-				float radius;
-				float angle;
-				Vector4 color;
-			};
-
-			struct Vertex {
-				// center position
-				float x, y, z;
-				float radius;
-
-				// point coord
-				float sx, sy;
-				float angle;
-
-				// color
-				float r, g, b, a;
-			};
-
 			GLRenderer &renderer;
 			IGLDevice &device;
 			GLSettings &settings;
-			std::vector<Sprite> sprites;
-
-			GLImage *lastImage;
+			GLSpriteBatcher batcher;
 
-			std::vector<Vertex> vertices;
-			std::vector<uint32_t> indices;
+			GLSpriteBatchDrawer drawer;
 
 			GLProgram *program;
 			GLProgramUniform projectionViewMatrix;
@@ -77,10 +58,11 @@ namespace spades {
 			GLProgramUniform viewOriginVector;
 
 			GLProgramAttribute positionAttribute;
-			GLProgramAttribute spritePosAttribute;
+			GLProgramAttribute angleAttribute;
 			GLProgramAttribute colorAttribute;
+			GLProgramAttribute cornerAttribute;
 
-			void Flush();
+			void DrawBatches();
 
 		public:
 			GLSpriteRenderer(GLRenderer &);
@@ -21,8 +21,6 @@
 #include <cstdlib>
 #include <vector>
 
-#include <kiss_fft130/kiss_fft.h>
-
 #include "GLFramebufferManager.h"
 #include "GLImage.h"
 #include "GLProfiler.h"
@@ -32,407 +30,15 @@
 #include "GLRenderer.h"
 #include "GLShadowShader.h"
 #include "GLWaterRenderer.h"
+#include "GLWaveTank.h"
 #include "IGLDevice.h"
 #include <Client/GameMap.h>
-#include <Core/ConcurrentDispatch.h>
 #include <Core/Debug.h>
 #include <Core/Settings.h>
 
 namespace spades {
 	namespace draw {
 
-#pragma mark - Wave Tank Simulation
-
-		class GLWaterRenderer::IWaveTank : public ConcurrentDispatch {
-		protected:
-			float dt;
-			int size, samples;
-
-		private:
-			uint32_t* bitmap;
-
-			int Encode8bit(float v) {
-				v = (v + 1.0F) * 0.5F * 255.0F;
-				v = floorf(v + 0.5F);
-
-				int i = (int)v;
-				if (i < 0)
-					i = 0;
-				if (i > 255)
-					i = 255;
-				return i;
-			}
-
-			uint32_t MakeBitmapPixel(float dx, float dy, float h) {
-				float x = dx, y = dy, z = 0.04F;
-				float scale = 200.0F;
-				x *= scale;
-				y *= scale;
-				z *= scale;
-
-				uint32_t out;
-				out = Encode8bit(z);
-				out |= Encode8bit(y) << 8;
-				out |= Encode8bit(x) << 16;
-				out |= Encode8bit(h * -10.0F) << 24;
-				return out;
-			}
-
-			void MakeBitmapRow(float* h1, float* h2, float* h3, uint32_t* out) {
-				out[0] = MakeBitmapPixel(h2[1] - h2[size - 1], h3[0] - h1[0], h2[0]);
-				out[size - 1] = MakeBitmapPixel(h2[0] - h2[size - 2], h3[size - 1] - h1[size - 1], h2[size - 1]);
-				for (int x = 1; x < size - 1; x++)
-					out[x] = MakeBitmapPixel(h2[x + 1] - h2[x - 1], h3[x] - h1[x], h2[x]);
-			}
-
-		public:
-			IWaveTank(int size) : size(size) {
-				bitmap = new uint32_t[size * size];
-				samples = size * size;
-			}
-			virtual ~IWaveTank() { delete[] bitmap; }
-			void SetTimeStep(float dt) { this->dt = dt; }
-
-			int GetSize() const { return size; }
-
-			uint32_t* GetBitmap() const { return bitmap; }
-
-			void MakeBitmap(float* height) {
-				MakeBitmapRow(height + (size - 1) * size, height, height + size, bitmap);
-				MakeBitmapRow(height + (size - 2) * size, height + (size - 1) * size, height,
-				              bitmap + (size - 1) * size);
-				for (int y = 1; y < size - 1; y++) {
-					MakeBitmapRow(height + (y - 1) * size, height + y * size,
-					              height + (y + 1) * size, bitmap + y * size);
-				}
-			}
-		};
-
-#pragma mark - FFT Wave Solver
-
-		struct SinCosTable {
-			float sinCoarse[256];
-			float cosCoarse[256];
-			float sinFine[256];
-			float cosFine[256];
-
-		public:
-			SinCosTable() {
-				for (int i = 0; i < 256; i++) {
-					float ang = (float)i / 256.0F * (M_PI_F * 2.0F);
-					sinCoarse[i] = sinf(ang);
-					cosCoarse[i] = cosf(ang);
-
-					ang = (float)i / 65536.0F * (M_PI_F * 2.0F);
-					sinFine[i] = sinf(ang);
-					cosFine[i] = cosf(ang);
-				}
-			}
-
-			void Compute(unsigned int step, float& outSin, float& outCos) {
-				step &= 0xFFFF;
-				if (step == 0) {
-					outSin = 0;
-					outCos = 1.0F;
-					return;
-				}
-
-				int fine = step & 0xFF;
-				int coarse = step >> 8;
-
-				outSin = sinCoarse[coarse];
-				outCos = cosCoarse[coarse];
-
-				if (fine != 0) {
-					float c = cosFine[fine];
-					float s = sinFine[fine];
-					float c2 = outCos * c - outSin * s;
-					float s2 = outCos * s + outSin * c;
-					outCos = c2;
-					outSin = s2;
-				}
-			}
-		};
-
-		static SinCosTable sinCosTable;
-
-		template <int SizeBits> class GLWaterRenderer::FFTWaveTank : public IWaveTank {
-			enum { Size = 1 << SizeBits, SizeHalf = Size / 2 };
-			kiss_fft_cfg fft;
-
-			typedef kiss_fft_cpx Complex;
-
-			struct Cell {
-				float magnitude;
-				uint32_t phase;
-				float phasePerSecond;
-
-				float m00, m01;
-				float m10, m11;
-			};
-
-			Cell cells[SizeHalf + 1][Size];
-
-			Complex spectrum[SizeHalf + 1][Size];
-
-			Complex temp1[Size];
-			Complex temp2[Size];
-			Complex temp3[Size][Size];
-
-			float height[Size][Size];
-
-		public:
-			FFTWaveTank() : IWaveTank(Size) {
-				auto* getRandom = SampleRandomFloat;
-
-				fft = kiss_fft_alloc(Size, 1, NULL, NULL);
-
-				for (int x = 0; x < Size; x++) {
-					for (int y = 0; y <= SizeHalf; y++) {
-						Cell& cell = cells[y][x];
-						if (x == 0 && y == 0) {
-							cell.magnitude = 0;
-							cell.phasePerSecond = 0.0F;
-							cell.phase = 0;
-						} else {
-							int cx = std::min(x, Size - x);
-							float dist = (float)sqrt(cx * cx + y * y);
-							float mag = 0.8F / dist / (float)Size;
-							mag /= dist;
-
-							float scal = dist / (float)SizeHalf;
-							scal *= scal;
-							mag *= expf(-scal * 3.0F);
-
-							cell.magnitude = mag;
-							cell.phase = static_cast<uint32_t>(SampleRandom());
-							cell.phasePerSecond = dist * 1.0E+9F * 128 / Size;
-						}
-
-						cell.m00 = getRandom() - getRandom();
-						cell.m01 = getRandom() - getRandom();
-						cell.m10 = getRandom() - getRandom();
-						cell.m11 = getRandom() - getRandom();
-					}
-				}
-			}
-			~FFTWaveTank() { kiss_fft_free(fft); }
-
-			void Run() override {
-				// advance cells
-				for (int x = 0; x < Size; x++) {
-					for (int y = 0; y <= SizeHalf; y++) {
-						Cell& cell = cells[y][x];
-						uint32_t dphase;
-						dphase = (uint32_t)(cell.phasePerSecond * dt);
-						cell.phase += dphase;
-
-						unsigned int phase = cell.phase >> 16;
-						float c, s;
-						sinCosTable.Compute(phase, s, c);
-
-						float u, v;
-						u = c * cell.m00 + s * cell.m01;
-						v = c * cell.m10 + s * cell.m11;
-
-						spectrum[y][x].r = u * cell.magnitude;
-						spectrum[y][x].i = v * cell.magnitude;
-					}
-				}
-
-				// rfft
-				for (int y = 0; y <= SizeHalf; y++) {
-					for (int x = 0; x < Size; x++)
-						temp1[x] = spectrum[y][x];
-
-					kiss_fft(fft, temp1, temp2);
-
-					if (y == 0) {
-						for (int x = 0; x < Size; x++)
-							temp3[x][0] = temp2[x];
-					} else if (y == SizeHalf) {
-						for (int x = 0; x < Size; x++) {
-							temp3[x][SizeHalf].r = temp2[x].r;
-							temp3[x][SizeHalf].i = 0.0F;
-						}
-					} else {
-						for (int x = 0; x < Size; x++) {
-							temp3[x][y] = temp2[x];
-							temp3[x][Size - y].r = temp2[x].r;
-							temp3[x][Size - y].i = -temp2[x].i;
-						}
-					}
-				}
-				for (int x = 0; x < Size; x++) {
-					kiss_fft(fft, temp3[x], temp2);
-					for (int y = 0; y < Size; y++)
-						height[x][y] = temp2[y].r;
-				}
-
-				MakeBitmap((float*)height);
-			}
-		};
-
-#pragma mark - FTCS PDE Solver
-
-		class GLWaterRenderer::StandardWaveTank : public IWaveTank {
-			float* height;
-			float* heightFiltered;
-			float* velocity;
-
-			template <bool xy> void DoPDELine(float* vy, float* y1, float* y2, float* yy) {
-				int pitch = xy ? size : 1;
-				for (int i = 0; i < size; i++) {
-					float v1 = *y1, v2 = *y2, v = *yy;
-					float force = v1 + v2 - (v + v);
-					force *= dt * 80.0F;
-					*vy += force;
-
-					y1 += pitch;
-					y2 += pitch;
-					yy += pitch;
-					vy += pitch;
-				}
-			}
-
-			template <bool xy> void Denoise(float* arr) {
-				int pitch = xy ? size : 1;
-#if 1
-				if ((arr[0] > 0.0F && arr[(size - 1) * pitch] < 0.0F && arr[pitch] < 0.0F) ||
-				    (arr[0] < 0.0F && arr[(size - 1) * pitch] > 0.0F && arr[pitch] > 0.0F)) {
-					float ttl = (arr[1] + arr[(size - 1) * pitch]) * 0.5F;
-					arr[0] = ttl;
-				}
-				if ((arr[(size - 1) * pitch] > 0.0F && arr[(size - 2) * pitch] < 0.0F &&
-				     arr[0] < 0.0F) ||
-				    (arr[(size - 1) * pitch] < 0.0F && arr[(size - 2) * pitch] > 0.0F &&
-				     arr[0] > 0.0F)) {
-					float ttl = (arr[0] + arr[(size - 2) * pitch]) * 0.5F;
-					arr[(size - 1) * pitch] = ttl;
-				}
-				for (int i = 1; i < size - 1; i++) {
-					if ((arr[i * pitch] > 0.0F && arr[(i - 1) * pitch] < 0.0F &&
-					     arr[(i + 1) * pitch] < 0.0F) ||
-					    (arr[i * pitch] < 0.0F && arr[(i - 1) * pitch] > 0.0F &&
-					     arr[(i + 1) * pitch] > 0.0F)) {
-						float ttl = (arr[(i + 1) * pitch] + arr[(i - 1) * pitch]) * 0.5F;
-						arr[i * pitch] = ttl;
-					}
-				}
-#else
-				// Lax-Friedrich
-				float buf[256]; // TODO: variable size
-				SPAssert(size <= 256);
-				for (int i = 0; i < size; i++)
-					buf[i] = arr[i * pitch] * 0.5F;
-
-				arr[0] = buf[1] + buf[size - 1];
-				arr[(size - 1) * pitch] = buf[size - 2] + buf[0];
-
-				for (int i = 1; i < size - 1; i++)
-					arr[i * pitch] = buf[i - 1] + buf[i + 1];
-#endif
-			}
-
-		public:
-			StandardWaveTank(int size) : IWaveTank(size) {
-				height = new float[size * size];
-				heightFiltered = new float[size * size];
-				velocity = new float[size * size];
-				std::fill(height, height + size * size, 0.0F);
-				std::fill(velocity, velocity + size * size, 0.0F);
-			}
-
-			~StandardWaveTank() {
-
-				delete[] height;
-				delete[] heightFiltered;
-				delete[] velocity;
-			}
-
-			void Run() override {
-				// advance time
-				for (int i = 0; i < samples; i++)
-					height[i] += velocity[i] * dt;
-#ifndef NDEBUG
-				for (int i = 0; i < samples; i++)
-					SPAssert(!std::isnan(height[i]));
-				for (int i = 0; i < samples; i++)
-					SPAssert(!std::isnan(velocity[i]));
-#endif
-
-				// solve ddz/dtt = c^2 (ddz/dxx + ddz/dyy)
-
-				// do ddz/dyy
-				DoPDELine<false>(velocity, height + (size - 1) * size, height + size, height);
-				DoPDELine<false>(velocity + (size - 1) * size, height + (size - 2) * size, height,
-					height + (size - 1) * size);
-				for (int y = 1; y < size - 1; y++) {
-					DoPDELine<false>(velocity + y * size, height + (y - 1) * size,
-					                 height + (y + 1) * size, height + y * size);
-				}
-
-				// do ddz/dxx
-				DoPDELine<true>(velocity, height + (size - 1), height + 1, height);
-				DoPDELine<true>(velocity + (size - 1), height + (size - 2), height, height + (size - 1));
-				for (int x = 1; x < size - 1; x++)
-					DoPDELine<true>(velocity + x, height + (x - 1), height + (x + 1), height + x);
-
-				// make average 0
-				float sum = 0.0F;
-				for (int i = 0; i < samples; i++)
-					sum += height[i];
-				sum /= (float)samples;
-				for (int i = 0; i < samples; i++)
-					height[i] -= sum;
-
-				// limit energy
-				sum = 0.0F;
-				for (int i = 0; i < samples; i++) {
-					sum += height[i] * height[i];
-					sum += velocity[i] * velocity[i];
-				}
-				sum = sqrtf(sum / (float)samples / 2.0F) * 80.0F;
-				if (sum > 1.0F) {
-					sum = 1.0F / sum;
-					for (int i = 0; i < samples; i++) {
-						height[i] *= sum;
-						velocity[i] *= sum;
-					}
-				}
-
-				// denoise
-				for (int i = 0; i < size; i++)
-					Denoise<true>(height + i);
-				for (int i = 0; i < size; i++)
-					Denoise<false>(height + i * size);
-
-				// add randomness
-				int count = (int)floorf(dt * 600.0F);
-				if (count > 400)
-					count = 400;
-
-				for (int i = 0; i < count; i++) {
-					int ox = SampleRandomInt(0, size - 3);
-					int oy = SampleRandomInt(0, size - 3);
-					static const float gauss[] = {
-						0.225610111284052F, 0.548779777431897F, 0.225610111284052F
-					};
-					float strength = (SampleRandomFloat() - SampleRandomFloat()) * 0.15F * 100.0F;
-					for (int x = 0; x < 3; x++)
-					for (int y = 0; y < 3; y++) {
-						velocity[(x + ox) + (y + oy) * size] += strength * gauss[x] * gauss[y];
-					}
-				}
-
-				for (int i = 0; i < samples; i++)
-					heightFiltered[i] = height[i]; // * height[i] * 100.0F;
-
-				// build bitmap
-				MakeBitmap(heightFiltered);
-			}
-		};
-
 #pragma mark - Water Renderer
 
 		void GLWaterRenderer::PreloadShaders(GLRenderer& renderer) {
@@ -499,21 +105,24 @@ namespace spades {
 				IGLDevice::BGRA, IGLDevice::UnsignedByte, bitmap.data());
 
 			size_t numLayers = ((int)settings.r_water >= 2) ? 3 : 1;
+			int waveTankSizeBits = ((int)settings.r_water >= 3) ? 8 : 7;
+
+			if (settings.r_waterBenchmark)
+				GLWaveSimulation::Benchmark(waveTankSizeBits, static_cast<int>(numLayers));
 
 			// create wave tank simlation
-			for (size_t i = 0; i < numLayers; i++) {
-				if ((int)settings.r_water >= 3)
-					waveTanks.push_back(new FFTWaveTank<8>());
-				else
-					waveTanks.push_back(new FFTWaveTank<7>());
-			}
+			std::vector<std::unique_ptr<GLWaveTank>> waveTanks;
+			for (size_t i = 0; i < numLayers; i++)
+				waveTanks.emplace_back(new GLFFTWaveTank(waveTankSizeBits));
+			waveSimulation.reset(new GLWaveSimulation(std::move(waveTanks)));
+			GLWaveTank& waveTank = waveSimulation->GetTank(0);
 
 			// create heightmap texture
 			waveTexture = device.GenTexture();
 			if (numLayers == 1) {
 				device.BindTexture(IGLDevice::Texture2D, waveTexture);
 				device.TexImage2D(IGLDevice::Texture2D, 0, IGLDevice::RGBA8,
-				                  waveTanks[0]->GetSize(), waveTanks[0]->GetSize(), 0,
+				                  waveTank.GetSize(), waveTank.GetSize(), 0,
 				                  IGLDevice::BGRA, IGLDevice::UnsignedByte, NULL);
 				device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureMagFilter, IGLDevice::Linear);
 				device.TexParamater(IGLDevice::Texture2D, IGLDevice::TextureMinFilter, IGLDevice::LinearMipmapLinear);
@@ -526,7 +135,7 @@ namespace spades {
 			} else {
 				device.BindTexture(IGLDevice::Texture2DArray, waveTexture);
 				device.TexImage3D(IGLDevice::Texture2DArray, 0, IGLDevice::RGBA8,
-				                  waveTanks[0]->GetSize(), waveTanks[0]->GetSize(),
+				                  waveTank.GetSize(), waveTank.GetSize(),
 				                  static_cast<IGLDevice::Sizei>(numLayers), 0, IGLDevice::BGRA,
 				                  IGLDevice::UnsignedByte, NULL);
 				device.TexParamater(IGLDevice::Texture2DArray, IGLDevice::TextureMagFilter, IGLDevice::Linear);
@@ -608,10 +217,7 @@ namespace spades {
 			if (occlusionQuery)
 				device.DeleteQuery(occlusionQuery);
 
-			for (size_t i = 0; i < waveTanks.size(); i++) {
-				waveTanks[i]->Join();
-				delete waveTanks[i];
-			}
+			waveSimulation.reset();
 			device.DeleteTexture(waveTexture);
 		}
 
@@ -739,13 +345,13 @@ namespace spades {
 
 				static GLShadowShader shadowShader;
 
-				if (waveTanks.size() == 1) {
+				if (waveSimulation->GetNumTanks() == 1) {
 					device.ActiveTexture(3);
 					device.BindTexture(IGLDevice::Texture2D, waveTexture);
 					waveTextureUnif.SetValue(3);
 
 					shadowShader(&renderer, prg, 4);
-				} else if (waveTanks.size() == 3) {
+				} else if (waveSimulation->GetNumTanks() == 3) {
 					device.ActiveTexture(3);
 					device.BindTexture(IGLDevice::Texture2DArray, waveTexture);
 					waveTextureArrayUnif.SetValue(3);
@@ -823,30 +429,31 @@ namespace spades {
 			// update wavetank simulation
 			{
 				GLProfiler::Context profiler(renderer.GetGLProfiler(), "Waiting for Simulation To Done");
-				for (size_t i = 0; i < waveTanks.size(); i++)
-					waveTanks[i]->Join();
+				waveSimulation->Join();
 			}
 			{
 				{
 					GLProfiler::Context profiler(renderer.GetGLProfiler(), "Upload");
-					if (waveTanks.size() == 1) {
+					if (waveSimulation->GetNumTanks() == 1) {
+						GLWaveTank& waveTank = waveSimulation->GetTank(0);
 						device.BindTexture(IGLDevice::Texture2D, waveTexture);
-						device.TexSubImage2D(IGLDevice::Texture2D, 0, 0, 0, waveTanks[0]->GetSize(),
-						                     waveTanks[0]->GetSize(), IGLDevice::BGRA,
-						                     IGLDevice::UnsignedByte, waveTanks[0]->GetBitmap());
+						device.TexSubImage2D(IGLDevice::Texture2D, 0, 0, 0, waveTank.GetSize(),
+						                     waveTank.GetSize(), IGLDevice::BGRA,
+						                     IGLDevice::UnsignedByte, waveTank.GetBitmap());
 					} else {
 						device.BindTexture(IGLDevice::Texture2DArray, waveTexture);
-						for (size_t i = 0; i < waveTanks.size(); i++) {
+						for (size_t i = 0; i < waveSimulation->GetNumTanks(); i++) {
+							GLWaveTank& waveTank = waveSimulation->GetTank(i);
 							device.TexSubImage3D(
 							  IGLDevice::Texture2DArray, 0, 0, 0, static_cast<IGLDevice::Sizei>(i),
-							  waveTanks[i]->GetSize(), waveTanks[i]->GetSize(), 1, IGLDevice::BGRA,
-							  IGLDevice::UnsignedByte, waveTanks[i]->GetBitmap());
+							  waveTank.GetSize(), waveTank.GetSize(), 1, IGLDevice::BGRA,
+							  IGLDevice::UnsignedByte, waveTank.GetBitmap());
 						}
 					}
 				}
 				{
 					GLProfiler::Context profiler(renderer.GetGLProfiler(), "Generate Mipmap");
-					if (waveTanks.size() == 1) {
+					if (waveSimulation->GetNumTanks() == 1) {
 						device.BindTexture(IGLDevice::Texture2D, waveTexture);
 						device.GenerateMipmap(IGLDevice::Texture2D);
 					} else {
@@ -856,14 +463,15 @@ namespace spades {
 				}
 			}
 
-			for (size_t i = 0; i < waveTanks.size(); i++) {
+			for (size_t i = 0; i < waveSimulation->GetNumTanks(); i++) {
+				GLWaveTank& waveTank = waveSimulation->GetTank(i);
 				switch (i) {
-					case 0: waveTanks[i]->SetTimeStep(dt); break;
-					case 1: waveTanks[i]->SetTimeStep(dt * 0.15704F / 0.08F); break;
-					case 2: waveTanks[i]->SetTimeStep(dt * 0.02344F / 0.08F); break;
+					case 0: waveTank.SetTimeStep(dt); break;
+					case 1: waveTank.SetTimeStep(dt * 0.15704F / 0.08F); break;
+					case 2: waveTank.SetTimeStep(dt * 0.02344F / 0.08F); break;
 				}
-				waveTanks[i]->Start();
 			}
+			waveSimulation->Start();
 
 			{
 				GLProfiler::Context profiler(renderer.GetGLProfiler(), "Upload Water Color Texture");
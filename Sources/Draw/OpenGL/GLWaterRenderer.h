@@ -21,6 +21,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "IGLDevice.h"
@@ -34,17 +35,15 @@ namespace spades {
 		class IGLDevice;
 		class GLProgram;
 		class GLSettings;
+		class GLWaveSimulation;
 		class GLWaterRenderer {
-			class IWaveTank;
-			class StandardWaveTank;
-			template <int SizeBits> class FFTWaveTank;
 
 			GLRenderer &renderer;
 			IGLDevice &device;
 			GLSettings &settings;
 			client::GameMap *map;
 
-			std::vector<IWaveTank *> waveTanks;
+			std::unique_ptr<GLWaveSimulation> waveSimulation;
 
 			int w, h;
 
@@ -0,0 +1,612 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#include <algorithm>
+#include <cmath>
+
+#include "../SW/SWFeatureLevel.h" // for ENABLE_SSE2
+#include "GLWaveTank.h"
+#include <Core/Debug.h>
+#include <Core/Math.h>
+#include <Core/Parallel.h>
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	namespace draw {
+
+#pragma mark - Bitmap Packing
+
+		namespace {
+			int Encode8bit(float v) {
+				v = (v + 1.0F) * 0.5F * 255.0F;
+				v = floorf(v + 0.5F);
+
+				int i = (int)v;
+				if (i < 0)
+					i = 0;
+				if (i > 255)
+					i = 255;
+				return i;
+			}
+
+			uint32_t MakeBitmapPixel(float dx, float dy, float h) {
+				float x = dx, y = dy, z = 0.04F;
+				float scale = 200.0F;
+				x *= scale;
+				y *= scale;
+				z *= scale;
+
+				uint32_t out;
+				out = Encode8bit(z);
+				out |= Encode8bit(y) << 8;
+				out |= Encode8bit(x) << 16;
+				out |= Encode8bit(h * -10.0F) << 24;
+				return out;
+			}
+
+			void MakeBitmapRowReference(const float* h1, const float* h2, const float* h3,
+			                            uint32_t* out, int size) {
+				out[0] = MakeBitmapPixel(h2[1] - h2[size - 1], h3[0] - h1[0], h2[0]);
+				out[size - 1] = MakeBitmapPixel(h2[0] - h2[size - 2], h3[size - 1] - h1[size - 1], h2[size - 1]);
+				for (int x = 1; x < size - 1; x++)
+					out[x] = MakeBitmapPixel(h2[x + 1] - h2[x - 1], h3[x] - h1[x], h2[x]);
+			}
+
+#if ENABLE_SSE2
+			/** `Encode8bit` for 4 values. Clamping before the truncation gives
+			 * the same result as clamping the floored value. */
+			__m128i Encode8bitSSE2(__m128 v) {
+				const __m128 half = _mm_set1_ps(0.5F);
+				const __m128 c255 = _mm_set1_ps(255.0F);
+				v = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(v, _mm_set1_ps(1.0F)), half), c255);
+				v = _mm_add_ps(v, half);
+				v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), c255);
+				return _mm_cvttps_epi32(v);
+			}
+#endif
+
+			void MakeBitmapRow(const float* h1, const float* h2, const float* h3, uint32_t* out,
+			                   int size) {
+				out[0] = MakeBitmapPixel(h2[1] - h2[size - 1], h3[0] - h1[0], h2[0]);
+				out[size - 1] = MakeBitmapPixel(h2[0] - h2[size - 2], h3[size - 1] - h1[size - 1], h2[size - 1]);
+
+				int x = 1;
+#if ENABLE_SSE2
+				const __m128 scale = _mm_set1_ps(200.0F);
+				const __m128 heightScale = _mm_set1_ps(-10.0F);
+				const __m128i blue = _mm_set1_epi32(Encode8bit(0.04F * 200.0F));
+				for (; x + 4 <= size - 1; x += 4) {
+					__m128 dx = _mm_sub_ps(_mm_loadu_ps(h2 + x + 1), _mm_loadu_ps(h2 + x - 1));
+					__m128 dy = _mm_sub_ps(_mm_loadu_ps(h3 + x), _mm_loadu_ps(h1 + x));
+					__m128 h = _mm_loadu_ps(h2 + x);
+
+					__m128i pixels = blue;
+					pixels = _mm_or_si128(pixels, _mm_slli_epi32(Encode8bitSSE2(_mm_mul_ps(dy, scale)), 8));
+					pixels = _mm_or_si128(pixels, _mm_slli_epi32(Encode8bitSSE2(_mm_mul_ps(dx, scale)), 16));
+					pixels = _mm_or_si128(pixels, _mm_slli_epi32(Encode8bitSSE2(_mm_mul_ps(h, heightScale)), 24));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), pixels);
+				}
+#endif
+				for (; x < size - 1; x++)
+					out[x] = MakeBitmapPixel(h2[x + 1] - h2[x - 1], h3[x] - h1[x], h2[x]);
+			}
+		} // namespace
+
+		GLWaveTank::GLWaveTank(int size) : size(size), samples(size * size) {
+			bitmap.resize(samples);
+		}
+
+		GLWaveTank::~GLWaveTank() {}
+
+		void GLWaveTank::MakeBitmapTask(const float* height, int index) {
+			int endY = std::min((index + 1) * BitmapRowsPerTask, size);
+			for (int y = index * BitmapRowsPerTask; y < endY; y++) {
+				int y1 = (y + size - 1) % size, y3 = (y + 1) % size;
+				MakeBitmapRow(height + y1 * size, height + y * size, height + y3 * size,
+				              bitmap.data() + y * size, size);
+			}
+		}
+
+		void GLWaveTank::MakeBitmapReference(const float* height) {
+			for (int y = 0; y < size; y++) {
+				int y1 = (y + size - 1) % size, y3 = (y + 1) % size;
+				MakeBitmapRowReference(height + y1 * size, height + y * size,
+				                       height + y3 * size, bitmap.data() + y * size, size);
+			}
+		}
+
+#pragma mark - FFT Wave Solver
+
+		namespace {
+			struct SinCosTable {
+				float sinCoarse[256];
+				float cosCoarse[256];
+				float sinFine[256];
+				float cosFine[256];
+
+			public:
+				SinCosTable() {
+					for (int i = 0; i < 256; i++) {
+						float ang = (float)i / 256.0F * (M_PI_F * 2.0F);
+						sinCoarse[i] = sinf(ang);
+						cosCoarse[i] = cosf(ang);
+
+						ang = (float)i / 65536.0F * (M_PI_F * 2.0F);
+						sinFine[i] = sinf(ang);
+						cosFine[i] = cosf(ang);
+					}
+				}
+
+				void Compute(unsigned int step, float& outSin, float& outCos) const {
+					step &= 0xFFFF;
+					if (step == 0) {
+						outSin = 0;
+						outCos = 1.0F;
+						return;
+					}
+
+					int fine = step & 0xFF;
+					int coarse = step >> 8;
+
+					outSin = sinCoarse[coarse];
+					outCos = cosCoarse[coarse];
+
+					if (fine != 0) {
+						float c = cosFine[fine];
+						float s = sinFine[fine];
+						float c2 = outCos * c - outSin * s;
+						float s2 = outCos * s + outSin * c;
+						outCos = c2;
+						outSin = s2;
+					}
+				}
+			};
+
+			const SinCosTable sinCosTable;
+		} // namespace
+
+		GLFFTWaveTank::GLFFTWaveTank(int sizeBits)
+		    : GLWaveTank(1 << sizeBits), sizeHalf(size / 2) {
+			auto* getRandom = SampleRandomFloat;
+
+			fft = kiss_fft_alloc(size, 1, NULL, NULL);
+
+			const std::size_t halfSamples = static_cast<std::size_t>(sizeHalf + 1) * size;
+			cells.resize(halfSamples);
+			spectrum.resize(halfSamples);
+			rows.resize(halfSamples);
+			columns.resize(samples);
+			result.resize(samples);
+			height.resize(samples);
+
+			for (int x = 0; x < size; x++) {
+				for (int y = 0; y <= sizeHalf; y++) {
+					Cell& cell = cells[x + y * size];
+					if (x == 0 && y == 0) {
+						cell.magnitude = 0;
+						cell.phasePerSecond = 0.0F;
+						cell.phase = 0;
+					} else {
+						int cx = std::min(x, size - x);
+						float dist = (float)sqrt(cx * cx + y * y);
+						float mag = 0.8F / dist / (float)size;
+						mag /= dist;
+
+						float scal = dist / (float)sizeHalf;
+						scal *= scal;
+						mag *= expf(-scal * 3.0F);
+
+						cell.magnitude = mag;
+						cell.phase = static_cast<uint32_t>(SampleRandom());
+						cell.phasePerSecond = dist * 1.0E+9F * 128 / size;
+					}
+
+					cell.m00 = getRandom() - getRandom();
+					cell.m01 = getRandom() - getRandom();
+					cell.m10 = getRandom() - getRandom();
+					cell.m11 = getRandom() - getRandom();
+				}
+			}
+		}
+
+		GLFFTWaveTank::~GLFFTWaveTank() { kiss_fft_free(fft); }
+
+		int GLFFTWaveTank::GetNumTasks(int stage) const {
+			switch (stage) {
+				case 0: return sizeHalf + 1;
+				case 1: return size;
+				case 2: return GetNumBitmapTasks();
+				default: return 0;
+			}
+		}
+
+		void GLFFTWaveTank::RunTask(int stage, int index) {
+			switch (stage) {
+				case 0: TransformRow(index); break;
+				case 1: TransformColumn(index); break;
+				case 2: MakeBitmapTask(height.data(), index); break;
+			}
+		}
+
+		void GLFFTWaveTank::RunReference() {
+			for (int y = 0; y <= sizeHalf; y++)
+				TransformRow(y);
+			for (int x = 0; x < size; x++)
+				TransformColumn(x);
+			MakeBitmapReference(height.data());
+		}
+
+		void GLFFTWaveTank::TransformRow(int y) {
+			// advance cells
+			Cell* cellRow = cells.data() + y * size;
+			kiss_fft_cpx* spectrumRow = spectrum.data() + y * size;
+			for (int x = 0; x < size; x++) {
+				Cell& cell = cellRow[x];
+				uint32_t dphase;
+				dphase = (uint32_t)(cell.phasePerSecond * dt);
+				cell.phase += dphase;
+
+				unsigned int phase = cell.phase >> 16;
+				float c, s;
+				sinCosTable.Compute(phase, s, c);
+
+				float u, v;
+				u = c * cell.m00 + s * cell.m01;
+				v = c * cell.m10 + s * cell.m11;
+
+				spectrumRow[x].r = u * cell.magnitude;
+				spectrumRow[x].i = v * cell.magnitude;
+			}
+
+			// rfft: the lower half of the spectrum is the conjugate of the
+			// upper half
+			kiss_fft_cpx* row = rows.data() + y * size;
+			kiss_fft(fft, spectrumRow, row);
+
+			if (y == 0) {
+				for (int x = 0; x < size; x++)
+					columns[x * size] = row[x];
+			} else if (y == sizeHalf) {
+				for (int x = 0; x < size; x++) {
+					columns[x * size + sizeHalf].r = row[x].r;
+					columns[x * size + sizeHalf].i = 0.0F;
+				}
+			} else {
+				for (int x = 0; x < size; x++) {
+					columns[x * size + y] = row[x];
+					columns[x * size + size - y].r = row[x].r;
+					columns[x * size + size - y].i = -row[x].i;
+				}
+			}
+		}
+
+		void GLFFTWaveTank::TransformColumn(int x) {
+			kiss_fft_cpx* out = result.data() + x * size;
+			kiss_fft(fft, columns.data() + x * size, out);
+			for (int y = 0; y < size; y++)
+				height[x * size + y] = out[y].r;
+		}
+
+#pragma mark - FTCS PDE Solver
+
+		GLStandardWaveTank::GLStandardWaveTank(int size) : GLWaveTank(size) {
+			height.resize(samples, 0.0F);
+			heightFiltered.resize(samples);
+			velocity.resize(samples, 0.0F);
+		}
+
+		GLStandardWaveTank::~GLStandardWaveTank() {}
+
+		int GLStandardWaveTank::GetNumTasks(int stage) const {
+			switch (stage) {
+				case 0: return 1;
+				case 1: return GetNumBitmapTasks();
+				default: return 0;
+			}
+		}
+
+		void GLStandardWaveTank::RunTask(int stage, int index) {
+			switch (stage) {
+				case 0: Simulate(); break;
+				case 1: MakeBitmapTask(heightFiltered.data(), index); break;
+			}
+		}
+
+		void GLStandardWaveTank::RunReference() {
+			Simulate();
+			MakeBitmapReference(heightFiltered.data());
+		}
+
+		template <bool xy>
+		void GLStandardWaveTank::DoPDELine(float* vy, float* y1, float* y2, float* yy) {
+			int pitch = xy ? size : 1;
+			for (int i = 0; i < size; i++) {
+				float v1 = *y1, v2 = *y2, v = *yy;
+				float force = v1 + v2 - (v + v);
+				force *= dt * 80.0F;
+				*vy += force;
+
+				y1 += pitch;
+				y2 += pitch;
+				yy += pitch;
+				vy += pitch;
+			}
+		}
+
+		template <bool xy> void GLStandardWaveTank::Denoise(float* arr) {
+			int pitch = xy ? size : 1;
+#if 1
+			if ((arr[0] > 0.0F && arr[(size - 1) * pitch] < 0.0F && arr[pitch] < 0.0F) ||
+			    (arr[0] < 0.0F && arr[(size - 1) * pitch] > 0.0F && arr[pitch] > 0.0F)) {
+				float ttl = (arr[1] + arr[(size - 1) * pitch]) * 0.5F;
+				arr[0] = ttl;
+			}
+			if ((arr[(size - 1) * pitch] > 0.0F && arr[(size - 2) * pitch] < 0.0F &&
+			     arr[0] < 0.0F) ||
+			    (arr[(size - 1) * pitch] < 0.0F && arr[(size - 2) * pitch] > 0.0F &&
+			     arr[0] > 0.0F)) {
+				float ttl = (arr[0] + arr[(size - 2) * pitch]) * 0.5F;
+				arr[(size - 1) * pitch] = ttl;
+			}
+			for (int i = 1; i < size - 1; i++) {
+				if ((arr[i * pitch] > 0.0F && arr[(i - 1) * pitch] < 0.0F &&
+				     arr[(i + 1) * pitch] < 0.0F) ||
+				    (arr[i * pitch] < 0.0F && arr[(i - 1) * pitch] > 0.0F &&
+				     arr[(i + 1) * pitch] > 0.0F)) {
+					float ttl = (arr[(i + 1) * pitch] + arr[(i - 1) * pitch]) * 0.5F;
+					arr[i * pitch] = ttl;
+				}
+			}
+#else
+			// Lax-Friedrich
+			float buf[256]; // TODO: variable size
+			SPAssert(size <= 256);
+			for (int i = 0; i < size; i++)
+				buf[i] = arr[i * pitch] * 0.5F;
+
+			arr[0] = buf[1] + buf[size - 1];
+			arr[(size - 1) * pitch] = buf[size - 2] + buf[0];
+
+			for (int i = 1; i < size - 1; i++)
+				arr[i * pitch] = buf[i - 1] + buf[i + 1];
+#endif
+		}
+
+		void GLStandardWaveTank::Simulate() {
+			float* height = this->height.data();
+			float* velocity = this->velocity.data();
+
+			// advance time
+			for (int i = 0; i < samples; i++)
+				height[i] += velocity[i] * dt;
+#ifndef NDEBUG
+			for (int i = 0; i < samples; i++)
+				SPAssert(!std::isnan(height[i]));
+			for (int i = 0; i < samples; i++)
+				SPAssert(!std::isnan(velocity[i]));
+#endif
+
+			// solve ddz/dtt = c^2 (ddz/dxx + ddz/dyy)
+
+			// do ddz/dyy
+			DoPDELine<false>(velocity, height + (size - 1) * size, height + size, height);
+			DoPDELine<false>(velocity + (size - 1) * size, height + (size - 2) * size, height,
+				height + (size - 1) * size);
+			for (int y = 1; y < size - 1; y++) {
+				DoPDELine<false>(velocity + y * size, height + (y - 1) * size,
+				                 height + (y + 1) * size, height + y * size);
+			}
+
+			// do ddz/dxx
+			DoPDELine<true>(velocity, height + (size - 1), height + 1, height);
+			DoPDELine<true>(velocity + (size - 1), height + (size - 2), height, height + (size - 1));
+			for (int x = 1; x < size - 1; x++)
+				DoPDELine<true>(velocity + x, height + (x - 1), height + (x + 1), height + x);
+
+			// make average 0
+			float sum = 0.0F;
+			for (int i = 0; i < samples; i++)
+				sum += height[i];
+			sum /= (float)samples;
+			for (int i = 0; i < samples; i++)
+				height[i] -= sum;
+
+			// limit energy
+			sum = 0.0F;
+			for (int i = 0; i < samples; i++) {
+				sum += height[i] * height[i];
+				sum += velocity[i] * velocity[i];
+			}
+			sum = sqrtf(sum / (float)samples / 2.0F) * 80.0F;
+			if (sum > 1.0F) {
+				sum = 1.0F / sum;
+				for (int i = 0; i < samples; i++) {
+					height[i] *= sum;
+					velocity[i] *= sum;
+				}
+			}
+
+			// denoise
+			for (int i = 0; i < size; i++)
+				Denoise<true>(height + i);
+			for (int i = 0; i < size; i++)
+				Denoise<false>(height + i * size);
+
+			// add randomness
+			int count = (int)floorf(dt * 600.0F);
+			if (count > 400)
+				count = 400;
+
+			for (int i = 0; i < count; i++) {
+				int ox = SampleRandomInt(0, size - 3);
+				int oy = SampleRandomInt(0, size - 3);
+				static const float gauss[] = {
+					0.225610111284052F, 0.548779777431897F, 0.225610111284052F
+				};
+				float strength = (SampleRandomFloat() - SampleRandomFloat()) * 0.15F * 100.0F;
+				for (int x = 0; x < 3; x++)
+				for (int y = 0; y < 3; y++) {
+					velocity[(x + ox) + (y + oy) * size] += strength * gauss[x] * gauss[y];
+				}
+			}
+
+			for (int i = 0; i < samples; i++)
+				heightFiltered[i] = height[i]; // * height[i] * 100.0F;
+		}
+
+#pragma mark - Simulation
+
+		class GLWaveSimulation::Worker : public ConcurrentDispatch {
+			GLWaveSimulation& simulation;
+
+		public:
+			Worker(GLWaveSimulation& simulation) : simulation(simulation) {}
+			void Run() override { simulation.Work(); }
+		};
+
+		GLWaveSimulation::GLWaveSimulation(std::vector<std::unique_ptr<GLWaveTank>> inTanks)
+		    : tanks(std::move(inTanks)) {
+			SPADES_MARK_FUNCTION();
+
+			numStages = 0;
+			for (const auto& tank : tanks)
+				numStages = std::max(numStages, tank->GetNumStages());
+
+			int maxTasks = 0;
+			taskOffsets.resize(numStages);
+			for (int stage = 0; stage < numStages; stage++) {
+				auto& offsets = taskOffsets[stage];
+				offsets.push_back(0);
+				for (const auto& tank : tanks) {
+					int numTasks = stage < tank->GetNumStages() ? tank->GetNumTasks(stage) : 0;
+					offsets.push_back(offsets.back() + numTasks);
+				}
+				maxTasks = std::max(maxTasks, offsets.back());
+			}
+
+			nextTask.reset(new std::atomic<int>[numStages]);
+			doneTasks.reset(new std::atomic<int>[numStages]);
+
+			unsigned int numWorkers = GetNumHardwareThreads();
+			numWorkers = std::min(numWorkers, static_cast<unsigned int>(std::max(maxTasks, 1)));
+			for (unsigned int i = 0; i < numWorkers; i++)
+				workers.emplace_back(new Worker(*this));
+		}
+
+		GLWaveSimulation::~GLWaveSimulation() {
+			SPADES_MARK_FUNCTION();
+			Join();
+		}
+
+		void GLWaveSimulation::Start() {
+			SPADES_MARK_FUNCTION();
+
+			for (int stage = 0; stage < numStages; stage++) {
+				nextTask[stage] = 0;
+				doneTasks[stage] = 0;
+			}
+			for (auto& worker : workers)
+				worker->Start();
+		}
+
+		void GLWaveSimulation::Join() {
+			SPADES_MARK_FUNCTION();
+			for (auto& worker : workers)
+				worker->Join();
+		}
+
+		void GLWaveSimulation::Work() {
+			for (int stage = 0; stage < numStages; stage++) {
+				const auto& offsets = taskOffsets[stage];
+				const int numTasks = offsets.back();
+
+				int task;
+				while ((task = nextTask[stage].fetch_add(1)) < numTasks) {
+					std::size_t tank = 0;
+					while (task >= offsets[tank + 1])
+						tank++;
+					tanks[tank]->RunTask(stage, task - offsets[tank]);
+					if (doneTasks[stage].fetch_add(1) + 1 == numTasks) {
+						std::lock_guard<std::mutex> lock{stageMutex};
+						stageDone.notify_all();
+					}
+				}
+
+				// only the tasks claimed by running workers are left
+				std::unique_lock<std::mutex> lock{stageMutex};
+				stageDone.wait(lock, [&] { return doneTasks[stage].load() >= numTasks; });
+			}
+		}
+
+		void GLWaveSimulation::Benchmark(int sizeBits, int numTanks) {
+			SPADES_MARK_FUNCTION();
+
+			std::vector<std::unique_ptr<GLWaveTank>> tanks;
+			for (int i = 0; i < numTanks; i++)
+				tanks.emplace_back(new GLFFTWaveTank(sizeBits));
+			GLWaveSimulation simulation{std::move(tanks)};
+
+			SPLog("Water simulation benchmark: %d tank(s) of %dx%d", numTanks, 1 << sizeBits,
+			      1 << sizeBits);
+
+			// a zero time step repeats the same step, so both methods can be
+			// compared on the same tanks
+			for (std::size_t i = 0; i < simulation.GetNumTanks(); i++) {
+				simulation.GetTank(i).SetTimeStep(1.0F / 60.0F);
+				simulation.GetTank(i).RunReference();
+				simulation.GetTank(i).SetTimeStep(0.0F);
+			}
+
+			const int numSteps = 50;
+			const std::size_t bitmapSize = static_cast<std::size_t>(1) << (sizeBits * 2);
+
+			Stopwatch sw;
+			for (int step = 0; step < numSteps; step++)
+				for (std::size_t i = 0; i < simulation.GetNumTanks(); i++)
+					simulation.GetTank(i).RunReference();
+			double referenceTime = sw.GetTime() / numSteps;
+
+			std::vector<uint32_t> reference;
+			for (std::size_t i = 0; i < simulation.GetNumTanks(); i++) {
+				const uint32_t* bitmap = simulation.GetTank(i).GetBitmap();
+				reference.insert(reference.end(), bitmap, bitmap + bitmapSize);
+			}
+
+			sw.Reset();
+			for (int step = 0; step < numSteps; step++) {
+				simulation.Start();
+				simulation.Join();
+			}
+			double parallelTime = sw.GetTime() / numSteps;
+
+			bool matches = true;
+			for (std::size_t i = 0; i < simulation.GetNumTanks(); i++) {
+				const uint32_t* bitmap = simulation.GetTank(i).GetBitmap();
+				matches &= std::equal(bitmap, bitmap + bitmapSize,
+				                      reference.begin() + i * bitmapSize);
+			}
+
+			SPLog("  one thread, scalar packing: %.3f ms", referenceTime * 1000.0);
+			SPLog("  %d workers, SIMD packing: %.3f ms (%.2fx)%s",
+			      static_cast<int>(simulation.workers.size()), parallelTime * 1000.0,
+			      referenceTime / std::max(parallelTime, 1.0e-9), matches ? "" : " MISMATCH");
+		}
+	} // namespace draw
+} // namespace spades
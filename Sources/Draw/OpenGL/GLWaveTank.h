@@ -0,0 +1,189 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <kiss_fft130/kiss_fft.h>
+
+#include <Core/ConcurrentDispatch.h>
+
+namespace spades {
+	namespace draw {
+		/**
+		 * A water wave simulation producing a tiling bumpmap (normal and
+		 * height packed into BGRA pixels).
+		 *
+		 * A simulation step is split into stages of independent tasks so that
+		 * `GLWaveSimulation` can spread it over worker threads: the tasks of a
+		 * stage may run concurrently, and a stage starts only after the
+		 * previous one is complete.
+		 */
+		class GLWaveTank {
+		protected:
+			float dt = 0.0F;
+			int size, samples;
+
+			/** The number of bitmap rows packed by a single task. */
+			enum { BitmapRowsPerTask = 16 };
+
+			int GetNumBitmapTasks() const {
+				return (size + BitmapRowsPerTask - 1) / BitmapRowsPerTask;
+			}
+
+			/** Packs the rows of bitmap task `index` from the (tiling) `height`. */
+			void MakeBitmapTask(const float* height, int index);
+
+			/** Packs the whole bitmap one pixel at a time. */
+			void MakeBitmapReference(const float* height);
+
+		private:
+			std::vector<uint32_t> bitmap;
+
+		public:
+			GLWaveTank(int size);
+			virtual ~GLWaveTank();
+
+			void SetTimeStep(float dt) { this->dt = dt; }
+			int GetSize() const { return size; }
+			const uint32_t* GetBitmap() const { return bitmap.data(); }
+
+			virtual int GetNumStages() const = 0;
+			virtual int GetNumTasks(int stage) const = 0;
+			virtual void RunTask(int stage, int index) = 0;
+
+			/** Runs a whole step on the calling thread, packing the bitmap
+			 * with the scalar code. */
+			virtual void RunReference() = 0;
+		};
+
+		/**
+		 * Synthesizes waves from a random spectrum with an inverse 2D FFT.
+		 * Stages: the spectrum rows (advance and transform), the columns,
+		 * then the bitmap rows.
+		 */
+		class GLFFTWaveTank : public GLWaveTank {
+			struct Cell {
+				float magnitude;
+				uint32_t phase;
+				float phasePerSecond;
+
+				float m00, m01;
+				float m10, m11;
+			};
+
+			kiss_fft_cfg fft;
+			int sizeHalf;
+
+			/** `(sizeHalf + 1) x size`, the upper half of the spectrum. */
+			std::vector<Cell> cells;
+			std::vector<kiss_fft_cpx> spectrum;
+			std::vector<kiss_fft_cpx> rows;
+			/** `size x size`, transposed (a row per spectrum column). */
+			std::vector<kiss_fft_cpx> columns;
+			std::vector<kiss_fft_cpx> result;
+			std::vector<float> height;
+
+			void TransformRow(int y);
+			void TransformColumn(int x);
+
+		public:
+			GLFFTWaveTank(int sizeBits);
+			~GLFFTWaveTank();
+
+			int GetNumStages() const override { return 3; }
+			int GetNumTasks(int stage) const override;
+			void RunTask(int stage, int index) override;
+			void RunReference() override;
+		};
+
+		/**
+		 * Solves the wave equation with the FTCS scheme. The solver runs as
+		 * a single task, followed by the bitmap rows.
+		 */
+		class GLStandardWaveTank : public GLWaveTank {
+			std::vector<float> height;
+			std::vector<float> heightFiltered;
+			std::vector<float> velocity;
+
+			template <bool xy> void DoPDELine(float* vy, float* y1, float* y2, float* yy);
+			template <bool xy> void Denoise(float* arr);
+			void Simulate();
+
+		public:
+			GLStandardWaveTank(int size);
+			~GLStandardWaveTank();
+
+			int GetNumStages() const override { return 2; }
+			int GetNumTasks(int stage) const override;
+			void RunTask(int stage, int index) override;
+			void RunReference() override;
+		};
+
+		/**
+		 * Steps a set of wave tanks together on the dispatch threads.
+		 *
+		 * The tasks of all tanks are pulled from per-stage counters by every
+		 * worker. A worker that runs out of tasks waits for the tasks of the
+		 * stage that are still running before moving on to the next stage.
+		 * It never waits for a task that no thread has claimed yet, so the
+		 * step completes even if only one worker gets a thread.
+		 */
+		class GLWaveSimulation {
+			class Worker;
+
+			std::vector<std::unique_ptr<GLWaveTank>> tanks;
+			std::vector<std::unique_ptr<Worker>> workers;
+
+			int numStages;
+			/** `taskOffsets[stage][i]` is the first task of `tanks[i]`. */
+			std::vector<std::vector<int>> taskOffsets;
+			std::unique_ptr<std::atomic<int>[]> nextTask;
+			std::unique_ptr<std::atomic<int>[]> doneTasks;
+			/** Signaled when the last task of a stage is done. */
+			std::mutex stageMutex;
+			std::condition_variable stageDone;
+
+			void Work();
+
+		public:
+			GLWaveSimulation(std::vector<std::unique_ptr<GLWaveTank>> tanks);
+			~GLWaveSimulation();
+
+			std::size_t GetNumTanks() const { return tanks.size(); }
+			GLWaveTank& GetTank(std::size_t i) { return *tanks[i]; }
+
+			/** Starts a step of all tanks. The tanks must not be touched until
+			 * `Join` returns. */
+			void Start();
+			void Join();
+
+			/** Logs the time of a step of `numTanks` FFT tanks of size
+			 * `1 << sizeBits` on one thread and on the dispatch threads. */
+			static void Benchmark(int sizeBits, int numTanks);
+		};
+	} // namespace draw
+} // namespace spades
@@ -354,6 +354,10 @@ namespace spades {
 			virtual void EnableVertexAttribArray(UInteger index, bool) = 0;
 			virtual void VertexAttribDivisor(UInteger index, UInteger divisor) = 0;
 
+			/** Whether `VertexAttribDivisor` and the instanced draw calls are
+			 * available. */
+			virtual bool IsInstancingSupported() = 0;
+
 			virtual void DrawArrays(Enum mode, Integer first, Sizei count) = 0;
 			virtual void DrawElements(Enum mode, Sizei count, Enum type, const void* indices) = 0;
 			virtual void DrawArraysInstanced(Enum mode, Integer first, Sizei count,
@@ -0,0 +1,168 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "SWBufferedPort.h"
+#include <Core/Debug.h>
+#include <Core/Exception.h>
+#include <Core/IRunnable.h>
+#include <Core/Thread.h>
+
+namespace spades {
+	namespace draw {
+		class SWBufferedPort::Presenter : public IRunnable {
+			SWBufferedPort &port;
+
+		public:
+			Presenter(SWBufferedPort &port) : port(port) {}
+			void Run() override { port.RunPresenter(); }
+		};
+
+		SWBufferedPort::SWBufferedPort(int width, int height, int numBuffers)
+		    : backBuffer(0),
+		      presenting(NoBuffer),
+		      quit(false),
+		      lastPresentTime(-1.0),
+		      numFrames(0),
+		      intervalSum(0.0),
+		      intervalSquaredSum(0.0),
+		      maxInterval(0.0),
+		      swapWaitTime(0.0) {
+			SPADES_MARK_FUNCTION();
+
+			if (numBuffers < 1)
+				SPInvalidArgument("numBuffers");
+
+			for (int i = 0; i < numBuffers; i++)
+				buffers.push_back(Handle<Bitmap>::New(width, height));
+
+			if (numBuffers > 1) {
+				presenterRunnable.reset(new Presenter(*this));
+				presenterThread.reset(new Thread(presenterRunnable.get()));
+				presenterThread->Start();
+			}
+		}
+
+		SWBufferedPort::~SWBufferedPort() { StopPresenting(); }
+
+		void SWBufferedPort::StopPresenting() {
+			if (!presenterThread)
+				return;
+
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				quit = true;
+			}
+			condvar.notify_all();
+
+			presenterThread->Join();
+			presenterThread.reset();
+		}
+
+		std::size_t SWBufferedPort::FindFreeBuffer() {
+			for (std::size_t i = 0; i < buffers.size(); i++) {
+				if (i == presenting || std::find(queue.begin(), queue.end(), i) != queue.end())
+					continue;
+				return i;
+			}
+			return NoBuffer;
+		}
+
+		void SWBufferedPort::RecordPresent() {
+			double now = clock.GetTime();
+			if (lastPresentTime >= 0.0) {
+				double interval = now - lastPresentTime;
+				numFrames++;
+				intervalSum += interval;
+				intervalSquaredSum += interval * interval;
+				maxInterval = std::max(maxInterval, interval);
+			}
+			lastPresentTime = now;
+		}
+
+		void SWBufferedPort::RunPresenter() {
+			std::unique_lock<std::mutex> lock{mutex};
+			while (true) {
+				condvar.wait(lock, [&] { return quit || !queue.empty(); });
+				if (queue.empty())
+					break; // quitting, and everything was presented
+
+				presenting = queue.front();
+				queue.pop_front();
+
+				lock.unlock();
+				Present(*buffers[presenting]);
+				lock.lock();
+
+				RecordPresent();
+				presenting = NoBuffer;
+				condvar.notify_all();
+			}
+		}
+
+		void SWBufferedPort::Swap() {
+			SPADES_MARK_FUNCTION();
+
+			if (!presenterThread) {
+				Present(*buffers[backBuffer]);
+				std::lock_guard<std::mutex> lock{mutex};
+				RecordPresent();
+				return;
+			}
+
+			std::unique_lock<std::mutex> lock{mutex};
+			queue.push_back(backBuffer);
+			condvar.notify_all();
+
+			// wait until a buffer is neither queued nor being presented
+			Stopwatch sw;
+			condvar.wait(lock, [&] { return FindFreeBuffer() != NoBuffer; });
+			swapWaitTime += sw.GetTime();
+			backBuffer = FindFreeBuffer();
+		}
+
+		auto SWBufferedPort::GetPacingStatistics() -> PacingStatistics {
+			std::lock_guard<std::mutex> lock{mutex};
+			PacingStatistics stats;
+			stats.numFrames = numFrames;
+			stats.swapWaitTime = swapWaitTime;
+			if (numFrames > 0) {
+				double n = static_cast<double>(numFrames);
+				stats.meanInterval = intervalSum / n;
+				stats.intervalDeviation = std::sqrt(
+				  std::max(0.0, intervalSquaredSum / n - stats.meanInterval * stats.meanInterval));
+				stats.maxInterval = maxInterval;
+			}
+			return stats;
+		}
+
+		void SWBufferedPort::ResetPacingStatistics() {
+			std::lock_guard<std::mutex> lock{mutex};
+			numFrames = 0;
+			intervalSum = 0.0;
+			intervalSquaredSum = 0.0;
+			maxInterval = 0.0;
+			swapWaitTime = 0.0;
+		}
+	} // namespace draw
+} // namespace spades
@@ -0,0 +1,99 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "SWPort.h"
+#include <Core/Stopwatch.h>
+
+namespace spades {
+	class IRunnable;
+	class Thread;
+
+	namespace draw {
+		/**
+		 * `SWPort` that owns several framebuffers and presents them on a
+		 * background thread, so that presenting a frame overlaps rendering
+		 * the next one. With a single buffer, `Swap` presents the frame
+		 * itself before returning.
+		 *
+		 * Subclasses implement `Present` and must call `StopPresenting` in
+		 * their destructor because `Present` can't be called once they are
+		 * destroyed.
+		 */
+		class SWBufferedPort : public SWPort {
+			class Presenter;
+
+			std::vector<Handle<Bitmap>> buffers;
+			std::size_t backBuffer;
+
+			std::mutex mutex;
+			std::condition_variable condvar;
+			/** Buffers waiting to be presented, oldest first. */
+			std::deque<std::size_t> queue;
+			/** The buffer being presented, or `NoBuffer`. */
+			std::size_t presenting;
+			bool quit;
+
+			std::unique_ptr<IRunnable> presenterRunnable;
+			std::unique_ptr<Thread> presenterThread;
+
+			// frame pacing, protected by `mutex`
+			Stopwatch clock;
+			double lastPresentTime;
+			std::size_t numFrames;
+			double intervalSum, intervalSquaredSum, maxInterval;
+			double swapWaitTime;
+
+			static constexpr std::size_t NoBuffer = static_cast<std::size_t>(-1);
+
+			std::size_t FindFreeBuffer();
+			void RecordPresent();
+			void RunPresenter();
+
+		protected:
+			SWBufferedPort(int width, int height, int numBuffers);
+			~SWBufferedPort();
+
+			/** Presents `frame`. Called on the presentation thread, one frame
+			 * at a time and in the order they were swapped. */
+			virtual void Present(Bitmap &frame) = 0;
+
+			/** Presents the queued frames and stops the presentation thread. */
+			void StopPresenting();
+
+		public:
+			Bitmap &GetFramebuffer() override { return *buffers[backBuffer]; }
+			void Swap() override;
+
+			int GetNumBuffers() const { return static_cast<int>(buffers.size()); }
+
+			PacingStatistics GetPacingStatistics() override;
+			void ResetPacingStatistics() override;
+		};
+	} // namespace draw
+} // namespace spades
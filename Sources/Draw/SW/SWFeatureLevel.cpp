@@ -18,17 +18,25 @@
 
  */
 
+#include <string>
+
 #include "SWFeatureLevel.h"
 #include <Core/CpuID.h>
+#include <Core/Math.h>
+#include <Core/Settings.h>
+
+DEFINE_SPADES_SETTING(r_swFeatureLevel, "auto");
 
 namespace spades {
 	namespace draw {
 
-		// TODO: correct detection
-
 #if ENABLE_SSE2
-		SWFeatureLevel DetectFeatureLevel() {
+		static SWFeatureLevel DetectHardwareFeatureLevel() {
 			CpuID cpuid;
+#if ENABLE_AVX2
+			if (cpuid.Supports(CpuFeature::AVX2))
+				return SWFeatureLevel::AVX2;
+#endif
 			if (cpuid.Supports(CpuFeature::SSE2))
 				return SWFeatureLevel::SSE2;
 
@@ -36,9 +44,57 @@ namespace spades {
 			return SWFeatureLevel::SSE;
 		}
 #elif ENABLE_SSE
-		SWFeatureLevel DetectFeatureLevel() { return SWFeatureLevel::SSE; }
+		static SWFeatureLevel DetectHardwareFeatureLevel() { return SWFeatureLevel::SSE; }
 #else
-		SWFeatureLevel DetectFeatureLevel() { return SWFeatureLevel::None; }
+		static SWFeatureLevel DetectHardwareFeatureLevel() { return SWFeatureLevel::None; }
+#endif
+
+		SWFeatureLevel DetectFeatureLevel() {
+			SWFeatureLevel level = DetectHardwareFeatureLevel();
+
+			// `r_swFeatureLevel` caps the detected level, which is mainly
+			// useful for comparing the performance of the code paths.
+			std::string limitName = r_swFeatureLevel;
+			SWFeatureLevel limit = level;
+			if (EqualsIgnoringCase(limitName, "none")) {
+				limit = SWFeatureLevel::None;
+#if ENABLE_SSE
+			} else if (EqualsIgnoringCase(limitName, "sse")) {
+				limit = SWFeatureLevel::SSE;
+#endif
+#if ENABLE_SSE2
+			} else if (EqualsIgnoringCase(limitName, "sse2")) {
+				limit = SWFeatureLevel::SSE2;
 #endif
+			} else if (!EqualsIgnoringCase(limitName, "auto") &&
+			           !EqualsIgnoringCase(limitName, "avx2")) {
+				SPLog("Unknown r_swFeatureLevel \"%s\" ignored", limitName.c_str());
+			}
+
+			if (level > limit)
+				level = limit;
+
+			SPLog("SWRenderer feature level: %s", GetFeatureLevelName(level));
+			return level;
+		}
+
+		const char* GetFeatureLevelName(SWFeatureLevel level) {
+			switch (level) {
+				case SWFeatureLevel::None: return "None";
+#if ENABLE_MMX
+				case SWFeatureLevel::MMX: return "MMX";
+#endif
+#if ENABLE_SSE
+				case SWFeatureLevel::SSE: return "SSE";
+#endif
+#if ENABLE_SSE2
+				case SWFeatureLevel::SSE2: return "SSE2";
+#endif
+#if ENABLE_AVX2
+				case SWFeatureLevel::AVX2: return "AVX2";
+#endif
+			}
+			return "Unknown";
+		}
 	} // namespace draw
 } // namespace spades
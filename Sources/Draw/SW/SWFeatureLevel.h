@@ -47,12 +47,28 @@
 #define ENABLE_SSE2 0
 #endif
 
+// AVX2 code is compiled into separate functions and only selected at runtime
+// when `CpuID` reports support, so the binary still runs on older CPUs.
+#if ENABLE_SSE2 && (defined(__GNUC__) || defined(_MSC_VER))
+#define ENABLE_AVX2 1
+#else
+#define ENABLE_AVX2 0
+#endif
+
 #if ENABLE_SSE
 #include <xmmintrin.h>
 #endif
 #if ENABLE_SSE2
 #include <emmintrin.h>
 #endif
+#if ENABLE_AVX2
+#include <immintrin.h>
+#if defined(__GNUC__)
+#define SPADES_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SPADES_TARGET_AVX2
+#endif
+#endif
 
 #include <Core/ConcurrentDispatch.h>
 #include <Core/Debug.h>
@@ -74,17 +90,21 @@ namespace spades {
 #endif
 #if ENABLE_SSE2
 			SSE2,
+#endif
+#if ENABLE_AVX2
+			AVX2,
 #endif
 		};
 
-		static inline bool operator>(SWFeatureLevel a, SWFeatureLevel b) {
+		static inline constexpr bool operator>(SWFeatureLevel a, SWFeatureLevel b) {
 			return static_cast<int>(a) > static_cast<int>(b);
 		}
-		static inline bool operator>=(SWFeatureLevel a, SWFeatureLevel b) {
+		static inline constexpr bool operator>=(SWFeatureLevel a, SWFeatureLevel b) {
 			return static_cast<int>(a) >= static_cast<int>(b);
 		}
 
 		SWFeatureLevel DetectFeatureLevel();
+		const char* GetFeatureLevelName(SWFeatureLevel);
 
 #if ENABLE_SSE // assume SSE availability (no checks!)
 		static inline float fastDiv(float a, float b) {
@@ -31,7 +31,12 @@
 namespace spades {
 	namespace draw {
 		SWFlatMapRenderer::SWFlatMapRenderer(SWRenderer &r, Handle<client::GameMap> inMap)
-		    : r(r), map(std::move(inMap)), w(map->Width()), h(map->Height()), needsUpdate(true) {
+		    : r(r),
+		      map(std::move(inMap)),
+		      w(map->Width()),
+		      h(map->Height()),
+		      surface(*map),
+		      needsUpdate(false) {
 			SPADES_MARK_FUNCTION();
 
 			if (w & 31) {
@@ -40,16 +45,19 @@ namespace spades {
 
 			img = Handle<SWImage>::New(map->Width(), map->Height());
 			updateMap.resize(w * h / 32);
-			std::fill(updateMap.begin(), updateMap.end(), 0xffffffff);
+			std::fill(updateMap.begin(), updateMap.end(), 0);
 			updateMap2.resize(w * h / 32);
-			std::fill(updateMap2.begin(), updateMap2.end(), 0xffffffff);
+			std::fill(updateMap2.begin(), updateMap2.end(), 0);
 
-			Update(true);
+			auto *outPixels = img->GetRawBitmap();
+			const uint32_t *colors = surface.GetColors();
+			for (int i = 0; i < w * h; i++)
+				outPixels[i] = ConvertPixel(colors[i]);
 		}
 
 		SWFlatMapRenderer::~SWFlatMapRenderer() { SPADES_MARK_FUNCTION(); }
 
-		void SWFlatMapRenderer::Update(bool firstTime) {
+		void SWFlatMapRenderer::Update() {
 			SPADES_MARK_FUNCTION();
 			{
 				std::lock_guard<std::mutex> lock(updateInfoLock);
@@ -60,48 +68,33 @@ namespace spades {
 				updateMap.swap(updateMap2);
 				std::fill(updateMap.begin(), updateMap.end(), 0);
 			}
-			auto *outPixels = img->GetRawBitmap();
-
-			auto *mapRenderer = r.mapRenderer.get();
 
 			int idx = 0;
 			for (int y = 0; y < h; y++) {
 				for (int x = 0; x < w; x += 32) {
-					uint32_t upd = updateMap2[idx];
-					if (upd) {
-						for (int i = 0; i < 32; i++) {
-							if (upd & 1) {
-								auto c = GeneratePixel(x + i, y);
-								outPixels[i] = c;
-								if (!firstTime) {
-									mapRenderer->UpdateRle(x + i, y);
-									mapRenderer->UpdateRle((x + i + 1) & (w - 1), y);
-									mapRenderer->UpdateRle((x + i - 1) & (w - 1), y);
-									mapRenderer->UpdateRle(x + i, (y + 1) & (h - 1));
-									mapRenderer->UpdateRle(x + i, (y - 1) & (h - 1));
-								}
-							}
-							upd >>= 1;
-						}
-						// updateMap[idx] = 0;
+					uint32_t upd = updateMap2[idx++];
+					for (int i = 0; upd; i++, upd >>= 1) {
+						if (upd & 1)
+							surface.Invalidate(x + i, y);
 					}
-					outPixels += 32;
-					idx++;
 				}
 			}
-		}
 
-		uint32_t SWFlatMapRenderer::GeneratePixel(int x, int y) {
-			const int depth = map->Depth();
-			for (int z = 0; z < depth; z++) {
-				if (map->IsSolid(x, y, z)) {
-					uint32_t col = map->GetColor(x, y, z);
-					col = (col & 0xff00) | ((col & 0xff) << 16) | ((col & 0xff0000) >> 16);
-					col |= 0xff000000;
-					return col;
-				}
+			surface.Update();
+
+			auto *outPixels = img->GetRawBitmap();
+			auto *mapRenderer = r.mapRenderer.get();
+			const uint32_t *colors = surface.GetColors();
+			for (int index : surface.GetUpdatedColumns()) {
+				outPixels[index] = ConvertPixel(colors[index]);
+				// the RLE spans depend on the whole column, not only on its top
+				mapRenderer->UpdateRle(index % w, index / w);
 			}
-			return 0; // shouldn't reach here for valid maps
+		}
+
+		uint32_t SWFlatMapRenderer::ConvertPixel(uint32_t col) {
+			// 0xAABBGGRR to 0xAARRGGBB
+			return (col & 0xff00ff00) | ((col & 0xff) << 16) | ((col & 0xff0000) >> 16);
 		}
 
 		void SWFlatMapRenderer::SetNeedsUpdate(int x, int y) {
@@ -23,6 +23,7 @@
 #include <mutex>
 #include <vector>
 
+#include <Client/GameMapSurface.h>
 #include <Core/RefCountedObject.h>
 
 namespace spades {
@@ -33,17 +34,23 @@ namespace spades {
 		class SWRenderer;
 		class SWImage;
 
+		/**
+		 * Keeps the minimap image in sync with a `client::GameMapSurface`.
+		 * Changed columns are collected under a lock and applied to the
+		 * surface and the image when the image is requested.
+		 */
 		class SWFlatMapRenderer {
 			SWRenderer &r;
 			Handle<SWImage> img;
 			Handle<client::GameMap> map;
 			int w, h;
+			client::GameMapSurface surface;
 			std::mutex updateInfoLock;
 			std::vector<uint32_t> updateMap;
 			std::vector<uint32_t> updateMap2;
 			bool volatile needsUpdate;
 
-			uint32_t GeneratePixel(int x, int y);
+			static uint32_t ConvertPixel(uint32_t);
 
 		public:
 			SWFlatMapRenderer(SWRenderer &r, Handle<client::GameMap>);
@@ -54,7 +61,7 @@ namespace spades {
 				return *img;
 			}
 
-			void Update(bool firstTime = false);
+			void Update();
 			void SetNeedsUpdate(int x, int y);
 		};
 	} // namespace draw
@@ -19,6 +19,7 @@
  */
 
 #include "SWImage.h"
+#include "SWImageRenderer.h"
 #include <Core/FileManager.h>
 #include <Core/IStream.h>
 
@@ -88,6 +89,10 @@ namespace spades {
 				SPRaise("Out of range.");
 			}
 
+			// polygons queued with the old content must be drawn first
+			if (pendingRenderer)
+				pendingRenderer->Flush();
+
 			{
 				int bw = inBmp.GetWidth();
 				int bh = inBmp.GetHeight();
@@ -27,7 +27,11 @@
 
 namespace spades {
 	namespace draw {
+		class SWImageRenderer;
+
 		class SWImage : public client::IImage {
+			friend class SWImageRenderer;
+
 			// Handle<Bitmap> rawBmp;
 
 			std::vector<uint32_t> bmp;
@@ -38,6 +42,10 @@ namespace spades {
 			float w, h;
 			float iw, ih;
 
+			/** The renderer with queued polygons using this image, which
+			 * must be flushed before the image is modified. */
+			SWImageRenderer *pendingRenderer = nullptr;
+
 		protected:
 			~SWImage();
 
@@ -18,20 +18,27 @@
 
  */
 
-#include "SWImageRenderer.h"
+#include <atomic>
+
 #include "SWImage.h"
+#include "SWImageRenderer.h"
+#include "SWUtils.h"
 #include <Core/Bitmap.h>
+#include <Core/Debug.h>
 
 namespace spades {
 	namespace draw {
 		SWImageRenderer::SWImageRenderer(SWFeatureLevel lvl)
-		    : shader(ShaderType::Image), featureLevel(lvl) {}
+		    : depthBuffer(nullptr), shader(ShaderType::Image), featureLevel(lvl), pixelsDrawn(0) {}
 
-		SWImageRenderer::~SWImageRenderer() {}
+		SWImageRenderer::~SWImageRenderer() { Flush(); }
 
 		void SWImageRenderer::SetFramebuffer(spades::Bitmap* bmp) {
+			if (bmp != frame.GetPointerOrNull())
+				Flush();
 			this->frame = bmp;
 			if (bmp) {
+				bins.resize((bmp->GetHeight() + TileHeight - 1) / TileHeight);
 				fbSize4 = MakeVector4(static_cast<float>(bmp->GetWidth()) * 0.5F,
 				                      static_cast<float>(bmp->GetHeight()) * -0.5F, 1.0F, 1.0F);
 				fbCenter4 = MakeVector4(static_cast<float>(bmp->GetWidth()) * 0.5F,
@@ -39,7 +46,11 @@ namespace spades {
 			}
 		}
 
-		void SWImageRenderer::SetDepthBuffer(float* f) { depthBuffer = f; }
+		void SWImageRenderer::SetDepthBuffer(float* f) {
+			if (f != depthBuffer)
+				Flush();
+			depthBuffer = f;
+		}
 		void SWImageRenderer::SetShaderType(ShaderType type) { shader = type; }
 		void SWImageRenderer::SetZRange(float zNear, float) {
 			// currently zNear is ignored...
@@ -237,7 +248,7 @@ namespace spades {
 			static_assert(!ndc, "Denormalize pass was not selected");
 
 			static void DrawPolygonInternalInner(SWImage* img, const Vertex& v1, const Vertex& v2,
-			                                     const Vertex& v3, SWImageRenderer& r) {
+			                                     const Vertex& v3, Tile& r) {
 				// TODO: support null image
 
 				Bitmap& fb = *r.frame;
@@ -408,15 +419,17 @@ namespace spades {
 
 				Interpolator longSpanX(x1, x3, y3 - y1);
 				SWImageGouraudInterpolator<level> longSpan(v1, v3, y3 - y1);
+				// the Y coordinate the long span interpolators are at
+				int longSpanY = y1;
 				{
 					Interpolator shortSpanX(x1, x2, y2 - y1);
 					SWImageGouraudInterpolator<level> shortSpan(v1, v2, y2 - y1);
-					int minY = std::max(0, y1);
-					int maxY = std::min(fbH, y2);
+					int minY = std::max(r.minY, y1);
+					int maxY = std::min(r.maxY, y2);
 					shortSpanX.MoveNext(minY - y1);
 					shortSpan.MoveNext(minY - y1);
-					longSpanX.MoveNext(minY - y1);
-					longSpan.MoveNext(minY - y1);
+					longSpanX.MoveNext(minY - longSpanY);
+					longSpan.MoveNext(minY - longSpanY);
 					for (int y = minY; y < maxY; y++) {
 						int lineX1 = shortSpanX.GetCurrent();
 						auto line1 = shortSpan.GetCurrent();
@@ -436,16 +449,17 @@ namespace spades {
 							             v1.position.z);
 						}
 					}
+					longSpanY = std::max(minY, maxY);
 				}
 				{
 					Interpolator shortSpanX(x2, x3, y3 - y2);
 					SWImageGouraudInterpolator<level> shortSpan(v2, v3, y3 - y2);
-					int minY = std::max(0, y2);
-					int maxY = std::min(fbH, y3);
+					int minY = std::max(r.minY, y2);
+					int maxY = std::min(r.maxY, y3);
 					shortSpanX.MoveNext(minY - y2);
 					shortSpan.MoveNext(minY - y2);
-					longSpanX.MoveNext(minY - y2);
-					longSpan.MoveNext(minY - y2);
+					longSpanX.MoveNext(minY - longSpanY);
+					longSpan.MoveNext(minY - longSpanY);
 					for (int y = minY; y < maxY; y++) {
 						int lineX1 = shortSpanX.GetCurrent();
 						auto line1 = shortSpan.GetCurrent();
@@ -473,18 +487,18 @@ namespace spades {
 			                                const Vertex& v3, SWImageRenderer& r) {
 				if (v2.position.y < v1.position.y) {
 					if (v3.position.y < v2.position.y) {
-						DrawPolygonInternalInner(img, v3, v2, v1, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v3, v2, v1);
 					} else if (v3.position.y < v1.position.y) {
-						DrawPolygonInternalInner(img, v2, v3, v1, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v2, v3, v1);
 					} else {
-						DrawPolygonInternalInner(img, v2, v1, v3, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v2, v1, v3);
 					}
 				} else if (v3.position.y < v1.position.y) {
-					DrawPolygonInternalInner(img, v3, v1, v2, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v3, v1, v2);
 				} else if (v3.position.y < v2.position.y) {
-					DrawPolygonInternalInner(img, v1, v3, v2, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v1, v3, v2);
 				} else {
-					DrawPolygonInternalInner(img, v1, v2, v3, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v1, v2, v3);
 				}
 			}
 		};
@@ -492,6 +506,104 @@ namespace spades {
 		// TODO: Non-SSE2 renderer for solid polygons
 
 #pragma mark - SSE2
+#if ENABLE_AVX2
+		/** @return the upper 32 bits of the eight 64-bit values in `lo` and `hi`, in order. */
+		SPADES_TARGET_AVX2
+		static inline __m256i HighDwordsAVX2(__m256i lo, __m256i hi) {
+			auto v = _mm256_castps_si256(_mm256_shuffle_ps(
+			  _mm256_castsi256_ps(lo), _mm256_castsi256_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+			return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		}
+
+		/**
+		 * Draws `count` (a multiple of 8) textured pixels starting at an even X
+		 * coordinate. This computes the same result as the 2-pixel loop of the
+		 * SSE2 polygon renderer, but fetches the texels with a gather.
+		 * `u`, `v` and the steps are the 32.32 fixed-point texture coordinates
+		 * of the first pixel, and `dither` is the row's `{u, v}` offsets for
+		 * even and odd pixels.
+		 */
+		template <bool depthTest, bool linearInterpolate>
+		SPADES_TARGET_AVX2 static void
+		DrawSpanAVX2(uint32_t* out, float* depthOut, int count, int64_t u, int64_t v,
+		             int64_t stepU, int64_t stepV, const uint32_t* tpixels, int tw, int th,
+		             const int16_t* dither, __m128i mulCol128, float z) {
+			auto uLo = _mm256_setr_epi64x(u, u + stepU, u + stepU * 2, u + stepU * 3);
+			auto vLo = _mm256_setr_epi64x(v, v + stepV, v + stepV * 2, v + stepV * 3);
+			auto uHi = _mm256_add_epi64(uLo, _mm256_set1_epi64x(stepU * 4));
+			auto vHi = _mm256_add_epi64(vLo, _mm256_set1_epi64x(stepV * 4));
+			auto uStep = _mm256_set1_epi64x(stepU * 8);
+			auto vStep = _mm256_set1_epi64x(stepV * 8);
+
+			auto ditherU = _mm256_setr_epi32(dither[0], dither[2], dither[0], dither[2],
+			                                 dither[0], dither[2], dither[0], dither[2]);
+			auto ditherV = _mm256_setr_epi32(dither[1], dither[3], dither[1], dither[3],
+			                                 dither[1], dither[3], dither[1], dither[3]);
+			auto uvMask = _mm256_set1_epi32(texUVScaleInt - 1);
+			auto tw8 = _mm256_set1_epi32(tw);
+			auto th8 = _mm256_set1_epi32(th);
+			auto mulCol = _mm256_broadcastsi128_si256(mulCol128);
+			auto zero = _mm256_setzero_si256();
+			auto one = _mm256_set1_epi16(0x100);
+			auto zv = _mm256_set1_ps(z);
+
+			for (int x = 0; x < count; x += 8) {
+				auto ui = HighDwordsAVX2(uLo, uHi);
+				auto vi = HighDwordsAVX2(vLo, vHi);
+				uLo = _mm256_add_epi64(uLo, uStep);
+				uHi = _mm256_add_epi64(uHi, uStep);
+				vLo = _mm256_add_epi64(vLo, vStep);
+				vHi = _mm256_add_epi64(vHi, vStep);
+
+				if (linearInterpolate) {
+					ui = _mm256_add_epi32(ui, ditherU);
+					vi = _mm256_add_epi32(vi, ditherV);
+				}
+
+				// repeat, then scale to texels. the products fit in 32 bits
+				// because the texture is never larger than 65536 texels wide.
+				ui = _mm256_and_si256(ui, uvMask);
+				vi = _mm256_and_si256(vi, uvMask);
+				ui = _mm256_srli_epi32(_mm256_mullo_epi32(ui, tw8), texUVScaleBits);
+				vi = _mm256_srli_epi32(_mm256_mullo_epi32(vi, th8), texUVScaleBits);
+
+				auto index = _mm256_add_epi32(ui, _mm256_mullo_epi32(vi, tw8));
+				auto tex =
+				  _mm256_i32gather_epi32(reinterpret_cast<const int*>(tpixels), index, 4);
+				if (_mm256_testz_si256(tex, tex))
+					continue; // transparent
+
+				auto* outp = reinterpret_cast<__m256i*>(out + x);
+				auto dst = _mm256_loadu_si256(outp);
+
+				// modulate by the constant color. now [u8.8x4] per pixel
+				auto tLo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(tex, zero), mulCol);
+				auto tHi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(tex, zero), mulCol);
+
+				// inversed src alpha, [0,255] -> [0,256]
+				auto aLo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(tLo, 0xff), 0xff);
+				auto aHi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(tHi, 0xff), 0xff);
+				aLo = _mm256_srli_epi16(aLo, 8);
+				aHi = _mm256_srli_epi16(aHi, 8);
+				aLo = _mm256_sub_epi16(one, _mm256_add_epi16(aLo, _mm256_srli_epi16(aLo, 7)));
+				aHi = _mm256_sub_epi16(one, _mm256_add_epi16(aHi, _mm256_srli_epi16(aHi, 7)));
+
+				auto dLo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), aLo);
+				auto dHi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), aHi);
+				dLo = _mm256_srli_epi16(_mm256_adds_epu16(dLo, tLo), 8);
+				dHi = _mm256_srli_epi16(_mm256_adds_epu16(dHi, tHi), 8);
+				auto result = _mm256_packus_epi16(dLo, dHi);
+
+				if (depthTest) {
+					auto pass = _mm256_cmp_ps(zv, _mm256_loadu_ps(depthOut + x), _CMP_NGT_UQ);
+					result = _mm256_blendv_epi8(dst, result, _mm256_castps_si256(pass));
+				}
+
+				_mm256_storeu_si256(outp, result);
+			}
+		}
+#endif
+
 #if ENABLE_SSE2
 
 #pragma mark General
@@ -500,7 +612,7 @@ namespace spades {
 		                                        false, linearInterpolate> {
 
 			static void DrawPolygonInternalInner(SWImage* img, const Vertex& v1, const Vertex& v2,
-			                                     const Vertex& v3, SWImageRenderer& r) {
+			                                     const Vertex& v3, Tile& r) {
 
 				Bitmap& fb = *r.frame;
 
@@ -708,7 +820,7 @@ namespace spades {
 				};
 
 				auto drawScanline =
-				  [tw, th, tpixels, bmp, fbW, depthBuffer, &drawPixel, &drawPixel2, &r,
+				  [tw, th, tpixels, bmp, fbW, depthBuffer, mulCol, &drawPixel, &drawPixel2, &r,
 				   &ditherMap, &ditherMap2](int y, int x1, int x2, const SWImageVarying& vary1,
 				                            const SWImageVarying& vary2, float z1, float z2) {
 					  uint32_t* out = bmp + (y * fbW);
@@ -771,6 +883,22 @@ namespace spades {
 					  int reminders = maxX & 1;
 					  maxX -= reminders;
 					  auto dither = ditherMap2[y & 1];
+#if ENABLE_AVX2
+					  if (r.featureLevel >= SWFeatureLevel::AVX2) {
+						  int count = (maxX - minX) & ~7;
+						  if (count > 0) {
+							  DrawSpanAVX2<depthTest, linearInterpolate>(
+							    out, depthOut, count, vary.uvU, vary.uvV, vary.stepU, vary.stepV,
+							    tpixels, tw, th, &ditherMap[(y & 1) * 4], mulCol, z1);
+							  out += count;
+							  if (depthTest) {
+								  depthOut += count;
+							  }
+							  vary.MoveNext(count);
+							  minX += count;
+						  }
+					  }
+#endif
 					  for (int x = minX; x < maxX; x += 2) {
 						  auto vr1 = vary.GetCurrent();
 						  vary.MoveNext();
@@ -823,15 +951,17 @@ namespace spades {
 
 				Interpolator longSpanX(x1, x3, y3 - y1);
 				SWImageGouraudInterpolator<SWFeatureLevel::SSE2> longSpan(v1, v3, y3 - y1);
+				// the Y coordinate the long span interpolators are at
+				int longSpanY = y1;
 				{
 					Interpolator shortSpanX(x1, x2, y2 - y1);
 					SWImageGouraudInterpolator<SWFeatureLevel::SSE2> shortSpan(v1, v2, y2 - y1);
-					int minY = std::max(0, y1);
-					int maxY = std::min(fbH, y2);
+					int minY = std::max(r.minY, y1);
+					int maxY = std::min(r.maxY, y2);
 					shortSpanX.MoveNext(minY - y1);
 					shortSpan.MoveNext(minY - y1);
-					longSpanX.MoveNext(minY - y1);
-					longSpan.MoveNext(minY - y1);
+					longSpanX.MoveNext(minY - longSpanY);
+					longSpan.MoveNext(minY - longSpanY);
 					for (int y = minY; y < maxY; y++) {
 						int lineX1 = shortSpanX.GetCurrent();
 						auto line1 = shortSpan.GetCurrent();
@@ -851,16 +981,17 @@ namespace spades {
 							             v1.position.z);
 						}
 					}
+					longSpanY = std::max(minY, maxY);
 				}
 				{
 					Interpolator shortSpanX(x2, x3, y3 - y2);
 					SWImageGouraudInterpolator<SWFeatureLevel::SSE2> shortSpan(v2, v3, y3 - y2);
-					int minY = std::max(0, y2);
-					int maxY = std::min(fbH, y3);
+					int minY = std::max(r.minY, y2);
+					int maxY = std::min(r.maxY, y3);
 					shortSpanX.MoveNext(minY - y2);
 					shortSpan.MoveNext(minY - y2);
-					longSpanX.MoveNext(minY - y2);
-					longSpan.MoveNext(minY - y2);
+					longSpanX.MoveNext(minY - longSpanY);
+					longSpan.MoveNext(minY - longSpanY);
 					for (int y = minY; y < maxY; y++) {
 						int lineX1 = shortSpanX.GetCurrent();
 						auto line1 = shortSpan.GetCurrent();
@@ -888,18 +1019,18 @@ namespace spades {
 			                                const Vertex& v3, SWImageRenderer& r) {
 				if (v2.position.y < v1.position.y) {
 					if (v3.position.y < v2.position.y) {
-						DrawPolygonInternalInner(img, v3, v2, v1, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v3, v2, v1);
 					} else if (v3.position.y < v1.position.y) {
-						DrawPolygonInternalInner(img, v2, v3, v1, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v2, v3, v1);
 					} else {
-						DrawPolygonInternalInner(img, v2, v1, v3, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v2, v1, v3);
 					}
 				} else if (v3.position.y < v1.position.y) {
-					DrawPolygonInternalInner(img, v3, v1, v2, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v3, v1, v2);
 				} else if (v3.position.y < v2.position.y) {
-					DrawPolygonInternalInner(img, v1, v3, v2, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v1, v3, v2);
 				} else {
-					DrawPolygonInternalInner(img, v1, v2, v3, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v1, v2, v3);
 				}
 			}
 		};
@@ -910,7 +1041,7 @@ namespace spades {
 		                                        lerp> {
 
 			static void DrawPolygonInternalInner(SWImage* img, const Vertex& v1, const Vertex& v2,
-			                                     const Vertex& v3, SWImageRenderer& r) {
+			                                     const Vertex& v3, Tile& r) {
 
 				Bitmap& fb = *r.frame;
 
@@ -1087,15 +1218,17 @@ namespace spades {
 
 				Interpolator longSpanX(x1, x3, y3 - y1);
 				SWImageGouraudInterpolator<SWFeatureLevel::SSE2> longSpan(v1, v3, y3 - y1);
+				// the Y coordinate the long span interpolators are at
+				int longSpanY = y1;
 				{
 					Interpolator shortSpanX(x1, x2, y2 - y1);
 					SWImageGouraudInterpolator<SWFeatureLevel::SSE2> shortSpan(v1, v2, y2 - y1);
-					int minY = std::max(0, y1);
-					int maxY = std::min(fbH, y2);
+					int minY = std::max(r.minY, y1);
+					int maxY = std::min(r.maxY, y2);
 					shortSpanX.MoveNext(minY - y1);
 					shortSpan.MoveNext(minY - y1);
-					longSpanX.MoveNext(minY - y1);
-					longSpan.MoveNext(minY - y1);
+					longSpanX.MoveNext(minY - longSpanY);
+					longSpan.MoveNext(minY - longSpanY);
 					for (int y = minY; y < maxY; y++) {
 						int lineX1 = shortSpanX.GetCurrent();
 						auto line1 = shortSpan.GetCurrent();
@@ -1115,16 +1248,17 @@ namespace spades {
 							             v1.position.z);
 						}
 					}
+					longSpanY = std::max(minY, maxY);
 				}
 				{
 					Interpolator shortSpanX(x2, x3, y3 - y2);
 					SWImageGouraudInterpolator<SWFeatureLevel::SSE2> shortSpan(v2, v3, y3 - y2);
-					int minY = std::max(0, y2);
-					int maxY = std::min(fbH, y3);
+					int minY = std::max(r.minY, y2);
+					int maxY = std::min(r.maxY, y3);
 					shortSpanX.MoveNext(minY - y2);
 					shortSpan.MoveNext(minY - y2);
-					longSpanX.MoveNext(minY - y2);
-					longSpan.MoveNext(minY - y2);
+					longSpanX.MoveNext(minY - longSpanY);
+					longSpan.MoveNext(minY - longSpanY);
 					for (int y = minY; y < maxY; y++) {
 						int lineX1 = shortSpanX.GetCurrent();
 						auto line1 = shortSpan.GetCurrent();
@@ -1152,18 +1286,18 @@ namespace spades {
 			                                const Vertex& v3, SWImageRenderer& r) {
 				if (v2.position.y < v1.position.y) {
 					if (v3.position.y < v2.position.y) {
-						DrawPolygonInternalInner(img, v3, v2, v1, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v3, v2, v1);
 					} else if (v3.position.y < v1.position.y) {
-						DrawPolygonInternalInner(img, v2, v3, v1, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v2, v3, v1);
 					} else {
-						DrawPolygonInternalInner(img, v2, v1, v3, r);
+						r.Enqueue(&DrawPolygonInternalInner, img, v2, v1, v3);
 					}
 				} else if (v3.position.y < v1.position.y) {
-					DrawPolygonInternalInner(img, v3, v1, v2, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v3, v1, v2);
 				} else if (v3.position.y < v2.position.y) {
-					DrawPolygonInternalInner(img, v1, v3, v2, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v1, v3, v2);
 				} else {
-					DrawPolygonInternalInner(img, v1, v2, v3, r);
+					r.Enqueue(&DrawPolygonInternalInner, img, v1, v2, v3);
 				}
 			}
 		};
@@ -1370,6 +1504,78 @@ namespace spades {
 			}
 		};
 
+		void SWImageRenderer::Enqueue(RasterizeFunction rasterize, SWImage* img, const Vertex& v1,
+		                              const Vertex& v2, const Vertex& v3) {
+			const int fbH = frame->GetHeight();
+			if (v3.position.y <= 0.0F || v1.position.y >= static_cast<float>(fbH))
+				return; // viewport cull
+
+			// same range as the rasterizer's
+			const int minY = std::max(static_cast<int>(v1.position.y), 0);
+			const int maxY = std::min(static_cast<int>(v3.position.y), fbH);
+			if (minY >= maxY)
+				return;
+
+			if (img && img->pendingRenderer != this) {
+				if (img->pendingRenderer)
+					img->pendingRenderer->Flush();
+				img->pendingRenderer = this;
+				retainedImages.push_back(Handle<SWImage>(*img));
+			}
+
+			auto index = static_cast<uint32_t>(commands.size());
+			commands.push_back(Command{rasterize, img, v1, v2, v3});
+
+			const int lastTile = (maxY - 1) / TileHeight;
+			for (int t = minY / TileHeight; t <= lastTile; t++)
+				bins[t].push_back(index);
+		}
+
+		void SWImageRenderer::Flush() {
+			SPADES_MARK_FUNCTION();
+
+			if (commands.empty())
+				return;
+
+			const int fbH = frame->GetHeight();
+			Tile baseTile{frame.GetPointerOrNull(), depthBuffer, featureLevel, 0, fbH, 0};
+
+			if (commands.size() < MinParallelCommands) {
+				// not worth splitting into tiles
+				for (const auto& c : commands)
+					c.rasterize(c.img, c.v1, c.v2, c.v3, baseTile);
+				pixelsDrawn += baseTile.pixelsDrawn;
+			} else {
+				const int numTiles = static_cast<int>(bins.size());
+				std::atomic<int> nextTile{0};
+				std::atomic<unsigned long long> numPixelsDrawn{0};
+
+				// tiles are handed out one by one since the polygons (e.g.,
+				// a cloud of smoke sprites) are rarely spread evenly
+				InvokeParallel2([&](unsigned int, unsigned int) {
+					Tile tile = baseTile;
+					int t;
+					while ((t = nextTile.fetch_add(1)) < numTiles) {
+						tile.minY = t * TileHeight;
+						tile.maxY = std::min(tile.minY + TileHeight, fbH);
+						for (uint32_t i : bins[t]) {
+							const auto& c = commands[i];
+							c.rasterize(c.img, c.v1, c.v2, c.v3, tile);
+						}
+					}
+					numPixelsDrawn += tile.pixelsDrawn;
+				});
+				pixelsDrawn += numPixelsDrawn;
+			}
+
+			commands.clear();
+			for (auto& bin : bins)
+				bin.clear();
+			for (const auto& img : retainedImages)
+				img->pendingRenderer = nullptr;
+			retainedImages.clear();
+		}
+
 		void SWImageRenderer::DrawPolygon(SWImage* img, const Vertex& v1, const Vertex& v2,
 		                                  const Vertex& v3) {
 			SPAssert(frame);
@@ -20,6 +20,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "SWFeatureLevel.h"
 #include <Core/Math.h>
 #include <Core/RefCountedObject.h>
@@ -49,6 +52,42 @@ namespace spades {
 			SWFeatureLevel featureLevel;
 			unsigned long long pixelsDrawn;
 
+			/** Height of a tile in pixels. Tiles span the whole framebuffer width
+			 * because the rasterizer works on scanlines. */
+			enum { TileHeight = 16 };
+
+			/** Below this number of queued polygons `Flush` doesn't bother
+			 * starting the worker threads. */
+			enum { MinParallelCommands = 16 };
+
+			/** The target of the rasterizer, limited to the scanlines of one tile. */
+			struct Tile {
+				Bitmap *frame;
+				float *depthBuffer;
+				SWFeatureLevel featureLevel;
+				int minY, maxY;
+				unsigned long long pixelsDrawn;
+			};
+
+			using RasterizeFunction = void (*)(SWImage *, const Vertex &, const Vertex &,
+			                                   const Vertex &, Tile &);
+
+			/** A screen-space polygon whose vertices are sorted by Y. */
+			struct Command {
+				RasterizeFunction rasterize;
+				SWImage *img;
+				Vertex v1, v2, v3;
+			};
+
+			std::vector<Command> commands;
+			/** Indices of the commands overlapping each tile, in submission order. */
+			std::vector<std::vector<uint32_t>> bins;
+			/** Keeps the images referenced by `commands` alive. */
+			std::vector<Handle<SWImage>> retainedImages;
+
+			void Enqueue(RasterizeFunction, SWImage *, const Vertex &, const Vertex &,
+			             const Vertex &);
+
 			template <SWFeatureLevel, bool, bool, bool, bool, bool> struct PolygonRenderer;
 
 			template <SWFeatureLevel, bool, bool, bool, bool> struct PolygonRenderer3;
@@ -68,6 +107,16 @@ namespace spades {
 
 			void DrawPolygon(SWImage *img, const Vertex &v1, const Vertex &v2, const Vertex &v3);
 
+			/**
+			 * Rasterizes all polygons queued by `DrawPolygon`.
+			 *
+			 * Polygons are only transformed and binned to tiles when they are
+			 * drawn. The tiles are rasterized in parallel here, each of them
+			 * drawing its polygons in submission order, so this must be called
+			 * before the framebuffer is read or modified by anything else.
+			 */
+			void Flush();
+
 			unsigned long long GetPixelsDrawn() { return pixelsDrawn; }
 			void ResetPixelStatistics() { pixelsDrawn = 0; }
 		};
@@ -18,7 +18,9 @@
 
  */
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 
@@ -35,6 +37,11 @@
 using namespace std;
 
 DEFINE_SPADES_SETTING(r_swUndersampling, "0");
+DEFINE_SPADES_SETTING(r_swRleCompaction, "1");
+DEFINE_SPADES_SETTING(r_swRleHeapTrace, "0");
+DEFINE_SPADES_SETTING(r_swFrameBudget, "0");
+DEFINE_SPADES_SETTING(r_swReprojection, "0");
+DEFINE_SPADES_SETTING(r_swReprojectionRefresh, "8");
 
 namespace spades {
 	namespace draw {
@@ -112,33 +119,69 @@ namespace spades {
 		      map(m),
 		      frameBuf(nullptr),
 		      depthBuf(nullptr),
-		      rleHeap(m->Width() * m->Height() * 64) {
+		      rleHeap(m->Width() * m->Height() * 64),
+		      rleUpdateTime(0.0),
+		      numRleUpdates(0),
+		      adaptiveUndersampling(1),
+		      averageFrameTime(0.0),
+		      averageMapTime(0.0),
+		      framesSinceAdaptation(0),
+		      historyUndersampling(0),
+		      historyValid(false),
+		      framesSinceFullRender(0),
+		      numBlocksRendered(0),
+		      numBlocksTotal(0) {
 			rle.resize(w * h);
 			rleLen.resize(w * h);
+			rleSolidMap.resize(w * h);
+			rleDirty.resize(w * h, false);
 
 			Stopwatch sw;
 			sw.Reset();
 			SPLog("Building RLE map...");
 
-			int idx = 0;
-			for (int y = 0; y < h; y++)
-			for (int x = 0; x < w; x++) {
-				BuildRle(x, y, rleBuf);
-
-				auto ref = rleHeap.Alloc(rleBuf.size() * sizeof(RleData));
-				short* ptr = rleHeap.Dereference<short>(ref);
-				std::memcpy(ptr, rleBuf.data(), rleBuf.size() * sizeof(RleData));
-
-				rle[idx] = ref;
-				rleLen[idx] = rleBuf.size() * sizeof(RleData);
+			// build the columns of bands of rows in parallel...
+			enum { RowsPerBand = 16 };
+			int numBands = (h + RowsPerBand - 1) / RowsPerBand;
+			std::vector<std::vector<RleData>> bandRles(numBands);
+			std::atomic<int> nextBand{0};
+			InvokeParallel2([&](unsigned int, unsigned int) {
+				std::vector<RleData> buf;
+				int band;
+				while ((band = nextBand.fetch_add(1)) < numBands) {
+					auto& out = bandRles[band];
+					for (int y = band * RowsPerBand; y < std::min(h, (band + 1) * RowsPerBand); y++)
+					for (int x = 0; x < w; x++) {
+						int idx = x + y * w;
+						rleSolidMap[idx] = map->GetSolidMapWrapped(x, y);
+						BuildRle(x, y, buf);
+						out.insert(out.end(), buf.begin(), buf.end());
+						rleLen[idx] = buf.size() * sizeof(RleData);
+					}
+				}
+			});
 
-				idx++;
+			// ...and pack them into the heap in order
+			for (int band = 0, idx = 0; band < numBands; band++) {
+				const RleData* data = bandRles[band].data();
+				for (int i = 0; i < RowsPerBand * w && idx < w * h; i++, idx++) {
+					auto ref = rleHeap.Alloc(rleLen[idx]);
+					std::memcpy(rleHeap.Dereference<RleData>(ref), data, rleLen[idx]);
+					data += rleLen[idx] / sizeof(RleData);
+					rle[idx] = ref;
+				}
 			}
 
 			SPLog("RLE map created in %.6f seconds", sw.GetTime());
+
+			if (r_swRleHeapTrace)
+				rleTraceInitial = rleLen;
 		}
 
-		SWMapRenderer::~SWMapRenderer() {}
+		SWMapRenderer::~SWMapRenderer() {
+			if (!rleTraceInitial.empty())
+				ReplayRleTrace();
+		}
 
 		void SWMapRenderer::BuildRle(int x, int y, std::vector<RleData>& out) {
 			out.clear();
@@ -158,41 +201,36 @@ namespace spades {
 				reinterpret_cast<short*>(out.data())[idx] = static_cast<short>(val);
 			};
 
+			// emits the Z coordinates of the set bits followed by the terminator
+			auto emitAscending = [&](uint64_t bits) {
+				for (int z = 0; bits; z++, bits >>= 1)
+					if (bits & 1)
+						out.push_back(static_cast<RleData>(z));
+				out.push_back(-1);
+			};
+			auto emitDescending = [&](uint64_t bits) {
+				for (int z = 63; bits; z--, bits <<= 1)
+					if (bits >> 63)
+						out.push_back(static_cast<RleData>(z));
+				out.push_back(-1);
+			};
+
 			uint64_t smap = map->GetSolidMapWrapped(x, y);
 			std::array<uint64_t, 4> adjs = {
 			  map->GetSolidMapWrapped(x + 1, y), map->GetSolidMapWrapped(x - 1, y),
 			  map->GetSolidMapWrapped(x, y + 1), map->GetSolidMapWrapped(x, y - 1)};
-			bool old = false;
 
-			for (int z = 0; z < 64; z++) {
-				bool b = (smap >> z) & 1;
-				if (b && !old)
-					out.push_back(static_cast<RleData>(z));
-				old = b;
-			}
-			out.push_back(-1);
+			// top of each run (the voxel above is air)
+			emitAscending(smap & ~(smap << 1));
 
+			// bottom of each run (the voxel below is air, z = 63 is the floor)
 			setHeader(0, out.size());
+			emitDescending(smap & ~((smap >> 1) | (1ULL << 63)));
 
-			old = true;
-			for (int z = 63; z >= 0; z--) {
-				bool b = (smap >> z) & 1;
-				if (b && !old)
-					out.push_back(static_cast<RleData>(z));
-				old = b;
-			}
-			out.push_back(-1);
-
+			// side faces
 			for (int k = 0; k < 4; k++) {
 				setHeader(k + 1, out.size());
-				for (int z = 0; z < 64; z++) {
-					if ((smap >> z) & 1) {
-						if (!((adjs[k] >> z) & 1)) {
-							out.push_back(static_cast<RleData>(z));
-						}
-					}
-				}
-				out.push_back(-1);
+				emitAscending(smap & ~adjs[k]);
 			}
 
 			// padding
@@ -203,16 +241,116 @@ namespace spades {
 
 		void SWMapRenderer::UpdateRle(int x, int y) {
 			int idx = x + y * w;
-			BuildRle(x, y, rleBuf);
+			uint64_t smap = map->GetSolidMapWrapped(x, y);
+
+			// the previous frame shows the old blocks (or their old colors)
+			historyValid = false;
+
+			// the RLE only depends on the solidity, so recoloring doesn't matter
+			if (smap == rleSolidMap[idx])
+				return;
+			rleSolidMap[idx] = smap;
+
+			// the side faces of the adjacent columns change as well
+			MarkRleDirty(x, y);
+			MarkRleDirty((x + 1) & (w - 1), y);
+			MarkRleDirty((x - 1) & (w - 1), y);
+			MarkRleDirty(x, (y + 1) & (h - 1));
+			MarkRleDirty(x, (y - 1) & (h - 1));
+		}
+
+		void SWMapRenderer::MarkRleDirty(int x, int y) {
+			int idx = x + y * w;
+			if (!rleDirty[idx]) {
+				rleDirty[idx] = true;
+				dirtyRles.push_back(idx);
+			}
+		}
+
+		void SWMapRenderer::ApplyRleUpdates() {
+			SPADES_MARK_FUNCTION();
 
-			rleHeap.Free(rle[idx], rleLen[idx]);
+			if (dirtyRles.empty())
+				return;
+
+			Stopwatch sw;
+
+			for (int idx : dirtyRles) {
+				rleDirty[idx] = false;
+				BuildRle(idx & (w - 1), idx / w, rleBuf);
+
+				// rewrite in place if the column still fits its block, otherwise
+				// move it to a new block with some room to grow
+				size_t len = rleBuf.size() * sizeof(RleData);
+				if (len > rleLen[idx]) {
+					rleHeap.Free(rle[idx], rleLen[idx]);
+					rleLen[idx] = len + RleSlack;
+					rle[idx] = rleHeap.Alloc(rleLen[idx]);
+					if (!rleTraceInitial.empty())
+						rleTrace.emplace_back(idx, rleLen[idx]);
+				}
+				std::memcpy(rleHeap.Dereference<RleData>(rle[idx]), rleBuf.data(), len);
+			}
+
+			numRleUpdates += dirtyRles.size();
+			dirtyRles.clear();
+
+			// moved columns leave holes behind. they are reused by later moves,
+			// but repack everything when they add up to an eighth of the data.
+			size_t holes = rleHeap.GetFreeBytes() - rleHeap.GetLargestFreeRegion();
+			size_t used = rleHeap.GetSize() - rleHeap.GetFreeBytes();
+			if (r_swRleCompaction && holes > used / 8)
+				CompactRle();
 
-			auto ref = rleHeap.Alloc(rleBuf.size() * sizeof(RleData));
-			short* ptr = rleHeap.Dereference<short>(ref);
-			std::memcpy(ptr, rleBuf.data(), rleBuf.size() * sizeof(RleData));
+			rleUpdateTime += sw.GetTime();
+		}
+
+		void SWMapRenderer::CompactRle() {
+			SPADES_MARK_FUNCTION();
+
+			size_t total = 0;
+			for (size_t len : rleLen)
+				total += len;
+
+			MiniHeap newHeap(total + total / 8);
+			for (size_t idx = 0; idx < rle.size(); idx++) {
+				auto ref = newHeap.Alloc(rleLen[idx]);
+				std::memcpy(newHeap.Dereference<RleData>(ref),
+				            rleHeap.Dereference<RleData>(rle[idx]), rleLen[idx]);
+				rle[idx] = ref;
+			}
 
-			rle[idx] = ref;
-			rleLen[idx] = rleBuf.size() * sizeof(RleData);
+			rleHeap = std::move(newHeap);
+		}
+
+		void SWMapRenderer::ReplayRleTrace() {
+			SPADES_MARK_FUNCTION();
+
+			// replays the recorded allocations to measure the heap alone
+			std::vector<MiniHeap::Ref> refs(rleTraceInitial.size());
+			std::vector<size_t> lens = rleTraceInitial;
+			MiniHeap heap(w * h * 64);
+
+			Stopwatch sw;
+			for (size_t idx = 0; idx < refs.size(); idx++)
+				refs[idx] = heap.Alloc(lens[idx]);
+			double initTime = sw.GetTime();
+
+			sw.Reset();
+			for (const auto& e : rleTrace) {
+				heap.Free(refs[e.first], lens[e.first]);
+				refs[e.first] = heap.Alloc(e.second);
+				lens[e.first] = e.second;
+			}
+			double replayTime = sw.GetTime();
+
+			SPLog("RLE heap trace: %zu initial allocations in %.3fms, %zu moves in %.3fms "
+			      "(%.1fns per move)",
+			      refs.size(), initTime * 1000.0, rleTrace.size(), replayTime * 1000.0,
+			      rleTrace.empty() ? 0.0 : replayTime * 1.0e9 / rleTrace.size());
+			SPLog("RLE heap trace: %zu bytes, %zu free in %zu regions (largest: %zu)",
+			      heap.GetSize(), heap.GetFreeBytes(), heap.GetNumFreeRegions(),
+			      heap.GetLargestFreeRegion());
 		}
 
 		template <SWFeatureLevel flevel>
@@ -704,7 +842,8 @@ namespace spades {
 
 		template <SWFeatureLevel flevel, int under>
 		void SWMapRenderer::RenderFinal(float yawMin, float yawMax, unsigned int numLines,
-		                                unsigned int threadId, unsigned int numThreads) {
+		                                unsigned int threadId, unsigned int numThreads,
+		                                const uint8_t* blockMask) {
 			float fovX = tanf(sceneDef.fovX * 0.5F);
 			float fovY = tanf(sceneDef.fovY * 0.5F);
 			Vector3 front = sceneDef.viewAxis[2];
@@ -730,7 +869,8 @@ namespace spades {
 			std::int32_t yawMin2 = static_cast<std::int32_t>(yawMin * yawScale);
 			auto& lineList = this->lines;
 
-			enum { blockSize = 8, hBlock = blockSize / under };
+			enum { blockSize = BlockSize, hBlock = blockSize / under };
+			unsigned int maskPitch = (fw + blockSize - 1) / blockSize;
 
 			Vector3 deltaDownLarge = deltaDown * blockSize;
 			Vector3 deltaRightLarge = deltaRight * hBlock;
@@ -754,6 +894,9 @@ namespace spades {
 					uint32_t* fb2 = fb + fx + fy * fw;
 					float* db2 = depthBuf + fx + fy * fw;
 
+					if (blockMask && !blockMask[fx / blockSize + fy / blockSize * maskPitch])
+						goto NextBlock; // reprojected from the previous frame
+
 					if (v2.z > 0.99F || v2.z < -0.99F)
 						goto FastBlockPath; // near to pole. cannot be approximated by piecewise
 
@@ -889,6 +1032,7 @@ namespace spades {
 					}
 				}
 
+				NextBlock:
 					v2 += deltaDownLarge;
 					screenPos.y += deltaScreenPosDown;
 				} // fy
@@ -897,6 +1041,212 @@ namespace spades {
 			} // fx
 		}
 
+		int SWMapRenderer::GetUndersampling() {
+			if (static_cast<float>(r_swFrameBudget) > 0.0F)
+				return adaptiveUndersampling;
+			return Clamp(static_cast<int>(r_swUndersampling), 1, 4);
+		}
+
+		void SWMapRenderer::AdaptUndersampling(double frameTime, double mapTime) {
+			double budget = static_cast<float>(r_swFrameBudget) * 0.001;
+			if (budget <= 0.0) {
+				framesSinceAdaptation = 0;
+				return;
+			}
+
+			averageFrameTime += (frameTime - averageFrameTime) * 0.1;
+			averageMapTime += (mapTime - averageMapTime) * 0.1;
+
+			// let the averages settle after each change
+			if (++framesSinceAdaptation < 16)
+				return;
+
+			if (averageFrameTime > budget && adaptiveUndersampling < 4) {
+				adaptiveUndersampling *= 2;
+				framesSinceAdaptation = 0;
+			} else if (adaptiveUndersampling > 1 &&
+			           averageFrameTime + averageMapTime < budget * 0.9) {
+				// halving the undersampling roughly doubles the map pass
+				adaptiveUndersampling /= 2;
+				framesSinceAdaptation = 0;
+			}
+		}
+
+		bool SWMapRenderer::Reproject(int under) {
+			SPADES_MARK_FUNCTION();
+
+			const client::SceneDefinition& def = sceneDef;
+			const client::SceneDefinition& old = historyDef;
+			int fw = frameBuf->GetWidth();
+			int fh = frameBuf->GetHeight();
+
+			if (!historyValid || historyColor.size() != static_cast<size_t>(fw * fh) ||
+			    historyUndersampling != under || def.fovX != old.fovX || def.fovY != old.fovY ||
+			    framesSinceFullRender >= static_cast<int>(r_swReprojectionRefresh))
+				return false;
+
+			// most of the frame would be disoccluded anyway
+			if ((def.viewOrigin - old.viewOrigin).GetLength() > 1.0F ||
+			    Vector3::Dot(def.viewAxis[2], old.viewAxis[2]) < 0.95F)
+				return false;
+
+			float fovX = tanf(def.fovX * 0.5F);
+			float fovY = tanf(def.fovY * 0.5F);
+			float pixelX = fovX * 2.0F / static_cast<float>(fw);
+			float pixelY = fovY * 2.0F / static_cast<float>(fh);
+			float invPixelX = 1.0F / pixelX;
+			float invPixelY = 1.0F / pixelY;
+			Vector3 front = def.viewAxis[2];
+			Vector3 right = def.viewAxis[0];
+			Vector3 down = def.viewAxis[1];
+			Vector3 oldFront = old.viewAxis[2];
+			Vector3 oldRight = old.viewAxis[0];
+			Vector3 oldDown = old.viewAxis[1];
+
+			int maskPitch = (fw + BlockSize - 1) / BlockSize;
+			int maskRows = (fh + BlockSize - 1) / BlockSize;
+			blockMask.assign(maskPitch * maskRows, 0);
+
+			uint32_t* fb = frameBuf->GetPixels();
+			float* db = depthBuf;
+			const uint32_t* oldColor = historyColor.data();
+			const float* oldDepth = historyDepth.data();
+
+			// Every pixel fetches the previous frame's pixel its ray passes
+			// through and takes it if the surface seen there is still seen
+			// through this pixel. Otherwise the surface was disoccluded (or
+			// occluded) by the camera movement and the block is rendered again.
+			std::atomic<int> nextRow{0};
+			InvokeParallel2([&](unsigned int, unsigned int) {
+				int row;
+				while ((row = nextRow.fetch_add(1)) < maskRows) {
+					uint8_t* mask = blockMask.data() + row * maskPitch;
+					int endY = std::min((row + 1) * static_cast<int>(BlockSize), fh);
+					for (int y = row * BlockSize; y < endY; y++) {
+						float sy = fovY - static_cast<float>(y) * pixelY;
+						for (int x = 0; x < fw; x++) {
+							float sx = static_cast<float>(x) * pixelX - fovX;
+							Vector3 dir = front + right * sx + down * sy;
+
+							float c = Vector3::Dot(dir, oldFront);
+							if (c > 0.0F) {
+								float invC = 1.0F / c;
+								int ox = static_cast<int>(
+								  floorf((Vector3::Dot(dir, oldRight) * invC + fovX) * invPixelX +
+								         0.5F));
+								int oy = static_cast<int>(
+								  floorf((fovY - Vector3::Dot(dir, oldDown) * invC) * invPixelY +
+								         0.5F));
+								if (ox >= 0 && oy >= 0 && ox < fw && oy < fh) {
+									int oi = ox + oy * fw;
+									Vector3 oldDir = oldFront +
+									                 oldRight * (static_cast<float>(ox) * pixelX - fovX) +
+									                 oldDown * (fovY - static_cast<float>(oy) * pixelY);
+									Vector3 rel = old.viewOrigin + oldDir * oldDepth[oi] - def.viewOrigin;
+									float depth = Vector3::Dot(rel, front);
+									if (depth > 0.01F) {
+										float invDepth = 1.0F / depth;
+										float nsx = Vector3::Dot(rel, right) * invDepth;
+										float nsy = Vector3::Dot(rel, down) * invDepth;
+										if (fabsf(nsx - sx) <= pixelX && fabsf(nsy - sy) <= pixelY) {
+											fb[x + y * fw] = oldColor[oi];
+											db[x + y * fw] = depth;
+											continue;
+										}
+									}
+								}
+							}
+
+							mask[x / BlockSize] = 1;
+						}
+					}
+				}
+			});
+
+			return true;
+		}
+
+		void SWMapRenderer::MarkNeededLines(float yawMin, float yawMax, unsigned int numLines) {
+			float fovX = tanf(sceneDef.fovX * 0.5F);
+			float fovY = tanf(sceneDef.fovY * 0.5F);
+			Vector3 front = sceneDef.viewAxis[2];
+			Vector3 right = sceneDef.viewAxis[0];
+			Vector3 down = sceneDef.viewAxis[1];
+
+			unsigned int fw = frameBuf->GetWidth();
+			unsigned int fh = frameBuf->GetHeight();
+			unsigned int maskPitch = (fw + BlockSize - 1) / BlockSize;
+			unsigned int maskRows = (fh + BlockSize - 1) / BlockSize;
+			Vector3 v1 = front - right * fovX + down * fovY;
+			Vector3 deltaRight = right * (fovX * 2.0F / static_cast<float>(fw) * BlockSize);
+			Vector3 deltaDown = -down * (fovY * 2.0F / static_cast<float>(fh) * BlockSize);
+
+			// same mapping from yaw to line as `RenderFinal`
+			static const float pi = M_PI_F;
+			float yawScale = 65536.0F / (pi * 2.0F);
+			std::int64_t yawScale2 =
+			  static_cast<std::int32_t>(pi * 2.0F / (yawMax - yawMin) * 65536.0F);
+			std::int32_t yawMin2 = static_cast<std::int32_t>(yawMin * yawScale);
+			int lastLine = static_cast<int>(numLines) - 1;
+			auto lineOf = [&](int yaw) {
+				std::int64_t index = (static_cast<std::int64_t>(yaw & 0xFFFF) * yawScale2) >> 16;
+				index = (index * numLines) >> 16;
+				return static_cast<int>(std::min<std::int64_t>(index, lastLine));
+			};
+			// the interpolation of `RenderFinal` may round past the corners
+			auto mark = [&](int first, int last) {
+				for (int i = std::max(first - 1, 0); i <= std::min(last + 1, lastLine); i++)
+					lineMask[i] = 1;
+			};
+
+			lineMask.assign(numLines, 0);
+
+			for (unsigned int by = 0; by < maskRows; by++) {
+				for (unsigned int bx = 0; bx < maskPitch; bx++) {
+					if (!blockMask[bx + by * maskPitch])
+						continue;
+
+					// the yaw of a block lies between the yaws of its corners
+					Vector3 v = v1 + deltaRight * static_cast<float>(bx) +
+					            deltaDown * static_cast<float>(by);
+					const Vector3 corners[] = {v + deltaRight, v + deltaDown,
+					                           v + deltaRight + deltaDown};
+					int yaw0 = (fastATan2(v.y, v.x) - yawMin2) & 0xFFFF;
+					int lo = yaw0, hi = yaw0;
+					for (const Vector3& corner : corners) {
+						int yaw = (fastATan2(corner.y, corner.x) - yawMin2) & 0xFFFF;
+						yaw = yaw0 + static_cast<std::int16_t>(yaw - yaw0); // phase unwrapping
+						lo = std::min(lo, yaw);
+						hi = std::max(hi, yaw);
+					}
+
+					if (hi - lo >= 16384) {
+						// the block contains a pole and touches lines all around
+						std::fill(lineMask.begin(), lineMask.end(), 1);
+						return;
+					}
+
+					if ((lo >> 16) == (hi >> 16)) {
+						mark(lineOf(lo), lineOf(hi));
+					} else {
+						mark(lineOf(lo), lastLine);
+						mark(0, lineOf(hi));
+					}
+				}
+			}
+		}
+
+		void SWMapRenderer::SaveHistory() {
+			size_t count = frameBuf->GetWidth() * frameBuf->GetHeight();
+			historyColor.resize(count);
+			historyDepth.resize(count);
+			std::memcpy(historyColor.data(), frameBuf->GetPixels(), count * sizeof(uint32_t));
+			std::memcpy(historyDepth.data(), depthBuf, count * sizeof(float));
+			historyDef = sceneDef;
+			historyUndersampling = GetUndersampling();
+			historyValid = true;
+		}
+
 		template <SWFeatureLevel flevel>
 		void SWMapRenderer::RenderInner(const client::SceneDefinition& def, Bitmap* frame,
 		                                float* depthBuffer) {
@@ -909,7 +1259,7 @@ namespace spades {
 			float pitchMin, pitchMax;
 			size_t numLines;
 
-			int under = r_swUndersampling;
+			int under = GetUndersampling();
 
 			{
 				float fovX = tanf(def.fovX * 0.5F);
@@ -957,7 +1307,6 @@ namespace spades {
 
 				numLines = static_cast<size_t>((yawMax - yawMin) / interval);
 
-				int under = Clamp((int)r_swUndersampling, 1, 4);
 				numLines /= under;
 
 				if (numLines < 8)
@@ -985,48 +1334,87 @@ namespace spades {
 				}
 			}
 
+			// only the blocks that cannot be reprojected from the previous
+			// frame and the lines they use are rendered
+			const uint8_t* renderMask = nullptr;
+			const uint8_t* lineNeeded = nullptr;
+			size_t numBlocks = ((frame->GetWidth() + BlockSize - 1) / BlockSize) *
+			                   ((frame->GetHeight() + BlockSize - 1) / BlockSize);
+			size_t numRenderedBlocks = numBlocks;
+			if (r_swReprojection && Reproject(under)) {
+				MarkNeededLines(yawMin, yawMax, static_cast<unsigned int>(numLines));
+				renderMask = blockMask.data();
+				lineNeeded = lineMask.data();
+				numRenderedBlocks = std::count(blockMask.begin(), blockMask.end(), 1);
+				framesSinceFullRender++;
+			} else {
+				framesSinceFullRender = 0;
+			}
+			numBlocksRendered += numRenderedBlocks;
+			numBlocksTotal += numBlocks;
+
 			{
-				unsigned int nlines = static_cast<unsigned int>(numLines);
-				InvokeParallel2([&](unsigned int th, unsigned int numThreads) {
-					unsigned int start = th * nlines / numThreads;
-					unsigned int end = (th + 1) * nlines / numThreads;
+				enum { LinesPerChunk = 16 };
+				int nlines = static_cast<int>(numLines);
+				std::atomic<int> nextLine{0};
+				InvokeParallel2([&](unsigned int, unsigned int) {
+					int start;
+					while ((start = nextLine.fetch_add(LinesPerChunk)) < nlines) {
+						int end = std::min(start + static_cast<int>(LinesPerChunk), nlines);
+						for (int i = start; i < end; i++)
+							if (!lineNeeded || lineNeeded[i])
+								BuildLine<flevel>(lines[i], pitchMin, pitchMax);
+					}
+				});
+			}
 
-					for (size_t i = start; i < end; i++)
-						BuildLine<flevel>(lines[i], pitchMin, pitchMax);
+			if (numRenderedBlocks > 0) {
+				InvokeParallel2([&](unsigned int th, unsigned int numThreads) {
+					unsigned int nlines = static_cast<unsigned int>(numLines);
+					if (under <= 1) {
+						RenderFinal<flevel, 1>(yawMin, yawMax, nlines, th, numThreads, renderMask);
+					} else if (under <= 2) {
+						RenderFinal<flevel, 2>(yawMin, yawMax, nlines, th, numThreads, renderMask);
+					} else {
+						RenderFinal<flevel, 4>(yawMin, yawMax, nlines, th, numThreads, renderMask);
+					}
 				});
 			}
 
-			InvokeParallel2([&](unsigned int th, unsigned int numThreads) {
-				if (under <= 1) {
-					RenderFinal<flevel, 1>(yawMin, yawMax, static_cast<unsigned int>(numLines), th, numThreads);
-				} else if (under <= 2) {
-					RenderFinal<flevel, 2>(yawMin, yawMax, static_cast<unsigned int>(numLines), th, numThreads);
-				} else {
-					RenderFinal<flevel, 4>(yawMin, yawMax, static_cast<unsigned int>(numLines), th, numThreads);
-				}
-			});
+			if (r_swReprojection) {
+				SaveHistory();
+			} else if (historyValid) {
+				historyValid = false;
+				historyColor = std::vector<uint32_t>();
+				historyDepth = std::vector<float>();
+			}
 
 			frameBuf = nullptr;
 			depthBuf = nullptr;
 		}
 
-		void SWMapRenderer::Render(const client::SceneDefinition& def, Bitmap& frame,
+		bool SWMapRenderer::Render(const client::SceneDefinition& def, Bitmap& frame,
 		                           float* depthBuffer) {
 			if (!depthBuffer)
 				SPInvalidArgument("depthBuffer");
 
+			ApplyRleUpdates();
+
 			IntVector3 p = def.viewOrigin.Floor();
-			if (map->IsSolidWrapped(p.x, p.y, p.z))
-				return;
+			if (map->IsSolidWrapped(p.x, p.y, p.z)) {
+				historyValid = false;
+				return false;
+			}
 
 #if ENABLE_SSE2
 			if (static_cast<int>(level) >= static_cast<int>(SWFeatureLevel::SSE2)) {
 				RenderInner<SWFeatureLevel::SSE2>(def, &frame, depthBuffer);
-				return;
+				return true;
 			}
 #endif
 
 			RenderInner<SWFeatureLevel::None>(def, &frame, depthBuffer);
+			return true;
 		}
 	} // namespace draw
 } // namespace spades
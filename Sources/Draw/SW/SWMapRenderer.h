@@ -63,13 +63,65 @@ namespace spades {
 
 			MiniHeap rleHeap;
 
+			/** Solid maps the RLE columns were built from. */
+			std::vector<uint64_t> rleSolidMap;
+			/** Columns to rebuild in the next `Render` call. */
+			std::vector<int> dirtyRles;
+			std::vector<bool> rleDirty;
+
+			/** Extra bytes given to a column moved to a new block. */
+			enum { RleSlack = 4 };
+
+			/** Size of the pixel blocks `RenderFinal` interpolates over. */
+			enum { BlockSize = 8 };
+
+			/** Recorded when `r_swRleHeapTrace` is set: the initial column sizes
+			 * followed by (column, new size) of every moved column. */
+			std::vector<std::size_t> rleTraceInitial;
+			std::vector<std::pair<int, std::size_t>> rleTrace;
+
+			double rleUpdateTime;
+			std::size_t numRleUpdates;
+
+			/** Undersampling factor chosen by `r_swFrameBudget`. */
+			int adaptiveUndersampling;
+			double averageFrameTime;
+			double averageMapTime;
+			int framesSinceAdaptation;
+
+			// Temporal reprojection (`r_swReprojection`): the map pass of the
+			// previous frame, before the models and the fog were drawn on it.
+			std::vector<uint32_t> historyColor;
+			std::vector<float> historyDepth;
+			client::SceneDefinition historyDef;
+			int historyUndersampling;
+			bool historyValid;
+			int framesSinceFullRender;
+			/** 8x8 pixel blocks that could not be reprojected. */
+			std::vector<uint8_t> blockMask;
+			/** Lines needed by the blocks in `blockMask`. */
+			std::vector<uint8_t> lineMask;
+
+			std::size_t numBlocksRendered;
+			std::size_t numBlocksTotal;
+
 			template <SWFeatureLevel level>
 			void BuildLine(Line& line, float minPitch, float maxPitch);
 			void BuildRle(int x, int y, std::vector<RleData>&);
+			void MarkRleDirty(int x, int y);
+			void ApplyRleUpdates();
+			void CompactRle();
+			void ReplayRleTrace();
+
+			int GetUndersampling();
+			bool Reproject(int under);
+			void MarkNeededLines(float yawMin, float yawMax, unsigned int numLines);
+			void SaveHistory();
 
 			template <SWFeatureLevel level, int undersamp>
 			void RenderFinal(float yawMin, float yawMax, unsigned int numLines,
-			                 unsigned int threadId, unsigned int numThreads);
+			                 unsigned int threadId, unsigned int numThreads,
+			                 const uint8_t* blockMask);
 
 			template <SWFeatureLevel level>
 			void RenderInner(const client::SceneDefinition&, Bitmap* fb, float* depthBuffer);
@@ -78,9 +130,44 @@ namespace spades {
 			SWMapRenderer(SWRenderer& r, client::GameMap*, SWFeatureLevel level);
 			~SWMapRenderer();
 
-			void Render(const client::SceneDefinition&, Bitmap& fb, float* depthBuffer);
-
+			/**
+			 * Renders the map to `fb` and `depthBuffer`.
+			 * @return `true` if every pixel was written. `false` if nothing
+			 *         was drawn because the camera is inside a block.
+			 */
+			bool Render(const client::SceneDefinition&, Bitmap& fb, float* depthBuffer);
+
+			/**
+			 * Notifies that the blocks of the column have changed. The RLE of
+			 * the column and its neighbors is rebuilt by the next `Render` call
+			 * if the solidity of the column has changed.
+			 */
 			void UpdateRle(int x, int y);
+
+			/** @return the time spent on rebuilding RLE columns since the last reset. */
+			double GetRleUpdateTime() { return rleUpdateTime; }
+			/** @return the number of RLE columns rebuilt since the last reset. */
+			std::size_t GetNumRleUpdates() { return numRleUpdates; }
+			/** @return the number of 8x8 pixel blocks rendered (not reprojected)
+			 * since the last reset, and the number of blocks in those frames. */
+			std::size_t GetNumBlocksRendered() { return numBlocksRendered; }
+			std::size_t GetNumBlocksTotal() { return numBlocksTotal; }
+			/** @return the undersampling factor used by the next frame. */
+			int GetCurrentUndersampling() { return GetUndersampling(); }
+			void ResetStatistics() {
+				rleUpdateTime = 0.0;
+				numRleUpdates = 0;
+				numBlocksRendered = 0;
+				numBlocksTotal = 0;
+			}
+
+			/**
+			 * Adjusts the undersampling factor to keep the frame time within
+			 * `r_swFrameBudget` milliseconds.
+			 * @param frameTime The duration of the last frame.
+			 * @param mapTime The time the map pass took in the last frame.
+			 */
+			void AdaptUndersampling(double frameTime, double mapTime);
 		};
 	} // namespace draw
 } // namespace spades
\ No newline at end of file
@@ -34,10 +34,23 @@ namespace spades {
 			center *= 0.5F;
 			radius = center.GetLength();
 
+			m.BuildLevels();
+			levels.resize(m.GetNumLevels());
+			for (int i = 0; i < m.GetNumLevels(); i++)
+				BuildLevel(m.GetLevel(i), levels[i]);
+		}
+
+		void SWModel::BuildLevel(const VoxelModel& m, Level& level) {
+			int w = m.GetWidth();
+			int h = m.GetHeight();
+			int d = m.GetDepth();
+			level.width = w;
+			level.height = h;
+
 			for (int y = 0; y < h; y++) {
 				for (int x = 0; x < w; x++) {
 
-					renderDataAddr.push_back(static_cast<uint32_t>(renderData.size()));
+					level.renderDataAddr.push_back(static_cast<uint32_t>(level.renderData.size()));
 
 					uint64_t map = m.GetSolidBitsAt(x, y);
 					uint64_t map1 = x > 0 ? m.GetSolidBitsAt(x - 1, y) : 0;
@@ -59,7 +72,7 @@ namespace spades {
 							encodedColor =
 							  (col & 0xff00) | ((col & 0xff) << 16) | ((col & 0xff0000) >> 16);
 							encodedColor |= z << 24;
-							renderData.push_back(encodedColor);
+							level.renderData.push_back(encodedColor);
 
 							auto material = static_cast<MaterialType>(col >> 24);
 
@@ -95,11 +108,11 @@ namespace spades {
 								normal = nx + ny * 3 + nz * 9;
 							}
 
-							renderData.push_back(normal);
+							level.renderData.push_back(normal);
 						}
 					}
 
-					renderData.push_back(0xffffffffU);
+					level.renderData.push_back(0xffffffffU);
 				}
 			}
 		}
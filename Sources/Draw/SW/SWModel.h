@@ -33,12 +33,21 @@ namespace spades {
 		class SWModel : public client::IModel {
 			friend class SWModelRenderer;
 
+			/** The surface voxels of one level of detail. */
+			struct Level {
+				int width, height;
+				std::vector<uint32_t> renderData;
+				std::vector<uint32_t> renderDataAddr;
+			};
+
 			Handle<VoxelModel> rawModel;
 			float radius;
 			Vector3 center;
 
-			std::vector<uint32_t> renderData;
-			std::vector<uint32_t> renderDataAddr;
+			/** Built from `VoxelModel::GetLevel(i)`. */
+			std::vector<Level> levels;
+
+			static void BuildLevel(const VoxelModel &, Level &);
 
 		protected:
 			~SWModel();
@@ -46,6 +55,8 @@ namespace spades {
 		public:
 			SWModel(VoxelModel& model);
 
+			int GetNumLevels() { return static_cast<int>(levels.size()); }
+
 			float GetRadius() { return radius; }
 			Vector3 GetCenter() { return center; }
 			VoxelModel& GetRawModel() { return *rawModel; }
@@ -18,18 +18,24 @@
 
  */
 
-#include "SWModelRenderer.h"
+#include <algorithm>
+#include <atomic>
+
 #include "SWModel.h"
+#include "SWModelRenderer.h"
 #include "SWRenderer.h"
 #include "SWUtils.h"
 #include <Core/Bitmap.h>
-#include <Core/Settings.h>
 #include <Core/Debug.h>
 #include <Core/Math.h>
+#include <Core/Settings.h>
+
+DEFINE_SPADES_SETTING(r_swModelLod, "1");
 
 namespace spades {
 	namespace draw {
-		SWModelRenderer::SWModelRenderer(SWRenderer* r, SWFeatureLevel level) : r(r), level(level) {}
+		SWModelRenderer::SWModelRenderer(SWRenderer* r, SWFeatureLevel level)
+		    : r(r), level(level), numBatches(0), numSplats(0), forcedLod(-1) {}
 		SWModelRenderer::~SWModelRenderer() {}
 
 		struct ZVals {
@@ -42,9 +48,44 @@ namespace spades {
 		};
 		static ZVals zvals;
 
-		template <SWFeatureLevel lvl>
-		void SWModelRenderer::RenderInner(spades::draw::SWModel& model,
-		                                  const client::ModelRenderParam& param) {
+#if ENABLE_AVX2
+		/** Depth-tested fill of a `w` x `h` rectangle, 8 pixels at a time. */
+		SPADES_TARGET_AVX2
+		static void SplatAVX2(uint32_t* fb, float* db, int fw, int w, int h, float zval,
+		                      uint32_t color) {
+			auto zv = _mm256_set1_ps(zval);
+			auto col = _mm256_set1_epi32(static_cast<int>(color));
+			auto tail = _mm256_cmpgt_epi32(_mm256_set1_epi32(w & 7),
+			                               _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			int w8 = w & ~7;
+
+			for (int y = 0; y < h; y++) {
+				int x = 0;
+				for (; x < w8; x += 8) {
+					auto d = _mm256_loadu_ps(db + x);
+					auto m = _mm256_cmp_ps(zv, d, _CMP_LT_OQ);
+					_mm256_storeu_ps(db + x, _mm256_blendv_ps(d, zv, m));
+
+					auto* fp = reinterpret_cast<__m256i*>(fb + x);
+					auto f = _mm256_loadu_si256(fp);
+					_mm256_storeu_si256(fp, _mm256_blendv_epi8(f, col, _mm256_castps_si256(m)));
+				}
+				if (x < w) {
+					// masked accesses so that we never touch pixels past the rectangle
+					auto d = _mm256_maskload_ps(db + x, tail);
+					auto m = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(zv, d, _CMP_LT_OQ)),
+					                          tail);
+					_mm256_maskstore_ps(db + x, m, zv);
+					_mm256_maskstore_epi32(reinterpret_cast<int*>(fb + x), m, col);
+				}
+				fb += fw;
+				db += fw;
+			}
+		}
+#endif
+
+		void SWModelRenderer::Render(spades::draw::SWModel& model,
+		                             const client::ModelRenderParam& param) {
 			auto& mat = param.matrix;
 			auto origin = mat.GetOrigin();
 			auto axis1 = mat.GetAxis(0);
@@ -56,12 +97,27 @@ namespace spades {
 			origin += axis2 * rawModelOrigin.y;
 			origin += axis3 * rawModelOrigin.z;
 
-			int w = rawModel.GetWidth();
-			int h = rawModel.GetHeight();
-			// int d = rawModel.GetDepth();
+			// compute center coord. for culling
+			auto center = origin;
+			{
+				auto localCenter = model.GetCenter();
+				center += axis1 * localCenter.x;
+				center += axis2 * localCenter.y;
+				center += axis3 * localCenter.z;
+
+				float largestAxis = axis1.GetSquaredLength();
+				largestAxis = std::max(largestAxis, axis2.GetSquaredLength());
+				largestAxis = std::max(largestAxis, axis3.GetSquaredLength());
+
+				if (!r->SphereFrustrumCull(center, model.GetRadius() * sqrtf(largestAxis)))
+					return;
+			}
+
+			Instance inst;
+			inst.model = &model;
+			uint8_t* brights = inst.brights;
 
 			// evaluate brightness for each normals
-			uint8_t brights[3 * 3 * 3 + 1];
 			{
 				auto lightVec = MakeVector3(0.f, -0.707f, -0.707f);
 				float dot1 = Vector3::Dot(axis1, lightVec) * fastRSqrt(axis1.GetSquaredLength());
@@ -126,40 +182,16 @@ namespace spades {
 			// "emissive" material
 			brights[27] = 255;
 
-			// compute center coord. for culling
-			{
-				auto center = origin;
-				auto localCenter = model.GetCenter();
-				center += axis1 * localCenter.x;
-				center += axis2 * localCenter.y;
-				center += axis3 * localCenter.z;
-
-				float largestAxis = axis1.GetSquaredLength();
-				largestAxis = std::max(largestAxis, axis2.GetSquaredLength());
-				largestAxis = std::max(largestAxis, axis3.GetSquaredLength());
-
-				if (!r->SphereFrustrumCull(center, model.GetRadius() * sqrtf(largestAxis)))
-					return;
-			}
-
 			Bitmap& fbmp = *r->fb;
-			auto* fb = fbmp.GetPixels();
 			int fw = fbmp.GetWidth();
 			int fh = fbmp.GetHeight();
-			auto* db = r->depthBuffer.data();
 
 			Matrix4 viewproj = r->GetProjectionViewMatrix();
 			Vector4 ndc2scrscale = {fw * 0.5f, -fh * 0.5f, 1.f, 1.f};
-			// Vector4 ndc2scroff = {fw * 0.5f, fh * 0.5f, 0.f, 0.f};
-			int ndc2scroffX = fw >> 1;
-			int ndc2scroffY = fh >> 1;
 
-			// render each points
-			auto tOrigin = viewproj * MakeVector4(origin.x, origin.y, origin.z, 1.f);
 			auto tAxis1 = viewproj * MakeVector4(axis1.x, axis1.y, axis1.z, 0.f);
 			auto tAxis2 = viewproj * MakeVector4(axis2.x, axis2.y, axis2.z, 0.f);
 			auto tAxis3 = viewproj * MakeVector4(axis3.x, axis3.y, axis3.z, 0.f);
-			tOrigin *= ndc2scrscale;
 			tAxis1 *= ndc2scrscale;
 			tAxis2 *= ndc2scrscale;
 			tAxis3 *= ndc2scrscale;
@@ -172,17 +204,73 @@ namespace spades {
 				pointDiameter = sqrtf(largestAxis);
 			}
 
-			uint32_t customColor;
-			customColor = (ToFixed8(param.customColor.z)
-						| (ToFixed8(param.customColor.y) << 8)
-						| (ToFixed8(param.customColor.x) << 16));
+			// choose the coarsest level whose voxels still project to at most
+			// a pixel at the model's center
+			int lod = 0;
+			if (forcedLod >= 0) {
+				lod = std::min(forcedLod, model.GetNumLevels() - 1);
+			} else if (r_swModelLod) {
+				float centerW = (viewproj * MakeVector4(center.x, center.y, center.z, 1.f)).w;
+				if (centerW > r->sceneDef.zNear)
+					lod = std::min(rawModel.GetLevelForVoxelSize(pointDiameter / centerW),
+					               model.GetNumLevels() - 1);
+			}
+
+			// a voxel of level `lod` covers `scale` voxels along each axis.
+			// place it at the center of them.
+			float scale = static_cast<float>(1 << lod);
+			origin += (axis1 + axis2 + axis3) * ((scale - 1.0F) * 0.5F);
+
+			inst.lod = lod;
+			inst.origin = viewproj * MakeVector4(origin.x, origin.y, origin.z, 1.f);
+			inst.origin *= ndc2scrscale;
+			inst.axis1 = tAxis1 * scale;
+			inst.axis2 = tAxis2 * scale;
+			inst.axis3 = tAxis3 * scale;
+			inst.pointDiameter = pointDiameter * scale;
+			inst.customColor = (ToFixed8(param.customColor.z)
+			                  | (ToFixed8(param.customColor.y) << 8)
+			                  | (ToFixed8(param.customColor.x) << 16));
+			instances.push_back(inst);
+
+			int width = model.levels[lod].width;
+			for (int x = 0; x < width; x += ColumnsPerBatch) {
+				if (numBatches == batches.size())
+					batches.emplace_back();
+				Batch& batch = batches[numBatches++];
+				batch.instance = instances.size() - 1;
+				batch.firstColumn = x;
+				batch.lastColumn = std::min(x + ColumnsPerBatch, width);
+				batch.splats.clear();
+			}
+		}
+
+		template <SWFeatureLevel lvl> void SWModelRenderer::Project(Batch& batch) {
+			const Instance& inst = instances[batch.instance];
+			const SWModel::Level& lod = inst.model->levels[inst.lod];
+			const uint8_t* brights = inst.brights;
+			int h = lod.height;
 
-			auto v1 = tOrigin;
-			float zNear = r->sceneDef.zNear;
-			for (int x = 0; x < w; x++) {
+			Bitmap& fbmp = *r->fb;
+			int fw = fbmp.GetWidth();
+			int fh = fbmp.GetHeight();
+			int ndc2scroffX = fw >> 1;
+			int ndc2scroffY = fh >> 1;
+
+			const auto tAxis1 = inst.axis1;
+			const auto tAxis2 = inst.axis2;
+			const auto tAxis3 = inst.axis3;
+			const float pointDiameter = inst.pointDiameter;
+			const uint32_t customColor = inst.customColor;
+			const float zNear = r->sceneDef.zNear;
+
+			int batchMinY = fh, batchMaxY = 0;
+
+			auto v1 = inst.origin + tAxis1 * static_cast<float>(batch.firstColumn);
+			for (int x = batch.firstColumn; x < batch.lastColumn; x++) {
 				auto v2 = v1;
 				for (int y = 0; y < h; y++) {
-					auto* mp = &model.renderData[model.renderDataAddr[x + y * w]];
+					auto* mp = &lod.renderData[lod.renderDataAddr[x + y * lod.width]];
 					while (*mp != 0xFFFFFFFFu) {
 						uint32_t data = *(mp++);
 						uint32_t normal = *(mp++);
@@ -222,10 +310,6 @@ namespace spades {
 						maxX = std::min(maxX, fw);
 						maxY = std::min(maxY, fh);
 
-						auto* fb2 = fb + (minX + minY * fw);
-						auto* db2 = db + (minX + minY * fw);
-						int w = maxX - minX;
-
 						uint32_t color = data & 0xFFFFFF;
 						if (color == 0)
 							color = customColor;
@@ -233,7 +317,7 @@ namespace spades {
 						SPAssert(normal < 28);
 						int bright = brights[normal];
 #if ENABLE_SSE2
-						if constexpr (lvl == SWFeatureLevel::SSE2) {
+						if constexpr (lvl >= SWFeatureLevel::SSE2) {
 							auto m = _mm_setr_epi32(color, 0, 0, 0);
 							auto f = _mm_set1_epi16(bright << 8);
 
@@ -252,37 +336,110 @@ namespace spades {
 							color = ((c1 & 0xFF0000) | (c2 & 0xFF00FF00)) >> 8;
 						}
 
-						for (int yy = minY; yy < maxY; yy++) {
-							auto* fb3 = fb2;
-							auto* db3 = db2;
-
-							for (int xx = w; xx > 0; xx--) {
-								if (zval < *db3) {
-									*db3 = zval;
-									*fb3 = color;
-								}
-								fb3++;
-								db3++;
-							}
-
-							fb2 += fw;
-							db2 += fw;
-						}
+						batch.splats.push_back(Splat{
+						  static_cast<int16_t>(minX), static_cast<int16_t>(minY),
+						  static_cast<int16_t>(maxX), static_cast<int16_t>(maxY), zval, color});
+						batchMinY = std::min(batchMinY, minY);
+						batchMaxY = std::max(batchMaxY, maxY);
 					}
 					v2 += tAxis2;
 				}
 				v1 += tAxis1;
 			}
+
+			batch.minY = batchMinY;
+			batch.maxY = batchMaxY;
 		}
 
-		void SWModelRenderer::Render(spades::draw::SWModel& model,
-		                             const client::ModelRenderParam& param) {
+		template <SWFeatureLevel lvl> void SWModelRenderer::DrawSplats(int minY, int maxY) {
+			Bitmap& fbmp = *r->fb;
+			auto* fb = fbmp.GetPixels();
+			int fw = fbmp.GetWidth();
+			auto* db = r->depthBuffer.data();
+
+			for (std::size_t i = 0; i < numBatches; i++) {
+				const Batch& batch = batches[i];
+				if (batch.maxY <= minY || batch.minY >= maxY)
+					continue;
+
+				for (const Splat& splat : batch.splats) {
+					int y1 = std::max<int>(splat.minY, minY);
+					int y2 = std::min<int>(splat.maxY, maxY);
+					if (y1 >= y2)
+						continue;
+
+					auto* fb2 = fb + (splat.minX + y1 * fw);
+					auto* db2 = db + (splat.minX + y1 * fw);
+					int w = splat.maxX - splat.minX;
+					float zval = splat.depth;
+					uint32_t color = splat.color;
+
+#if ENABLE_AVX2
+					if constexpr (lvl >= SWFeatureLevel::AVX2) {
+						if (w >= 4) {
+							SplatAVX2(fb2, db2, fw, w, y2 - y1, zval, color);
+							continue;
+						}
+					}
+#endif
+					for (int yy = y1; yy < y2; yy++) {
+						auto* fb3 = fb2;
+						auto* db3 = db2;
+
+						for (int xx = w; xx > 0; xx--) {
+							if (zval < *db3) {
+								*db3 = zval;
+								*fb3 = color;
+							}
+							fb3++;
+							db3++;
+						}
+
+						fb2 += fw;
+						db2 += fw;
+					}
+				}
+			}
+		}
+
+		template <SWFeatureLevel lvl> void SWModelRenderer::FlushInner() {
+			std::atomic<std::size_t> nextBatch{0};
+			InvokeParallel2([&](unsigned int, unsigned int) {
+				std::size_t i;
+				while ((i = nextBatch.fetch_add(1)) < numBatches)
+					Project<lvl>(batches[i]);
+			});
+
+			for (std::size_t i = 0; i < numBatches; i++)
+				numSplats += batches[i].splats.size();
+
+			int fh = r->fb->GetHeight();
+			int numBands = (fh + BandHeight - 1) / BandHeight;
+			std::atomic<int> nextBand{0};
+			InvokeParallel2([&](unsigned int, unsigned int) {
+				int band;
+				while ((band = nextBand.fetch_add(1)) < numBands)
+					DrawSplats<lvl>(band * BandHeight, std::min((band + 1) * BandHeight, fh));
+			});
+		}
+
+		void SWModelRenderer::Flush() {
+			if (numBatches > 0) {
+#if ENABLE_AVX2
+				if (static_cast<int>(level) >= static_cast<int>(SWFeatureLevel::AVX2)) {
+					FlushInner<SWFeatureLevel::AVX2>();
+				} else
+#endif
 #if ENABLE_SSE2
-			if (static_cast<int>(level) >= static_cast<int>(SWFeatureLevel::SSE2)) {
-				RenderInner<SWFeatureLevel::SSE2>(model, param);
-			} else
+				if (static_cast<int>(level) >= static_cast<int>(SWFeatureLevel::SSE2)) {
+					FlushInner<SWFeatureLevel::SSE2>();
+				} else
 #endif
-				RenderInner<SWFeatureLevel::None>(model, param);
+					FlushInner<SWFeatureLevel::None>();
+			}
+
+			instances.clear();
+			numBatches = 0;
 		}
 	} // namespace draw
-} // namespace spades
\ No newline at end of file
+} // namespace spades
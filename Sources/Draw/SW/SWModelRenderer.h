@@ -20,6 +20,10 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include "SWFeatureLevel.h"
 #include <Client/IRenderer.h>
 
@@ -27,19 +31,82 @@ namespace spades {
 	namespace draw {
 		class SWModel;
 		class SWRenderer;
+
+		/**
+		 * Splats voxel models into the framebuffer.
+		 *
+		 * Models are queued by `Render` and drawn by `Flush` in two parallel
+		 * passes: the voxel columns of the models are projected to screen
+		 * rectangles in batches, then the framebuffer is split into bands of
+		 * rows that are depth-tested and filled independently. Every band
+		 * visits the splats in submission order, so the output doesn't depend
+		 * on the number of threads.
+		 */
 		class SWModelRenderer {
 			friend class SWRenderer;
 			SWRenderer *r;
 			SWFeatureLevel level;
 
-			template <SWFeatureLevel>
-			void RenderInner(SWModel &model, const client::ModelRenderParam &param);
+			/** Number of voxel columns (along X) projected by one task. */
+			enum { ColumnsPerBatch = 8 };
+			/** Height of a band of the splat pass in pixels. */
+			enum { BandHeight = 16 };
+
+			/** A queued model with its transform already in screen space. */
+			struct Instance {
+				SWModel *model;
+				int lod;
+				/** Not divided by W yet. */
+				Vector4 origin, axis1, axis2, axis3;
+				float pointDiameter;
+				uint32_t customColor;
+				uint8_t brights[3 * 3 * 3 + 1];
+			};
+
+			/** A voxel projected to a screen rectangle. */
+			struct Splat {
+				int16_t minX, minY, maxX, maxY;
+				float depth;
+				uint32_t color;
+			};
+
+			/** The splats of a range of voxel columns of an instance. */
+			struct Batch {
+				std::size_t instance;
+				int firstColumn, lastColumn;
+				/** Screen rows covered by `splats`. */
+				int minY, maxY;
+				std::vector<Splat> splats;
+			};
+
+			std::vector<Instance> instances;
+			/** The first `numBatches` elements are used. The rest are kept
+			 * to reuse the memory of `Batch::splats`. */
+			std::vector<Batch> batches;
+			std::size_t numBatches;
+			std::size_t numSplats;
+
+			/** The level of detail of all models if not negative. Used by
+			 * `SWRenderer` to measure the error of each level. */
+			int forcedLod;
+
+			template <SWFeatureLevel> void Project(Batch &);
+			template <SWFeatureLevel> void DrawSplats(int minY, int maxY);
+			template <SWFeatureLevel> void FlushInner();
 
 		public:
 			SWModelRenderer(SWRenderer *, SWFeatureLevel level);
 			~SWModelRenderer();
 
+			/** Queues a model. `model` must stay alive until `Flush` is called. */
 			void Render(SWModel &model, const client::ModelRenderParam &param);
+
+			/** Draws all queued models. */
+			void Flush();
+
+			/** @return the number of splats drawn since the last reset. */
+			std::size_t GetNumSplats() { return numSplats; }
+			void ResetStatistics() { numSplats = 0; }
 		};
 	} // namespace draw
 } // namespace spades
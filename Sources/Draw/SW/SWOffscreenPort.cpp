@@ -0,0 +1,37 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "SWOffscreenPort.h"
+
+namespace spades {
+	namespace draw {
+		SWOffscreenPort::SWOffscreenPort(int width, int height, int numBuffers,
+		                                 PresentCallback callback)
+		    : SWBufferedPort(width, height, numBuffers), callback(std::move(callback)) {}
+
+		SWOffscreenPort::~SWOffscreenPort() { StopPresenting(); }
+
+		void SWOffscreenPort::Present(Bitmap& frame) {
+			if (callback)
+				callback(frame);
+		}
+	} // namespace draw
+} // namespace spades
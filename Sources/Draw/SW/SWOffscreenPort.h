@@ -0,0 +1,54 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <functional>
+
+#include "SWBufferedPort.h"
+
+namespace spades {
+	namespace draw {
+		/**
+		 * `SWPort` that doesn't display anything, for headless runs and
+		 * offscreen rendering. Presented frames can be captured with a
+		 * callback.
+		 */
+		class SWOffscreenPort : public SWBufferedPort {
+		public:
+			/** Called with each presented frame. With several buffers, this
+			 * runs on the presentation thread. */
+			using PresentCallback = std::function<void(const Bitmap &)>;
+
+		private:
+			PresentCallback callback;
+
+		protected:
+			~SWOffscreenPort();
+
+			void Present(Bitmap &) override;
+
+		public:
+			SWOffscreenPort(int width, int height, int numBuffers = 1,
+			                PresentCallback callback = PresentCallback());
+		};
+	} // namespace draw
+} // namespace spades
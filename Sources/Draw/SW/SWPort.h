@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 #include <Core/Bitmap.h>
 #include <Core/RefCountedObject.h>
 
@@ -30,16 +32,36 @@ namespace spades {
 			~SWPort() {}
 
 		public:
+			/** Timing of the frames presented by a port, in seconds. */
+			struct PacingStatistics {
+				std::size_t numFrames = 0;
+				/** Interval between consecutive presented frames. */
+				double meanInterval = 0.0;
+				double intervalDeviation = 0.0;
+				double maxInterval = 0.0;
+				/** Time `Swap` spent waiting for a buffer to render into. */
+				double swapWaitTime = 0.0;
+			};
+
 			/**
-			 * Returns a `Bitmap` on which the scene is rendered.
+			 * Returns a `Bitmap` on which the scene is rendered. A port with
+			 * several buffers may return a different bitmap (of the same
+			 * size) after each `Swap`, so its contents are undefined at the
+			 * start of a frame.
 			 */
 			virtual Bitmap &GetFramebuffer() = 0;
 
 			/**
 			 * Presents the contents of the framebuffer (returned by
-			 * `GetFramebuffer`) to the screen.
+			 * `GetFramebuffer`) to the screen. The framebuffer must not be
+			 * touched until `GetFramebuffer` returns it again.
 			 */
 			virtual void Swap() = 0;
+
+			/** @return the frame pacing since the last reset. Ports that don't
+			 * measure it report no frames. */
+			virtual PacingStatistics GetPacingStatistics() { return {}; }
+			virtual void ResetPacingStatistics() {}
 		};
 	} // namespace draw
 } // namespace spades
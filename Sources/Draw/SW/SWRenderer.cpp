@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cfenv>
 #include <cstdlib>
 
@@ -34,11 +35,14 @@
 #include <Client/GameMap.h>
 #include <Core/Bitmap.h>
 #include <Core/Settings.h>
+#include <Core/VoxelModel.h>
 
 #include "SWUtils.h"
 
 DEFINE_SPADES_SETTING(r_swStatistics, "0");
 DEFINE_SPADES_SETTING(r_swNumThreads, "4");
+DEFINE_SPADES_SETTING(r_swModelLodDiff, "0");
+DEFINE_SPADES_SETTING(r_swBenchmarkPasses, "0");
 
 SPADES_SETTING(r_dlights);
 
@@ -230,114 +234,253 @@ namespace spades {
 			  sceneDef.viewOrigin, sceneDef.viewAxis[2] * ySin + sceneDef.viewAxis[1] * yCos);
 		}
 
-		template <SWFeatureLevel> void SWRenderer::ApplyDynamicLight(const DynamicLight& light) {
-			int fw = this->fb->GetWidth();
-			int fh = this->fb->GetHeight();
+		namespace {
+			/** Size of the screen tiles the dynamic lights are binned to. */
+			enum { LightTileSize = 32 };
+
+			/** A dynamic light prepared for `ApplyDynamicLightSpan`. */
+			struct LightSpanParam {
+				int minX, maxX, minY, maxY;
+				/** The light's origin in view space. */
+				Vector3 center;
+				/** Slightly enlarged radius used to reject the light by depth. */
+				float cullRadius;
+				float invRadius2;
+				int r, g, b;
+			};
+		} // namespace
 
-			float fovX = tanf(sceneDef.fovX * 0.5F);
-			float fovY = tanf(sceneDef.fovY * 0.5F);
+		/**
+		 * Adds `light` to the pixels `[x1, x2)` of a row. `fb` and `db` point
+		 * to the start of the row and `vy` is the Y slope of the row's view rays.
+		 */
+		template <SWFeatureLevel>
+		static void ApplyDynamicLightSpan(uint32_t* fb, const float* db, int x1, int x2,
+		                                  float fovX, float dvx, float vy,
+		                                  const LightSpanParam& light) {
+			for (int x = x1; x < x2; x++) {
+				Vector3 pos;
 
-			float dvx = -fovX * 2.0F / static_cast<float>(fw);
-			float dvy = -fovY * 2.0F / static_cast<float>(fh);
+				pos.z = db[x];
+				pos.x = (fovX + dvx * static_cast<float>(x)) * pos.z;
+				pos.y = vy * pos.z;
 
-			int minX = light.minX;
-			int minY = light.minY;
-			int maxX = light.maxX;
-			int maxY = light.maxY;
-			int lightHeight = maxY - minY;
+				pos -= light.center;
 
-			SPAssert(minX >= 0);
-			SPAssert(minY >= 0);
-			SPAssert(maxX <= fw);
-			SPAssert(maxY <= fh);
+				float dist = pos.GetSquaredLength();
+				dist *= light.invRadius2;
 
-			Vector3 lightCenter;
-			Vector3 diff = light.param.origin - sceneDef.viewOrigin;
-			lightCenter.x = Vector3::Dot(diff, sceneDef.viewAxis[0]);
-			lightCenter.y = Vector3::Dot(diff, sceneDef.viewAxis[1]);
-			lightCenter.z = Vector3::Dot(diff, sceneDef.viewAxis[2]);
+				if (dist >= 1.0F)
+					continue;
 
-			int lightR = ToFixedFactor8(light.param.color.x);
-			int lightG = ToFixedFactor8(light.param.color.y);
-			int lightB = ToFixedFactor8(light.param.color.z);
+				float strength = 1.0F - dist;
+				strength *= strength;
+				strength *= 256.0F;
 
-			float invRadius2 = 1.0F / (light.param.radius * light.param.radius);
+				int factor = static_cast<int>(strength);
 
-			InvokeParallel2([=](unsigned int threadId, unsigned int numThreads) {
-				int startY = lightHeight * threadId / numThreads;
-				int endY = lightHeight * (threadId + 1) / numThreads;
-				startY += minY;
-				endY += minY;
+				int actualLightR = light.r * factor;
+				int actualLightG = light.g * factor;
+				int actualLightB = light.b * factor;
 
-				auto* fb = this->fb->GetPixels();
-				float* db = depthBuffer.data();
-				fb += startY * fw + minX;
-				db += startY * fw + minX;
+				auto srcColor = fb[x];
+				auto srcColorR = (srcColor >> 16) & 0xFF;
+				auto srcColorG = (srcColor >> 8) & 0xFF;
+				auto srcColorB = srcColor & 0xFF;
 
-				float vy = fovY + dvy * startY;
-				float vx = fovX + dvx * minX;
+				actualLightR *= srcColorR;
+				actualLightG *= srcColorG;
+				actualLightB *= srcColorB;
 
-				int lightWidth = maxX - minX;
+				auto destColorR = actualLightR >> 16;
+				auto destColorG = actualLightG >> 16;
+				auto destColorB = actualLightB >> 16;
 
-				for (int y = startY; y < endY; y++) {
-					float vx2 = vx;
-					auto* fb2 = fb;
-					auto* db2 = db;
+				destColorR = std::min<uint32_t>(destColorR + srcColorR, 255);
+				destColorG = std::min<uint32_t>(destColorG + srcColorG, 255);
+				destColorB = std::min<uint32_t>(destColorB + srcColorB, 255);
 
-					for (int x = lightWidth; x > 0; x--) {
-						Vector3 pos;
+				fb[x] = destColorB | (destColorG << 8) | (destColorR << 16);
+			}
+		}
 
-						pos.z = *db2;
-						pos.x = vx2 * pos.z;
-						pos.y = vy * pos.z;
+#if ENABLE_SSE2
+		template <>
+		void ApplyDynamicLightSpan<SWFeatureLevel::SSE2>(uint32_t* fb, const float* db, int x1,
+		                                                 int x2, float fovX, float dvx, float vy,
+		                                                 const LightSpanParam& light) {
+			auto lanes = _mm_setr_ps(0.0F, 1.0F, 2.0F, 3.0F);
+			auto fovX4 = _mm_set1_ps(fovX);
+			auto dvx4 = _mm_set1_ps(dvx);
+			auto vy4 = _mm_set1_ps(vy);
+			auto centerX = _mm_set1_ps(light.center.x);
+			auto centerY = _mm_set1_ps(light.center.y);
+			auto centerZ = _mm_set1_ps(light.center.z);
+			auto invRadius2 = _mm_set1_ps(light.invRadius2);
+			auto one = _mm_set1_ps(1.0F);
+			auto lightR = _mm_set1_ps(static_cast<float>(light.r));
+			auto lightG = _mm_set1_ps(static_cast<float>(light.g));
+			auto lightB = _mm_set1_ps(static_cast<float>(light.b));
+			auto channelMask = _mm_set1_epi32(0xFF);
+			auto channelMax = _mm_set1_epi32(0xFF);
+
+			// (light * factor * src) >> 16 is computed in float. every product
+			// is an integer below 2^24, so this is exact.
+			auto addLight = [](__m128 lightFactor, __m128i src) {
+				auto v = _mm_mul_ps(lightFactor, _mm_cvtepi32_ps(src));
+				return _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(1.0F / 65536.0F)));
+			};
 
-						pos -= lightCenter;
+			int x = x1;
+			for (; x + 4 <= x2; x += 4) {
+				auto z = _mm_loadu_ps(db + x);
+				auto vx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+				vx = _mm_add_ps(fovX4, _mm_mul_ps(dvx4, vx));
+
+				auto posX = _mm_sub_ps(_mm_mul_ps(vx, z), centerX);
+				auto posY = _mm_sub_ps(_mm_mul_ps(vy4, z), centerY);
+				auto posZ = _mm_sub_ps(z, centerZ);
+
+				auto dist = _mm_add_ps(_mm_mul_ps(posX, posX), _mm_mul_ps(posY, posY));
+				dist = _mm_add_ps(dist, _mm_mul_ps(posZ, posZ));
+				dist = _mm_mul_ps(dist, invRadius2);
+
+				auto lit = _mm_cmplt_ps(dist, one);
+				if (_mm_movemask_ps(lit) == 0)
+					continue;
+
+				auto strength = _mm_sub_ps(one, dist);
+				strength = _mm_mul_ps(strength, strength);
+				strength = _mm_mul_ps(strength, _mm_set1_ps(256.0F));
+				auto factor = _mm_cvtepi32_ps(_mm_cvttps_epi32(strength));
+
+				auto* out = reinterpret_cast<__m128i*>(fb + x);
+				auto src = _mm_loadu_si128(out);
+				auto srcR = _mm_and_si128(_mm_srli_epi32(src, 16), channelMask);
+				auto srcG = _mm_and_si128(_mm_srli_epi32(src, 8), channelMask);
+				auto srcB = _mm_and_si128(src, channelMask);
+
+				// the sums are below 2^15, so the 16-bit min works on 32-bit lanes
+				auto destR = _mm_add_epi32(srcR, addLight(_mm_mul_ps(lightR, factor), srcR));
+				auto destG = _mm_add_epi32(srcG, addLight(_mm_mul_ps(lightG, factor), srcG));
+				auto destB = _mm_add_epi32(srcB, addLight(_mm_mul_ps(lightB, factor), srcB));
+				destR = _mm_min_epi16(destR, channelMax);
+				destG = _mm_min_epi16(destG, channelMax);
+				destB = _mm_min_epi16(destB, channelMax);
+
+				auto dest = _mm_or_si128(_mm_slli_epi32(destR, 16), _mm_slli_epi32(destG, 8));
+				dest = _mm_or_si128(dest, destB);
+
+				auto litMask = _mm_castps_si128(lit);
+				dest = _mm_or_si128(_mm_and_si128(litMask, dest), _mm_andnot_si128(litMask, src));
+				_mm_storeu_si128(out, dest);
+			}
 
-						float dist = pos.GetSquaredLength();
-						dist *= invRadius2;
+			ApplyDynamicLightSpan<SWFeatureLevel::None>(fb, db, x, x2, fovX, dvx, vy, light);
+		}
+#endif
 
-						if (dist < 1.0F) {
-							float strength = 1.0F - dist;
-							strength *= strength;
-							strength *= 256.0F;
+		template <SWFeatureLevel level> void SWRenderer::ApplyDynamicLights() {
+			if (lights.empty())
+				return;
 
-							int factor = static_cast<int>(strength);
+			const int fw = this->fb->GetWidth();
+			const int fh = this->fb->GetHeight();
 
-							int actualLightR = lightR * factor;
-							int actualLightG = lightG * factor;
-							int actualLightB = lightB * factor;
+			const float fovX = tanf(sceneDef.fovX * 0.5F);
+			const float fovY = tanf(sceneDef.fovY * 0.5F);
 
-							auto srcColor = *fb2;
-							auto srcColorR = (srcColor >> 16) & 0xFF;
-							auto srcColorG = (srcColor >> 8) & 0xFF;
-							auto srcColorB = srcColor & 0xFF;
+			const float dvx = -fovX * 2.0F / static_cast<float>(fw);
+			const float dvy = -fovY * 2.0F / static_cast<float>(fh);
 
-							actualLightR *= srcColorR;
-							actualLightG *= srcColorG;
-							actualLightB *= srcColorB;
+			std::vector<LightSpanParam> params;
+			params.reserve(lights.size());
+			for (const auto& light : lights) {
+				SPAssert(light.minX >= 0);
+				SPAssert(light.minY >= 0);
+				SPAssert(light.maxX <= fw);
+				SPAssert(light.maxY <= fh);
 
-							auto destColorR = actualLightR >> 16;
-							auto destColorG = actualLightG >> 16;
-							auto destColorB = actualLightB >> 16;
+				if (light.minX >= light.maxX || light.minY >= light.maxY)
+					continue;
 
-							destColorR = std::min<uint32_t>(destColorR + srcColorR, 255);
-							destColorG = std::min<uint32_t>(destColorG + srcColorG, 255);
-							destColorB = std::min<uint32_t>(destColorB + srcColorB, 255);
+				LightSpanParam p;
+				p.minX = light.minX;
+				p.maxX = light.maxX;
+				p.minY = light.minY;
+				p.maxY = light.maxY;
 
-							uint32_t destColor =
-							  destColorB | (destColorG << 8) | (destColorR << 16);
+				Vector3 diff = light.param.origin - sceneDef.viewOrigin;
+				p.center.x = Vector3::Dot(diff, sceneDef.viewAxis[0]);
+				p.center.y = Vector3::Dot(diff, sceneDef.viewAxis[1]);
+				p.center.z = Vector3::Dot(diff, sceneDef.viewAxis[2]);
 
-							*fb2 = destColor;
-						}
+				p.cullRadius = light.param.radius * 1.01F;
+				p.invRadius2 = 1.0F / (light.param.radius * light.param.radius);
 
-						vx2 += dvx;
-						fb2++;
-						db2++;
+				p.r = ToFixedFactor8(light.param.color.x);
+				p.g = ToFixedFactor8(light.param.color.y);
+				p.b = ToFixedFactor8(light.param.color.z);
+				params.push_back(p);
+			}
+
+			const int tilesX = (fw + LightTileSize - 1) / LightTileSize;
+			const int tilesY = (fh + LightTileSize - 1) / LightTileSize;
+			const int numTiles = tilesX * tilesY;
+			std::atomic<int> nextTile{0};
+
+			InvokeParallel2([&](unsigned int, unsigned int) {
+				uint32_t* const pixels = this->fb->GetPixels();
+				const float* const depths = depthBuffer.data();
+				std::vector<const LightSpanParam*> tileLights;
+
+				int t;
+				while ((t = nextTile.fetch_add(1)) < numTiles) {
+					const int tx1 = (t % tilesX) * LightTileSize;
+					const int ty1 = (t / tilesX) * LightTileSize;
+					const int tx2 = std::min(tx1 + LightTileSize, fw);
+					const int ty2 = std::min(ty1 + LightTileSize, fh);
+
+					tileLights.clear();
+					for (const auto& p : params) {
+						if (p.maxX > tx1 && p.minX < tx2 && p.maxY > ty1 && p.minY < ty2)
+							tileLights.push_back(&p);
 					}
+					if (tileLights.empty())
+						continue;
 
-					vy += dvy;
-					fb += fw;
-					db += fw;
+					// reject the lights that are entirely in front of or
+					// behind everything in this tile
+					float minZ = depths[tx1 + ty1 * fw];
+					float maxZ = minZ;
+					for (int y = ty1; y < ty2; y++) {
+						const float* row = depths + y * fw;
+						for (int x = tx1; x < tx2; x++) {
+							minZ = std::min(minZ, row[x]);
+							maxZ = std::max(maxZ, row[x]);
+						}
+					}
+					tileLights.erase(std::remove_if(tileLights.begin(), tileLights.end(),
+					                                [=](const LightSpanParam* p) {
+						                                return p->center.z + p->cullRadius < minZ ||
+						                                       p->center.z - p->cullRadius > maxZ;
+					                                }),
+					                 tileLights.end());
+
+					// lights are applied in order so the result doesn't
+					// depend on the tiling
+					for (int y = ty1; y < ty2; y++) {
+						const float vy = fovY + dvy * static_cast<float>(y);
+						uint32_t* fbRow = pixels + y * fw;
+						const float* dbRow = depths + y * fw;
+						for (const auto* p : tileLights) {
+							if (y < p->minY || y >= p->maxY)
+								continue;
+							ApplyDynamicLightSpan<level>(fbRow, dbRow, std::max(tx1, p->minX),
+							                             std::min(tx2, p->maxX), fovX, dvx, vy,
+							                             *p);
+						}
+					}
 				}
 			});
 		}
@@ -519,6 +662,262 @@ namespace spades {
 
 #endif
 
+#if ENABLE_AVX2
+
+		/** Rows `[startY, endY)` of `ApplyFog<SWFeatureLevel::AVX2>`. Two 4x4
+		 * blocks are processed at once so each row of the pair is 8 pixels. */
+		SPADES_TARGET_AVX2
+		static void ApplyFogRowsAVX2(uint32_t* fb, const float* db, int fw, int startY,
+		                             int endY, float fovX, float vy, float dvx, float dvy,
+		                             float scale, int fogR, int fogG, int fogB) {
+			auto fog = _mm256_setr_epi16(fogB, fogG, fogR, 0, fogB, fogG, fogR, 0, fogB, fogG,
+			                             fogR, 0, fogB, fogG, fogR, 0);
+
+			for (int y = startY; y < endY; y += 4) {
+				float vx = fovX;
+
+				for (int x = 0; x < fw; x += 8) {
+					float depthScale1 = (1.0F + vx * vx + vy * vy);
+					depthScale1 *= fastRSqrt(depthScale1) * scale;
+					vx += dvx;
+					float depthScale2 = (1.0F + vx * vx + vy * vy);
+					depthScale2 *= fastRSqrt(depthScale2) * scale;
+					vx += dvx;
+					auto depthScale8 = _mm256_insertf128_ps(_mm256_set1_ps(depthScale1),
+					                                        _mm_set1_ps(depthScale2), 1);
+
+					auto* fb2 = fb + x;
+					auto* db2 = db + x;
+					for (int by = 0; by < 4; by++) {
+						auto dist = _mm256_loadu_ps(db2);
+						auto color = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(fb2));
+
+						dist = _mm256_mul_ps(dist, depthScale8);
+						dist = _mm256_max_ps(dist, _mm256_set1_ps(0.0F));
+						dist = _mm256_min_ps(dist, _mm256_set1_ps(256.0F));
+						auto factorX = _mm256_cvtps_epi32(dist);
+						auto factorY = _mm256_sub_epi32(_mm256_set1_epi32(0x100), factorX);
+
+						factorX = _mm256_shufflelo_epi16(factorX, 0xa0);
+						factorX = _mm256_shufflehi_epi16(factorX, 0xa0);
+						factorY = _mm256_shufflelo_epi16(factorY, 0xa0);
+						factorY = _mm256_shufflehi_epi16(factorY, 0xa0);
+
+						// pixels 0, 1, 4, 5 (unpack works within 128-bit lanes)
+						auto color1 = _mm256_unpacklo_epi8(color, _mm256_setzero_si256());
+						auto factor1X = _mm256_shuffle_epi32(factorY, 0x50);
+						auto factor1Y = _mm256_shuffle_epi32(factorX, 0x50);
+						color1 = _mm256_mullo_epi16(color1, factor1X);
+						auto fog1 = _mm256_mullo_epi16(fog, factor1Y);
+						fog1 = _mm256_adds_epu16(fog1, color1);
+						fog1 = _mm256_srli_epi16(fog1, 8);
+
+						// pixels 2, 3, 6, 7
+						auto color2 = _mm256_unpackhi_epi8(color, _mm256_setzero_si256());
+						auto factor2X = _mm256_shuffle_epi32(factorY, 0xfa);
+						auto factor2Y = _mm256_shuffle_epi32(factorX, 0xfa);
+						color2 = _mm256_mullo_epi16(color2, factor2X);
+						auto fog2 = _mm256_mullo_epi16(fog, factor2Y);
+						fog2 = _mm256_adds_epu16(fog2, color2);
+						fog2 = _mm256_srli_epi16(fog2, 8);
+
+						auto pack = _mm256_packus_epi16(fog1, fog2);
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(fb2), pack);
+
+						fb2 += fw;
+						db2 += fw;
+					}
+				}
+
+				vy += dvy;
+				fb += fw * 4;
+				db += fw * 4;
+			}
+		}
+
+		template <> void SWRenderer::ApplyFog<SWFeatureLevel::AVX2>() {
+			int fw = this->fb->GetWidth();
+			int fh = this->fb->GetHeight();
+
+			float fovX = tanf(sceneDef.fovX * 0.5F);
+			float fovY = tanf(sceneDef.fovY * 0.5F);
+
+			float dvx = -fovX * 2.0F / static_cast<float>(fw / 4);
+			float dvy = -fovY * 2.0F / static_cast<float>(fh / 4);
+
+			int fogR = ToFixed8(fogColor.x);
+			int fogG = ToFixed8(fogColor.y);
+			int fogB = ToFixed8(fogColor.z);
+
+			float scale = 255.0F / fogDistance;
+
+			InvokeParallel2([&](unsigned int threadId, unsigned int numThreads) {
+				int startY = fh * threadId / numThreads;
+				int endY = fh * (threadId + 1) / numThreads;
+				startY &= ~3;
+				endY &= ~3;
+
+				float vy = fovY + dvy * (startY >> 2);
+				ApplyFogRowsAVX2(this->fb->GetPixels() + fw * startY,
+				                 depthBuffer.data() + fw * startY, fw, startY, endY, fovX, vy,
+				                 dvx, dvy, scale, fogR, fogG, fogB);
+			});
+
+		} // ApplyFog()
+
+#endif
+
+		static uint32_t ConvertColor32(Vector4 col) {
+			auto convertColor = [](float f) {
+				int i = static_cast<int>(f * 255.0F + 0.5F);
+				return static_cast<uint32_t>(Clamp(i, 0, 255));
+			};
+			uint32_t c;
+			c = convertColor(col.x);
+			c |= convertColor(col.y) << 8;
+			c |= convertColor(col.z) << 16;
+			c |= convertColor(col.w) << 24;
+			return c;
+		}
+
+		/** Fills `count` pixels with `color` and `depth`. */
+		template <SWFeatureLevel>
+		static void ClearSpan(uint32_t* fb, float* db, std::size_t count, uint32_t color,
+		                      float depth) {
+			std::fill(fb, fb + count, color);
+			std::fill(db, db + count, depth);
+		}
+
+		/** Converts `count` framebuffer pixels to the RGBA order of `Bitmap`
+		 * (swaps red and blue and makes them opaque). */
+		template <SWFeatureLevel>
+		static void ConvertSpan(const uint32_t* src, uint32_t* dest, std::size_t count) {
+			for (std::size_t i = 0; i < count; i++) {
+				uint32_t c = src[i];
+				dest[i] = 0xFF000000 | (c & 0xFF00) | ((c & 0xFF) << 16) | ((c & 0xFF0000) >> 16);
+			}
+		}
+
+#if ENABLE_SSE2
+		template <>
+		void ClearSpan<SWFeatureLevel::SSE2>(uint32_t* fb, float* db, std::size_t count,
+		                                     uint32_t color, float depth) {
+			auto color4 = _mm_set1_epi32(static_cast<int>(color));
+			auto depth4 = _mm_set1_ps(depth);
+			std::size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(fb + i), color4);
+				_mm_storeu_ps(db + i, depth4);
+			}
+			ClearSpan<SWFeatureLevel::None>(fb + i, db + i, count - i, color, depth);
+		}
+
+		template <>
+		void ConvertSpan<SWFeatureLevel::SSE2>(const uint32_t* src, uint32_t* dest,
+		                                       std::size_t count) {
+			auto alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+			auto green = _mm_set1_epi32(0xFF00);
+			auto redBlue = _mm_set1_epi32(0xFF00FF);
+			std::size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				// rotating each pixel by 16 bits swaps red and blue
+				auto rb = _mm_and_si128(_mm_or_si128(_mm_slli_epi32(c, 16), _mm_srli_epi32(c, 16)),
+				                        redBlue);
+				c = _mm_or_si128(_mm_or_si128(_mm_and_si128(c, green), rb), alpha);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), c);
+			}
+			ConvertSpan<SWFeatureLevel::None>(src + i, dest + i, count - i);
+		}
+#endif
+
+#if ENABLE_AVX2
+		SPADES_TARGET_AVX2
+		static void ClearSpanAVX2(uint32_t* fb, float* db, std::size_t count, uint32_t color,
+		                          float depth) {
+			auto color8 = _mm256_set1_epi32(static_cast<int>(color));
+			auto depth8 = _mm256_set1_ps(depth);
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(fb + i), color8);
+				_mm256_storeu_ps(db + i, depth8);
+			}
+			ClearSpan<SWFeatureLevel::None>(fb + i, db + i, count - i, color, depth);
+		}
+
+		SPADES_TARGET_AVX2
+		static void ConvertSpanAVX2(const uint32_t* src, uint32_t* dest, std::size_t count) {
+			auto swizzle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			                                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+			auto alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+				c = _mm256_or_si256(_mm256_shuffle_epi8(c, swizzle), alpha);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), c);
+			}
+			ConvertSpan<SWFeatureLevel::None>(src + i, dest + i, count - i);
+		}
+
+		template <>
+		void ClearSpan<SWFeatureLevel::AVX2>(uint32_t* fb, float* db, std::size_t count,
+		                                     uint32_t color, float depth) {
+			ClearSpanAVX2(fb, db, count, color, depth);
+		}
+
+		template <>
+		void ConvertSpan<SWFeatureLevel::AVX2>(const uint32_t* src, uint32_t* dest,
+		                                       std::size_t count) {
+			ConvertSpanAVX2(src, dest, count);
+		}
+#endif
+
+		/** Rows handed out at once by the full-screen passes. */
+		enum { FullScreenStripHeight = 16 };
+
+		template <SWFeatureLevel level> void SWRenderer::ClearFrame() {
+			int fw = this->fb->GetWidth();
+			int fh = this->fb->GetHeight();
+			uint32_t* pixels = this->fb->GetPixels();
+			float* depths = depthBuffer.data();
+
+			// the depth of the sky, which the fog pass turns into the fog color
+			uint32_t color = ConvertColor32(MakeVector4(fogColor.x, fogColor.y, fogColor.z, 1.0F));
+			float depth = 10000.0F;
+
+			std::atomic<int> nextY{0};
+			InvokeParallel2([&](unsigned int, unsigned int) {
+				int y;
+				while ((y = nextY.fetch_add(FullScreenStripHeight)) < fh) {
+					int rows = std::min(static_cast<int>(FullScreenStripHeight), fh - y);
+					std::size_t offset = static_cast<std::size_t>(y) * fw;
+					ClearSpan<level>(pixels + offset, depths + offset,
+					                 static_cast<std::size_t>(rows) * fw, color, depth);
+				}
+			});
+		}
+
+		template <SWFeatureLevel level> void SWRenderer::ConvertFramebuffer(Bitmap& out) {
+			int fw = this->fb->GetWidth();
+			int fh = this->fb->GetHeight();
+			SPAssert(out.GetWidth() == fw);
+			SPAssert(out.GetHeight() == fh);
+			const uint32_t* inPix = this->fb->GetPixels();
+			uint32_t* outPix = out.GetPixels();
+
+			// `Bitmap` is bottom-up
+			std::atomic<int> nextY{0};
+			InvokeParallel2([&](unsigned int, unsigned int) {
+				int y;
+				while ((y = nextY.fetch_add(FullScreenStripHeight)) < fh) {
+					int endY = std::min(y + static_cast<int>(FullScreenStripHeight), fh);
+					for (; y < endY; y++)
+						ConvertSpan<level>(inPix + y * fw, outPix + (fh - 1 - y) * fw,
+						                   static_cast<std::size_t>(fw));
+				}
+			});
+		}
+
 		void SWRenderer::EnsureSceneStarted() {
 			SPADES_MARK_FUNCTION_DEBUG();
 			if (!duringSceneRendering)
@@ -681,6 +1080,30 @@ namespace spades {
 			spr.color = drawColorAlphaPremultiplied;
 		}
 
+		void SWRenderer::AddSprites(client::IImage& image, const client::SpriteParam* params,
+		                            std::size_t count) {
+			SPADES_MARK_FUNCTION();
+			EnsureInitialized();
+			EnsureSceneStarted();
+
+			Handle<SWImage> swImage = dynamic_cast<SWImage&>(image);
+
+			for (std::size_t i = 0; i < count; i++) {
+				const client::SpriteParam& param = params[i];
+				if (!SphereFrustrumCull(param.center, param.radius * 1.5f))
+					continue;
+
+				sprites.push_back(Sprite());
+				auto& spr = sprites.back();
+
+				spr.img = swImage;
+				spr.center = param.center;
+				spr.radius = param.radius;
+				spr.rotation = param.rotation;
+				spr.color = param.color;
+			}
+		}
+
 		void SWRenderer::AddLongSprite(client::IImage&, spades::Vector3 p1, spades::Vector3 p2,
 		                               float radius) {
 			SPADES_MARK_FUNCTION();
@@ -689,53 +1112,79 @@ namespace spades {
 			// TODO: long sprite
 		}
 
-		static uint32_t ConvertColor32(Vector4 col) {
-			auto convertColor = [](float f) {
-				int i = static_cast<int>(f * 255.0F + 0.5F);
-				return static_cast<uint32_t>(Clamp(i, 0, 255));
-			};
-			uint32_t c;
-			c = convertColor(col.x);
-			c |= convertColor(col.y) << 8;
-			c |= convertColor(col.z) << 16;
-			c |= convertColor(col.w) << 24;
-			return c;
-		}
-
 		void SWRenderer::EndScene() {
 			EnsureInitialized();
 			EnsureSceneStarted();
 
-			// clear scene
-			auto* px = this->fb->GetPixels();
-			std::fill(px, px + fb->GetWidth() * fb->GetHeight(),
-				ConvertColor32(MakeVector4(fogColor.x, fogColor.y, fogColor.z, 1.0F)));
+			imageRenderer->Flush();
+
+			Stopwatch passStopwatch;
+
+			// draw map
+			bool mapDrawn = false;
+			if (!sceneDef.skipWorld && mapRenderer) {
+				// flat map renderer sends 'Update RLE' to map renderer.
+				// rendering map before this leads to the corrupted renderer image.
+				flatMapRenderer->Update();
+				mapDrawn = mapRenderer->Render(sceneDef, *fb, depthBuffer.data());
+			}
+			passTimes.map += passStopwatch.GetTime();
+			passStopwatch.Reset();
+
+			// clear scene. the map pass writes every pixel, so this is only
+			// needed when it didn't run.
+			if (!mapDrawn) {
+#if ENABLE_AVX2
+				if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::AVX2))
+					ClearFrame<SWFeatureLevel::AVX2>();
+				else
+#endif
+#if ENABLE_SSE2
+				if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::SSE2))
+					ClearFrame<SWFeatureLevel::SSE2>();
+				else
+#endif
+					ClearFrame<SWFeatureLevel::None>();
+			}
+			passTimes.clear += passStopwatch.GetTime();
+			passStopwatch.Reset();
 
 			if (!sceneDef.skipWorld) {
-				// draw map
-				if (mapRenderer) {
-					// flat map renderer sends 'Update RLE' to map renderer.
-					// rendering map before this leads to the corrupted renderer image.
-					flatMapRenderer->Update();
-					mapRenderer->Render(sceneDef, *fb, depthBuffer.data());
-				}
 
 				// draw models
+				if (r_swModelLodDiff)
+					MeasureModelLodError();
 				for (const auto& m : models)
 					modelRenderer->Render(*m.model, m.param);
+				modelRenderer->Flush();
 				models.clear();
+				passTimes.models += passStopwatch.GetTime();
+				passStopwatch.Reset();
 
 				// deferred lighting
-				for (const auto& light : lights)
-					ApplyDynamicLight<SWFeatureLevel::None>(light);
+#if ENABLE_SSE2
+				if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::SSE2))
+					ApplyDynamicLights<SWFeatureLevel::SSE2>();
+				else
+#endif
+					ApplyDynamicLights<SWFeatureLevel::None>();
 				lights.clear();
+				passTimes.lights += passStopwatch.GetTime();
+				passStopwatch.Reset();
 
+#if ENABLE_AVX2
+				if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::AVX2))
+					ApplyFog<SWFeatureLevel::AVX2>();
+				else
+#endif
 #if ENABLE_SSE2
 				if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::SSE2))
 					ApplyFog<SWFeatureLevel::SSE2>();
 				else
 #endif
 					ApplyFog<SWFeatureLevel::None>();
+				passTimes.fog += passStopwatch.GetTime();
+				passStopwatch.Reset();
 
 				// render sprites
 				{
@@ -779,7 +1228,9 @@ namespace spades {
 						imageRenderer->DrawPolygon(spr.img.GetPointerOrNull(), v1, v2, v3);
 					}
 					sprites.clear();
+					imageRenderer->Flush();
 				}
+				passTimes.sprites += passStopwatch.GetTime();
 			}
 
 			// render debug lines
@@ -1044,19 +1495,166 @@ namespace spades {
 			EnsureSceneNotStarted();
 		}
 
+		void SWRenderer::MeasureModelLodError() {
+			SPADES_MARK_FUNCTION();
+
+			uint32_t* pixels = fb->GetPixels();
+			std::size_t numPixels = static_cast<std::size_t>(fb->GetWidth()) * fb->GetHeight();
+			std::vector<uint32_t> background(pixels, pixels + numPixels);
+			std::vector<float> backgroundDepth = depthBuffer;
+			std::vector<uint32_t> reference;
+			std::size_t numSplats = modelRenderer->GetNumSplats();
+
+			for (int lod = 0; lod < VoxelModel::MaxLevels; lod++) {
+				std::copy(background.begin(), background.end(), pixels);
+				std::copy(backgroundDepth.begin(), backgroundDepth.end(), depthBuffer.begin());
+
+				modelRenderer->ResetStatistics();
+				modelRenderer->forcedLod = lod;
+				for (const auto& m : models)
+					modelRenderer->Render(*m.model, m.param);
+				modelRenderer->Flush();
+
+				if (lod == 0) {
+					reference.assign(pixels, pixels + numPixels);
+					SPLog("Model LOD 0: %zu splats", modelRenderer->GetNumSplats());
+					continue;
+				}
+
+				// error of the pixels that differ from the full-detail image,
+				// in 0-255 per channel
+				std::size_t numDiffering = 0;
+				uint64_t totalError = 0;
+				for (std::size_t i = 0; i < numPixels; i++) {
+					uint32_t a = pixels[i], b = reference[i];
+					if (a == b)
+						continue;
+					numDiffering++;
+					for (int shift = 0; shift < 24; shift += 8)
+						totalError += std::abs(static_cast<int>((a >> shift) & 0xFF) -
+						                       static_cast<int>((b >> shift) & 0xFF));
+				}
+				SPLog("Model LOD %d: %zu splats, %.2f%% pixels differ, mean error %.2f", lod,
+				      modelRenderer->GetNumSplats(), 100.0 * numDiffering / numPixels,
+				      numDiffering ? totalError / (3.0 * numDiffering) : 0.0);
+			}
+
+			std::copy(background.begin(), background.end(), pixels);
+			std::copy(backgroundDepth.begin(), backgroundDepth.end(), depthBuffer.begin());
+			modelRenderer->forcedLod = -1;
+			modelRenderer->numSplats = numSplats;
+		}
+
+		template <SWFeatureLevel level> void SWRenderer::BenchmarkFullScreenPassesAt(Bitmap& out) {
+			enum { NumIterations = 20 };
+
+			auto measure = [&](const char* name, auto pass) {
+				pass(); // warm up
+				Stopwatch sw;
+				for (int i = 0; i < NumIterations; i++)
+					pass();
+				SPLog("  %s (%s): %.3fms", name, GetFeatureLevelName(level),
+				      sw.GetTime() * 1000.0 / NumIterations);
+			};
+
+			measure("Clear", [&] { ClearFrame<level>(); });
+			measure("Fog", [&] { ApplyFog<level>(); });
+			measure("Readback", [&] { ConvertFramebuffer<level>(out); });
+		}
+
+		void SWRenderer::BenchmarkFullScreenPasses() {
+			SPADES_MARK_FUNCTION();
+
+			static const int sizes[][2] = {{1920, 1080}, {3840, 2160}};
+
+			Handle<Bitmap> savedFb = fb;
+			std::vector<float> savedDepth = std::move(depthBuffer);
+			client::SceneDefinition savedSceneDef = sceneDef;
+
+			for (const auto& size : sizes) {
+				int w = size[0], h = size[1];
+				auto frame = Handle<Bitmap>::New(w, h);
+				auto out = Handle<Bitmap>::New(w, h);
+				fb = frame;
+
+				// a spread of depths so that the fog factors vary
+				depthBuffer.resize(static_cast<std::size_t>(w) * h);
+				for (std::size_t i = 0; i < depthBuffer.size(); i++)
+					depthBuffer[i] = static_cast<float>(i % 997) * 0.2F;
+				sceneDef.fovY = 60.0F * M_PI_F / 180.0F;
+				sceneDef.fovX = 2.0F * atanf(tanf(sceneDef.fovY * 0.5F) * w / h);
+
+				SPLog("Full-screen passes at %dx%d, %d threads:", w, h,
+				      static_cast<int>(r_swNumThreads));
+				BenchmarkFullScreenPassesAt<SWFeatureLevel::None>(*out);
+#if ENABLE_SSE2
+				if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::SSE2))
+					BenchmarkFullScreenPassesAt<SWFeatureLevel::SSE2>(*out);
+#endif
+#if ENABLE_AVX2
+				if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::AVX2))
+					BenchmarkFullScreenPassesAt<SWFeatureLevel::AVX2>(*out);
+#endif
+			}
+
+			fb = std::move(savedFb);
+			depthBuffer = std::move(savedDepth);
+			sceneDef = savedSceneDef;
+		}
+
 		void SWRenderer::Flip() {
 			SPADES_MARK_FUNCTION();
 			EnsureValid();
 			EnsureSceneNotStarted();
 
+			imageRenderer->Flush();
+
+			double dur = renderStopwatch.GetTime();
+			if (mapRenderer)
+				mapRenderer->AdaptUndersampling(dur, passTimes.map);
+
 			if (r_swStatistics) {
-				double dur = renderStopwatch.GetTime();
 				SPLog("==== SWRenderer Statistics ====");
 				SPLog("Elapsed Time: %.3fus", dur * 1000000.0);
 				SPLog("Polygon pixels drawn: %llu", imageRenderer->GetPixelsDrawn());
+				SPLog("Feature level: %s", GetFeatureLevelName(featureLevel));
+				SPLog("Model splats: %zu", modelRenderer->GetNumSplats());
+				if (mapRenderer) {
+					SPLog("RLE columns rebuilt: %zu in %.3fus", mapRenderer->GetNumRleUpdates(),
+					      mapRenderer->GetRleUpdateTime() * 1000000.0);
+					SPLog("Map blocks rendered: %zu/%zu, undersampling: %d",
+					      mapRenderer->GetNumBlocksRendered(), mapRenderer->GetNumBlocksTotal(),
+					      mapRenderer->GetCurrentUndersampling());
+				}
+				SPLog("Clear: %.3fus, Map: %.3fus, Models: %.3fus, Lights: %.3fus, Fog: %.3fus, "
+				      "Sprites: %.3fus",
+				      passTimes.clear * 1000000.0, passTimes.map * 1000000.0,
+				      passTimes.models * 1000000.0, passTimes.lights * 1000000.0,
+				      passTimes.fog * 1000000.0, passTimes.sprites * 1000000.0);
+
+				// a single interval says little about pacing
+				auto pacing = port->GetPacingStatistics();
+				if (pacing.numFrames >= 60) {
+					SPLog("Present interval over %zu frames: mean %.3fms, deviation %.3fms, "
+					      "max %.3fms; waited for buffers %.3fms",
+					      pacing.numFrames, pacing.meanInterval * 1000.0,
+					      pacing.intervalDeviation * 1000.0, pacing.maxInterval * 1000.0,
+					      pacing.swapWaitTime * 1000.0);
+					port->ResetPacingStatistics();
+				}
 			}
 
+			if (r_swBenchmarkPasses) {
+				r_swBenchmarkPasses = 0;
+				BenchmarkFullScreenPasses();
+			}
+
+			passTimes = PassTimes();
+
 			imageRenderer->ResetPixelStatistics();
+			modelRenderer->ResetStatistics();
+			if (mapRenderer)
+				mapRenderer->ResetStatistics();
 			renderStopwatch.Reset();
 			port->Swap();
 
@@ -1069,20 +1667,20 @@ namespace spades {
 			EnsureValid();
 			EnsureSceneNotStarted();
 
-			int w = fb->GetWidth();
-			int h = fb->GetHeight();
-			uint32_t* inPix = fb->GetPixels();
-			auto bm = Handle<Bitmap>::New(w, h);
-			uint32_t* outPix = bm->GetPixels();
-			for (int y = 0; y < h; y++) {
-				uint32_t* src = inPix + y * w;
-				uint32_t* dest = outPix + (h - 1 - y) * w;
-				for (int x = w; x != 0; x--) {
-					auto c = *(src++);
-					c = 0xFF000000 | (c & 0xFF00) | ((c & 0xFF) << 16) | ((c & 0xFF0000) >> 16);
-					*(dest++) = c;
-				}
-			}
+			imageRenderer->Flush();
+
+			auto bm = Handle<Bitmap>::New(fb->GetWidth(), fb->GetHeight());
+#if ENABLE_AVX2
+			if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::AVX2))
+				ConvertFramebuffer<SWFeatureLevel::AVX2>(*bm);
+			else
+#endif
+#if ENABLE_SSE2
+			if (static_cast<int>(featureLevel) >= static_cast<int>(SWFeatureLevel::SSE2))
+				ConvertFramebuffer<SWFeatureLevel::SSE2>(*bm);
+			else
+#endif
+				ConvertFramebuffer<SWFeatureLevel::None>(*bm);
 			return bm;
 		}
 
@@ -125,6 +125,17 @@ namespace spades {
 
 			Stopwatch renderStopwatch;
 
+			/** Time spent in each scene pass since the last `Flip`, in seconds. */
+			struct PassTimes {
+				double clear = 0.0;
+				double map = 0.0;
+				double models = 0.0;
+				double lights = 0.0;
+				double fog = 0.0;
+				double sprites = 0.0;
+			};
+			PassTimes passTimes;
+
 			bool duringSceneRendering;
 
 			void BuildProjectionMatrix();
@@ -138,9 +149,27 @@ namespace spades {
 
 			void SetFramebuffer(Bitmap *);
 
+			/** Fills the framebuffer with the fog color and the depth
+			 * buffer with the sky depth. */
+			template <SWFeatureLevel> void ClearFrame();
 			template <SWFeatureLevel> void ApplyFog();
+			/** Writes the framebuffer to `out` (same size) in `Bitmap`'s
+			 * pixel format and row order. */
+			template <SWFeatureLevel> void ConvertFramebuffer(Bitmap &out);
+
+			/** Applies all `lights`. The lights are binned to screen tiles
+			 * and the tiles are processed in parallel. */
+			template <SWFeatureLevel> void ApplyDynamicLights();
+
+			/** Draws `models` at every level of detail and logs how much each
+			 * level differs from the full-detail image. Leaves the framebuffer
+			 * unchanged. */
+			void MeasureModelLodError();
 
-			template <SWFeatureLevel> void ApplyDynamicLight(const DynamicLight &);
+			/** Times the full-screen passes at 1080p and 4K for each feature
+			 * level up to `featureLevel` and logs the results. */
+			void BenchmarkFullScreenPasses();
+			template <SWFeatureLevel> void BenchmarkFullScreenPassesAt(Bitmap &out);
 
 		protected:
 			~SWRenderer();
@@ -176,6 +205,8 @@ namespace spades {
 
 			void AddSprite(client::IImage &, Vector3 center, float radius, float rotation) override;
 			void AddLongSprite(client::IImage &, Vector3 p1, Vector3 p2, float radius) override;
+			void AddSprites(client::IImage &, const client::SpriteParam *sprites,
+			                std::size_t count) override;
 
 			void EndScene() override;
 
@@ -24,43 +24,20 @@
 #include <array>
 #include <memory>
 
-#include <Core/ConcurrentDispatch.h>
 #include <Core/Debug.h>
+#include <Core/Parallel.h>
 
 namespace spades {
 	namespace draw {
 		int GetNumSWRendererThreads();
 
-		template <class F> static void InvokeParallel(F f, unsigned int numThreads) {
-			SPAssert(numThreads <= 32);
-			std::array<std::unique_ptr<ConcurrentDispatch>, 32> disp;
-			for (auto i = 1U; i < numThreads; i++) {
-				auto ff = [i, &f]() { f(i); };
-				disp[i] = std::unique_ptr<ConcurrentDispatch>(
-				  static_cast<ConcurrentDispatch*>(new FunctionDispatch<decltype(ff)>(ff)));
-				disp[i]->Start();
-			}
-			f(0);
-			for (auto i = 1U; i < numThreads; i++)
-				disp[i]->Join();
-		}
+		using spades::InvokeParallel2;
 
+		/** Calls `f(i, numThreads)` on `r_swNumThreads` threads. */
 		template <class F> static void InvokeParallel2(F f) {
-
 			unsigned int numThreads = static_cast<unsigned int>(GetNumSWRendererThreads());
-			numThreads = std::max(numThreads, 1U);
 			numThreads = std::min(numThreads, 32U);
-
-			std::array<std::unique_ptr<ConcurrentDispatch>, 32> disp;
-			for (auto i = 1U; i < numThreads; i++) {
-				auto ff = [i, &f, numThreads]() { f(i, numThreads); };
-				disp[i] = std::unique_ptr<ConcurrentDispatch>(
-				  static_cast<ConcurrentDispatch*>(new FunctionDispatch<decltype(ff)>(ff)));
-				disp[i]->Start();
-			}
-			f(0, numThreads);
-			for (auto i = 1U; i < numThreads; i++)
-				disp[i]->Join();
+			InvokeParallel2(f, numThreads);
 		}
 
 		static inline PURE int ToFixed8(float v) {
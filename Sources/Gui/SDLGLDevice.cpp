@@ -175,6 +175,15 @@ namespace spades {
 			}
 			SPLog("------------------");
 
+#if GLEW
+			instancingSupported =
+			  (glVertexAttribDivisor || glVertexAttribDivisorARB) &&
+			  (glDrawArraysInstanced || glDrawArraysInstancedARB || glDrawArraysInstancedEXT);
+#else
+			instancingSupported = true;
+#endif
+			SPLog("Instanced drawing: %s", instancingSupported ? "supported" : "not supported");
+
 			CheckExistence(glFrontFace);
 			glFrontFace(GL_CW);
 
@@ -1217,8 +1226,16 @@ namespace spades {
 		}
 
 		void SDLGLDevice::VertexAttribDivisor(UInteger index, UInteger divisor) {
-			CheckExistence(glVertexAttribDivisorARB);
-			glVertexAttribDivisorARB(index, divisor);
+#if GLEW
+			if (glVertexAttribDivisor)
+				glVertexAttribDivisor(index, divisor);
+			else if (glVertexAttribDivisorARB)
+				glVertexAttribDivisorARB(index, divisor);
+			else
+				ReportMissingFunc("glVertexAttribDivisor");
+#else
+			glVertexAttribDivisor(index, divisor);
+#endif
 			CheckError();
 		}
 
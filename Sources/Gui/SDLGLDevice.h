@@ -32,6 +32,7 @@ namespace spades {
 			SDL_Window* window;
 			SDL_GLContext context;
 			int w, h;
+			bool instancingSupported;
 
 		protected:
 			~SDLGLDevice();
@@ -125,6 +126,7 @@ namespace spades {
 			                          const void*) override;
 			void EnableVertexAttribArray(UInteger index, bool) override;
 			void VertexAttribDivisor(UInteger index, UInteger divisor) override;
+			bool IsInstancingSupported() override { return instancingSupported; }
 
 			void DrawArrays(Enum mode, Integer first, Sizei count) override;
 			void DrawElements(Enum mode, Sizei count, Enum type, const void* indices) override;
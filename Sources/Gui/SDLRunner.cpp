@@ -37,6 +37,7 @@
 #include <Core/Math.h>
 #include <Core/Settings.h>
 #include <Draw/OpenGL/GLRenderer.h>
+#include <Draw/SW/SWBufferedPort.h>
 #include <Draw/SW/SWPort.h>
 #include <Draw/SW/SWRenderer.h>
 #include <ZeroSpades.h>
@@ -47,6 +48,7 @@ DEFINE_SPADES_SETTING(r_fullscreen, "0");
 DEFINE_SPADES_SETTING(r_vsync, "1");
 DEFINE_SPADES_SETTING(r_allowSoftwareRendering, "0");
 DEFINE_SPADES_SETTING(r_renderer, "gl");
+DEFINE_SPADES_SETTING(r_swBuffers, "1");
 DEFINE_SPADES_SETTING(s_audioDriver, "openal");
 DEFINE_SPADES_SETTING(cl_fps, "0");
 
@@ -421,6 +423,67 @@ namespace spades {
 			}
 		};
 
+		/**
+		 * Renders into its own buffers and copies each frame to the window
+		 * surface on the presentation thread, so that the copy and the
+		 * surface update overlap rendering the next frame.
+		 */
+		class SDLBufferedSWPort : public draw::SWBufferedPort, public Disposable {
+			SDL_Window* wnd;
+			SDL_Surface* surface;
+
+			SDLBufferedSWPort(SDL_Window* wnd, SDL_Surface* surface, int numBuffers)
+			    : SWBufferedPort(surface->w & ~7, surface->h & ~7, numBuffers),
+			      wnd(wnd),
+			      surface(surface) {
+				if ((surface->w & 7) || (surface->h & 7)) {
+					SPLog("Surface size %dx%d doesn't match the software renderer's"
+						  " requirements. Rounded to %dx%d.",
+						  surface->w, surface->h, surface->w & ~7, surface->h & ~7);
+					if (SDL_MUSTLOCK(surface))
+						SDL_LockSurface(surface);
+					memset(surface->pixels, 0, surface->h * surface->pitch);
+					if (SDL_MUSTLOCK(surface))
+						SDL_UnlockSurface(surface);
+				}
+			}
+
+		protected:
+			~SDLBufferedSWPort() { StopPresenting(); }
+
+			void Present(Bitmap& frame) override {
+				if (!surface)
+					return;
+
+				if (SDL_MUSTLOCK(surface))
+					SDL_LockSurface(surface);
+
+				int w = frame.GetWidth();
+				int h = frame.GetHeight();
+				uint32_t* outPixels = reinterpret_cast<uint32_t*>(surface->pixels);
+				outPixels += ((surface->w - w) >> 1) + ((surface->h - h) >> 1) * (surface->pitch >> 2);
+				const uint32_t* inPixels = frame.GetPixels();
+				for (int y = 0; y < h; y++) {
+					std::memcpy(outPixels, inPixels, w * 4);
+					outPixels += surface->pitch >> 2;
+					inPixels += w;
+				}
+
+				if (SDL_MUSTLOCK(surface))
+					SDL_UnlockSurface(surface);
+				SDL_UpdateWindowSurface(wnd);
+			}
+
+		public:
+			SDLBufferedSWPort(SDL_Window* wnd, int numBuffers)
+			    : SDLBufferedSWPort(wnd, SDL_GetWindowSurface(wnd), numBuffers) {}
+
+			void Dispose() override {
+				StopPresenting();
+				surface = nullptr;
+			}
+		};
+
 		std::tuple<Handle<client::IRenderer>, Handle<Disposable>>
 		SDLRunner::CreateRenderer(SDL_Window* wnd, RendererType type) {
 			switch (type) {
@@ -432,7 +495,16 @@ namespace spades {
 					  std::move(dummy));
 				}
 				case RendererType::SW: {
-					auto port = Handle<SDLSWPort>::New(wnd).Cast<draw::SWPort>();
+					int numBuffers = Clamp(static_cast<int>(r_swBuffers), 1, 3);
+#ifdef __APPLE__
+					// the window surface can only be updated on the main thread
+					numBuffers = 1;
+#endif
+					Handle<draw::SWPort> port;
+					if (numBuffers > 1)
+						port = Handle<SDLBufferedSWPort>::New(wnd, numBuffers).Cast<draw::SWPort>();
+					else
+						port = Handle<SDLSWPort>::New(wnd).Cast<draw::SWPort>();
 					return std::make_tuple(
 					  Handle<draw::SWRenderer>::New(port).Cast<client::IRenderer>(),
 					  port.Cast<Disposable>());
@@ -0,0 +1,260 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Testing.h"
+#include <Client/DemoPlayer.h>
+#include <Client/GameMap.h>
+#include <Client/GameProperties.h>
+#include <Client/Grenade.h>
+#include <Client/NetProtocol.h>
+#include <Client/Player.h>
+#include <Client/World.h>
+#include <Core/FileManager.h>
+#include <Core/IFileSystem.h>
+#include <Core/MemoryStream.h>
+
+using namespace spades;
+using namespace spades::client;
+
+namespace {
+	constexpr int NumPlayers = 8;
+	constexpr float DemoLength = 15.0F;
+	const char* const DemoFileName = "Demos/ReplayTest.demo";
+
+	/** Serves a single demo file from memory. */
+	class DemoFileSystem : public IFileSystem {
+		std::string data;
+
+	public:
+		explicit DemoFileSystem(std::string data) : data(std::move(data)) {}
+
+		std::vector<std::string> EnumFiles(const char*) override { return {}; }
+		std::unique_ptr<IStream> OpenForReading(const char*) override {
+			return stmp::make_unique<MemoryStream>(data.data(), data.size());
+		}
+		std::unique_ptr<IStream> OpenForWriting(const char*) override { return nullptr; }
+		bool FileExists(const char* fn) override { return std::strcmp(fn, DemoFileName) == 0; }
+	};
+
+	/** Encodes a packet the way the server sends it. */
+	class PacketWriter {
+		std::vector<char> data;
+
+	public:
+		explicit PacketWriter(PacketType type) { data.push_back(static_cast<char>(type)); }
+
+		void Write(uint8_t v) { data.push_back(static_cast<char>(v)); }
+		void Write(uint32_t v) {
+			for (int i = 0; i < 4; i++)
+				Write(static_cast<uint8_t>(v >> (i * 8)));
+		}
+		void Write(float v) {
+			uint32_t bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			Write(bits);
+		}
+		void Write(const Vector3& v) {
+			Write(v.x);
+			Write(v.y);
+			Write(v.z);
+		}
+
+		const std::vector<char>& GetData() const { return data; }
+	};
+
+	/**
+	 * Generates a demo of players running around, digging and throwing
+	 * grenades, with irregular packet spacing like a recording of a real
+	 * server.
+	 */
+	std::string MakeDemo() {
+		std::string demo;
+		demo.push_back(static_cast<char>(DemoPlayer::FILE_VERSION));
+		demo.push_back(3); // 0.75
+
+		std::mt19937 rng{17};
+		std::uniform_real_distribution<float> unit{0.0F, 1.0F};
+		auto randomPosition = [&] {
+			return MakeVector3(196.0F + unit(rng) * 40.0F, 196.0F + unit(rng) * 40.0F,
+			                   50.0F + unit(rng) * 6.0F);
+		};
+
+		float time = 0.0F;
+		while (time < DemoLength) {
+			time += 0.005F + unit(rng) * 0.075F;
+			uint8_t playerId = static_cast<uint8_t>(rng() % NumPlayers);
+			unsigned int kind = rng() % 20;
+
+			std::unique_ptr<PacketWriter> packet;
+			if (kind < 13) {
+				packet.reset(new PacketWriter(PacketTypeInputData));
+				packet->Write(playerId);
+				packet->Write(static_cast<uint8_t>(rng()));
+			} else if (kind < 15) {
+				packet.reset(new PacketWriter(PacketTypeWorldUpdate));
+				for (int i = 0; i < NumPlayers; i++) {
+					packet->Write(randomPosition());
+					float yaw = unit(rng) * 6.28F;
+					packet->Write(MakeVector3(cosf(yaw), sinf(yaw), 0.0F));
+				}
+			} else if (kind < 18) {
+				// dig into the ground and the towers
+				packet.reset(new PacketWriter(PacketTypeBlockAction));
+				packet->Write(playerId);
+				packet->Write(static_cast<uint8_t>(BlockActionTool));
+				packet->Write(static_cast<uint32_t>(192 + rng() % 48));
+				packet->Write(static_cast<uint32_t>(192 + rng() % 48));
+				packet->Write(static_cast<uint32_t>(40 + rng() % 21));
+			} else {
+				packet.reset(new PacketWriter(PacketTypeGrenadePacket));
+				packet->Write(playerId);
+				packet->Write(0.5F + unit(rng) * 2.5F);
+				packet->Write(randomPosition());
+				packet->Write(MakeVector3(unit(rng) - 0.5F, unit(rng) - 0.5F, -unit(rng)));
+			}
+
+			const std::vector<char>& data = packet->GetData();
+			uint16_t length = static_cast<uint16_t>(data.size());
+			demo.append(reinterpret_cast<const char*>(&time), sizeof(float));
+			demo.append(reinterpret_cast<const char*>(&length), sizeof(uint16_t));
+			demo.append(data.begin(), data.end());
+		}
+		return demo;
+	}
+
+	/** A platform with towers to dig through, and the players on it. */
+	std::unique_ptr<World> MakeWorld() {
+		auto map = Handle<GameMap>::New();
+		const uint32_t color = 0x7F808080;
+		for (int x = 192; x < 240; x++)
+			for (int y = 192; y < 240; y++) {
+				int top = (x % 8 < 2 && y % 8 < 2) ? 40 : (x + y) % 9 == 0 ? 59 : 60;
+				for (int z = top; z < GameMap::DefaultDepth; z++)
+					map->Set(x, y, z, true, color, true);
+			}
+
+		auto properties = std::make_shared<GameProperties>(ProtocolVersion::v075);
+		auto world = stmp::make_unique<World>(properties);
+		world->SetMap(map);
+
+		for (int i = 0; i < NumPlayers; i++) {
+			auto player = stmp::make_unique<Player>(*world, i, RIFLE_WEAPON, i % 2);
+			player->SetPosition(MakeVector3(200.0F + i * 4.0F, 216.0F, 55.0F));
+			world->SetPlayer(i, std::move(player));
+		}
+		return world;
+	}
+
+	/** Applies a demo packet to the world like `DemoNetClient` does for a
+	 * spectator. */
+	void ApplyPacket(World& world, const std::vector<char>& data) {
+		NetPacketReader r{data};
+		switch (r.GetType()) {
+			case PacketTypeInputData: {
+				auto p = world.GetPlayer(r.ReadByte());
+				PlayerInput inp = ParsePlayerInput(r.ReadByte());
+				if (p)
+					p->SetInput(inp);
+			} break;
+			case PacketTypeWorldUpdate: {
+				int entries = static_cast<int>(r.GetLength() / 24);
+				for (int i = 0; i < entries; i++) {
+					Vector3 pos = r.ReadVector3();
+					Vector3 front = r.ReadVector3();
+					auto p = world.GetPlayer(i);
+					if (p && p->IsAlive() && !p->IsSpectator()) {
+						p->RepositionPlayer(pos);
+						p->SetOrientation(front);
+					}
+				}
+			} break;
+			case PacketTypeBlockAction: {
+				r.ReadByte();
+				r.ReadByte();
+				std::vector<IntVector3> cells{r.ReadIntVector3()};
+				world.DestroyBlock(cells);
+			} break;
+			case PacketTypeGrenadePacket: {
+				int pId = r.ReadByte();
+				float fuse = r.ReadFloat();
+				Vector3 pos = r.ReadVector3();
+				Vector3 vel = r.ReadVector3();
+				world.AddGrenade(stmp::make_unique<Grenade>(world, pId, pos, vel, fuse));
+			} break;
+			default: SPADES_CHECK(false);
+		}
+	}
+
+	/**
+	 * Replays the demo up to `targetTime` into a new world like
+	 * `DemoNetClient::FastReplay` does: the world is aged up to each
+	 * packet's timestamp before the packet is applied.
+	 */
+	uint64_t Replay(const DemoPlayer& demo, float targetTime) {
+		auto world = MakeWorld();
+		demo.ReplayUpTo(targetTime, [&](const std::vector<char>& data, float dt) {
+			world->AdvanceFixed(dt);
+			ApplyPacket(*world, data);
+		});
+		return world->GetStateHash();
+	}
+
+	void TestReplayIsDeterministic() {
+		FileManager::AddFileSystem(new DemoFileSystem(MakeDemo()));
+
+		DemoPlayer demo;
+		SPADES_CHECK(demo.Open(DemoFileName));
+		SPADES_CHECK(demo.GetDuration() > DemoLength - 0.1F);
+
+		uint64_t initial = MakeWorld()->GetStateHash();
+		uint64_t full = Replay(demo, demo.GetDuration());
+		uint64_t half = Replay(demo, demo.GetDuration() * 0.5F);
+		std::printf("world hashes: initial %016llx, half %016llx, full %016llx\n",
+		            (unsigned long long)initial, (unsigned long long)half,
+		            (unsigned long long)full);
+
+		// make sure that the demo actually changes the world
+		SPADES_CHECK(half != initial);
+		SPADES_CHECK(full != half);
+
+		// replaying again, after a replay to another time (like seeking
+		// back and forth), ends up in the same state
+		SPADES_CHECK(Replay(demo, demo.GetDuration()) == full);
+		SPADES_CHECK(Replay(demo, demo.GetDuration() * 0.5F) == half);
+
+		// and so does replaying the demo opened once more
+		DemoPlayer demo2;
+		SPADES_CHECK(demo2.Open(DemoFileName));
+		SPADES_CHECK(Replay(demo2, demo2.GetDuration()) == full);
+	}
+
+	void TestAll() { TestReplayIsDeterministic(); }
+} // namespace
+
+SPADES_TEST_MAIN(TestAll)
@@ -0,0 +1,377 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Testing.h"
+#include <Client/GameMap.h>
+#include <Core/Math.h>
+#include <Draw/OpenGL/GLMapChunkMesher.h>
+
+using namespace spades;
+using namespace spades::draw;
+
+namespace {
+	using Vertex = GLMapChunkMesher::Vertex;
+	using Mesh = GLMapChunkMesher::Mesh;
+
+	enum { Size = GLMapChunkMesher::Size };
+
+	/** Hills with tunnels and a few damaged blocks, painted in large patches
+	 * of the same color so that there are faces to merge. */
+	Handle<client::GameMap> MakeTerrain() {
+		auto map = Handle<client::GameMap>::New();
+		std::mt19937 rng{7};
+		const uint32_t palette[] = {0x64306080, 0x64808040, 0x64205020};
+		for (int x = 0; x < map->Width(); x++)
+			for (int y = 0; y < map->Height(); y++) {
+				int top = 36 + static_cast<int>(6.0F * (sinf(x * 0.05F) + cosf(y * 0.07F)));
+				if (rng() % 200 == 0)
+					top -= 8;
+				uint32_t color = palette[(x / 8 + y / 8) % 3];
+				// a new map starts with a solid top layer
+				map->Set(x, y, 0, false, 0, true);
+				for (int z = top; z < client::GameMap::DefaultDepth; z++) {
+					bool cave = z >= top + 5 && z < top + 8 && (x % 24 < 4 || y % 40 < 3);
+					if (cave)
+						continue;
+					uint32_t c = color;
+					if (rng() % 100 == 0)
+						c = (c & 0xFFFFFF) | (static_cast<uint32_t>(rng() % 100) << 24);
+					map->Set(x, y, z, true, c, true);
+				}
+			}
+		// the bottom layer is different from the one above it in places,
+		// so that the water surface setting matters
+		for (int x = 0; x < map->Width(); x += 3)
+			for (int y = 0; y < map->Height(); y += 5)
+				map->Set(x, y, 62, false, 0, true);
+		return map;
+	}
+
+	/** The per-face mesher before face merging and column caching were
+	 * added, emitting the same vertices. */
+	class ReferenceMesher {
+		const client::GameMap& map;
+		bool waterSurface;
+
+		bool IsSolid(int x, int y, int z) const {
+			if (z < 0)
+				return false;
+			if (z >= 64)
+				return true;
+			x &= map.Width() - 1;
+			y &= map.Height() - 1;
+			return map.IsSolid(x, y, (z == 63) ? (waterSurface ? 62 : 63) : z);
+		}
+
+		unsigned int CalcAOID(int x, int y, int z, int ux, int uy, int uz, int vx, int vy,
+		                      int vz) const {
+			unsigned int v = 0;
+			if (IsSolid(x - ux, y - uy, z - uz))
+				v |= 1;
+			if (IsSolid(x + ux, y + uy, z + uz))
+				v |= 1 << 1;
+			if (IsSolid(x - vx, y - vy, z - vz))
+				v |= 1 << 2;
+			if (IsSolid(x + vx, y + vy, z + vz))
+				v |= 1 << 3;
+			if (IsSolid(x - ux + vx, y - uy + vy, z - uz + vz))
+				v |= 1 << 4;
+			if (IsSolid(x - ux - vx, y - uy - vy, z - uz - vz))
+				v |= 1 << 5;
+			if (IsSolid(x + ux + vx, y + uy + vy, z + uz + vz))
+				v |= 1 << 6;
+			if (IsSolid(x + ux - vx, y + uy - vy, z + uz - vz))
+				v |= 1 << 7;
+			return v;
+		}
+
+		void EmitVertex(Mesh& mesh, int x, int y, int z, int aoX, int aoY, int aoZ, int ux,
+		                int uy, int vx, int vy, uint32_t color, int nx, int ny, int nz) const {
+			int uz = (ux == 0 && uy == 0) ? 1 : 0;
+			int vz = (vx == 0 && vy == 0) ? 1 : 0;
+			unsigned int aoID = CalcAOID(aoX, aoY, aoZ, ux, uy, uz, vx, vy, vz);
+
+			Vertex inst{};
+			if (nz == 1 || ny == 1)
+				inst.shading = 0;
+			else if (nx == 1 || nx == -1)
+				inst.shading = 0;
+			else if (nz == -1)
+				inst.shading = 220;
+			else
+				inst.shading = 255;
+
+			inst.colorRed = (uint8_t)(color);
+			inst.colorGreen = (uint8_t)(color >> 8);
+			inst.colorBlue = (uint8_t)(color >> 16);
+			inst.nx = nx;
+			inst.ny = ny;
+			inst.nz = nz;
+			inst.sx = (x << 1) + ux + vx;
+			inst.sy = (y << 1) + uy + vy;
+			inst.sz = (z << 1) + uz + vz;
+
+			unsigned int aoTexX = (aoID & 15) * 16;
+			unsigned int aoTexY = (aoID >> 4) * 16;
+
+			uint16_t idx = (uint16_t)mesh.vertices.size();
+			for (int i = 0; i < 4; i++) {
+				int du = i & 1, dv = i >> 1;
+				inst.x = x + ux * du + vx * dv;
+				inst.y = y + uy * du + vy * dv;
+				inst.z = z + uz * du + vz * dv;
+				inst.aoX = aoTexX + 15 * du;
+				inst.aoY = aoTexY + 15 * dv;
+				mesh.vertices.push_back(inst);
+			}
+			for (int i : {0, 1, 2, 1, 3, 2})
+				mesh.indices.push_back(idx + i);
+		}
+
+	public:
+		ReferenceMesher(const client::GameMap& map, bool waterSurface)
+		    : map(map), waterSurface(waterSurface) {}
+
+		void Build(int cx, int cy, int cz, Mesh& mesh) const {
+			mesh.Clear();
+			for (int x = 0; x < Size; x++)
+				for (int y = 0; y < Size; y++)
+					for (int z = 0; z < Size; z++) {
+						int xx = x + cx * Size;
+						int yy = y + cy * Size;
+						int zz = z + cz * Size;
+						if (!IsSolid(xx, yy, zz))
+							continue;
+
+						uint32_t col = map.GetColor(xx, yy, zz);
+						int health = col >> 24;
+						uint32_t f = (std::max(health, 32) << 8) / 100;
+						col = DarkenColor(col, f);
+
+						if (!IsSolid(xx, yy, zz + 1))
+							EmitVertex(mesh, x + 1, y, z + 1, xx, yy, zz + 1, -1, 0, 0, 1, col, 0,
+							           0, 1);
+						if (!IsSolid(xx, yy, zz - 1))
+							EmitVertex(mesh, x, y, z, xx, yy, zz - 1, 1, 0, 0, 1, col, 0, 0, -1);
+						if (!IsSolid(xx - 1, yy, zz))
+							EmitVertex(mesh, x, y + 1, z, xx - 1, yy, zz, 0, 0, 0, -1, col, -1, 0,
+							           0);
+						if (!IsSolid(xx + 1, yy, zz))
+							EmitVertex(mesh, x + 1, y, z, xx + 1, yy, zz, 0, 0, 0, 1, col, 1, 0, 0);
+						if (!IsSolid(xx, yy - 1, zz))
+							EmitVertex(mesh, x, y, z, xx, yy - 1, zz, 0, 0, 1, 0, col, 0, -1, 0);
+						if (!IsSolid(xx, yy + 1, zz))
+							EmitVertex(mesh, x + 1, y + 1, z, xx, yy + 1, zz, 0, 0, -1, 0, col, 0,
+							           1, 0);
+					}
+		}
+	};
+
+	using VertexKey = std::array<int, 15>;
+	using QuadKey = std::array<VertexKey, 4>;
+
+	VertexKey MakeVertexKey(const Vertex& v) {
+		return {v.x,       v.y,  v.z,  v.aoX, v.aoY, v.colorRed, v.colorGreen, v.colorBlue,
+		        v.shading, v.nx, v.ny, v.nz,  v.sx,  v.sy,       v.sz};
+	}
+
+	/** Checks that the mesh is made of quads with the usual index pattern and
+	 * returns them in a canonical order. */
+	std::vector<QuadKey> GetQuads(const Mesh& mesh) {
+		std::vector<QuadKey> quads;
+		SPADES_CHECK(mesh.vertices.size() % 4 == 0);
+		SPADES_CHECK(mesh.indices.size() == mesh.vertices.size() / 4 * 6);
+		for (std::size_t q = 0; q * 4 + 3 < mesh.vertices.size(); q++) {
+			static const int pattern[] = {0, 1, 2, 1, 3, 2};
+			for (int i = 0; i < 6 && q * 6 + i < mesh.indices.size(); i++)
+				SPADES_CHECK(mesh.indices[q * 6 + i] == q * 4 + pattern[i]);
+
+			QuadKey quad;
+			for (int i = 0; i < 4; i++)
+				quad[i] = MakeVertexKey(mesh.vertices[q * 4 + i]);
+			quads.push_back(quad);
+		}
+		std::sort(quads.begin(), quads.end());
+		return quads;
+	}
+
+	/** A unit voxel face covered by a quad, as it is shaded. */
+	struct UnitFace {
+		/** Chunk local position of the face's minimum corner */
+		int x, y, z;
+		int nx, ny, nz;
+		int colorRed, colorGreen, colorBlue, shading;
+		/** Ambient occlusion tile */
+		int aoTileX, aoTileY;
+		/** Where the map shadow shaders evaluate the shadow, times 10 */
+		int shadowX, shadowY, shadowZ;
+
+		std::array<int, 15> Key() const {
+			return {x,        y,       z,       nx,      ny,      nz,      colorRed, colorGreen,
+			        colorBlue, shading, aoTileX, aoTileY, shadowX, shadowY, shadowZ};
+		}
+		bool operator<(const UnitFace& o) const { return Key() < o.Key(); }
+		bool operator==(const UnitFace& o) const { return Key() == o.Key(); }
+	};
+
+	Vector3 GetPosition(const Vertex& v) {
+		return MakeVector3(v.x, v.y, v.z);
+	}
+
+	/** Splits each quad of the mesh into unit faces and returns them sorted.
+	 * Also checks that each quad is a rectangle facing its normal. */
+	std::vector<UnitFace> GetUnitFaces(const Mesh& mesh) {
+		std::vector<UnitFace> faces;
+		for (std::size_t q = 0; q * 4 + 3 < mesh.vertices.size(); q++) {
+			const Vertex* quad = &mesh.vertices[q * 4];
+			Vector3 origin = GetPosition(quad[0]);
+			Vector3 u = GetPosition(quad[1]) - origin;
+			Vector3 v = GetPosition(quad[2]) - origin;
+			Vector3 n = MakeVector3(quad[0].nx, quad[0].ny, quad[0].nz);
+			SPADES_CHECK(GetPosition(quad[3]) == origin + u + v);
+			SPADES_CHECK(Vector3::Dot(Vector3::Cross(u, v), n) < 0.0F);
+
+			int w = static_cast<int>(u.GetLength() + 0.5F);
+			int h = static_cast<int>(v.GetLength() + 0.5F);
+			SPADES_CHECK(w >= 1 && h >= 1);
+
+			// the ambient occlusion texture coordinates span one tile
+			// whatever the size of the quad
+			for (int i = 0; i < 4; i++) {
+				SPADES_CHECK(quad[i].aoX == quad[0].aoX + 15 * (i & 1));
+				SPADES_CHECK(quad[i].aoY == quad[0].aoY + 15 * (i >> 1));
+			}
+
+			Vector3 shadowOrigin = MakeVector3(quad[0].sx, quad[0].sy, quad[0].sz) * 0.5F;
+			Vector3 shadowU = MakeVector3(quad[1].sx, quad[1].sy, quad[1].sz) * 0.5F - shadowOrigin;
+			Vector3 shadowV = MakeVector3(quad[2].sx, quad[2].sy, quad[2].sz) * 0.5F - shadowOrigin;
+
+			for (int j = 0; j < h; j++)
+				for (int i = 0; i < w; i++) {
+					// the shadow coordinate of fragments near the corners and
+					// at the center of the unit face, snapped like the map
+					// shadow fragment shaders do
+					Vector3 shadow;
+					const float samples[][2] = {{0.1F, 0.1F}, {0.5F, 0.5F}, {0.9F, 0.2F},
+					                            {0.2F, 0.9F}, {0.9F, 0.9F}};
+					for (std::size_t k = 0; k < sizeof(samples) / sizeof(samples[0]); k++) {
+						float s = (i + samples[k][0]) / w, t = (j + samples[k][1]) / h;
+						Vector3 c = shadowOrigin + shadowU * s + shadowV * t;
+						c = c - n * 0.5F;
+						c = MakeVector3(std::floor(c.x), std::floor(c.y), std::floor(c.z)) +
+						    MakeVector3(0.5F, 0.5F, 0.5F) + n * 0.6F;
+						if (k == 0)
+							shadow = c;
+						SPADES_CHECK(c == shadow);
+					}
+
+					Vector3 p0 = origin + u * (static_cast<float>(i) / w) +
+					             v * (static_cast<float>(j) / h);
+					Vector3 p1 = p0 + u * (1.0F / w) + v * (1.0F / h);
+					UnitFace face;
+					face.x = static_cast<int>(std::min(p0.x, p1.x));
+					face.y = static_cast<int>(std::min(p0.y, p1.y));
+					face.z = static_cast<int>(std::min(p0.z, p1.z));
+					face.nx = quad[0].nx;
+					face.ny = quad[0].ny;
+					face.nz = quad[0].nz;
+					face.colorRed = quad[0].colorRed;
+					face.colorGreen = quad[0].colorGreen;
+					face.colorBlue = quad[0].colorBlue;
+					face.shading = quad[0].shading;
+					face.aoTileX = quad[0].aoX / 16;
+					face.aoTileY = quad[0].aoY / 16;
+					face.shadowX = static_cast<int>(std::floor(shadow.x * 10.0F + 0.5F));
+					face.shadowY = static_cast<int>(std::floor(shadow.y * 10.0F + 0.5F));
+					face.shadowZ = static_cast<int>(std::floor(shadow.z * 10.0F + 0.5F));
+					faces.push_back(face);
+				}
+		}
+		std::sort(faces.begin(), faces.end());
+		return faces;
+	}
+
+	void TestChunks(bool waterSurface) {
+		auto map = MakeTerrain();
+		ReferenceMesher reference{*map, waterSurface};
+		GLMapChunkMesher perFace{*map, waterSurface, false};
+		GLMapChunkMesher greedy{*map, waterSurface, true};
+
+		const int numChunkX = map->Width() / Size, numChunkY = map->Height() / Size;
+		// include the chunks on the map edges, whose neighbors wrap around
+		const int chunkXs[] = {0, 1, 2, 5, numChunkX - 1};
+		const int chunkYs[] = {0, 1, 3, numChunkY - 1};
+
+		Mesh referenceMesh, perFaceMesh, greedyMesh;
+		std::size_t numFaces = 0, numGreedyQuads = 0;
+		int numMismatches = 0;
+		for (int cx : chunkXs)
+			for (int cy : chunkYs)
+				for (int cz = 0; cz < map->Depth() / Size; cz++) {
+					reference.Build(cx, cy, cz, referenceMesh);
+					perFace.Build(cx, cy, cz, perFaceMesh);
+					greedy.Build(cx, cy, cz, greedyMesh);
+
+					// per-face meshing emits the same quads as the reference
+					bool sameQuads = GetQuads(perFaceMesh) == GetQuads(referenceMesh);
+
+					// greedy meshing covers every face exactly once, and each
+					// of them is shaded and shadowed as it is without merging
+					std::vector<UnitFace> faces = GetUnitFaces(perFaceMesh);
+					std::vector<UnitFace> greedyFaces = GetUnitFaces(greedyMesh);
+					bool sameFaces = faces == greedyFaces;
+
+					if (!sameQuads || !sameFaces) {
+						if (numMismatches++ < 5)
+							std::fprintf(stderr, "chunk (%d, %d, %d): quads %s, faces %s\n", cx,
+							             cy, cz, sameQuads ? "match" : "differ",
+							             sameFaces ? "match" : "differ");
+					}
+					SPADES_CHECK(sameQuads);
+					SPADES_CHECK(sameFaces);
+					SPADES_CHECK(greedyMesh.vertices.size() <= perFaceMesh.vertices.size());
+
+					numFaces += faces.size();
+					numGreedyQuads += greedyMesh.vertices.size() / 4;
+				}
+
+		std::printf("waterSurface=%d: %zu faces, %zu quads after merging\n", waterSurface ? 1 : 0,
+		            numFaces, numGreedyQuads);
+		// make sure that there was something to mesh and to merge
+		SPADES_CHECK(numFaces > 1000);
+		SPADES_CHECK(numGreedyQuads < numFaces);
+	}
+
+	void TestAll() {
+		TestChunks(false);
+		TestChunks(true);
+	}
+} // namespace
+
+SPADES_TEST_MAIN(TestAll)
@@ -0,0 +1,111 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "Testing.h"
+#include <Client/GameMap.h>
+#include <Draw/OpenGL/GLMapOccluder.h>
+
+using namespace spades;
+using namespace spades::draw;
+
+namespace {
+	/** Ridges and valleys, with a few holes dug into the slopes, so that
+	 * chunks are hidden behind the ridges from the valleys. */
+	Handle<client::GameMap> MakeTerrain() {
+		auto map = Handle<client::GameMap>::New();
+		std::mt19937 rng{11};
+		for (int x = 0; x < map->Width(); x++)
+			for (int y = 0; y < map->Height(); y++) {
+				int top = 40 + static_cast<int>(18.0F * sinf(x * 0.06F) * cosf(y * 0.05F));
+				// a new map starts with a solid top layer
+				map->Set(x, y, 0, false, 0, true);
+				for (int z = top; z < client::GameMap::DefaultDepth; z++)
+					map->Set(x, y, z, true, 0x7F808080, true);
+				if (rng() % 30 == 0)
+					for (int z = top; z < std::min(top + 6, 62); z++)
+						map->Set(x, y, z, false, 0, true);
+			}
+		return map;
+	}
+
+	int GetGroundZ(const client::GameMap& map, int x, int y) {
+		for (int z = 0; z < map.Depth(); z++)
+			if (map.IsSolid(x, y, z))
+				return z;
+		return map.Depth();
+	}
+
+	void TestNeverCullsVisibleChunks() {
+		auto map = MakeTerrain();
+		GLMapOccluder occluder{*map};
+
+		std::mt19937 rng{13};
+		int numOccluded = 0, numVisibleOccluded = 0;
+		for (int i = 0; i < 2000; i++) {
+			// an eye a little above the ground, or anywhere in the air
+			int x = static_cast<int>(rng() % map->Width());
+			int y = static_cast<int>(rng() % map->Height());
+			float eyeZ = static_cast<float>(GetGroundZ(*map, x, y)) -
+			             (i % 4 == 0 ? std::uniform_real_distribution<float>{1.0F, 30.0F}(rng)
+			                         : 1.5F);
+			Vector3 eye = MakeVector3(x + std::uniform_real_distribution<float>{}(rng),
+			                          y + std::uniform_real_distribution<float>{}(rng), eyeZ);
+
+			// a chunk around the eye, in the unwrapped coordinates the
+			// renderer uses
+			const int size = 16;
+			int cx = (x / size) + static_cast<int>(rng() % 13) - 6;
+			int cy = (y / size) + static_cast<int>(rng() % 13) - 6;
+			int cz = static_cast<int>(rng() % 4);
+			AABB3 box{MakeVector3(static_cast<float>(cx * size), static_cast<float>(cy * size),
+			                      static_cast<float>(cz * size)),
+			          MakeVector3(static_cast<float>((cx + 1) * size),
+			                      static_cast<float>((cy + 1) * size),
+			                      static_cast<float>((cz + 1) * size))};
+
+			if (!occluder.IsOccluded(eye, box))
+				continue;
+			numOccluded++;
+			if (GLMapOccluder::IsVisibleBruteForce(*map, eye, box)) {
+				if (numVisibleOccluded++ < 5)
+					std::fprintf(stderr,
+					             "chunk [%d, %d, %d] is visible from (%.2f, %.2f, %.2f), but "
+					             "was reported as occluded\n",
+					             cx, cy, cz, eye.x, eye.y, eye.z);
+			}
+		}
+
+		std::printf("%d of 2000 chunks occluded\n", numOccluded);
+		SPADES_CHECK(numVisibleOccluded == 0);
+		// make sure that the occluder was actually exercised
+		SPADES_CHECK(numOccluded > 100);
+	}
+
+	void TestAll() { TestNeverCullsVisibleChunks(); }
+} // namespace
+
+SPADES_TEST_MAIN(TestAll)
@@ -0,0 +1,106 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Testing.h"
+#include <Client/GameMap.h>
+#include <Draw/OpenGL/GLMapShadowGenerator.h>
+#include <Draw/OpenGL/GLRadiosityEvaluator.h>
+
+using namespace spades;
+using namespace spades::draw;
+
+namespace {
+	/** Hills and pillars with random colors, so that there are lit faces
+	 * of every orientation around the tested voxels. */
+	Handle<client::GameMap> MakeTerrain() {
+		auto map = Handle<client::GameMap>::New();
+		std::mt19937 rng{3};
+		for (int x = 0; x < map->Width(); x++)
+			for (int y = 0; y < map->Height(); y++) {
+				int top = 40 + static_cast<int>(10.0F * (sinf(x * 0.1F) + cosf(y * 0.13F)));
+				if (rng() % 50 == 0)
+					top -= 10;
+				// a new map starts with a solid top layer
+				map->Set(x, y, 0, false, 0, true);
+				for (int z = top; z < client::GameMap::DefaultDepth; z++)
+					map->Set(x, y, z, true, rng() | 0x7F000000, true);
+			}
+		return map;
+	}
+
+	/** The largest channel difference between two encoded values. */
+	int EncodedDistance(uint32_t a, uint32_t b) {
+		int d = 0;
+		for (int shift = 0; shift < 32; shift += 8)
+			d = std::max(d, std::abs(static_cast<int>((a >> shift) & 0xFF) -
+			                         static_cast<int>((b >> shift) & 0xFF)));
+		return d;
+	}
+
+	void TestMatchesReference(bool highPrecision) {
+		auto map = MakeTerrain();
+		const int w = map->Width(), h = map->Height();
+		std::vector<uint32_t> bitmap(static_cast<std::size_t>(w * h));
+		GLMapShadowGenerator{*map}.Generate(bitmap.data());
+
+		GLRadiosityEvaluator evaluator{bitmap.data(), w, h, highPrecision};
+
+		std::mt19937 rng{5};
+		float maxError = 0.0F, maxValue = 0.0F;
+		int maxEncodedDistance = 0;
+		for (int i = 0; i < 20000; i++) {
+			int x = static_cast<int>(rng() % w), y = static_cast<int>(rng() % h);
+			IntVector3 v = IntVector3::Make(x, y, static_cast<int>(rng() % 64));
+			GLRadiosityEvaluator::Result res = evaluator.Evaluate(v);
+			GLRadiosityEvaluator::Result ref = evaluator.EvaluateReference(v);
+			maxValue = std::max({maxValue, ref.base.x, ref.base.y, ref.base.z});
+			const Vector3 pairs[][2] = {
+			  {res.base, ref.base}, {res.x, ref.x}, {res.y, ref.y}, {res.z, ref.z}};
+			for (const auto& pair : pairs) {
+				Vector3 diff = pair[0] - pair[1];
+				maxError = std::max({maxError, std::fabs(diff.x), std::fabs(diff.y),
+				                     std::fabs(diff.z)});
+				maxEncodedDistance =
+				  std::max(maxEncodedDistance, EncodedDistance(evaluator.EncodeValue(pair[0]),
+				                                               evaluator.EncodeValue(pair[1])));
+			}
+		}
+		std::printf("highPrecision=%d: max value %g, max error %g, max encoded difference %d\n",
+		            highPrecision ? 1 : 0, maxValue, maxError, maxEncodedDistance);
+		// make sure that the voxels actually gathered some light
+		SPADES_CHECK(maxValue > 0.0F);
+		SPADES_CHECK(maxError < 1.0e-4F);
+		SPADES_CHECK(maxEncodedDistance <= 1);
+	}
+
+	void TestAll() {
+		TestMatchesReference(false);
+		TestMatchesReference(true);
+	}
+} // namespace
+
+SPADES_TEST_MAIN(TestAll)
@@ -0,0 +1,87 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Testing.h"
+#include <Core/MiniHeap.h>
+
+using namespace spades;
+
+namespace {
+	/** Growing a full heap must always make room for the allocation. */
+	void TestGrowFullHeap() {
+		for (size_t initialSize = 1; initialSize <= 64; initialSize++) {
+			for (size_t bytes = 1; bytes <= 256; bytes++) {
+				MiniHeap heap{initialSize};
+				heap.Alloc(initialSize);
+				MiniHeap::Ref ref = heap.Alloc(bytes);
+				SPADES_CHECK(ref >= initialSize);
+				SPADES_CHECK(ref + bytes <= heap.GetSize());
+				SPADES_CHECK(heap.Validate());
+			}
+		}
+	}
+
+	/** Random allocations never overlap and freeing everything merges the heap again. */
+	void TestRandomAllocations() {
+		MiniHeap heap{16};
+		std::mt19937 rng{1};
+		std::vector<std::pair<MiniHeap::Ref, size_t>> allocations;
+
+		for (int i = 0; i < 20000; i++) {
+			if (allocations.empty() || rng() % 3 != 0) {
+				size_t bytes = 1 + rng() % (rng() % 8 == 0 ? 4096 : 64);
+				allocations.emplace_back(heap.Alloc(bytes), bytes);
+			} else {
+				size_t k = rng() % allocations.size();
+				heap.Free(allocations[k].first, allocations[k].second);
+				allocations[k] = allocations.back();
+				allocations.pop_back();
+			}
+		}
+		SPADES_CHECK(heap.Validate());
+
+		std::sort(allocations.begin(), allocations.end());
+		for (size_t i = 0; i < allocations.size(); i++) {
+			SPADES_CHECK(allocations[i].first + allocations[i].second <= heap.GetSize());
+			if (i + 1 < allocations.size())
+				SPADES_CHECK(allocations[i].first + allocations[i].second <=
+				             allocations[i + 1].first);
+		}
+
+		for (const auto& a : allocations)
+			heap.Free(a.first, a.second);
+		SPADES_CHECK(heap.Validate());
+		SPADES_CHECK(heap.GetNumFreeRegions() == 1);
+		SPADES_CHECK(heap.GetFreeBytes() == heap.GetSize());
+	}
+
+	void TestAll() {
+		TestGrowFullHeap();
+		TestRandomAllocations();
+	}
+} // namespace
+
+SPADES_TEST_MAIN(TestAll)
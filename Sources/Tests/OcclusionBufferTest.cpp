@@ -0,0 +1,92 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "Testing.h"
+#include <Client/GameMap.h>
+#include <Client/OcclusionBuffer.h>
+#include <Client/SceneDefinition.h>
+
+using namespace spades;
+using namespace spades::client;
+
+namespace {
+	/** Water with a 4 blocks thick wall across the view from `x` on, reaching up to `top`. */
+	Handle<GameMap> MakeMap(int x, int top) {
+		auto map = Handle<GameMap>::New();
+		const uint32_t color = 0x7F808080;
+		for (int cx = 0; cx < 256; cx++)
+			for (int cy = 0; cy < 256; cy++)
+				map->Set(cx, cy, 63, true, color, true);
+		for (int cx = x; cx < x + 4; cx++)
+			for (int cy = 0; cy < 256; cy++)
+				for (int z = top; z < 63; z++)
+					map->Set(cx, cy, z, true, color, true);
+		return map;
+	}
+
+	/** Looking along +X from above the water. */
+	SceneDefinition MakeView() {
+		SceneDefinition def;
+		def.fovY = DEG2RAD(68.0F);
+		def.fovX = DEG2RAD(90.0F);
+		def.zNear = 0.05F;
+		def.zFar = 128.0F;
+		def.viewOrigin = MakeVector3(90.0F, 130.0F, 60.0F);
+		def.viewAxis[0] = MakeVector3(0.0F, 1.0F, 0.0F);
+		def.viewAxis[1] = MakeVector3(0.0F, 0.0F, -1.0F);
+		def.viewAxis[2] = MakeVector3(1.0F, 0.0F, 0.0F);
+		return def;
+	}
+
+	/** A small model above the water behind the walls. */
+	const AABB3 modelBox{MakeVector3(129.0F, 129.0F, 56.0F), MakeVector3(131.0F, 131.0F, 59.0F)};
+
+	void TestWallHidesReflection() {
+		// the wall is between the eye and the water in front of the model,
+		// so both the model and its reflection are hidden
+		auto map = MakeMap(100, 57);
+		OcclusionBuffer buffer;
+		buffer.Build(*map, MakeView());
+		SPADES_CHECK(buffer.IsOccluded(modelBox));
+		SPADES_CHECK(buffer.IsOccludedWithReflection(modelBox));
+
+		// the eye sees over the wall
+		SPADES_CHECK(!buffer.IsOccluded(
+		  AABB3{MakeVector3(129.0F, 129.0F, 40.0F), MakeVector3(131.0F, 131.0F, 43.0F)}));
+	}
+
+	void TestReflectionInFrontOfWall() {
+		// the model is behind the wall, but its reflection is seen on the
+		// water between the eye and the wall
+		auto map = MakeMap(120, 40);
+		OcclusionBuffer buffer;
+		buffer.Build(*map, MakeView());
+		SPADES_CHECK(buffer.IsOccluded(modelBox));
+		SPADES_CHECK(!buffer.IsOccludedWithReflection(modelBox));
+	}
+
+	void TestAll() {
+		TestWallHidesReflection();
+		TestReflectionInFrontOfWall();
+	}
+} // namespace
+
+SPADES_TEST_MAIN(TestAll)
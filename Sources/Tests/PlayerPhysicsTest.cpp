@@ -0,0 +1,238 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Testing.h"
+#include <Client/GameMap.h>
+#include <Client/GameProperties.h>
+#include <Client/IWorldListener.h>
+#include <Client/Player.h>
+#include <Client/World.h>
+#include <Core/Settings.h>
+
+SPADES_SETTING(cg_batchPlayerPhysics);
+
+using namespace spades;
+using namespace spades::client;
+
+namespace {
+	constexpr int NumPlayers = 24;
+	constexpr int NumTicks = 600;
+	constexpr int AreaMin = 200, AreaMax = 232;
+
+	/**
+	 * Records the events fired by the player movement and the tools in the
+	 * order they happen, with the position of every player whenever a tool
+	 * fires. The hit scan results depend on the random weapon spread, so
+	 * they are not recorded.
+	 */
+	class EventRecorder : public IWorldListener {
+		World& world;
+
+		void Record(const char* name, Player& p) {
+			char buf[64];
+			std::snprintf(buf, sizeof(buf), "%d %s %d", tick, name, p.GetId());
+			events.push_back(buf);
+		}
+
+		void RecordPositions() {
+			for (std::size_t i = 0; i < world.GetNumPlayerSlots(); i++) {
+				auto p = world.GetPlayer(static_cast<unsigned int>(i));
+				if (!p)
+					continue;
+				Vector3 pos = p->GetPosition();
+				char buf[128];
+				std::snprintf(buf, sizeof(buf), "  %d at %a %a %a", static_cast<int>(i), pos.x, pos.y,
+				              pos.z);
+				events.push_back(buf);
+			}
+		}
+
+	public:
+		std::vector<std::string> events;
+		int tick = 0;
+
+		EventRecorder(World& world) : world(world) {}
+
+		void PlayerObjectSet(int) override {}
+		void PlayerMadeFootstep(Player& p) override { Record("footstep", p); }
+		void PlayerJumped(Player& p) override { Record("jumped", p); }
+		void PlayerLanded(Player& p, bool hurt) override {
+			Record(hurt ? "landed hard" : "landed", p);
+		}
+		void PlayerFiredWeapon(Player& p) override {
+			Record("fired", p);
+			RecordPositions();
+		}
+		void PlayerEjectedBrass(Player& p) override { Record("ejected brass", p); }
+		void PlayerDryFiredWeapon(Player& p) override { Record("dry fired", p); }
+		void PlayerReloadingWeapon(Player& p) override { Record("reloading", p); }
+		void PlayerReloadedWeapon(Player& p) override { Record("reloaded", p); }
+		void PlayerChangedTool(Player& p) override { Record("changed tool", p); }
+		void PlayerPulledGrenadePin(Player& p) override { Record("pulled pin", p); }
+		void PlayerThrewGrenade(Player& p, stmp::optional<const Grenade&>) override {
+			Record("threw grenade", p);
+		}
+		void PlayerMissedSpade(Player& p) override {
+			Record("missed spade", p);
+			RecordPositions();
+		}
+		void PlayerHitBlockWithSpade(Player& p, Vector3, IntVector3, IntVector3) override {
+			Record("spaded block", p);
+		}
+		void PlayerKilledPlayer(Player&, Player&, KillType) override {}
+		void PlayerRestocked(Player& p) override { Record("restocked", p); }
+		void BulletHitPlayer(Player&, HitType, Vector3, Player&,
+		                     std::unique_ptr<IBulletHitScanState>&) override {}
+		void BulletNearPlayer(Player&) override {}
+		void BulletHitBlock(Vector3, IntVector3, IntVector3) override {}
+		void AddBulletTracer(Player&, Vector3, Vector3) override {}
+		void GrenadeExploded(const Grenade&) override {}
+		void GrenadeBounced(const Grenade&) override {}
+		void GrenadeDroppedIntoWater(const Grenade&) override {}
+		void BlocksFell(std::vector<IntVector3>) override {}
+		void LocalPlayerBlockAction(IntVector3, BlockActionType) override {}
+		void LocalPlayerCreatedLineBlock(IntVector3, IntVector3) override {}
+		void LocalPlayerHurt(HurtType, Vector3) override {}
+		void LocalPlayerBuildError(BuildFailureReason) override {}
+	};
+
+	/** Flat ground with steps and walls to climb and run into. */
+	Handle<GameMap> MakeTerrain() {
+		auto map = Handle<GameMap>::New();
+		std::mt19937 rng{42};
+		const uint32_t color = 0x7F808080;
+		for (int x = AreaMin - 8; x < AreaMax + 8; x++) {
+			for (int y = AreaMin - 8; y < AreaMax + 8; y++) {
+				int top = 60;
+				if (rng() % 6 == 0)
+					top -= 1 + static_cast<int>(rng() % 3);
+				for (int z = top; z < GameMap::DefaultDepth; z++)
+					map->Set(x, y, z, true, color, true);
+			}
+		}
+		return map;
+	}
+
+	/** Runs the same scripted match and returns the recorded events. */
+	std::vector<std::string> RunMatch(bool batched, uint64_t& stateHash) {
+		cg_batchPlayerPhysics = batched ? 1 : 0;
+
+		auto properties = std::make_shared<GameProperties>(ProtocolVersion::v075);
+		World world{properties};
+		world.SetMap(MakeTerrain());
+
+		EventRecorder recorder{world};
+		world.SetListener(&recorder);
+
+		std::mt19937 rng{1234};
+		auto uniform = [&](float a, float b) {
+			return std::uniform_real_distribution<float>{a, b}(rng);
+		};
+
+		for (int i = 0; i < NumPlayers; i++) {
+			auto weapon = static_cast<WeaponType>(i % 3);
+			auto player = stmp::make_unique<Player>(world, i, weapon, i % 2);
+			player->SetPosition(MakeVector3(uniform(AreaMin, AreaMax), uniform(AreaMin, AreaMax),
+			                                uniform(50.0F, 57.0F)));
+			world.SetPlayer(i, std::move(player));
+		}
+		world.SetLocalPlayerIndex(0);
+
+		// some corpses among the living
+		for (int i = NumPlayers - 3; i < NumPlayers; i++)
+			world.GetPlayer(i)->KilledBy(KillTypeWeapon, *world.GetPlayer(0), 100);
+
+		for (int tick = 0; tick < NumTicks; tick++) {
+			recorder.tick = tick;
+			for (int i = 0; i < NumPlayers; i++) {
+				Player& p = *world.GetPlayer(i);
+				unsigned int bits = rng();
+				if (tick % 30 == 0 || (bits & 0xF) == 0) {
+					PlayerInput input;
+					input.moveForward = (bits >> 4) % 3 == 0;
+					input.moveBackward = (bits >> 4) % 3 == 1;
+					input.moveLeft = (bits >> 6) % 4 == 0;
+					input.moveRight = (bits >> 6) % 4 == 1;
+					input.jump = (bits >> 8) % 5 == 0;
+					input.crouch = (bits >> 11) % 7 == 0;
+					input.sprint = (bits >> 14) % 3 == 0;
+					input.sneak = (bits >> 16) % 9 == 0;
+					p.SetInput(input);
+
+					WeaponInput weaponInput;
+					weaponInput.primary = (bits >> 19) % 4 == 0;
+					weaponInput.secondary = (bits >> 21) % 5 == 0;
+					p.SetWeaponInput(weaponInput);
+
+					float yaw = uniform(-3.14F, 3.14F), pitch = uniform(-0.8F, 0.8F);
+					p.SetOrientation(MakeVector3(cosf(yaw) * cosf(pitch),
+					                             sinf(yaw) * cosf(pitch), sinf(pitch)));
+				}
+				if (tick == NumTicks / 2 && i % 4 == 1)
+					p.SetTool(Player::ToolSpade);
+			}
+			world.Advance(WorldTimeStep);
+		}
+
+		stateHash = world.GetStateHash();
+		world.SetListener(nullptr);
+		return std::move(recorder.events);
+	}
+
+	void TestBatchedMatchesPerPlayer() {
+		uint64_t perPlayerHash, batchedHash;
+		std::vector<std::string> perPlayer = RunMatch(false, perPlayerHash);
+		std::vector<std::string> batched = RunMatch(true, batchedHash);
+
+		SPADES_CHECK(perPlayerHash == batchedHash);
+		SPADES_CHECK(perPlayer.size() == batched.size());
+		for (std::size_t i = 0; i < std::min(perPlayer.size(), batched.size()); i++) {
+			if (perPlayer[i] != batched[i]) {
+				std::fprintf(stderr, "event %zu differs:\n  per-player: %s\n  batched:    %s\n", i,
+				             perPlayer[i].c_str(), batched[i].c_str());
+				SPADES_CHECK(perPlayer[i] == batched[i]);
+				break;
+			}
+		}
+
+		// make sure the scripted match exercises the paths compared above
+		auto count = [&](const char* name) {
+			std::size_t n = 0;
+			for (const auto& e : perPlayer)
+				n += e.find(name) != std::string::npos ? 1 : 0;
+			return n;
+		};
+		SPADES_CHECK(count(" jumped ") > 0);
+		SPADES_CHECK(count(" landed") > 0);
+		SPADES_CHECK(count(" footstep ") > 0);
+		SPADES_CHECK(count(" fired ") > 0);
+	}
+} // namespace
+
+SPADES_TEST_MAIN(TestBatchedMatchesPerPlayer)
@@ -0,0 +1,56 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <cstdio>
+
+/**
+ * Minimal helpers for the unit tests. Each test is a separate executable
+ * run by CTest, which fails if `main` returns a nonzero value.
+ */
+namespace spades {
+	namespace test {
+		extern int numFailures;
+	} // namespace test
+} // namespace spades
+
+/** Reports a failure (without stopping the test) if `cond` doesn't hold. */
+#define SPADES_CHECK(cond)                                                                     \
+	do {                                                                                       \
+		if (!(cond)) {                                                                         \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+			++::spades::test::numFailures;                                                     \
+		}                                                                                      \
+	} while (0)
+
+/** Defines `numFailures` and `main`, which runs `body` and reports the result. */
+#define SPADES_TEST_MAIN(body)                                                                 \
+	int spades::test::numFailures = 0;                                                         \
+	int main() {                                                                               \
+		body();                                                                                \
+		if (::spades::test::numFailures > 0) {                                                 \
+			std::fprintf(stderr, "%d check(s) failed\n", ::spades::test::numFailures);         \
+			return 1;                                                                          \
+		}                                                                                      \
+		std::printf("all checks passed\n");                                                    \
+		return 0;                                                                              \
+	}
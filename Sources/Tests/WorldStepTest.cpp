@@ -0,0 +1,162 @@
+/*
+ Copyright (c) 2026 Francois ND
+ based on code of OpenSpades (c) yvt 2013.
+
+ This file is part of ZeroSpades, a fork of OpenSpades.
+
+ ZeroSpades is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ZeroSpades is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ZeroSpades.	 If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+
+#include "Testing.h"
+#include <Client/GameMap.h>
+#include <Client/GameProperties.h>
+#include <Client/Player.h>
+#include <Client/World.h>
+#include <Core/Settings.h>
+
+SPADES_SETTING(cg_interpolateWorld);
+
+using namespace spades;
+using namespace spades::client;
+
+namespace {
+	constexpr int NumPlayers = 8;
+	constexpr int NumSteps = 480;
+	constexpr int StepsPerInput = 20;
+
+	std::unique_ptr<World> MakeWorld() {
+		auto map = Handle<GameMap>::New();
+		const uint32_t color = 0x7F808080;
+		for (int x = 192; x < 240; x++)
+			for (int y = 192; y < 240; y++)
+				for (int z = (x + y) % 9 == 0 ? 59 : 60; z < GameMap::DefaultDepth; z++)
+					map->Set(x, y, z, true, color, true);
+
+		auto properties = std::make_shared<GameProperties>(ProtocolVersion::v075);
+		auto world = stmp::make_unique<World>(properties);
+		world->SetMap(map);
+
+		for (int i = 0; i < NumPlayers; i++) {
+			auto player = stmp::make_unique<Player>(*world, i, RIFLE_WEAPON, i % 2);
+			player->SetPosition(MakeVector3(200.0F + i * 4.0F, 216.0F, 55.0F));
+			world->SetPlayer(i, std::move(player));
+		}
+		world->SetLocalPlayerIndex(0);
+		return world;
+	}
+
+	/** Sets the inputs used from the step `step` on. */
+	void SetInputs(World& world, int step) {
+		std::mt19937 rng{static_cast<unsigned int>(step)};
+		for (int i = 0; i < NumPlayers; i++) {
+			unsigned int bits = rng();
+			PlayerInput input;
+			input.moveForward = (bits & 3) != 0;
+			input.moveLeft = (bits >> 2) % 3 == 0;
+			input.moveRight = (bits >> 2) % 3 == 1;
+			input.jump = (bits >> 4) % 3 == 0;
+			input.crouch = (bits >> 6) % 5 == 0;
+			input.sprint = (bits >> 8) % 2 == 0;
+			world.GetPlayer(i)->SetInput(input);
+
+			float yaw = static_cast<float>(bits >> 16) / 65536.0F * 6.28F;
+			world.GetPlayer(i)->SetOrientation(MakeVector3(cosf(yaw), sinf(yaw), 0.0F));
+		}
+	}
+
+	/** Runs `NumSteps` steps of `Advance` directly. */
+	uint64_t RunReference() {
+		auto world = MakeWorld();
+		for (int step = 0; step < NumSteps; step++) {
+			if (step % StepsPerInput == 0)
+				SetInputs(*world, step);
+			world->Advance(WorldTimeStep);
+		}
+		return world->GetStateHash();
+	}
+
+	/**
+	 * Runs `NumSteps` steps through `AdvanceFixed` with frame times from
+	 * `nextFrameTime`, which must not exceed `WorldTimeStep` so that the
+	 * inputs can be set between the same steps as in `RunReference`.
+	 */
+	uint64_t RunFrames(const std::function<float()>& nextFrameTime) {
+		auto world = MakeWorld();
+		int step = 0;
+		SetInputs(*world, step);
+		while (step < NumSteps) {
+			int numSteps = world->AdvanceFixed(nextFrameTime());
+			SPADES_CHECK(numSteps <= 1);
+			SPADES_CHECK(world->GetInterpolationFactor() >= 0.0F);
+			SPADES_CHECK(world->GetInterpolationFactor() <= 1.0F);
+			step += numSteps;
+			if (numSteps > 0 && step < NumSteps && step % StepsPerInput == 0)
+				SetInputs(*world, step);
+		}
+		return world->GetStateHash();
+	}
+
+	void TestFrameRateIndependence() {
+		uint64_t reference = RunReference();
+
+		SPADES_CHECK(RunFrames([] { return WorldTimeStep; }) == reference);
+		SPADES_CHECK(RunFrames([] { return 1.0F / 144.0F; }) == reference);
+		SPADES_CHECK(RunFrames([] { return 1.0F / 75.0F; }) == reference);
+
+		std::mt19937 rng{7};
+		std::uniform_real_distribution<float> frameTime{0.001F, WorldTimeStep};
+		SPADES_CHECK(RunFrames([&] { return frameTime(rng); }) == reference);
+	}
+
+	void TestInterpolation() {
+		cg_interpolateWorld = 1;
+
+		auto world = MakeWorld();
+		Player& other = *world->GetPlayer(1);
+		PlayerInput input;
+		input.moveForward = true;
+		other.SetInput(input);
+		world->AdvanceFixed(WorldTimeStep * 10.5F);
+		SPADES_CHECK(std::fabs(world->GetInterpolationFactor() - 0.5F) < 0.01F);
+
+		// the local player isn't interpolated so that the camera doesn't lag
+		Player& local = world->GetLocalPlayer().value();
+		SPADES_CHECK(local.GetEye(true) == local.GetEye());
+
+		// the others are drawn between their last two states
+		Vector3 eye = other.GetEye();
+		Vector3 interpolated = other.GetEye(true);
+		SPADES_CHECK((interpolated - eye).GetLength() > 0.0F);
+		SPADES_CHECK((interpolated - eye).GetLength() < 0.5F);
+
+		cg_interpolateWorld = 0;
+		SPADES_CHECK(world->GetInterpolationFactor() == 1.0F);
+		SPADES_CHECK(other.GetEye(true) == other.GetEye());
+		cg_interpolateWorld = 1;
+	}
+
+	void TestAll() {
+		TestFrameRateIndependence();
+		TestInterpolation();
+	}
+} // namespace
+
+SPADES_TEST_MAIN(TestAll)